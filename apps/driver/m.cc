@@ -6,6 +6,7 @@
 #include "clib/array.h"
 #include "clib/object.h"
 #include "clib/util.h"
+#include "clib/thread.h"
 #include "clib/string.h"
 #include "compiler/compiler.h"
 #include "compiler/ld.h"
@@ -20,10 +21,51 @@ extern int optind, opterr, optopt;
 
 void print_usage()
 {
-    printf("m usage: m -o output file -f ir|bc|ob src file\n");
+    printf("m usage: m -o output file -f ir|bc|ob -j workers src files\n");
+    printf("  m [-C dir] without source files starts the repl\n");
+    printf("  -j N compiles source files on N workers, 0 uses all hardware threads, default 1\n");
+    printf("  -C dir keeps compiled files in the cache dir and skips sources that did not change,\n");
+    printf("        the repl keeps the objects its jit compiled there\n");
+    printf("  -time-report prints time, allocations and token/node/type counts of each compile phase\n");
+    printf("  -O0|-O1|-O2|-O3|-Os optimization level of the native code, default -O2\n");
+    printf("  -march=cpu generates code for the cpu, native for the host cpu, default generic\n");
+    printf("  -mattr=features enables or disables cpu features, e.g. +avx2,-fma\n");
+    printf("  -flto links the bitcode of the source files and of bitcode inputs, e.g. from clang -flto,\n");
+    printf("        into one module optimized as a whole, -c -o names its object file\n");
+    printf("  inputs other than .m files are passed to the linker\n");
     exit(2);
 }
 
+//removes the long option from argv so that getopt does not take it as a group of short options
+bool _take_long_option(int *argc, char *argv[], const char *option)
+{
+    for (int i = 1; i < *argc; i++) {
+        if (strcmp(argv[i], option) && !(argv[i][0] == '-' && !strcmp(argv[i] + 1, option)))
+            continue;
+        for (int j = i; j < *argc - 1; j++)
+            argv[j] = argv[j + 1];
+        (*argc)--;
+        return true;
+    }
+    return false;
+}
+
+//removes the long option with a value, e.g. -march=native, returns the value or 0 if it is not given
+const char *_take_long_option_value(int *argc, char *argv[], const char *option)
+{
+    size_t len = strlen(option);
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], option, len))
+            continue;
+        const char *value = argv[i] + len;
+        for (int j = i; j < *argc - 1; j++)
+            argv[j] = argv[j + 1];
+        (*argc)--;
+        return value;
+    }
+    return 0;
+}
+
 const char * ld_exe_cmd = "ld.lld -pie -z relro --hash-style=gnu --build-id --eh-frame-hdr -m elf_x86_64 -dynamic-linker /lib64/ld-linux-x86-64.so.2 /lib/x86_64-linux-gnu/Scrt1.o /lib/x86_64-linux-gnu/crti.o /usr/bin/../lib/gcc/x86_64-linux-gnu/11/crtbeginS.o -L/usr/bin/../lib/gcc/x86_64-linux-gnu/11 -L/usr/bin/../lib/gcc/x86_64-linux-gnu/11/../../../../lib64 -L/lib/x86_64-linux-gnu -L/lib/../lib64 -L/usr/lib/x86_64-linux-gnu -L/usr/lib/../lib64 -L/usr/lib/llvm-18/bin/../lib -L/lib -L/usr/lib -lgcc --as-needed -lgcc_s --no-as-needed -lc -lgcc --as-needed -lgcc_s --no-as-needed /usr/bin/../lib/gcc/x86_64-linux-gnu/11/crtendS.o /lib/x86_64-linux-gnu/crtn.o";
 
 int main(int argc, char *argv[])
@@ -35,13 +77,25 @@ int main(int argc, char *argv[])
     struct array src_files;
     array_init(&src_files, sizeof(char *));
     struct array obj_files;
-    array_init(&obj_files, sizeof(char *));
+    array_init_free(&obj_files, sizeof(string), string_free_generic);
     bool is_compiler_front_end = false;
     string link_cmd;
     string_init_chars(&link_cmd, ld_exe_cmd);
     char *output_filepath = 0;
     string sys_path;
     string_init(&sys_path);
+    unsigned int workers = 1;
+    const char *cache_dir = 0;
+    bool time_report = _take_long_option(&argc, argv, "-time-report");
+    bool lto = _take_long_option(&argc, argv, "-flto");
+    struct llvm_target_options target;
+    llvm_target_options_init(&target);
+    const char *cpu = _take_long_option_value(&argc, argv, "-march=");
+    const char *features = _take_long_option_value(&argc, argv, "-mattr=");
+    if (cpu)
+        target.cpu = cpu;
+    if (features)
+        target.features = features;
 #ifdef __APPLE__
     const char *ld_cmd = "ld64.lld.darwinnew";
     const char *finalization = "-lSystem";
@@ -60,7 +114,7 @@ int main(int argc, char *argv[])
      * ':' indicating this option has argument value: optarg
      * 
      */
-    while ((c = getopt(argc, argv, "cf:o:s:")) != -1) {
+    while ((c = getopt(argc, argv, "cf:o:s:j:C:O:")) != -1) {
         switch (c) {
         case 'f': {
             if (strcmp(optarg, "bc") == 0)
@@ -96,45 +150,168 @@ int main(int argc, char *argv[])
             string_add_chars(&sys_path, optarg);
             break;
         }
+        case 'j':{
+            int n = atoi(optarg);
+            if (n < 0)
+                print_usage();
+            workers = n ? (unsigned int)n : thread_hardware_concurrency();
+            break;
+        }
+        case 'C':{
+            cache_dir = optarg;
+            break;
+        }
+        case 'O':{
+            if (!parse_opt_level(optarg, &target.opt_level))
+                print_usage();
+            break;
+        }
         case '?':
         default:
             abort();
         }
     }
+    //objects and bitcode are not compiled, they are linked with the objects of the source files
+    struct array link_files;
+    array_init(&link_files, sizeof(char *));
     for(; optind < argc; optind++){     
-        array_push_ptr(&src_files, argv[optind]);
+        const char *ext = strrchr(argv[optind], '.');
+        array_push_ptr(ext && !strcmp(ext, ".m") ? &src_files : &link_files, argv[optind]);
     }
+    //lto applies to native objects only, -f ir or bc writes the files of the modules as is
+    lto = lto && file_type == FT_OBJECT;
+    target.lto = lto;
     int result = 0;
     if (!array_size(&src_files)) {
+        //without source files m starts the repl, -C keeps its compiled objects across sessions
         printf("%s\n", engine_version());
-        print_usage();
-        //result = run_repl();
+        app_init();
+        result = run_repl(string_get(&sys_path), cache_dir);
+        app_deinit();
     } else {
         if (!file_type)
             file_type = FT_OBJECT;
         app_init();
         printf("sys_path: %s\n", string_get(&sys_path));
-        for (size_t i = 0; i < array_size(&src_files); i++) {
+        size_t job_count = array_size(&src_files);
+        //-o names the object file only when a single file is compiled without linking
+        bool output_is_object = output_filepath && is_compiler_front_end && job_count == 1 && !lto;
+        struct compile_cache cache;
+        struct array jobs;
+        array_init(&jobs, sizeof(struct compile_job));
+        for (size_t i = 0; i < job_count; i++) {
             const char *fn = (const char *)array_get_ptr(&src_files, i);
             if (access(fn, F_OK) == -1) {
                 printf("file: %s does not exist\n", fn);
                 exit(1);
             }
-            printf("compiling %s -> %s\n", fn, output_filepath);
-            result = compile(string_get(&sys_path), fn, file_type, output_filepath);
-            char *basename = get_basename((char *)fn);
-            char *obj_name = strcat(basename, ".o");
+            string obj_name;
+            string_init_chars(&obj_name, fn);
+            string_substr(&obj_name, '.');
+            string_add_chars(&obj_name, lto ? ".bc" : ".o");
+            array_push(&obj_files, &obj_name);
+            struct compile_job job;
+            job.source_file = fn;
+            job.output_filepath = output_is_object ? output_filepath : 0;
+            job.file_type = lto ? FT_BITCODE : file_type;
+            job.target = &target;
+            job.cache = cache_dir ? &cache : 0;
+            job.result = 0;
+            array_push(&jobs, &job);
+        }
+        u64 start = get_time_ns();
+        struct sys_prelude prelude;
+        sys_prelude_init(&prelude, string_get(&sys_path));
+        if (cache_dir) {
+            compile_cache_init(&cache, cache_dir, &prelude);
+            //native is keyed by the host cpu so that a cache shared by machines tells them apart
+            char *host_cpu = strcmp(target.cpu, "native") ? 0 : LLVMGetHostCPUName();
+            char options[256];
+            snprintf(options, sizeof(options), "-O%d -march=%s -mattr=%s%s", target.opt_level, host_cpu ? host_cpu : target.cpu, target.features, lto ? " -flto" : "");
+            compile_cache_add_options(&cache, options);
+            if (host_cpu)
+                LLVMDisposeMessage(host_cpu);
+        }
+        u64 prelude_ns = get_time_ns() - start;
+        start = get_time_ns();
+        int failed = compile_jobs(&prelude, (struct compile_job *)array_get(&jobs, 0), job_count, workers);
+        u64 compile_ns = get_time_ns() - start;
+        sys_prelude_deinit(&prelude);
+        struct time_report total;
+        time_report_init(&total);
+        for (size_t i = 0; i < job_count; i++) {
+            struct compile_job *job = (struct compile_job *)array_get(&jobs, i);
+            printf("compiled %s: %s\n", job->source_file, job->result ? "failed" : (job->cached ? "cached" : "ok"));
+            time_report_add(&total, &job->time_report);
+            if (lto)
+                continue;
+            string *obj_name = (string *)array_get(&obj_files, i);
+            string_add_chars(&link_cmd, " ");
+            string_add_chars(&link_cmd, output_is_object ? output_filepath : string_get(obj_name));
+        }
+        u64 lto_ns = 0;
+        if (lto && !failed) {
+            //the bitcode of the modules and the bitcode inputs go to one object, the other inputs to the linker
+            struct array bitcode_files;
+            array_init(&bitcode_files, sizeof(char *));
+            for (size_t i = 0; i < job_count; i++)
+                array_push_ptr(&bitcode_files, (char *)string_get((string *)array_get(&obj_files, i)));
+            for (size_t i = 0; i < array_size(&link_files); i++) {
+                char *fn = (char *)array_get_ptr(&link_files, i);
+                if (is_bitcode_file(fn))
+                    array_push_ptr(&bitcode_files, fn);
+            }
+            string lto_obj;
+            if (is_compiler_front_end && output_filepath) {
+                string_init_chars(&lto_obj, output_filepath);
+            } else {
+                string_init_chars(&lto_obj, (const char *)array_get_ptr(&src_files, 0));
+                string_substr(&lto_obj, '.');
+                string_add_chars(&lto_obj, ".lto.o");
+            }
+            start = get_time_ns();
+            failed = link_time_optimize((const char **)array_get(&bitcode_files, 0), array_size(&bitcode_files), &target, string_get(&lto_obj));
+            lto_ns = get_time_ns() - start;
+            printf("link time optimized %zu modules: %s\n", array_size(&bitcode_files), failed ? "failed" : "ok");
             string_add_chars(&link_cmd, " ");
-            string_add_chars(&link_cmd, obj_name);
+            string_add_chars(&link_cmd, string_get(&lto_obj));
+            string_deinit(&lto_obj);
+            array_deinit(&bitcode_files);
+        }
+        for (size_t i = 0; i < array_size(&link_files); i++) {
+            char *fn = (char *)array_get_ptr(&link_files, i);
+            if (lto && is_bitcode_file(fn))
+                continue;
+            string_add_chars(&link_cmd, " ");
+            string_add_chars(&link_cmd, fn);
+        }
+        if (time_report) {
+            printf("time report, summed over %zu files on %u workers:\n", job_count, workers);
+            time_report_print(&total, stdout);
+            printf("read prelude: %.3f ms\n", prelude_ns / 1e6);
+            printf("compile wall time: %.3f ms\n", compile_ns / 1e6);
+            if (lto)
+                printf("link time optimization: %.3f ms\n", lto_ns / 1e6);
+        }
+        if (cache_dir) {
+            printf("cache %s: %zu hits, %zu misses, %zu stored\n", cache_dir, cache.hits, cache.misses, cache.stores);
+            compile_cache_deinit(&cache);
         }
+        result = failed ? 1 : 0;
+        array_deinit(&jobs);
         app_deinit();
     }
     // do linker
-    if (file_type == FT_OBJECT && !is_compiler_front_end) {
+    if (array_size(&src_files) && file_type == FT_OBJECT && !is_compiler_front_end && !result) {
         printf("linking %s\n", string_get(&link_cmd));
+        u64 start = get_time_ns();
         result = system(string_get(&link_cmd));
+        if (time_report)
+            printf("link: %.3f ms\n", (get_time_ns() - start) / 1e6);
     }
     array_deinit(&src_files);
+    array_deinit(&link_files);
+    array_deinit(&obj_files);
     string_deinit(&link_cmd);
     string_deinit(&sys_path);
     return result;
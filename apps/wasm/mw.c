@@ -3,8 +3,10 @@
 #include "clib/string.h"
 #include "compiler/engine.h"
 #include "codegen/wasm/cg_wasm.h"
+#include "codegen/wasm/wasm_pass.h"
 #include "lexer/lexer.h"
 #include "app/app.h"
+#include "app/time_report.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -17,31 +19,59 @@ const char *version(void)
 }
 
 u32 code_size = 0;
+//the engine keeps the analyzed prelude and is reused for every compile request
+static struct engine *engine = 0;
+static bool app_initialized = false;
 
-u8 *compile_code(const char *text)
+void _ensure_app_init(void)
 {
+    if (app_initialized)
+        return;
     app_init();
-    struct engine *engine = engine_wasm_new();
+    app_initialized = true;
+}
+
+void _ensure_engine(void)
+{
+    _ensure_app_init();
+    if (!engine)
+        engine = engine_wasm_new();
+}
+
+void set_opt_level(u32 level)
+{
+    _ensure_engine();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg->opt_level = level < WASM_OPT_LEVEL_MAX ? level : WASM_OPT_LEVEL_MAX;
+}
+
+void set_target_features(u32 features)
+{
+    _ensure_engine();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg->target_features = features;
+}
+
+u8 *compile_code(const char *text)
+{
+    _ensure_engine();
     struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
     compile_to_wasm(engine, text);
     u8 *data = cg->ba.data;
     code_size = cg->ba.size;
     cg->ba.data = 0;
     free((void *)text);
-    engine_free(engine);
-    app_deinit();
     return data;
 } 
 
 u8 *highlight_code(const char *text)
 {
-    app_init();
+    _ensure_app_init();
     struct frontend *fe = frontend_init();
     struct lexer * lexer = lexer_new_with_string(text);
     const char *highlighted = highlight(lexer, text);
     lexer_free(lexer);
     frontend_deinit(fe);
-    app_deinit();
     return (u8*)highlighted;
 }
 
@@ -49,3 +79,18 @@ u32 get_code_size(void)
 {
     return code_size;
 }
+
+struct time_report *get_time_report(void)
+{
+    return engine ? &engine->time_report : 0;
+}
+
+u32 get_phase_count(void)
+{
+    return PHASE_COUNT;
+}
+
+const char *get_phase_name(u32 phase)
+{
+    return compile_phase_name(phase);
+}
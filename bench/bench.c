@@ -0,0 +1,130 @@
+/*
+ * bench.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * compiler benchmark driver, usage: mbench [-json] [benchmark name filter]
+ * -json prints all results as one json document instead of the table, so runs on different
+ * commits can be compared by bench name and metric
+ */
+#include "bench.h"
+#include "app/app.h"
+#include "compiler/engine.h"
+#include "clib/array.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+void bench_lexer_throughput(void);
+void bench_lexer_dfa(void);
+void bench_hashtable_ops(void);
+void bench_hash_quality(void);
+void bench_hash_throughput(void);
+void bench_parser_arena(void);
+void bench_parser_load_vs_parse(void);
+void bench_engine_empty_program(void);
+void bench_compiler_throughput(void);
+void bench_runtime_corpus(void);
+void bench_runtime_lto(void);
+void bench_wasm_emit_throughput(void);
+void bench_tier_latency(void);
+
+static struct bench benches[] = {
+    { "lexer_throughput", bench_lexer_throughput },
+    { "lexer_dfa", bench_lexer_dfa },
+    { "hashtable", bench_hashtable_ops },
+    { "hash_quality", bench_hash_quality },
+    { "hash_throughput", bench_hash_throughput },
+    { "parser_arena", bench_parser_arena },
+    { "parser_load_vs_parse", bench_parser_load_vs_parse },
+    { "engine_empty_program", bench_engine_empty_program },
+    { "compiler_throughput", bench_compiler_throughput },
+    { "runtime", bench_runtime_corpus },
+    { "runtime_lto", bench_runtime_lto },
+    { "wasm_emit", bench_wasm_emit_throughput },
+    { "tier_latency", bench_tier_latency },
+};
+
+struct bench_result {
+    const char *bench_name;
+    char metric[128];
+    double value;
+    const char *unit;
+};
+
+//results collected for the json output, 0 when printing the table
+static struct array *json_results = 0;
+
+u64 bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+void bench_report(const char *bench_name, const char *metric, double value, const char *unit)
+{
+    if (!json_results) {
+        printf("%-32s %-40s %12.2f %s\n", bench_name, metric, value, unit);
+        return;
+    }
+    struct bench_result result;
+    result.bench_name = bench_name;
+    snprintf(result.metric, sizeof(result.metric), "%s", metric);
+    result.value = value;
+    result.unit = unit;
+    array_push(json_results, &result);
+}
+
+static void _print_json_string(const char *str)
+{
+    putchar('"');
+    for (; *str; str++) {
+        if (*str == '"' || *str == '\\')
+            putchar('\\');
+        putchar(*str);
+    }
+    putchar('"');
+}
+
+static void _print_json(struct array *results)
+{
+    printf("{\n  \"version\": ");
+    _print_json_string(engine_version());
+    printf(",\n  \"results\": [");
+    for (u32 i = 0; i < array_size(results); i++) {
+        struct bench_result *result = array_get(results, i);
+        printf("%s\n    {\"bench\": ", i ? "," : "");
+        _print_json_string(result->bench_name);
+        printf(", \"metric\": ");
+        _print_json_string(result->metric);
+        printf(", \"value\": %.6g, \"unit\": ", result->value);
+        _print_json_string(result->unit);
+        printf("}");
+    }
+    printf("\n  ]\n}\n");
+}
+
+int main(int argc, char **argv)
+{
+    struct array results;
+    int arg = 1;
+    if (arg < argc && !strcmp(argv[arg], "-json")) {
+        array_init(&results, sizeof(struct bench_result));
+        json_results = &results;
+        arg++;
+    }
+    const char *filter = arg < argc ? argv[arg] : 0;
+    app_init();
+    for (size_t i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        if (filter && !strstr(benches[i].name, filter))
+            continue;
+        benches[i].run();
+    }
+    if (json_results) {
+        _print_json(json_results);
+        array_deinit(json_results);
+    }
+    app_deinit();
+    return 0;
+}
@@ -0,0 +1,35 @@
+/*
+ * bench.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for compiler benchmarks
+ */
+#ifndef __MLANG_BENCH_H__
+#define __MLANG_BENCH_H__
+
+#include "clib/typedef.h"
+#include "clib/string.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MB (1024.0 * 1024.0)
+
+struct bench {
+    const char *name;
+    void (*run)(void);
+};
+
+#define BENCH(MODULE, FUNC) void MODULE##_##FUNC(void)
+
+u64 bench_now_ns(void);
+void bench_report(const char *bench_name, const char *metric, double value, const char *unit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * bench_hash.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * hash function benchmarks: collision quality on symbol, identifier and pointer key sets,
+ * and throughput by key length, compared with the previous byte-at-a-time hash
+ */
+#include "bench.h"
+#include "clib/hash.h"
+#include "clib/util.h"
+#include <ctype.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_SOURCE_DIR
+#define M_SOURCE_DIR "."
+#endif
+
+//the previous hash function from Donald E. Knuth, The Art of Computer Programming Vol 3
+static unsigned int _knuth_hash(unsigned char *data, size_t len)
+{
+    unsigned hash = (unsigned)len;
+    for (size_t i = 0; i < len; ++i) {
+        hash = ((hash << 5) ^ (hash >> 27)) ^ data[i];
+    }
+    return hash;
+}
+
+struct key_set {
+    const char *name;
+    unsigned char *keys; //key_size bytes per key
+    size_t *lens;
+    size_t key_size;
+    size_t count;
+};
+
+static void _key_set_add(struct key_set *ks, const void *key, size_t len)
+{
+    memcpy(&ks->keys[ks->count * ks->key_size], key, len);
+    ks->lens[ks->count++] = len;
+}
+
+static void _key_set_init(struct key_set *ks, const char *name, size_t key_size, size_t cap)
+{
+    ks->name = name;
+    ks->key_size = key_size;
+    ks->count = 0;
+    MALLOC(ks->keys, key_size * cap);
+    MALLOC(ks->lens, sizeof(size_t) * cap);
+}
+
+static void _key_set_deinit(struct key_set *ks)
+{
+    FREE(ks->keys);
+    FREE(ks->lens);
+}
+
+#define MAX_SYMBOLS 65536
+#define MAX_SYMBOL_SIZE 64
+
+static bool _has_symbol(struct key_set *ks, const char *sym, size_t len)
+{
+    for (size_t i = 0; i < ks->count; i++) {
+        if (ks->lens[i] == len && !memcmp(&ks->keys[i * ks->key_size], sym, len))
+            return true;
+    }
+    return false;
+}
+
+//unique identifiers of the .m files in the directory
+static void _collect_symbols(struct key_set *ks, const char *dir_path)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir)
+        return;
+    struct dirent *entry;
+    char path[1024];
+    while ((entry = readdir(dir))) {
+        size_t name_len = strlen(entry->d_name);
+        if (name_len < 3 || strcmp(&entry->d_name[name_len - 2], ".m"))
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir_path, entry->d_name);
+        const char *text = read_text_file(path);
+        if (!text)
+            continue;
+        for (const char *p = text; *p;) {
+            if (!isalpha((unsigned char)*p) && *p != '_') {
+                p++;
+                continue;
+            }
+            const char *start = p;
+            while (isalnum((unsigned char)*p) || *p == '_') p++;
+            size_t len = (size_t)(p - start);
+            if (len < MAX_SYMBOL_SIZE && ks->count < MAX_SYMBOLS && !_has_symbol(ks, start, len))
+                _key_set_add(ks, start, len);
+        }
+        FREE((void *)text);
+    }
+    closedir(dir);
+}
+
+static int _cmp_uint(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+    return x < y ? -1 : x > y;
+}
+
+//distinct hashes, and bucket load of a power of two table at load factor 0.5 indexed by the low bits
+static void _bench_quality(struct key_set *ks, const char *fun_name, hash_fun fun)
+{
+    size_t n = ks->count;
+    size_t cap = 1;
+    while (cap < 2 * n) cap <<= 1;
+    unsigned int *hashes;
+    u32 *loads;
+    MALLOC(hashes, n * sizeof(unsigned int));
+    CALLOC(loads, cap, sizeof(u32));
+    for (size_t i = 0; i < n; i++) {
+        hashes[i] = fun(&ks->keys[i * ks->key_size], ks->lens[i]);
+        loads[hashes[i] & (cap - 1)]++;
+    }
+    qsort(hashes, n, sizeof(unsigned int), _cmp_uint);
+    size_t distinct = n ? 1 : 0;
+    for (size_t i = 1; i < n; i++) distinct += hashes[i] != hashes[i - 1];
+    //chi-square of the bucket loads over the expected value, 1.0 for a uniform hash
+    double expected = (double)n / cap, chi = 0;
+    u32 max_load = 0;
+    for (size_t i = 0; i < cap; i++) {
+        chi += (loads[i] - expected) * (loads[i] - expected) / expected;
+        if (loads[i] > max_load) max_load = loads[i];
+    }
+    char metric[128];
+    snprintf(metric, sizeof(metric), "%s %zu %s collisions", ks->name, n, fun_name);
+    bench_report("hash_quality", metric, (double)(n - distinct), "keys");
+    snprintf(metric, sizeof(metric), "%s %zu %s chi2/dof", ks->name, n, fun_name);
+    bench_report("hash_quality", metric, chi / (cap - 1), "");
+    snprintf(metric, sizeof(metric), "%s %zu %s max bucket", ks->name, n, fun_name);
+    bench_report("hash_quality", metric, max_load, "keys");
+    FREE(loads);
+    FREE(hashes);
+}
+
+BENCH(bench_hash, quality)
+{
+    struct key_set sets[3];
+    _key_set_init(&sets[0], "m symbols", MAX_SYMBOL_SIZE, MAX_SYMBOLS);
+    _collect_symbols(&sets[0], M_SOURCE_DIR "/src/sys");
+    _collect_symbols(&sets[0], M_SOURCE_DIR "/samples");
+    size_t n = 1000000;
+    char ident[32];
+    _key_set_init(&sets[1], "idents", sizeof(ident), n);
+    for (size_t i = 0; i < n; i++) {
+        int len = sprintf(ident, "ident_%zu", i);
+        _key_set_add(&sets[1], ident, len);
+    }
+    //16 byte objects of one heap block as pointer keys
+    char *objects;
+    MALLOC(objects, n * 16);
+    _key_set_init(&sets[2], "pointers", sizeof(void *), n);
+    for (size_t i = 0; i < n; i++) {
+        void *p = &objects[i * 16];
+        _key_set_add(&sets[2], &p, sizeof(p));
+    }
+    for (int i = 0; i < 3; i++) {
+        _bench_quality(&sets[i], "knuth", _knuth_hash);
+        _bench_quality(&sets[i], "hash_key", hash_key);
+        _key_set_deinit(&sets[i]);
+    }
+    FREE(objects);
+}
+
+static void _bench_throughput(const char *fun_name, hash_fun fun, unsigned char *data, size_t key_len, size_t total)
+{
+    size_t count = total / key_len;
+    unsigned int sum = 0;
+    u64 start = bench_now_ns();
+    for (size_t i = 0; i < count; i++) {
+        sum += fun(&data[(i * key_len) % (total - key_len)], key_len);
+    }
+    u64 ns = bench_now_ns() - start;
+    char metric[128];
+    snprintf(metric, sizeof(metric), "%s %zu bytes key MB/s", fun_name, key_len);
+    bench_report("hash_throughput", metric, (count * key_len) / MB / (ns / 1e9), "MB/s");
+    snprintf(metric, sizeof(metric), "%s %zu bytes key ns/key", fun_name, key_len);
+    bench_report("hash_throughput", metric, (double)ns / count, "ns");
+    if (sum == 42) printf("\n");
+}
+
+BENCH(bench_hash, throughput)
+{
+    size_t total = 64 * 1024 * 1024;
+    unsigned char *data;
+    MALLOC(data, total);
+    for (size_t i = 0; i < total; i++) data[i] = (unsigned char)(i * 2654435761u >> 13);
+    size_t key_lens[] = { 4, 8, 16, 64, 1024 };
+    for (size_t i = 0; i < sizeof(key_lens) / sizeof(key_lens[0]); i++) {
+        _bench_throughput("knuth", _knuth_hash, data, key_lens[i], total);
+        _bench_throughput("hash", hash, data, key_lens[i], total);
+        _bench_throughput("hash_key", hash_key, data, key_lens[i], total);
+    }
+    FREE(data);
+}
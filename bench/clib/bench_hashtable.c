@@ -0,0 +1,137 @@
+/*
+ * bench_hashtable.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * hashtable micro benchmarks: set/get/remove with pointer, int and string keys
+ */
+#include "bench.h"
+#include "clib/hashtable.h"
+#include "clib/util.h"
+#include <stdio.h>
+
+#define KEY_STR_SIZE 16
+
+static void _report(const char *metric, size_t n, const char *op, u64 ns)
+{
+    char name[64];
+    sprintf(name, "%s %zu %s ns/op", metric, n, op);
+    bench_report("hashtable", name, (double)ns / n, "ns");
+}
+
+//keys are shuffled so lookups do not follow the insertion order
+static void _shuffle(size_t *order, size_t n)
+{
+    u64 seed = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < n; i++) order[i] = i;
+    for (size_t i = n - 1; i > 0; i--) {
+        seed ^= seed << 13; seed ^= seed >> 7; seed ^= seed << 17;
+        size_t j = seed % (i + 1);
+        size_t t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+}
+
+static void _bench_int_keys(size_t n, size_t *order)
+{
+    struct hashtable ht;
+    hashtable_init_with_size(&ht, sizeof(u64), sizeof(u64));
+    u64 start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        u64 key = i * 2654435761ull;
+        hashtable_set_v(&ht, &key, &key);
+    }
+    _report("int", n, "set", bench_now_ns() - start);
+    u64 sum = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        u64 key = order[i] * 2654435761ull;
+        sum += *(u64 *)hashtable_get_v(&ht, &key);
+    }
+    _report("int", n, "get hit", bench_now_ns() - start);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        u64 key = order[i] * 2654435761ull + 1;
+        sum += hashtable_in_v(&ht, &key);
+    }
+    _report("int", n, "get miss", bench_now_ns() - start);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        u64 key = order[i] * 2654435761ull;
+        hashtable_remove_g(&ht, &key, sizeof(key));
+    }
+    _report("int", n, "remove", bench_now_ns() - start);
+    if (sum == 42) printf("\n");
+    hashtable_deinit(&ht);
+}
+
+static void _bench_pointer_keys(size_t n, size_t *order)
+{
+    struct hashtable ht;
+    char *objects;
+    MALLOC(objects, n);
+    hashtable_init(&ht);
+    u64 start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hashtable_set_p(&ht, &objects[i], &objects[i]);
+    }
+    _report("pointer", n, "set", bench_now_ns() - start);
+    size_t hits = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hits += hashtable_get_p(&ht, &objects[order[i]]) == &objects[order[i]];
+    }
+    _report("pointer", n, "get hit", bench_now_ns() - start);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hashtable_remove_p(&ht, &objects[order[i]]);
+    }
+    _report("pointer", n, "remove", bench_now_ns() - start);
+    if (hits != n) printf("pointer key lookup failed\n");
+    hashtable_deinit(&ht);
+    FREE(objects);
+}
+
+static void _bench_str_keys(size_t n, size_t *order)
+{
+    struct hashtable ht;
+    char *keys;
+    MALLOC(keys, n * KEY_STR_SIZE);
+    for (size_t i = 0; i < n; i++) {
+        sprintf(&keys[i * KEY_STR_SIZE], "ident_%zu", i);
+    }
+    hashtable_init(&ht);
+    u64 start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hashtable_set(&ht, &keys[i * KEY_STR_SIZE], &keys[i * KEY_STR_SIZE]);
+    }
+    _report("string", n, "set", bench_now_ns() - start);
+    size_t hits = 0;
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hits += hashtable_get(&ht, &keys[order[i] * KEY_STR_SIZE]) != 0;
+    }
+    _report("string", n, "get hit", bench_now_ns() - start);
+    start = bench_now_ns();
+    for (size_t i = 0; i < n; i++) {
+        hashtable_remove(&ht, &keys[order[i] * KEY_STR_SIZE]);
+    }
+    _report("string", n, "remove", bench_now_ns() - start);
+    if (hits != n) printf("string key lookup failed\n");
+    hashtable_deinit(&ht);
+    FREE(keys);
+}
+
+BENCH(bench_hashtable, ops)
+{
+    size_t sizes[] = { 1000, 100000, 1000000, 10000000 };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s];
+        size_t *order;
+        MALLOC(order, n * sizeof(size_t));
+        _shuffle(order, n);
+        _bench_int_keys(n, order);
+        _bench_pointer_keys(n, order);
+        _bench_str_keys(n, order);
+        FREE(order);
+    }
+}
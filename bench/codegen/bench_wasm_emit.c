@@ -0,0 +1,127 @@
+/*
+ * bench_wasm_emit.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * wasm emitter benchmarks: LEB128 encoding throughput compared with the previous
+ * byte-at-a-time encoder, and the bytes per second of the wasm code generator on large modules
+ */
+#include "bench.h"
+#include "program_gen.h"
+#include "compiler/engine.h"
+#include "codegen/wasm/cg_wasm.h"
+#include "codegen/wasm/wasm_api.h"
+#include "clib/util.h"
+#include <stdio.h>
+
+#define ROUNDS 10
+#define VALUES (1 << 20)
+
+static struct program_params programs[] = {
+    { .shape = SHAPE_FUNCTIONS, .size = 2000 },
+    { .shape = SHAPE_LARGE_STRUCT, .size = 400 },
+    { .shape = SHAPE_MATCH_TABLE, .size = 4000 },
+};
+
+//the previous encoder: one ba_add a byte and a test of the rest of value per byte
+static u8 _emit_uint_bytewise(struct byte_array *ba, u64 value)
+{
+    u8 byte;
+    u8 index = 0;
+    do {
+        byte = 0x7F & value;
+        value >>= 7;
+        if (value != 0) {
+            byte |= 0x80;
+        }
+        ba_add(ba, byte);
+        index++;
+    } while (value != 0);
+    return index;
+}
+
+static void _report(const char *program, const char *metric, double value, const char *unit)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "%s %s", program, metric);
+    bench_report("wasm_emit", name, value, unit);
+}
+
+static double _mb_per_sec(u64 bytes, u64 ns)
+{
+    return ns ? bytes / MB / (ns / 1e9) : 0.0;
+}
+
+//values as they come in code: mostly local indices and small constants, some addresses and sizes
+static u64 _leb_value(u32 i)
+{
+    u32 hash = i * 2654435761u;
+    switch (hash >> 30) {
+    case 0:
+    case 1:
+        return hash & 0x3F;
+    case 2:
+        return hash & 0x3FFF;
+    default:
+        return hash;
+    }
+}
+
+static void _bench_leb128(void)
+{
+    u64 *values;
+    MALLOC(values, VALUES * sizeof(u64));
+    for (u32 i = 0; i < VALUES; i++) {
+        values[i] = _leb_value(i);
+    }
+    struct byte_array ba;
+    ba_init(&ba, 17);
+    u64 bytewise_ns = 0, ns = 0;
+    for (int r = 0; r < ROUNDS; r++) {
+        ba_reset(&ba);
+        u64 start = bench_now_ns();
+        for (u32 i = 0; i < VALUES; i++) {
+            _emit_uint_bytewise(&ba, values[i]);
+        }
+        bytewise_ns += bench_now_ns() - start;
+        ba_reset(&ba);
+        start = bench_now_ns();
+        for (u32 i = 0; i < VALUES; i++) {
+            wasm_emit_uint(&ba, values[i]);
+        }
+        ns += bench_now_ns() - start;
+    }
+    u64 bytes = (u64)ba.size * ROUNDS;
+    _report("leb128", "bytewise MB/s", _mb_per_sec(bytes, bytewise_ns), "MB/s");
+    _report("leb128", "MB/s", _mb_per_sec(bytes, ns), "MB/s");
+    _report("leb128", "speedup", ns ? (double)bytewise_ns / ns : 0.0, "x");
+    ba_deinit(&ba);
+    FREE(values);
+}
+
+BENCH(bench_wasm_emit, throughput)
+{
+    _bench_leb128();
+    char program[64];
+    for (size_t i = 0; i < ARRAY_SIZE(programs); i++) {
+        struct program_params *params = &programs[i];
+        u32 lines;
+        string code = gen_program(params, &lines);
+        snprintf(program, sizeof(program), "%s_%u", program_shape_name(params->shape), params->size);
+        //the engine is reused as the compile service does, so the module buffer is warm
+        struct engine *engine = engine_wasm_new();
+        struct cg_wasm *cg = (struct cg_wasm *)engine->be->cg;
+        struct time_report sum;
+        time_report_init(&sum);
+        for (int r = 0; r < ROUNDS; r++) {
+            compile_to_wasm(engine, string_get(&code));
+            time_report_add(&sum, &engine->time_report);
+        }
+        struct phase_stats *codegen = &sum.phases[PHASE_CODEGEN];
+        _report(program, "module bytes", cg->ba.size, "bytes");
+        _report(program, "codegen MB/s", _mb_per_sec((u64)cg->ba.size * ROUNDS, codegen->ns), "MB/s");
+        _report(program, "codegen allocs", (double)codegen->allocs / ROUNDS, "allocs");
+        engine_free(engine);
+        string_deinit(&code);
+    }
+}
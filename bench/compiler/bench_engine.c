@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * compile latency of an empty program: a new wasm engine per request, which parses and
+ * analyzes the system prelude every time, against one engine reused across requests
+ */
+#include "bench.h"
+#include "compiler/engine.h"
+#include "codegen/wasm/cg_wasm.h"
+#include <stdlib.h>
+
+#define REQUESTS 200
+
+//an empty source does not parse, the smallest module is a single expression
+static const char *empty_program = "0\n";
+
+static void _compile(struct engine *engine, const char *code)
+{
+    struct cg_wasm *cg = (struct cg_wasm *)engine->be->cg;
+    u8 *data = compile_to_wasm(engine, code);
+    cg->ba.data = 0;
+    free(data);
+}
+
+BENCH(bench_engine, empty_program)
+{
+    u64 start = bench_now_ns();
+    for (int i = 0; i < REQUESTS; i++) {
+        struct engine *engine = engine_wasm_new();
+        _compile(engine, empty_program);
+        engine_free(engine);
+    }
+    u64 fresh_ns = bench_now_ns() - start;
+
+    start = bench_now_ns();
+    struct engine *engine = engine_wasm_new();
+    u64 new_ns = bench_now_ns() - start;
+    start = bench_now_ns();
+    for (int i = 0; i < REQUESTS; i++) {
+        _compile(engine, empty_program);
+    }
+    u64 reused_ns = bench_now_ns() - start;
+    engine_free(engine);
+    bench_report("engine_empty_program", "engine_wasm_new with prelude us", new_ns / 1e3, "us");
+    bench_report("engine_empty_program", "new engine per request us", fresh_ns / 1e3 / REQUESTS, "us");
+    bench_report("engine_empty_program", "reused engine us", reused_ns / 1e3 / REQUESTS, "us");
+    bench_report("engine_empty_program", "speedup", (double)fresh_ns / reused_ns, "x");
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * compiler throughput over generated programs: lines per second of the lexer, parser,
+ * analyzer, wasm and llvm code generators measured separately, with allocations per phase
+ * and the peak resident set size of the process
+ */
+#include "bench.h"
+#include "program_gen.h"
+#include "lexer/lexer.h"
+#include "compiler/engine.h"
+#include "compiler/compiler.h"
+#include "codegen/wasm/cg_wasm.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#define ROUNDS 10
+
+static struct program_params programs[] = {
+    { .shape = SHAPE_FUNCTIONS, .size = 100 },
+    { .shape = SHAPE_FUNCTIONS, .size = 400 },
+    { .shape = SHAPE_DEEP_EXPR, .size = 50 },
+    { .shape = SHAPE_DEEP_EXPR, .size = 200 },
+    { .shape = SHAPE_LARGE_STRUCT, .size = 50 },
+    { .shape = SHAPE_LARGE_STRUCT, .size = 200 },
+    { .shape = SHAPE_GENERICS, .size = 100 },
+    { .shape = SHAPE_GENERICS, .size = 400 },
+    { .shape = SHAPE_MATCH_TABLE, .size = 100 },
+    { .shape = SHAPE_MATCH_TABLE, .size = 1000 },
+};
+
+static u64 _lex(const char *code, u64 *tokens)
+{
+    u64 start = bench_now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        struct lexer *lexer = lexer_new_with_string(code);
+        struct token *tok;
+        do {
+            tok = get_tok(lexer);
+            tok_clean(tok);
+            (*tokens)++;
+        } while (tok->token_type != TOKEN_EOF && tok->token_type != TOKEN_NULL);
+        lexer_free(lexer);
+    }
+    return bench_now_ns() - start;
+}
+
+//parse, analyze and wasm codegen phases summed over the rounds, the engine is reused as the compile service does
+static void _compile_wasm(const char *code, struct time_report *sum, u32 *module_size)
+{
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm *)engine->be->cg;
+    time_report_init(sum);
+    for (int i = 0; i < ROUNDS; i++) {
+        compile_to_wasm(engine, code);
+        time_report_add(sum, &engine->time_report);
+    }
+    *module_size = cg->ba.size;
+    engine_free(engine);
+}
+
+//analysis and llvm ir emission of a fresh llvm engine per round, the system prelude is loaded outside the measure
+static u64 _compile_llvm(struct program_params *params, u32 *lines)
+{
+    struct program_params llvm_params = *params;
+    llvm_params.wrap_main = true;
+    string text = gen_program(&llvm_params, lines);
+    const char *code = string_get(&text);
+    u64 ns = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+        struct engine *engine = engine_llvm_new(M_SOURCE_DIR "/src/sys", false);
+        struct ast_node *block = parse_code(engine->fe->parser, code);
+        engine->create_ir_module(engine->be->cg, "bench");
+        u64 start = bench_now_ns();
+        char *ir_string = engine->emit_ir_string(engine->be->cg, block);
+        ns += bench_now_ns() - start;
+        free_ir_string(ir_string);
+        node_free(block);
+        engine_free(engine);
+    }
+    string_deinit(&text);
+    return ns;
+}
+
+static double _peak_rss_mb(void)
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0; //kilobytes on linux
+}
+
+static void _report(const char *program, const char *metric, double value, const char *unit)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "%s %s", program, metric);
+    bench_report("compiler_throughput", name, value, unit);
+}
+
+static double _lines_per_sec(u32 lines, u64 ns)
+{
+    return ns ? (double)lines * ROUNDS / (ns / 1e9) : 0.0;
+}
+
+BENCH(bench_compiler, throughput)
+{
+    char program[64];
+    for (size_t i = 0; i < ARRAY_SIZE(programs); i++) {
+        struct program_params *params = &programs[i];
+        u32 lines;
+        string code = gen_program(params, &lines);
+        snprintf(program, sizeof(program), "%s_%u", program_shape_name(params->shape), params->size);
+        u64 tokens = 0;
+        u64 lex_ns = _lex(string_get(&code), &tokens);
+        struct time_report wasm;
+        u32 module_size;
+        _compile_wasm(string_get(&code), &wasm, &module_size);
+        struct phase_stats *parse = &wasm.phases[PHASE_PARSE], *analyze = &wasm.phases[PHASE_ANALYZE];
+        struct phase_stats *codegen = &wasm.phases[PHASE_CODEGEN];
+        _report(program, "lines", lines, "lines");
+        _report(program, "wasm module bytes", module_size, "bytes");
+        _report(program, "lex lines/s", _lines_per_sec(lines, lex_ns), "lines/s");
+        _report(program, "lex tokens/s", lex_ns ? tokens / (lex_ns / 1e9) : 0.0, "tokens/s");
+        //the parser pulls tokens from the lexer, so parse includes lexing
+        _report(program, "parse lines/s", _lines_per_sec(lines, parse->ns), "lines/s");
+        _report(program, "analyze lines/s", _lines_per_sec(lines, analyze->ns), "lines/s");
+        _report(program, "wasm codegen lines/s", _lines_per_sec(lines, codegen->ns + wasm.phases[PHASE_EMIT].ns), "lines/s");
+        //the llvm backend does not emit match expressions
+        if (params->shape != SHAPE_MATCH_TABLE) {
+            u32 llvm_lines;
+            u64 llvm_ns = _compile_llvm(params, &llvm_lines);
+            _report(program, "llvm analyze+codegen lines/s", _lines_per_sec(llvm_lines, llvm_ns), "lines/s");
+        }
+        _report(program, "parse allocs", (double)parse->allocs / ROUNDS, "allocs");
+        _report(program, "analyze allocs", (double)analyze->allocs / ROUNDS, "allocs");
+        _report(program, "wasm codegen allocs", (double)codegen->allocs / ROUNDS, "allocs");
+        _report(program, "peak rss", _peak_rss_mb(), "MB");
+        string_deinit(&code);
+    }
+}
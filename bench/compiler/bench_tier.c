@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * latency of tiered execution against the jit: the time to the first result of short
+ * programs, from parsing to the value, and the steady-state speed of a hot function called
+ * in a loop, interpreted only, tiered and jitted. the engine is created before the clock
+ * starts for both, its prelude costs the same either way
+ */
+#include "bench.h"
+#include "clib/util.h"
+#include "compiler/engine.h"
+#include "compiler/repl.h"
+#include "compiler/tier.h"
+#include "sema/analyzer.h"
+#include <stdio.h>
+
+#define ROUNDS 20
+#define HOT_CALLS 1000000
+
+struct tier_program {
+    const char *name;
+    const char *code;
+};
+
+static struct tier_program short_programs[] = {
+    { "expression", "2 + 3 * 4\n" },
+    { "fib", "\n\
+def fib(n:int) -> int:\n\
+    if n < 2:\n\
+        n\n\
+    else:\n\
+        fib(n-1) + fib(n-2)\n\
+fib(15)\n\
+" },
+    { "fib25", "\n\
+def fib(n:int) -> int:\n\
+    if n < 2:\n\
+        n\n\
+    else:\n\
+        fib(n-1) + fib(n-2)\n\
+fib(25)\n\
+" },
+    { "loop", "\n\
+def f(x:int) -> int: (x * 7 + 3) % 11\n\
+let mut sum = 0\n\
+for i in 0..1000:\n\
+    sum = sum + f(i)\n\
+sum\n\
+" },
+};
+
+static const char *hot_program = "\n\
+def f(x:int) -> int: (x * 7 + 3) % 11\n\
+let mut sum = 0\n\
+for i in 0..1000000:\n\
+    sum = sum + f(i)\n\
+sum\n\
+";
+
+enum run_mode {
+    RUN_JIT,
+    RUN_TIERED,
+    RUN_INTERPRETED, //the tier never promotes
+};
+
+static u64 _run(const char *code, enum run_mode mode, int *result)
+{
+    struct engine *engine = engine_llvm_new(M_SOURCE_DIR "/src/sys", false);
+    u64 start = bench_now_ns();
+    struct JIT *jit = 0;
+    struct tier *tier = 0;
+    struct ast_node *block = split_ast_nodes_with_start_func(0, parse_code(engine->fe->parser, code));
+    if (mode == RUN_JIT) {
+        jit = jit_new(engine);
+        *result = eval_module(jit, block).i_value;
+    } else {
+        tier = tier_new(engine);
+        if (mode == RUN_INTERPRETED)
+            tier->interp.hot_threshold = 0;
+        *result = tier_eval_module(tier, block).i_value;
+    }
+    u64 ns = bench_now_ns() - start;
+    node_free(block);
+    if (jit)
+        jit_free(jit);
+    if (tier)
+        tier_free(tier);
+    engine_free(engine);
+    return ns;
+}
+
+static u64 _best(const char *code, enum run_mode mode, int rounds, int *result)
+{
+    u64 best = 0;
+    for (int i = 0; i < rounds; i++) {
+        u64 ns = _run(code, mode, result);
+        if (!best || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+static void _check_result(const char *name, int result, int expected)
+{
+    if (result != expected)
+        fprintf(stderr, "%s: tiered result %d is not %d of the jit\n", name, result, expected);
+}
+
+BENCH(bench_tier, latency)
+{
+    char metric[128];
+    int result, jit_result;
+    for (size_t i = 0; i < ARRAY_SIZE(short_programs); i++) {
+        struct tier_program *program = &short_programs[i];
+        u64 jit_ns = _best(program->code, RUN_JIT, ROUNDS, &jit_result);
+        u64 tier_ns = _best(program->code, RUN_TIERED, ROUNDS, &result);
+        _check_result(program->name, result, jit_result);
+        snprintf(metric, sizeof(metric), "%s first result jit us", program->name);
+        bench_report("tier_latency", metric, jit_ns / 1e3, "us");
+        snprintf(metric, sizeof(metric), "%s first result tiered us", program->name);
+        bench_report("tier_latency", metric, tier_ns / 1e3, "us");
+        snprintf(metric, sizeof(metric), "%s first result speedup", program->name);
+        bench_report("tier_latency", metric, (double)jit_ns / tier_ns, "x");
+    }
+    u64 jit_ns = _best(hot_program, RUN_JIT, 3, &jit_result);
+    u64 tier_ns = _best(hot_program, RUN_TIERED, 3, &result);
+    _check_result("hot", result, jit_result);
+    u64 interp_ns = _best(hot_program, RUN_INTERPRETED, 3, &result);
+    _check_result("hot interpreted", result, jit_result);
+    bench_report("tier_latency", "hot call jit ns", (double)jit_ns / HOT_CALLS, "ns");
+    bench_report("tier_latency", "hot call tiered ns", (double)tier_ns / HOT_CALLS, "ns");
+    bench_report("tier_latency", "hot call interpreted ns", (double)interp_ns / HOT_CALLS, "ns");
+}
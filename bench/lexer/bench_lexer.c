@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * lexer throughput benchmark over synthetic large m code:
+ * in-memory text, memory-mapped file and FILE stream inputs
+ */
+#include "bench.h"
+#include "lexer/lexer.h"
+#include "sema/frontend.h"
+#include "clib/regex.h"
+#include <stdio.h>
+
+static const char *bench_file = "mbench_lexer.m";
+
+static string _gen_code(size_t min_size)
+{
+    string code;
+    string_init_chars(&code, "");
+    char line[512];
+    for (int i = 0; string_size(&code) < min_size; i++) {
+        sprintf(line,
+            "def fun_%d(x:int, y:f64) -> f64:\n"
+            "    let mut sum = 0.0 // running sum\n"
+            "    for i in 0..%d:\n"
+            "        sum += x * 0x%x + y / %d.25 - (i << 2)\n"
+            "    printf(\"fun_%d: %%f\\n\", sum)\n"
+            "    /* return the sum */\n"
+            "    sum\n\n", i, i % 100 + 1, i, i + 1, i);
+        string_add_chars(&code, line);
+    }
+    return code;
+}
+
+static size_t _lex_all(struct lexer *lexer)
+{
+    size_t tokens = 0;
+    struct token *tok;
+    do {
+        tok = get_tok(lexer);
+        tok_clean(tok);
+        tokens++;
+    } while (tok->token_type != TOKEN_EOF && tok->token_type != TOKEN_NULL);
+    return tokens;
+}
+
+static void _report(const char *input, size_t code_size, size_t tokens, u64 ns)
+{
+    char metric[128];
+    double secs = ns / 1e9;
+    sprintf(metric, "%s %.0fMB MB/s", input, code_size / MB);
+    bench_report("lexer_throughput", metric, code_size / MB / secs, "MB/s");
+    sprintf(metric, "%s %.0fMB tokens/s", input, code_size / MB);
+    bench_report("lexer_throughput", metric, tokens / secs, "tokens/s");
+}
+
+BENCH(bench_lexer, throughput)
+{
+    struct frontend *fe = frontend_init();
+    size_t sizes[] = { 1 << 20, 8 << 20, 32 << 20 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        string code = _gen_code(sizes[i]);
+        size_t code_size = string_size(&code);
+
+        u64 start = bench_now_ns();
+        struct lexer *lexer = lexer_new_with_string(string_get(&code));
+        size_t tokens = _lex_all(lexer);
+        lexer_free(lexer);
+        _report("in-memory", code_size, tokens, bench_now_ns() - start);
+
+        FILE *f = fopen(bench_file, "wb");
+        fwrite(string_get(&code), 1, code_size, f);
+        fclose(f);
+        string_deinit(&code);
+
+        start = bench_now_ns();
+        size_t mapped_size;
+        const char *text = map_text_file(bench_file, &mapped_size);
+        lexer = lexer_new(0, bench_file, text, mapped_size);
+        tokens = _lex_all(lexer);
+        lexer_free(lexer);
+        unmap_text_file(text, mapped_size);
+        _report("mapped-file", code_size, tokens, bench_now_ns() - start);
+
+        start = bench_now_ns();
+        lexer = lexer_new(fopen(bench_file, "rb"), bench_file, 0, 0);
+        tokens = _lex_all(lexer);
+        int window = lexer->stream_cap;
+        lexer_free(lexer);
+        _report("stream", code_size, tokens, bench_now_ns() - start);
+        char metric[128];
+        sprintf(metric, "stream %.0fMB window size", code_size / MB);
+        bench_report("lexer_throughput", metric, window / 1024.0, "KB");
+        remove(bench_file);
+    }
+    frontend_deinit(fe);
+}
+
+/*
+ * per-token pattern matching before and after merging the token patterns into one dfa:
+ * "nfa" runs the Thompson NFA of every pattern that can start with the current character
+ * and keeps the longest match, which is what the lexer did before.
+ */
+#define MAX_PATTERNS_PER_CHAR 16
+struct pattern_matches {
+    struct token_pattern *patterns[MAX_PATTERNS_PER_CHAR];
+    int pattern_match_count;
+};
+
+static void _init_char_matches(struct pattern_matches *char_matches)
+{
+    char test[2] = { 0, 0 };
+    struct token_patterns tps = get_token_patterns();
+    for (int i = 0; i < 128; i++) {
+        test[0] = (char)i;
+        struct pattern_matches *pm = &char_matches[i];
+        pm->pattern_match_count = 0;
+        for (size_t j = 0; j < tps.pattern_count; j++) {
+            size_t matched_len;
+            if (!tps.patterns[j].re)
+                continue;
+            regex_match(tps.patterns[j].re, test, &matched_len);
+            if (!matched_len || pm->pattern_match_count == MAX_PATTERNS_PER_CHAR)
+                continue;
+            pm->patterns[pm->pattern_match_count++] = &tps.patterns[j];
+        }
+    }
+}
+
+static int _nfa_match(struct pattern_matches *char_matches, const char *text)
+{
+    struct pattern_matches *pm = &char_matches[*text & 0x7F];
+    int max_matched = 0;
+    for (int i = 0; i < pm->pattern_match_count; i++) {
+        int matched = regex_match(pm->patterns[i]->re, text, 0);
+        if (matched > max_matched)
+            max_matched = matched;
+    }
+    return max_matched;
+}
+
+static int _dfa_match(struct dfa *dfa, const char *text)
+{
+    int matched_re;
+    return dfa_match(dfa, text, &matched_re);
+}
+
+BENCH(bench_lexer, dfa)
+{
+    struct frontend *fe = frontend_init();
+    string code = _gen_code(4 << 20);
+    const char *text = string_get(&code);
+    size_t code_size = string_size(&code);
+    struct pattern_matches char_matches[128];
+    _init_char_matches(&char_matches[0]);
+    struct dfa *dfa = get_token_patterns().dfa;
+    char metric[128];
+    u64 nfa_ns = 0, dfa_ns = 0;
+    for (int run = 0; run < 2; run++) {
+        u64 start = bench_now_ns();
+        size_t tokens = 0;
+        for (const char *p = text; *p;) {
+            int matched = run ? _dfa_match(dfa, p) : _nfa_match(&char_matches[0], p);
+            p += matched ? matched : 1;
+            tokens++;
+        }
+        u64 ns = bench_now_ns() - start;
+        if (run)
+            dfa_ns = ns;
+        else
+            nfa_ns = ns;
+        sprintf(metric, "%s token match MB/s", run ? "dfa" : "nfa");
+        bench_report("lexer_dfa", metric, code_size / MB / (ns / 1e9), "MB/s");
+    }
+    sprintf(metric, "dfa states %u speedup", dfa_state_count(dfa));
+    bench_report("lexer_dfa", metric, (double)nfa_ns / dfa_ns, "x");
+    string_deinit(&code);
+    frontend_deinit(fe);
+}
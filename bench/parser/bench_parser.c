@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * parser allocation benchmark: parse and release many small modules with nodes
+ * allocated one by one from the heap and from a per-module arena. load_vs_parse compares
+ * parsing a module with loading its saved binary ast
+ */
+#include "bench.h"
+#include "parser/parser.h"
+#include "sema/frontend.h"
+#include "compiler/engine.h"
+#include "parser/ast_serialize.h"
+#include "codegen/wasm/cg_wasm.h"
+#include <string.h>
+#include <stdio.h>
+
+#define MODULES 2000
+
+static const char *small_module = "\
+def dist2(x:f64, y:f64):\n\
+    x * x + y * y\n\
+def sum(n:int):\n\
+    let mut s = 0\n\
+    for i in 0..n:\n\
+        s = s + i * 2 + 1\n\
+    s\n\
+if dist2(3.0, 4.0) > 24.0: sum(10) else: 0\n\
+";
+
+static u64 _parse_modules(struct parser *parser, struct arena *arena)
+{
+    u64 start = bench_now_ns();
+    for (int i = 0; i < MODULES; i++) {
+        struct arena *prev_arena = ast_set_arena(arena);
+        struct ast_node *block = parse_code(parser, small_module);
+        ast_set_arena(prev_arena);
+        node_free(block);
+        if (arena)
+            arena_reset(arena);
+    }
+    return bench_now_ns() - start;
+}
+
+BENCH(bench_parser, arena)
+{
+    struct frontend *fe = frontend_init();
+    struct parser *parser = parser_new();
+    struct arena arena;
+    arena_init(&arena);
+    u64 heap_ns = _parse_modules(parser, 0);
+    u64 arena_ns = _parse_modules(parser, &arena);
+    bench_report("parser_arena", "heap nodes us/module", heap_ns / 1e3 / MODULES, "us");
+    bench_report("parser_arena", "arena nodes us/module", arena_ns / 1e3 / MODULES, "us");
+    bench_report("parser_arena", "arena speedup", (double)heap_ns / arena_ns, "x");
+    arena_deinit(&arena);
+    parser_free(parser);
+    frontend_deinit(fe);
+    //end to end: one wasm engine per module as the compile service does
+    u64 start = bench_now_ns();
+    for (int i = 0; i < MODULES / 10; i++) {
+        struct engine *engine = engine_wasm_new();
+        compile_to_wasm(engine, small_module);
+        engine_free(engine);
+    }
+    u64 ns = bench_now_ns() - start;
+    bench_report("parser_arena", "compile_to_wasm modules/s", (MODULES / 10) / (ns / 1e9), "modules/s");
+}
+
+#define LOAD_FUNCS 50
+
+//a module of LOAD_FUNCS functions shaped like small_module
+static char *_large_module(void)
+{
+    size_t cap = LOAD_FUNCS * 256 + 64;
+    char *text;
+    MALLOC(text, cap);
+    size_t len = 0;
+    for (int i = 0; i < LOAD_FUNCS; i++) {
+        len += snprintf(text + len, cap - len, "\
+def dist%d(x:f64, y:f64):\n\
+    x * x + y * y + %d.0\n\
+def sum%d(n:int):\n\
+    let mut s = 0\n\
+    for i in 0..n:\n\
+        s = s + i * 2 + %d\n\
+    s\n", i, i, i, i);
+    }
+    snprintf(text + len, cap - len, "if dist0(3.0, 4.0) > 24.0: sum0(10) else: 0\n");
+    return text;
+}
+
+BENCH(bench_parser, load_vs_parse)
+{
+    struct frontend *fe = frontend_init();
+    struct parser *parser = parser_new();
+    struct arena arena;
+    arena_init(&arena);
+    char *text = _large_module();
+    struct byte_array saved;
+    ba_init(&saved, 4096);
+    struct ast_node *block = parse_code(parser, text);
+    ast_serialize(parser->tc, block, &saved);
+    node_free(block);
+    int rounds = MODULES / 20;
+    u64 start = bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        struct arena *prev_arena = ast_set_arena(&arena);
+        block = parse_code(parser, text);
+        ast_set_arena(prev_arena);
+        node_free(block);
+        arena_reset(&arena);
+    }
+    u64 parse_ns = bench_now_ns() - start;
+    start = bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        struct arena *prev_arena = ast_set_arena(&arena);
+        block = ast_deserialize(parser->tc, saved.data, saved.size);
+        ast_set_arena(prev_arena);
+        node_free(block);
+        arena_reset(&arena);
+    }
+    u64 load_ns = bench_now_ns() - start;
+    bench_report("parser_load_vs_parse", "source bytes", (double)strlen(text), "bytes");
+    bench_report("parser_load_vs_parse", "saved ast bytes", (double)saved.size, "bytes");
+    bench_report("parser_load_vs_parse", "parse us/module", parse_ns / 1e3 / rounds, "us");
+    bench_report("parser_load_vs_parse", "load us/module", load_ns / 1e3 / rounds, "us");
+    bench_report("parser_load_vs_parse", "load speedup", (double)parse_ns / load_ns, "x");
+    //end to end on one engine: analysis and codegen are the same for both
+    struct engine *engine = engine_wasm_new();
+    start = bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        compile_to_wasm(engine, text);
+    }
+    u64 compile_ns = bench_now_ns() - start;
+    start = bench_now_ns();
+    for (int i = 0; i < rounds; i++) {
+        compile_ast_to_wasm(engine, saved.data, saved.size);
+    }
+    u64 compile_ast_ns = bench_now_ns() - start;
+    bench_report("parser_load_vs_parse", "compile_to_wasm us/module", compile_ns / 1e3 / rounds, "us");
+    bench_report("parser_load_vs_parse", "compile_ast_to_wasm us/module", compile_ast_ns / 1e3 / rounds, "us");
+    engine_free(engine);
+    ba_deinit(&saved);
+    FREE(text);
+    arena_deinit(&arena);
+    parser_free(parser);
+    frontend_deinit(fe);
+}
@@ -0,0 +1,163 @@
+/*
+ * program_gen.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * synthetic m programs stressing one part of the compiler each
+ */
+#include "program_gen.h"
+#include <stdarg.h>
+#include <stdio.h>
+
+static const char *shape_names[] = {
+    "functions",
+    "deep_expr",
+    "large_struct",
+    "generics",
+    "match_table",
+};
+
+//statements of the deep expression shape, each nested size levels deep. the parser stack
+//holds MAX_STATES states so the depth is capped
+#define DEEP_EXPR_STATEMENTS 64
+#define DEEP_EXPR_MAX_DEPTH 400
+
+const char *program_shape_name(enum program_shape shape)
+{
+    return shape < SHAPE_COUNT ? shape_names[shape] : "none";
+}
+
+static void _add(string *code, u32 *lines, const char *format, ...)
+{
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    string_add_chars(code, line);
+    (*lines)++;
+}
+
+//top level statements follow the definitions, indented into a main function if asked
+static void _begin_statements(string *code, const char *indent, u32 *lines)
+{
+    if (*indent)
+        _add(code, lines, "def main():\n");
+}
+
+static void _gen_functions(string *code, u32 size, const char *indent, u32 *lines)
+{
+    _add(code, lines, "def fn0(x:int, y:int) -> int: x + y\n");
+    for (u32 i = 1; i < size; i++) {
+        _add(code, lines, "def fn%u(x:int, y:int) -> int:\n", i);
+        _add(code, lines, "    let a = x * %u + y\n", i % 7 + 1);
+        _add(code, lines, "    if a > %u: fn%u(a - y, y) else: fn%u(a + x, x)\n", i, i - 1, i - 1);
+    }
+    _begin_statements(code, indent, lines);
+    _add(code, lines, "%sfn%u(1, 2)\n", indent, size - 1);
+}
+
+static void _gen_deep_expr(string *code, u32 size, const char *indent, u32 *lines)
+{
+    static const char *ops[] = { "+", "*", "-" };
+    _begin_statements(code, indent, lines);
+    _add(code, lines, "%slet x = 3\n", indent);
+    char line[4096];
+    if (size > DEEP_EXPR_MAX_DEPTH)
+        size = DEEP_EXPR_MAX_DEPTH;
+    for (u32 i = 0; i < DEEP_EXPR_STATEMENTS; i++) {
+        size_t len = snprintf(line, sizeof(line), "%slet e%u = ", indent, i);
+        for (u32 j = 0; j < size && len < sizeof(line) - 1; j++)
+            line[len++] = '(';
+        len += snprintf(line + len, sizeof(line) - len, "x");
+        for (u32 j = 0; j < size && len < sizeof(line); j++)
+            len += snprintf(line + len, sizeof(line) - len, " %s %u)", ops[j % 3], (i + j) % 9 + 1);
+        string_add_chars(code, line);
+        _add(code, lines, "\n");
+    }
+    _add(code, lines, "%se%u\n", indent, DEEP_EXPR_STATEMENTS - 1);
+}
+
+static void _gen_large_struct(string *code, u32 size, const char *indent, u32 *lines)
+{
+    string fields, values;
+    string_init_chars(&fields, "");
+    string_init_chars(&values, "");
+    char item[64];
+    for (u32 i = 0; i < size; i++) {
+        snprintf(item, sizeof(item), "%sm%u:mut %s", i ? ", " : "", i, i % 2 ? "f64" : "int");
+        string_add_chars(&fields, item);
+        snprintf(item, sizeof(item), "%s%u%s", i ? ", " : "", i, i % 2 ? ".0" : "");
+        string_add_chars(&values, item);
+    }
+    string_add_chars(code, "struct Big = ");
+    string_add(code, &fields);
+    string_add_chars(code, "\n");
+    (*lines)++;
+    _begin_statements(code, indent, lines);
+    string_add_chars(code, indent);
+    string_add_chars(code, "let mut s = Big{");
+    string_add(code, &values);
+    string_add_chars(code, "}\n");
+    (*lines)++;
+    for (u32 i = 0; i < size; i++) {
+        _add(code, lines, "%ss.m%u = s.m%u + %s\n", indent, i, i, i % 2 ? "1.5" : "1");
+    }
+    _add(code, lines, "%ss.m0\n", indent);
+    string_deinit(&values);
+    string_deinit(&fields);
+}
+
+static void _gen_generics(string *code, u32 size, const char *indent, u32 *lines)
+{
+    for (u32 i = 0; i < size; i++) {
+        _add(code, lines, "def g%u(x): x * x + x\n", i);
+    }
+    _begin_statements(code, indent, lines);
+    for (u32 i = 0; i < size; i++) {
+        _add(code, lines, "%slet a%u = g%u(%u)\n", indent, i, i, i);
+        _add(code, lines, "%slet b%u = g%u(%u.5)\n", indent, i, i, i);
+    }
+    _add(code, lines, "%sa0\n", indent);
+}
+
+static void _gen_match_table(string *code, u32 size, const char *indent, u32 *lines)
+{
+    _add(code, lines, "def pm(x):\n");
+    _add(code, lines, "    match x with\n");
+    for (u32 i = 0; i < size; i++) {
+        _add(code, lines, "    | %u -> %u\n", i, i * 3 + 1);
+    }
+    _add(code, lines, "    | _ -> 0\n");
+    _begin_statements(code, indent, lines);
+    _add(code, lines, "%spm(%u)\n", indent, size / 2);
+}
+
+string gen_program(struct program_params *params, u32 *lines)
+{
+    string code;
+    string_init_chars(&code, "");
+    *lines = 0;
+    u32 size = params->size ? params->size : 1;
+    const char *indent = params->wrap_main ? "    " : "";
+    switch (params->shape) {
+    case SHAPE_FUNCTIONS:
+        _gen_functions(&code, size, indent, lines);
+        break;
+    case SHAPE_DEEP_EXPR:
+        _gen_deep_expr(&code, size, indent, lines);
+        break;
+    case SHAPE_LARGE_STRUCT:
+        _gen_large_struct(&code, size, indent, lines);
+        break;
+    case SHAPE_GENERICS:
+        _gen_generics(&code, size, indent, lines);
+        break;
+    case SHAPE_MATCH_TABLE:
+        _gen_match_table(&code, size, indent, lines);
+        break;
+    default:
+        break;
+    }
+    return code;
+}
@@ -0,0 +1,53 @@
+/*
+ * program_gen.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the synthetic m program generator used by the compiler throughput benchmarks
+ */
+#ifndef __MLANG_PROGRAM_GEN_H__
+#define __MLANG_PROGRAM_GEN_H__
+
+#include "clib/util.h"
+#include "clib/string.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FOREACH_PROGRAM_SHAPE(ENUM_ITEM) \
+    ENUM_ITEM(SHAPE_FUNCTIONS)           \
+    ENUM_ITEM(SHAPE_DEEP_EXPR)           \
+    ENUM_ITEM(SHAPE_LARGE_STRUCT)        \
+    ENUM_ITEM(SHAPE_GENERICS)            \
+    ENUM_ITEM(SHAPE_MATCH_TABLE)
+
+enum program_shape {
+    FOREACH_PROGRAM_SHAPE(GENERATE_ENUM)
+    SHAPE_COUNT
+};
+
+/*
+ * size is what the shape scales:
+ *   functions:    number of functions, each calling the previous one
+ *   deep_expr:    nesting depth of the parenthesized expressions, bounded by the parser stack
+ *   large_struct: number of struct fields
+ *   generics:     number of generic functions, each specialized for int and f64
+ *   match_table:  number of match arms
+ */
+struct program_params {
+    enum program_shape shape;
+    u32 size;
+    //put the top level statements into a main function, for llvm which has no start function
+    bool wrap_main;
+};
+
+const char *program_shape_name(enum program_shape shape);
+//the program is a valid module ending with an expression, lines is set to its line count
+string gen_program(struct program_params *params, u32 *lines);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+// n rounds of copying a struct of 32 f64 and of initializing arrays from literals: a table
+// of 64 constants and a histogram of 64 zeros, returns a checksum of both
+
+struct Frame = m0:f64, m1:f64, m2:f64, m3:f64, m4:f64, m5:f64, m6:f64, m7:f64, m8:f64, m9:f64, m10:f64, m11:f64, m12:f64, m13:f64, m14:f64, m15:f64, m16:f64, m17:f64, m18:f64, m19:f64, m20:f64, m21:f64, m22:f64, m23:f64, m24:f64, m25:f64, m26:f64, m27:f64, m28:f64, m29:f64, m30:f64, m31:f64
+
+def trace(f:Frame): f.m0 + f.m5 + f.m26 + f.m31
+
+def lookup(i:int) -> int:
+    let table = [3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3, 2, 3, 8, 4, 6, 2, 6, 4, 3, 3, 8, 3, 2, 7, 9, 5, 0, 2, 8, 8, 4, 1, 9, 7, 1, 6, 9, 3, 9, 9, 3, 7, 5, 1, 0, 5, 8, 2, 0, 9, 7, 4, 9, 4, 4, 5, 9, 2]
+    table[i % 64]
+
+def run(n:int) -> int:
+    let frame = Frame{1.0, 0.5, 0.25, 0.125, 0.5, 2.0, 0.5, 0.25, 0.25, 0.5, 3.0, 0.5, 0.125, 0.25, 0.5, 4.0, 2.0, 0.5, 0.25, 0.125, 0.5, 1.0, 0.5, 0.25, 0.25, 0.5, 4.0, 0.5, 0.125, 0.25, 0.5, 3.0}
+    let mut sum = 0.0
+    let mut count = 0
+    for r in 0..n:
+        let copy = frame
+        sum = sum + trace(copy)
+        let mut hist = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]
+        hist[r % 64] = lookup(r)
+        count = count + hist[r % 64] + hist[(r + 1) % 64]
+    count + (int)(sum / 1000.0)
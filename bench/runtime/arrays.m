@@ -0,0 +1,23 @@
+// n passes over a 64x64 u8 image and f64 vectors of 256 elements: a row is added to each row
+// of the image and one vector is moved towards the other, returns a checksum of both
+
+def run(n:int) -> int:
+    let mut img:u8[64][64], row:u8[64]
+    let mut x:f64[256], y:f64[256]
+    for p in 0..64:
+        row[p] = p * 3
+        for q in 0..64:
+            img[p][q] = p + q * 5
+    for k in 0..256:
+        x[k] = k * 0.25
+        y[k] = 1.0
+    let a = 0.5
+    let mut sum = 0
+    for r in 0..n:
+        for i in 0..64:
+            for j in 0..64:
+                img[i][j] = img[i][j] + row[j]
+        for m in 0..256:
+            y[m] = a * x[m] + y[m] * 0.5
+        sum = sum + (int)img[r % 64][(r * 7) % 64] + (int)y[(r * 3) % 256]
+    sum
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * speed of the code emitted by the compiler: each program of the corpus in bench/runtime is
+ * compiled to wasm without and with simd and run by node with run_wasm.js, and compiled to
+ * native code by the llvm backend at -O0, -O2 and -O3 and run by the jit. all are timed against
+ * the C version of the program, with the size of the wasm modules and of the native object file.
+ * the modules in bench/runtime/lto are jitted as separate modules and linked into one module
+ * by link time optimization, so the calls across them can be inlined
+ */
+#include "bench.h"
+#include "runtime_c.h"
+#include "compiler/engine.h"
+#include "compiler/jit.h"
+#include "codegen/wasm/cg_wasm.h"
+#include "codegen/llvm/cg_llvm.h"
+#include "sema/analyzer.h"
+#include <llvm-c/BitWriter.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 5
+
+struct runtime_program {
+    const char *name;
+    int n; //argument of run(n), sized for tens of milliseconds of native code
+    int (*c_run)(int n);
+    bool is_wasm_only; //the llvm backend does not compile it, e.g. u8 arithmetic
+};
+
+static struct runtime_program programs[] = {
+    { "mandelbrot", 200, c_mandelbrot, false },
+    { "nbody", 100000, c_nbody, false },
+    { "matmul", 50, c_matmul, false },
+    { "sort", 20, c_sort, false },
+    { "format", 200000, c_format, false },
+    { "structs", 1000000, c_structs, false },
+    { "arrays", 2000, c_arrays, true },
+    { "aggregates", 1000000, c_aggregates, false },
+};
+
+typedef int (*run_fun)(int n);
+
+//the jit returns run as an object pointer, copied into the function pointer
+static run_fun _find_run(struct JIT *jit)
+{
+    void *address = jit_find_symbol(jit, "run").fp.address;
+    run_fun run;
+    memcpy(&run, &address, sizeof(run));
+    return run;
+}
+
+static u64 _time_best(run_fun run, int n, int *result)
+{
+    u64 best = 0;
+    *result = run(n); //warm up
+    for (int i = 0; i < ROUNDS; i++) {
+        u64 start = bench_now_ns();
+        *result = run(n);
+        u64 ns = bench_now_ns() - start;
+        if (!best || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+//write the wasm module to path, returns the module size, 0 if it failed to compile
+static u32 _compile_wasm(const char *code, const char *path, u32 target_features)
+{
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm *)engine->be->cg;
+    cg->target_features = target_features;
+    u8 *data = compile_to_wasm(engine, code);
+    u32 size = cg->ba.size;
+    cg->ba.data = 0;
+    engine_free(engine);
+    if (!data)
+        return 0;
+    FILE *file = fopen(path, "wb");
+    if (file) {
+        fwrite(data, 1, size, file);
+        fclose(file);
+    }
+    free(data);
+    return file ? size : 0;
+}
+
+//run the module by node, returns the best ns of one call or 0 if node is not available
+static u64 _run_wasm(const char *path, int n, int *result)
+{
+    char command[512];
+    snprintf(command, sizeof(command), "node \"%s/bench/runtime/run_wasm.js\" \"%s\" %d %d 2>/dev/null", M_SOURCE_DIR, path, n, ROUNDS);
+    FILE *pipe = popen(command, "r");
+    if (!pipe)
+        return 0;
+    unsigned long long ns = 0;
+    if (fscanf(pipe, "%d %llu", result, &ns) != 2)
+        ns = 0;
+    pclose(pipe);
+    return ns;
+}
+
+//jit the program with the llvm backend at the opt level and time it, returns 0 if it failed to compile
+static u64 _run_native(const char *code, enum llvm_opt_level opt_level, int n, int *result, size_t *object_size)
+{
+    struct engine *engine = engine_llvm_new(M_SOURCE_DIR "/src/sys", false);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    //the jit generates code at the opt level of the engine
+    cg->target_options.opt_level = opt_level;
+    struct JIT *jit = jit_new(engine);
+    u64 ns = 0;
+    *object_size = 0;
+    create_ir_module(cg, "runtime");
+    struct ast_node *block = parse_code(engine->fe->parser, code);
+    if (block) {
+        analyze(cg->base.sema_context, block);
+        emit_code(cg, block);
+        for (size_t i = 0; i < array_size(&block->block->nodes); i++) {
+            emit_ir_code(cg, array_get_ptr(&block->block->nodes, i));
+        }
+        optimize_ir_module(cg);
+        //the object file the compiler would write for the module, the jit compiles the same way
+        char *error = 0;
+        LLVMMemoryBufferRef object = 0;
+        if (!LLVMTargetMachineEmitToMemoryBuffer(cg->target_machine, cg->module, LLVMObjectFile, &error, &object)) {
+            *object_size = LLVMGetBufferSize(object);
+            LLVMDisposeMemoryBuffer(object);
+        } else {
+            LLVMDisposeMessage(error);
+        }
+        void *resource_tracker = jit_add_module(jit, cg->module);
+        cg->module = 0;
+        run_fun run = _find_run(jit);
+        if (run)
+            ns = _time_best(run, n, result);
+        jit_remove_module(resource_tracker);
+        node_free(block);
+    }
+    jit_free(jit);
+    engine_free(engine);
+    return ns;
+}
+
+static void _report(const char *program, const char *metric, double value, const char *unit)
+{
+    char name[128];
+    snprintf(name, sizeof(name), "%s %s", program, metric);
+    bench_report("runtime", name, value, unit);
+}
+
+static void _check_result(const char *program, const char *backend, int result, int expected)
+{
+    if (result != expected)
+        fprintf(stderr, "runtime %s: %s result %d is not %d of C\n", program, backend, result, expected);
+}
+
+static void _time_wasm(struct runtime_program *program, const char *code, const char *path, const char *backend, u32 target_features, int c_result, u64 c_ns)
+{
+    char metric[64];
+    u32 wasm_size = _compile_wasm(code, path, target_features);
+    if (!wasm_size)
+        return;
+    snprintf(metric, sizeof(metric), "%s module bytes", backend);
+    _report(program->name, metric, wasm_size, "bytes");
+    int result;
+    u64 ns = _run_wasm(path, program->n, &result);
+    if (ns) {
+        _check_result(program->name, backend, result, c_result);
+        snprintf(metric, sizeof(metric), "%s ns/op", backend);
+        _report(program->name, metric, ns, "ns");
+        snprintf(metric, sizeof(metric), "%s vs c", backend);
+        _report(program->name, metric, (double)ns / c_ns, "x");
+    }
+    remove(path);
+}
+
+static void _time_native(struct runtime_program *program, const char *code, const char *backend, enum llvm_opt_level opt_level, int c_result, u64 c_ns)
+{
+    char metric[64];
+    int result;
+    size_t object_size;
+    u64 ns = _run_native(code, opt_level, program->n, &result, &object_size);
+    if (!ns)
+        return;
+    _check_result(program->name, backend, result, c_result);
+    snprintf(metric, sizeof(metric), "%s object bytes", backend);
+    _report(program->name, metric, object_size, "bytes");
+    snprintf(metric, sizeof(metric), "%s ns/op", backend);
+    _report(program->name, metric, ns, "ns");
+    snprintf(metric, sizeof(metric), "%s vs c", backend);
+    _report(program->name, metric, (double)ns / c_ns, "x");
+}
+
+BENCH(bench_runtime, corpus)
+{
+    char path[256];
+    for (size_t i = 0; i < ARRAY_SIZE(programs); i++) {
+        struct runtime_program *program = &programs[i];
+        snprintf(path, sizeof(path), "%s/bench/runtime/%s.m", M_SOURCE_DIR, program->name);
+        const char *code = read_text_file(path);
+        if (!code)
+            continue;
+        int c_result;
+        u64 c_ns = _time_best(program->c_run, program->n, &c_result);
+        _report(program->name, "c ns/op", c_ns, "ns");
+
+        snprintf(path, sizeof(path), "runtime_%s.wasm", program->name);
+        _time_wasm(program, code, path, "wasm", 0, c_result, c_ns);
+        _time_wasm(program, code, path, "wasm simd", WASM_FEATURE_SIMD, c_result, c_ns);
+        if (program->is_wasm_only) {
+            free((void *)code);
+            continue;
+        }
+
+        _time_native(program, code, "native O0", LLVM_OPT_O0, c_result, c_ns);
+        _time_native(program, code, "native O2", LLVM_OPT_O2, c_result, c_ns);
+        _time_native(program, code, "native O3", LLVM_OPT_O3, c_result, c_ns);
+        free((void *)code);
+    }
+}
+
+static const char *lto_modules[] = { "vec", "hash", "particles" };
+#define LTO_MODULES ARRAY_SIZE(lto_modules)
+#define LTO_N 2000000
+
+//emit the module of bench/runtime/lto, optimized as lto says, returns 0 if it failed to compile
+static struct engine *_compile_lto_module(const char *name, bool lto)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/bench/runtime/lto/%s.m", M_SOURCE_DIR, name);
+    const char *code = read_text_file(path);
+    if (!code)
+        return 0;
+    struct engine *engine = engine_llvm_new(M_SOURCE_DIR "/src/sys", false);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    cg->target_options.lto = lto;
+    create_ir_module(cg, name);
+    struct ast_node *block = parse_code(engine->fe->parser, code);
+    free((void *)code);
+    if (!block) {
+        engine_free(engine);
+        return 0;
+    }
+    analyze(cg->base.sema_context, block);
+    emit_code(cg, block);
+    for (size_t i = 0; i < array_size(&block->block->nodes); i++) {
+        emit_ir_code(cg, array_get_ptr(&block->block->nodes, i));
+    }
+    optimize_ir_module(cg);
+    node_free(block);
+    return engine;
+}
+
+//each module is optimized and jitted on its own, the calls across them are calls in the object code
+static u64 _run_separate_modules(int *result)
+{
+    struct engine *engines[LTO_MODULES] = { 0 };
+    u64 ns = 0;
+    size_t compiled = 0;
+    for (; compiled < LTO_MODULES; compiled++) {
+        engines[compiled] = _compile_lto_module(lto_modules[compiled], false);
+        if (!engines[compiled])
+            break;
+    }
+    if (compiled == LTO_MODULES) {
+        struct JIT *jit = jit_new(engines[0]);
+        void *resource_trackers[LTO_MODULES];
+        for (size_t i = 0; i < LTO_MODULES; i++) {
+            struct cg_llvm *cg = (struct cg_llvm *)engines[i]->be->cg;
+            resource_trackers[i] = jit_add_module(jit, cg->module);
+            cg->module = 0;
+        }
+        run_fun run = _find_run(jit);
+        if (run)
+            ns = _time_best(run, LTO_N, result);
+        for (size_t i = 0; i < LTO_MODULES; i++)
+            jit_remove_module(resource_trackers[i]);
+        jit_free(jit);
+    }
+    for (size_t i = 0; i < compiled; i++)
+        engine_free(engines[i]);
+    return ns;
+}
+
+//the bitcode of the modules optimized by the pre-link pipeline is linked and optimized as one module
+static u64 _run_linked_modules(int *result)
+{
+    LLVMMemoryBufferRef bitcodes[LTO_MODULES];
+    struct engine *first = 0;
+    size_t compiled = 0;
+    for (; compiled < LTO_MODULES; compiled++) {
+        struct engine *engine = _compile_lto_module(lto_modules[compiled], true);
+        if (!engine)
+            break;
+        bitcodes[compiled] = LLVMWriteBitcodeToMemoryBuffer(((struct cg_llvm *)engine->be->cg)->module);
+        if (first)
+            engine_free(engine);
+        else
+            first = engine;
+    }
+    u64 ns = 0;
+    //linked in the context of the first engine which the jit shares
+    LLVMModuleRef module = compiled == LTO_MODULES ? link_bitcode_modules(((struct cg_llvm *)first->be->cg)->context, bitcodes, LTO_MODULES) : 0;
+    for (size_t i = 0; i < compiled; i++)
+        LLVMDisposeMemoryBuffer(bitcodes[i]);
+    if (module) {
+        LLVMTargetDataRef target_data;
+        LLVMTargetMachineRef target_machine = create_target_machine(module, 0, &target_data);
+        run_ir_pipeline(module, target_machine, LLVM_OPT_O2, LLVM_PIPELINE_LTO);
+        LLVMDisposeTargetData(target_data);
+        LLVMDisposeTargetMachine(target_machine);
+        struct JIT *jit = jit_new(first);
+        void *resource_tracker = jit_add_module(jit, module);
+        run_fun run = _find_run(jit);
+        if (run)
+            ns = _time_best(run, LTO_N, result);
+        jit_remove_module(resource_tracker);
+        jit_free(jit);
+    }
+    if (first)
+        engine_free(first);
+    return ns;
+}
+
+BENCH(bench_runtime, lto)
+{
+    int separate_result = 0, linked_result = 0;
+    u64 separate_ns = _run_separate_modules(&separate_result);
+    u64 linked_ns = _run_linked_modules(&linked_result);
+    if (!separate_ns || !linked_ns)
+        return;
+    if (separate_result != linked_result)
+        fprintf(stderr, "runtime lto: linked result %d is not %d of separate modules\n", linked_result, separate_result);
+    _report("particles", "native O2 separate modules ns/op", separate_ns, "ns");
+    _report("particles", "native O2 lto ns/op", linked_ns, "ns");
+    _report("particles", "lto vs separate", (double)linked_ns / separate_ns, "x");
+}
@@ -0,0 +1,23 @@
+// decimal formatting of n ints into a digit buffer, returns a checksum of the digits
+
+def run(n:int) -> int:
+    let mut buf:int[16]
+    let mut checksum = 0
+    for r in 0..n:
+        let mut len = 0
+        let mut value = r * 7919 + 1
+        while value > 0:
+            buf[len] = value % 10 + 48
+            len++
+            value = value / 10
+        let mut lo = 0
+        let mut hi = len - 1
+        while lo < hi:
+            let t = buf[lo]
+            buf[lo] = buf[hi]
+            buf[hi] = t
+            lo++
+            hi--
+        for p in 0..len:
+            checksum = (checksum * 31 + buf[p]) % 1000003
+    checksum
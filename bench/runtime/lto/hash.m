@@ -0,0 +1,3 @@
+// fnv style mixing of the positions of particles.m
+
+def mix(h:int, x:int) -> int: (h ^ x) * 16777619
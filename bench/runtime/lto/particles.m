@@ -0,0 +1,19 @@
+// n steps of a particle pulled by a fixed direction, every operation is a call into vec.m or
+// hash.m, returns the hash of the positions. the calls are inlined only when the modules are
+// linked before they are optimized
+
+from vec import func dot(ax:f64, ay:f64, bx:f64, by:f64) -> f64
+from vec import func lerp(a:f64, b:f64, t:f64) -> f64
+from vec import func clamp(x:f64, lo:f64, hi:f64) -> f64
+from hash import func mix(h:int, x:int) -> int
+
+def run(n:int) -> int:
+    let mut h = 0
+    let mut x = 0.5
+    let mut y = 0.25
+    for i in 0..n:
+        let d = dot(x, y, 0.75, -0.5)
+        x = clamp(lerp(x, d, 0.5) + 0.125, -1.0, 1.0)
+        y = clamp(lerp(y, x, 0.25) - 0.0625, -1.0, 1.0)
+        h = mix(h, (int)(x * 1000.0))
+    h
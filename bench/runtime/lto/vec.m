@@ -0,0 +1,10 @@
+// 2d vector helpers of particles.m, small enough that each call costs more than its body
+
+def dot(ax:f64, ay:f64, bx:f64, by:f64) -> f64: ax * bx + ay * by
+
+def lerp(a:f64, b:f64, t:f64) -> f64: a + (b - a) * t
+
+def clamp(x:f64, lo:f64, hi:f64) -> f64:
+    if x < lo: lo
+    elif x > hi: hi
+    else: x
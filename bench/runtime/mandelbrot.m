@@ -0,0 +1,34 @@
+// mandelbrot set of the README: escape time of n x 3n/4 pixels and the color of each pixel,
+// returns the sum of the color channels
+
+def color(iter_count:int, iter_max:int, sq_dist:f64) -> int:
+    let mut v = 0.0, r = 0.0, g = 0.0, b = 0.0
+    if iter_count < iter_max:
+        v = (log(iter_count+1.5-(log2((log(sq_dist))/2.0))))/3.4
+        if v < 1.0:
+            r = v ** 4;g = v ** 2.5;b = v
+        else:
+            v = v < 2.0 ? 2.0 - v : 0.0
+            r = v;g = v ** 1.5;b = v ** 3.0
+    (int)(r * 255) + (int)(g * 255) + (int)(b * 255)
+
+def run(n:int) -> int:
+    let width = n, height = n * 3 / 4
+    let xmin = -2.0, ymin = -1.2, xmax = 1.0, ymax = 1.2
+    let scalex = (xmax-xmin)/width, scaley = (ymax-ymin)/height, max_iter = 510
+    let mut sum = 0
+    for x in 0..width:
+        for y in 0..height:
+            let cx = xmin + scalex*x
+            let cy = ymin + scaley*y
+            let mut zx = 0.0, zy = 0.0
+            let mut zx2 = 0.0, zy2 = 0.0
+            let mut i = 0
+            while i<max_iter and (zx2 + zy2) < 4.0:
+                zy = 2.0 * zx * zy + cy
+                zx = zx2  - zy2 + cx
+                zx2 = zx * zx
+                zy2 = zy * zy
+                i++
+            sum = sum + color(i, max_iter, zx2 + zy2)
+    sum
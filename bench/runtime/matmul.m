@@ -0,0 +1,18 @@
+// n products of 32x32 f64 matrices, returns the sum of one element of each product
+
+def run(n:int) -> int:
+    let mut a:f64[32][32], b:f64[32][32], c:f64[32][32]
+    for p in 0..32:
+        for q in 0..32:
+            a[p][q] = p * 0.5 - q * 0.25
+            b[p][q] = q * 0.5 - p * 0.125
+    let mut sum = 0.0
+    for r in 0..n:
+        for i in 0..32:
+            for j in 0..32:
+                let mut acc = 0.0
+                for k in 0..32:
+                    acc = acc + a[i][k] * b[k][j]
+                c[i][j] = acc
+        sum = sum + c[r % 32][(r * 7) % 32]
+    (int)sum
@@ -0,0 +1,35 @@
+// n steps of a 5 body gravity simulation, returns the kinetic energy scaled to an int
+
+def run(n:int) -> int:
+    let mut x:f64[5], y:f64[5], z:f64[5], vx:f64[5], vy:f64[5], vz:f64[5], m:f64[5]
+    for k in 0..5:
+        x[k] = k * 1.5
+        y[k] = k * 0.5 - 1.0
+        z[k] = k * 0.25
+        vx[k] = k * 0.01
+        vy[k] = 0.02 - k * 0.01
+        vz[k] = 0.0
+        m[k] = k + 1.0
+    let dt = 0.01
+    for step in 0..n:
+        for i in 0..5:
+            for j in i+1..5:
+                let dx = x[i] - x[j], dy = y[i] - y[j], dz = z[i] - z[j]
+                let d2 = dx * dx + dy * dy + dz * dz + 0.01
+                let mag = dt / (d2 * d2 ** 0.5)
+                vx[i] = vx[i] - dx * m[j] * mag
+                vy[i] = vy[i] - dy * m[j] * mag
+                vz[i] = vz[i] - dz * m[j] * mag
+                vx[j] = vx[j] + dx * m[i] * mag
+                vy[j] = vy[j] + dy * m[i] * mag
+                vz[j] = vz[j] + dz * m[i] * mag
+        for b in 0..5:
+            x[b] = x[b] + dt * vx[b]
+            y[b] = y[b] + dt * vy[b]
+            z[b] = z[b] + dt * vz[b]
+    let mut e = 0.0
+    for c in 0..5:
+        let v2 = vx[c] * vx[c] + vy[c] * vy[c] + vz[c] * vz[c]
+        e = e + 0.5 * m[c] * v2
+    let scaled = e * 1000000.0
+    (int)scaled
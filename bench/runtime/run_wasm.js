@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * runs the exported run(n) function of a wasm module emitted by the m compiler and prints
+ * "<result> <best ns of one call>". usage: node run_wasm.js <module.wasm> <n> <rounds>
+ * the module imports memory, the stack pointer and the math functions from docs/m.wasm as it
+ * does in the browser
+ */
+const fs = require('fs');
+const path = require('path');
+
+const docs = path.resolve(__dirname, '../../docs');
+const wasi_env = require(path.join(docs, 'wasi.js')).wasi();
+const m = new WebAssembly.Instance(new WebAssembly.Module(fs.readFileSync(path.join(docs, 'm.wasm'))),
+    { wasi_snapshot_preview1: wasi_env }).exports;
+wasi_env.setEnv(m.memory, (text) => process.stderr.write(text));
+
+const code = new WebAssembly.Instance(new WebAssembly.Module(fs.readFileSync(process.argv[2])), {
+    sys: {
+        print: m.print,
+        putchar: m.putchar,
+        memory: m.memory,
+        __memory_base: new WebAssembly.Global({ value: 'i32', mutable: false }, 64 * 1024),
+        __stack_pointer: m.__stack_pointer,
+        setImageData: () => {}
+    },
+    math: {
+        pow: m.pow,
+        log2: m.log2,
+        log: m.log
+    }
+}).exports;
+
+const n = parseInt(process.argv[3]);
+const rounds = parseInt(process.argv[4]);
+//the first call is left out of the measure, it includes the tier up of the wasm code
+let result = code.run(n);
+let best = Infinity;
+for (let i = 0; i < rounds; i++) {
+    const start = process.hrtime.bigint();
+    result = code.run(n);
+    best = Math.min(best, Number(process.hrtime.bigint() - start));
+}
+console.log(`${result} ${best}`);
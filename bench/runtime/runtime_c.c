@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * C versions of the runtime benchmark corpus, written statement by statement after the m
+ * programs so that both compute the same checksum: the same f64 operations in the same order,
+ * pow for ** and wrapping 32-bit int arithmetic
+ */
+#include "runtime_c.h"
+#include <math.h>
+
+static int _color(int iter_count, int iter_max, double sq_dist)
+{
+    double v = 0.0, r = 0.0, g = 0.0, b = 0.0;
+    if (iter_count < iter_max) {
+        v = (log(iter_count + 1.5 - (log2((log(sq_dist)) / 2.0)))) / 3.4;
+        if (v < 1.0) {
+            r = pow(v, 4);
+            g = pow(v, 2.5);
+            b = v;
+        } else {
+            v = v < 2.0 ? 2.0 - v : 0.0;
+            r = v;
+            g = pow(v, 1.5);
+            b = pow(v, 3.0);
+        }
+    }
+    return (int)(r * 255) + (int)(g * 255) + (int)(b * 255);
+}
+
+int c_mandelbrot(int n)
+{
+    int width = n, height = n * 3 / 4;
+    double xmin = -2.0, ymin = -1.2, xmax = 1.0, ymax = 1.2;
+    double scalex = (xmax - xmin) / width, scaley = (ymax - ymin) / height;
+    int max_iter = 510;
+    int sum = 0;
+    for (int x = 0; x < width; x++) {
+        for (int y = 0; y < height; y++) {
+            double cx = xmin + scalex * x;
+            double cy = ymin + scaley * y;
+            double zx = 0.0, zy = 0.0;
+            double zx2 = 0.0, zy2 = 0.0;
+            int i = 0;
+            while (i < max_iter && (zx2 + zy2) < 4.0) {
+                zy = 2.0 * zx * zy + cy;
+                zx = zx2 - zy2 + cx;
+                zx2 = zx * zx;
+                zy2 = zy * zy;
+                i++;
+            }
+            sum = sum + _color(i, max_iter, zx2 + zy2);
+        }
+    }
+    return sum;
+}
+
+int c_nbody(int n)
+{
+    double x[5], y[5], z[5], vx[5], vy[5], vz[5], m[5];
+    for (int k = 0; k < 5; k++) {
+        x[k] = k * 1.5;
+        y[k] = k * 0.5 - 1.0;
+        z[k] = k * 0.25;
+        vx[k] = k * 0.01;
+        vy[k] = 0.02 - k * 0.01;
+        vz[k] = 0.0;
+        m[k] = k + 1.0;
+    }
+    double dt = 0.01;
+    for (int step = 0; step < n; step++) {
+        for (int i = 0; i < 5; i++) {
+            for (int j = i + 1; j < 5; j++) {
+                double dx = x[i] - x[j], dy = y[i] - y[j], dz = z[i] - z[j];
+                double d2 = dx * dx + dy * dy + dz * dz + 0.01;
+                double mag = dt / (d2 * pow(d2, 0.5));
+                vx[i] = vx[i] - dx * m[j] * mag;
+                vy[i] = vy[i] - dy * m[j] * mag;
+                vz[i] = vz[i] - dz * m[j] * mag;
+                vx[j] = vx[j] + dx * m[i] * mag;
+                vy[j] = vy[j] + dy * m[i] * mag;
+                vz[j] = vz[j] + dz * m[i] * mag;
+            }
+        }
+        for (int b = 0; b < 5; b++) {
+            x[b] = x[b] + dt * vx[b];
+            y[b] = y[b] + dt * vy[b];
+            z[b] = z[b] + dt * vz[b];
+        }
+    }
+    double e = 0.0;
+    for (int c = 0; c < 5; c++) {
+        double v2 = vx[c] * vx[c] + vy[c] * vy[c] + vz[c] * vz[c];
+        e = e + 0.5 * m[c] * v2;
+    }
+    double scaled = e * 1000000.0;
+    return (int)scaled;
+}
+
+int c_matmul(int n)
+{
+    double a[32][32], b[32][32], c[32][32];
+    for (int p = 0; p < 32; p++) {
+        for (int q = 0; q < 32; q++) {
+            a[p][q] = p * 0.5 - q * 0.25;
+            b[p][q] = q * 0.5 - p * 0.125;
+        }
+    }
+    double sum = 0.0;
+    for (int r = 0; r < n; r++) {
+        for (int i = 0; i < 32; i++) {
+            for (int j = 0; j < 32; j++) {
+                double acc = 0.0;
+                for (int k = 0; k < 32; k++) {
+                    acc = acc + a[i][k] * b[k][j];
+                }
+                c[i][j] = acc;
+            }
+        }
+        sum = sum + c[r % 32][(r * 7) % 32];
+    }
+    return (int)sum;
+}
+
+int c_sort(int n)
+{
+    int a[1000];
+    int seed = 12345;
+    int checksum = 0;
+    for (int r = 0; r < n; r++) {
+        for (int p = 0; p < 1000; p++) {
+            //m int multiplication wraps around at 32 bits
+            seed = (int)(((unsigned)seed * 1103515245u + 12345u) & 2147483647u);
+            a[p] = seed % 100000;
+        }
+        for (int i = 1; i < 1000; i++) {
+            int key = a[i];
+            int j = i - 1;
+            while (j >= 0 && a[j] > key) {
+                a[j + 1] = a[j];
+                j--;
+            }
+            a[j + 1] = key;
+        }
+        checksum = (checksum + a[r % 1000] + a[999]) % 1000000007;
+    }
+    return checksum;
+}
+
+int c_format(int n)
+{
+    int buf[16];
+    int checksum = 0;
+    for (int r = 0; r < n; r++) {
+        int len = 0;
+        int value = r * 7919 + 1;
+        while (value > 0) {
+            buf[len] = value % 10 + 48;
+            len++;
+            value = value / 10;
+        }
+        int lo = 0;
+        int hi = len - 1;
+        while (lo < hi) {
+            int t = buf[lo];
+            buf[lo] = buf[hi];
+            buf[hi] = t;
+            lo++;
+            hi--;
+        }
+        for (int p = 0; p < len; p++) {
+            checksum = (checksum * 31 + buf[p]) % 1000003;
+        }
+    }
+    return checksum;
+}
+
+struct vec3 {
+    double x, y, z;
+};
+
+static struct vec3 _add(struct vec3 a, struct vec3 b)
+{
+    return (struct vec3){ a.x + b.x, a.y + b.y, a.z + b.z };
+}
+
+static struct vec3 _scale(struct vec3 a, double s)
+{
+    return (struct vec3){ a.x * s, a.y * s, a.z * s };
+}
+
+static double _dot(struct vec3 a, struct vec3 b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+int c_structs(int n)
+{
+    struct vec3 p = { 0.0, 0.0, 0.0 };
+    struct vec3 v = { 0.5, -0.25, 0.125 };
+    double total = 0.0;
+    for (int r = 0; r < n; r++) {
+        struct vec3 d = _scale(v, r % 10 * 0.1);
+        p = _add(p, d);
+        total = total + _dot(p, v);
+    }
+    double scaled = total / 1000.0;
+    return (int)scaled;
+}
+
+int c_arrays(int n)
+{
+    unsigned char img[64][64], row[64];
+    double x[256], y[256];
+    for (int p = 0; p < 64; p++) {
+        row[p] = (unsigned char)(p * 3);
+        for (int q = 0; q < 64; q++) {
+            img[p][q] = (unsigned char)(p + q * 5);
+        }
+    }
+    for (int k = 0; k < 256; k++) {
+        x[k] = k * 0.25;
+        y[k] = 1.0;
+    }
+    double a = 0.5;
+    int sum = 0;
+    for (int r = 0; r < n; r++) {
+        for (int i = 0; i < 64; i++) {
+            for (int j = 0; j < 64; j++) {
+                img[i][j] = (unsigned char)(img[i][j] + row[j]);
+            }
+        }
+        for (int m = 0; m < 256; m++) {
+            y[m] = a * x[m] + y[m] * 0.5;
+        }
+        sum = sum + (int)img[r % 64][(r * 7) % 64] + (int)y[(r * 3) % 256];
+    }
+    return sum;
+}
+
+struct frame {
+    double m0, m1, m2, m3, m4, m5, m6, m7, m8, m9, m10, m11, m12, m13, m14, m15, m16, m17, m18, m19, m20, m21, m22, m23, m24, m25, m26, m27, m28, m29, m30, m31;
+};
+
+static double _trace(struct frame f)
+{
+    return f.m0 + f.m5 + f.m26 + f.m31;
+}
+
+static int _lookup(int i)
+{
+    int table[64] = { 3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7, 9, 3, 2, 3, 8, 4, 6, 2, 6, 4, 3, 3, 8, 3, 2, 7, 9, 5, 0, 2, 8, 8, 4, 1, 9, 7, 1, 6, 9, 3, 9, 9, 3, 7, 5, 1, 0, 5, 8, 2, 0, 9, 7, 4, 9, 4, 4, 5, 9, 2 };
+    return table[i % 64];
+}
+
+int c_aggregates(int n)
+{
+    struct frame frame = {
+        1.0, 0.5, 0.25, 0.125, 0.5, 2.0, 0.5, 0.25, 0.25, 0.5, 3.0, 0.5, 0.125, 0.25, 0.5, 4.0,
+        2.0, 0.5, 0.25, 0.125, 0.5, 1.0, 0.5, 0.25, 0.25, 0.5, 4.0, 0.5, 0.125, 0.25, 0.5, 3.0,
+    };
+    double sum = 0.0;
+    int count = 0;
+    for (int r = 0; r < n; r++) {
+        struct frame copy = frame;
+        sum = sum + _trace(copy);
+        int hist[64] = { 0 };
+        hist[r % 64] = _lookup(r);
+        count = count + hist[r % 64] + hist[(r + 1) % 64];
+    }
+    return count + (int)(sum / 1000.0);
+}
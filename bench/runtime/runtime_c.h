@@ -0,0 +1,29 @@
+/*
+ * runtime_c.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the C versions of the runtime benchmark corpus, the .m programs in
+ * bench/runtime. each computes what run(n) of the m program of the same name returns
+ */
+#ifndef __MLANG_RUNTIME_C_H__
+#define __MLANG_RUNTIME_C_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int c_mandelbrot(int n);
+int c_nbody(int n);
+int c_matmul(int n);
+int c_sort(int n);
+int c_format(int n);
+int c_structs(int n);
+int c_arrays(int n);
+int c_aggregates(int n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+// insertion sort of 1000 pseudo random ints, n times, returns a checksum of the sorted arrays
+
+def run(n:int) -> int:
+    let mut a:int[1000]
+    let mut seed = 12345
+    let mut checksum = 0
+    for r in 0..n:
+        for p in 0..1000:
+            seed = (seed * 1103515245 + 12345) & 2147483647
+            a[p] = seed % 100000
+        for i in 1..1000:
+            let key = a[i]
+            let mut j = i - 1
+            while j >= 0 and a[j] > key:
+                a[j + 1] = a[j]
+                j--
+            a[j + 1] = key
+        checksum = (checksum + a[r % 1000] + a[999]) % 1000000007
+    checksum
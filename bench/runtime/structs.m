@@ -0,0 +1,20 @@
+// n steps of vector arithmetic on structs passed and returned by value
+
+struct Vec3 = x:f64, y:f64, z:f64
+
+def add(a:Vec3, b:Vec3): Vec3{a.x + b.x, a.y + b.y, a.z + b.z}
+
+def scale(a:Vec3, s:f64): Vec3{a.x * s, a.y * s, a.z * s}
+
+def dot(a:Vec3, b:Vec3): a.x * b.x + a.y * b.y + a.z * b.z
+
+def run(n:int) -> int:
+    let mut p = Vec3{0.0, 0.0, 0.0}
+    let v = Vec3{0.5, -0.25, 0.125}
+    let mut total = 0.0
+    for r in 0..n:
+        let d = scale(v, r % 10 * 0.1)
+        p = add(p, d)
+        total = total + dot(p, v)
+    let scaled = total / 1000.0
+    (int)scaled
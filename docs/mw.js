@@ -27,6 +27,9 @@ function mw(wasi_env, module_name, print_func, is_remote_file, set_image_data) {
                 run_code: run_code,
                 highlight_code: highlight_code,
                 compile: compile,
+                time_report: time_report,
+                set_opt_level: set_opt_level,
+                set_target_features: set_target_features,
                 version: version,
                 mw_instance: obj.instance,
                 canvas_id: '',
@@ -38,6 +41,11 @@ function mw(wasi_env, module_name, print_func, is_remote_file, set_image_data) {
                 compile_code: obj.instance.exports.compile_code,
                 highlight_code: obj.instance.exports.highlight_code,
                 get_code_size: obj.instance.exports.get_code_size,
+                get_time_report: obj.instance.exports.get_time_report,
+                get_phase_count: obj.instance.exports.get_phase_count,
+                get_phase_name: obj.instance.exports.get_phase_name,
+                set_opt_level: obj.instance.exports.set_opt_level,
+                set_target_features: obj.instance.exports.set_target_features,
                 get_version: obj.instance.exports.version,
                 strlen: obj.instance.exports.strlen,
                 putchar: obj.instance.exports.putchar,
@@ -147,6 +155,36 @@ function mw(wasi_env, module_name, print_func, is_remote_file, set_image_data) {
         fs.writeFileSync(file_path, ta, 'binary');
         m_exports.free(wasm);
     }
+    //0 compiles the code as emitted, 1 (the default) runs the peephole optimizer of the wasm backend
+    function set_opt_level(level) {
+        if (m_exports.set_opt_level) {
+            m_exports.set_opt_level(level);
+        }
+    }
+    //1 lets the wasm backend use simd instructions, 0 (the default) keeps to wasm 1.0
+    function set_target_features(features) {
+        if (m_exports.set_target_features) {
+            m_exports.set_target_features(features);
+        }
+    }
+    function time_report() {
+        let ptr = m_exports.get_time_report && m_exports.get_phase_count ? m_exports.get_time_report() : 0;
+        if (!ptr) {
+            return [];
+        }
+        //the phases are named by m.wasm so the list follows include/app/time_report.h
+        let phases = [];
+        for (let i = 0; i < m_exports.get_phase_count(); i++) {
+            phases.push(to_js_str(m_exports.get_phase_name(i)));
+        }
+        //struct phase_stats is six u64 counters
+        let words = new Uint32Array(m_exports.memory.buffer, ptr, phases.length * 12);
+        let u64 = (i, field) => words[i * 12 + field * 2] + words[i * 12 + field * 2 + 1] * 4294967296;
+        return phases.map((phase, i) => ({
+            phase: phase, ns: u64(i, 0), allocs: u64(i, 1), alloc_bytes: u64(i, 2),
+            tokens: u64(i, 3), nodes: u64(i, 4), types: u64(i, 5)
+        }));
+    }
 }
 exports.mw = mw;
 //# sourceMappingURL=mw.js.map
\ No newline at end of file
@@ -173,6 +173,43 @@ let res = shift(cf64 { 10.0, 20.0 })
 res.re + res.im
 `, 110.0 + 220.0);
 
+mtest('pass struct referred later', `
+A struct variable passed to a function in an assignment and used again afterwards
+`, 
+`
+def add_c(a:cf64, b:cf64): cf64 { a.re + b.re, a.im + b.im }
+def scale(a:cf64, s:f64): cf64 { a.re * s, a.im * s }
+def dot(a:cf64, b:cf64): a.re * b.re + a.im * b.im
+def run():
+    let mut p = cf64 { 0.0, 0.0 }
+    let v = cf64 { 1.0, 2.0 }
+    let mut total = 0.0
+    for i in 0..3:
+        let d = scale(v, 2.0)
+        p = add_c(p, d)
+        total = total + dot(p, v)
+    total + p.re
+run()
+`, 66.0);
+
+mtest('pass struct referred later in loop', `
+Struct variables passed to functions nested in expressions of a loop body, each argument gets its own copy
+`, 
+`
+def add_c(a:cf64, b:cf64): cf64 { a.re + b.re, a.im + b.im }
+def scale(a:cf64, s:f64): cf64 { a.re * s, a.im * s }
+def dot(a:cf64, b:cf64): a.re * b.re + a.im * b.im
+def run(n:int):
+    let mut p = cf64 { 0.0, 0.0 }
+    let v = cf64 { 1.0, 2.0 }
+    let mut total = 0.0
+    for i in 0..n:
+        let d = scale(v, i * 1.0)
+        p = add_c(p, d)
+        total = total + dot(p, v)
+    total + p.re
+run(3)
+`, 23.0);
 
 mtest('complex addition', 'complex addition', 
 `
@@ -305,6 +342,94 @@ for i in 0..10:
 a[7][8]
 `, 15);
 
+mtest('array loop', 
+`
+element-wise arithmetic of arrays in a loop, the wasm backend runs such loops with vectors of
+elements when simd is enabled
+`, 
+`
+let mut x:f64[11], y:f64[11]
+for i in 0..11:
+    x[i] = i * 2.0
+    y[i] = 1.0
+let a = 0.5
+for j in 0..11:
+    y[j] = a * x[j] + y[j]
+y[0] + y[9] + y[10]
+`, 22.0);
+
+mtest('u8 row loop', 
+`
+add a row to each row of a two dimensions u8 array, the sums wrap around
+`, 
+`
+let mut img:u8[3][20], row:u8[20]
+for i in 0..3:
+    for j in 0..20:
+        img[i][j] = i * 100 + j
+for k in 0..20:
+    row[k] = 60
+for m in 0..3:
+    for n in 0..20:
+        img[m][n] = img[m][n] + row[n]
+(int)img[0][19] + (int)img[2][1]
+`, 79 + 5);
+
+mtest('array loop between rows', 
+`
+a loop reading one row of an array and writing another
+`, 
+`
+let mut b:int[2][9]
+for i in 0..9:
+    b[0][i] = i
+for j in 0..9:
+    b[1][j] = b[0][j] * 3 - 1
+b[1][8]
+`, 23);
+
+mtest('large struct copy', 
+`
+a struct of 256 bytes or more is copied with one memory.copy instead of a load and store per field
+`, 
+`
+struct Row = a:f64, b:f64, c:f64, d:f64, e:f64, f:f64, g:f64, h:f64
+struct Big = r0:Row, r1:Row, r2:Row, r3:Row
+let s = Big{Row{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, Row{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, Row{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, Row{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}}
+let t = s
+def sum(x:Big): x.r0.a + x.r1.d + x.r2.g + x.r3.h
+sum(t)
+`, 20.0);
+
+mtest('large constant array', 
+`
+an array of constant elements of 256 bytes or more is copied from the data section
+`, 
+`
+let s = "data before the array"
+let a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64]
+a[0] + a[31] + a[63]
+`, 97);
+
+mtest('large zero array', 
+`
+an array of 128 bytes or more of one byte value is filled with memory.fill
+`, 
+`
+let mut a = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]
+a[3] = 5
+a[3] + a[31]
+`, 5);
+
+mtest('large u8 array of one value', 
+`
+an array of 128 bytes or more of one byte value is filled with memory.fill
+`, 
+`
+let a:u8[128] = [7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7]
+(int)a[0] + (int)a[127]
+`, 14);
+
 mtest('pass array to a function', 
 `
 pass array variable to a function.
@@ -117,6 +117,30 @@ for i in 2..step..10:
 sum
 `, 20); 
 
+mtest('for loop with negative step', 'for loop statement counting down with a constant step', 
+`
+let mut sum = 0
+for i in 10..-3..0:
+    sum = sum + i
+sum
+`, 22); 
+
+mtest('for loop with constant trips', 'for loop statement of a few constant trips, the variable is visible after the loop', 
+`
+let mut sum = 0
+for i in 0..3..10:
+    sum = sum + i
+sum + i
+`, 30); 
+
+mtest('for loop of no trip', 'for loop statement with an empty range', 
+`
+let mut sum = 0
+for i in 5..5:
+    sum = sum + 1
+sum + i
+`, 5); 
+
 mtest('nest for loop', 'nest for loop statement', 
 `
 let mut sum = 0
@@ -193,6 +217,19 @@ while i < 5:
 n
 `, 12); 
 
+mtest('while loop local variable', 'declare a variable in the while loop body', 
+`
+def run():
+    let mut i = 0
+    let mut n = 0
+    while i < 5:
+        let sq = i * i
+        n = n + sq
+        i = i + 1
+    n
+run()
+`, 30); 
+
 mtest('for loop continue', 'use continue in for loop', 
 `
 let mut n = 0
@@ -203,6 +240,18 @@ for i in 0..5:
 n
 `, 7); 
 
+mtest('for loop continue with step', 'use continue and break in for loop with a constant step', 
+`
+let mut n = 0
+for i in 20..-2..0:
+    if i == 14:
+        continue
+    if i == 4:
+        break
+    n = n + i
+n + i
+`, 94); 
+
 mtest("mandelbrot set function", "various control block to show program structure",
 `
 let mut a:u8[200][300 * 4]
@@ -1,9 +1,22 @@
 import { mw } from '../mw';
 import { wasi } from '../wasi'
 
+//M_OPT_LEVEL runs the tests at another optimization level of the wasm backend, e.g. M_OPT_LEVEL=0 npx jest
+const opt_level = process.env.M_OPT_LEVEL;
+//M_TARGET_FEATURES runs them with features of the wasm backend, e.g. M_TARGET_FEATURES=1 npx jest for simd
+const target_features = process.env.M_TARGET_FEATURES;
+
 function get_mw(log:CallableFunction|null=null){
     let log_nothing = (t:any) => {};
-    return mw(wasi(), '../docs/m.wasm', log || log_nothing, false, null);
+    return mw(wasi(), '../docs/m.wasm', log || log_nothing, false, null).then((m) => {
+        if (opt_level !== undefined) {
+            m.set_opt_level(parseInt(opt_level));
+        }
+        if (target_features !== undefined) {
+            m.set_target_features(parseInt(target_features));
+        }
+        return m;
+    });
 }
 
 export function mtest(name:string, description:string, code:string, expect_value:any, is_tutorial=true, save_wasm=false)
@@ -4,6 +4,9 @@ export type MInstance = {
 	run_code: CallableFunction, 
 	highlight_code: CallableFunction,
 	compile: any,
+	time_report: CallableFunction,
+	set_opt_level: CallableFunction,
+	set_target_features: CallableFunction,
 	canvas_id:string,
 	text_id:string,
 };
@@ -14,6 +17,11 @@ type MExports = {
 	compile_code:CallableFunction,
 	highlight_code:CallableFunction,
 	get_code_size:CallableFunction,
+	get_time_report:CallableFunction,
+	get_phase_count:CallableFunction,
+	get_phase_name:CallableFunction,
+	set_opt_level:CallableFunction,
+	set_target_features:CallableFunction,
 	get_version: CallableFunction,
 	strlen:CallableFunction,
 
@@ -27,6 +35,17 @@ type MExports = {
 	__stack_pointer: any
 };
 
+//one compile phase of the last compiled code, see include/app/time_report.h
+export type PhaseStats = {
+	phase: string,
+	ns: number,
+	allocs: number,
+	alloc_bytes: number,
+	tokens: number,
+	nodes: number,
+	types: number
+};
+
 export type RunResult = {
 	start_result: any,
 	code_instance: WebAssembly.Instance,
@@ -59,6 +78,9 @@ export function mw(wasi_env:any, module_name:string, print_func:CallableFunction
 				run_code: run_code, 
 				highlight_code: highlight_code,
 				compile: compile,
+				time_report: time_report,
+				set_opt_level: set_opt_level,
+				set_target_features: set_target_features,
 				version: version,
 				mw_instance: obj.instance,
 				canvas_id: '',
@@ -70,6 +92,11 @@ export function mw(wasi_env:any, module_name:string, print_func:CallableFunction
 				compile_code: obj.instance.exports.compile_code as CallableFunction,
 				highlight_code: obj.instance.exports.highlight_code as CallableFunction,
 				get_code_size: obj.instance.exports.get_code_size as CallableFunction,
+				get_time_report: obj.instance.exports.get_time_report as CallableFunction,
+				get_phase_count: obj.instance.exports.get_phase_count as CallableFunction,
+				get_phase_name: obj.instance.exports.get_phase_name as CallableFunction,
+				set_opt_level: obj.instance.exports.set_opt_level as CallableFunction,
+				set_target_features: obj.instance.exports.set_target_features as CallableFunction,
 				get_version: obj.instance.exports.version as CallableFunction,
 				strlen: obj.instance.exports.strlen as CallableFunction,
 
@@ -200,4 +227,37 @@ export function mw(wasi_env:any, module_name:string, print_func:CallableFunction
 		fs.writeFileSync(file_path, ta, 'binary');
 		m_exports.free(wasm);
 	}
+	//0 compiles the code as emitted, 1 (the default) runs the peephole optimizer of the wasm backend
+	function set_opt_level(level:number) : void
+	{
+		if(m_exports.set_opt_level){
+			m_exports.set_opt_level(level);
+		}
+	}
+	//1 lets the wasm backend use simd instructions, 0 (the default) keeps to wasm 1.0
+	function set_target_features(features:number) : void
+	{
+		if(m_exports.set_target_features){
+			m_exports.set_target_features(features);
+		}
+	}
+	function time_report() : PhaseStats[]
+	{
+		let ptr = m_exports.get_time_report && m_exports.get_phase_count ? m_exports.get_time_report() : 0;
+		if(!ptr){
+			return [];
+		}
+		//the phases are named by m.wasm so the list follows include/app/time_report.h
+		let phases:string[] = [];
+		for(let i = 0; i < m_exports.get_phase_count(); i++){
+			phases.push(to_js_str(m_exports.get_phase_name(i)));
+		}
+		//struct phase_stats is six u64 counters
+		let words = new Uint32Array(m_exports.memory.buffer, ptr, phases.length * 12);
+		let u64 = (i:number, field:number) => words[i * 12 + field * 2] + words[i * 12 + field * 2 + 1] * 4294967296;
+		return phases.map((phase, i) => ({
+			phase: phase, ns: u64(i, 0), allocs: u64(i, 1), alloc_bytes: u64(i, 2),
+			tokens: u64(i, 3), nodes: u64(i, 4), types: u64(i, 5)
+		}));
+	}
 }
@@ -11,6 +11,7 @@
 
 #include "clib/hashtable.h"
 #include "clib/typedef.h"
+#include "clib/thread.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,9 +19,11 @@ extern "C" {
 
 struct app{
     struct hashtable error_reports;
+    struct mutex error_reports_lock;
 };
 
 struct app *app_get(void);
+//process wide initialization, it has to be called before any compiler thread is started
 void app_init(void);
 void app_deinit(void);
 void app_reset_error_reports(void);
@@ -68,6 +68,8 @@ void error_init(struct hashtable *error_reports);
 void error_deinit(struct hashtable *error_reports);
 struct error_reports get_error_reports(ErrorHandle handle);
 struct error_report *get_last_error_report(ErrorHandle handle);
+//drop reports of the handle, called when the handle object is freed so that its address can be reused
+void clear_error_reports(ErrorHandle handle);
 void report_error(ErrorHandle handle, enum error_code error_code, struct source_location loc, ...);
 
 #ifdef __cplusplus
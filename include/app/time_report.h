@@ -0,0 +1,72 @@
+/*
+ * time_report.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for compile time instrumentation: wall time, heap allocations and the number of
+ * tokens, ast nodes and types of each compile phase. the counters are per thread and always
+ * counted, a time report takes the difference at phase boundaries.
+ */
+#ifndef __MLANG_TIME_REPORT_H__
+#define __MLANG_TIME_REPORT_H__
+
+#include "clib/typedef.h"
+#include "clib/util.h"
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FOREACH_COMPILE_PHASE(ENUM_ITEM) \
+    ENUM_ITEM(PHASE_FRONTEND)            \
+    ENUM_ITEM(PHASE_PARSE)               \
+    ENUM_ITEM(PHASE_ANALYZE)             \
+    ENUM_ITEM(PHASE_CODEGEN)             \
+    ENUM_ITEM(PHASE_OPTIMIZE)            \
+    ENUM_ITEM(PHASE_EMIT)
+
+enum compile_phase {
+    FOREACH_COMPILE_PHASE(GENERATE_ENUM)
+    PHASE_COUNT
+};
+
+//created by the current thread: tokens by the lexer, nodes by ast_node_new and types by the type context
+struct compile_counters {
+    u64 tokens;
+    u64 nodes;
+    u64 types;
+};
+extern THREAD_LOCAL struct compile_counters g_compile_counters;
+
+struct phase_stats {
+    u64 ns;
+    u64 allocs;
+    u64 alloc_bytes;
+    u64 tokens;
+    u64 nodes;
+    u64 types;
+};
+
+struct time_report {
+    struct phase_stats phases[PHASE_COUNT];
+    //the running phase, PHASE_COUNT if none, and the counters when it began
+    enum compile_phase phase;
+    u64 start_ns;
+    struct alloc_stats start_allocs;
+    struct compile_counters start_counters;
+};
+
+void time_report_init(struct time_report *report);
+//end the running phase and start measuring phase, a phase can be entered more than once
+void time_report_begin(struct time_report *report, enum compile_phase phase);
+void time_report_end(struct time_report *report);
+void time_report_add(struct time_report *sum, struct time_report *report);
+const char *compile_phase_name(enum compile_phase phase);
+void time_report_print(struct time_report *report, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,54 @@
+/*
+ * arena.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * arena (bump) allocator c header file: objects are allocated by bumping a pointer in
+ * a chain of chunks and are released all together by arena_reset or arena_deinit
+ */
+#ifndef __CLIB_ARENA_H__
+#define __CLIB_ARENA_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+struct arena_chunk {
+    struct arena_chunk *next;
+    size_t size; //usable bytes after the chunk header
+};
+
+struct arena {
+    struct arena_chunk *chunks; //current chunk at head
+    char *pos;  //next free byte in current chunk
+    char *end;  //end of current chunk
+    size_t allocated; //bytes handed out since the last reset
+};
+
+//position in the arena, arena_rollback releases everything allocated after it
+struct arena_mark {
+    struct arena_chunk *chunk;
+    char *pos;
+    size_t allocated;
+};
+
+void arena_init(struct arena *arena);
+void arena_deinit(struct arena *arena);
+void *arena_alloc(struct arena *arena, size_t size);
+void *arena_calloc(struct arena *arena, size_t count, size_t size);
+//release all objects, the first chunk is kept for reuse
+void arena_reset(struct arena *arena);
+struct arena_mark arena_get_mark(struct arena *arena);
+void arena_rollback(struct arena *arena, struct arena_mark *mark);
+size_t arena_chunk_count(struct arena *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
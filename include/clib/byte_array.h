@@ -24,8 +24,12 @@ struct byte_array {
 void ba_init(struct byte_array *ba, u32 init_size);
 void ba_deinit(struct byte_array *ba);
 void ba_reset(struct byte_array *ba);
+//make room for bytes more bytes after size, the capacity at least doubles when it grows
+void ba_reserve(struct byte_array *ba, u32 bytes);
 void ba_add(struct byte_array *ba, u8 byte);
-void ba_add_array(struct byte_array *ba, u8 *byte, u32 bytes);
+void ba_add_array(struct byte_array *ba, const u8 *byte, u32 bytes);
+//remove bytes bytes at index, the bytes after them move down
+void ba_remove(struct byte_array *ba, u32 index, u32 bytes);
 void ba_set(struct byte_array *ba, u32 index, u8 byte);
 void ba_add2(struct byte_array *dst, struct byte_array *src);
 
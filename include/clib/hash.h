@@ -9,12 +9,22 @@
 #define __CLIB_HASH_H__
 
 #include "generic.h"
+#include "typedef.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef unsigned int (*hash_fun)(unsigned char *key, size_t len);
+
+//byte hash for keys of any length
 unsigned int hash(unsigned char *str, size_t len);
+//full 64 bits of the byte hash, for content keys where 32 bits would collide
+u64 hash64(unsigned char *str, size_t len);
+//fast path for pointer or integer keys
+unsigned int hash_word(u64 key);
+//default hash of hashtable: hash_word for 4 or 8 byte keys, hash for others
+unsigned int hash_key(unsigned char *key, size_t len);
 
 #define HASH_EMPTY 0
 #define HASH_EXIST 1
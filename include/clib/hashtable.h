@@ -17,16 +17,26 @@
 #ifdef __cplusplus
 extern "C" {
 #endif
-/*defined two data structure hash_head, and hash entry to contain existing struct hashbox data*/
-link_list(hash_head, hash_entry, struct hashbox)
+/*
+ * slot of the open addressing table: the full hash is kept inline so that probing
+ * compares hashes without touching the entry, the entry is one allocation holding
+ * the hashbox followed by the key and value, so value pointers stay valid when the
+ * table grows
+ */
+struct hash_slot {
+    unsigned int hash;
+    struct hashbox *box; //0 for empty slot
+};
 
 struct hashtable {
-    struct hash_head *heads;
+    struct hash_slot *slots;
     size_t size;
-    size_t cap;
+    size_t cap;   //power of two
+    unsigned int shift; //32 - log2(cap), to take the top bits of fibonacci hashing
     size_t value_size;
     size_t key_size;
     free_fun free_element;
+    hash_fun key_hash;
     bool key_is_c_str;
 };
 
@@ -37,6 +47,8 @@ void hashtable_c_str_key_init(struct hashtable *ht, free_fun free_element);
 void hashtable_init_with_value_size(struct hashtable *ht, size_t value_size, free_fun free_element);
 void hashtable_init_with_size(struct hashtable *ht, size_t key_size, size_t value_size);
 void hashtable_deinit(struct hashtable *ht);
+//replace the default hash_key function, only allowed while the table is empty
+void hashtable_set_hash_fun(struct hashtable *ht, hash_fun fun);
 size_t hashtable_size(struct hashtable *ht);
 void hashtable_set(struct hashtable *ht, const char *key, void *value);
 void hashtable_set2(struct hashtable *ht, const char *key, size_t key_size, void *value);
@@ -57,6 +69,14 @@ bool hashtable_in_g(struct hashtable *ht, void *key, size_t key_size);
 bool hashtable_in_p(struct hashtable *ht, void *key);
 bool hashtable_in_v(struct hashtable *ht, void *key);
 void hashtable_clear(struct hashtable *ht);
+/*
+ * dest becomes a copy of src sharing the element pointers, dest does not own the elements.
+ * hashtable_restore brings ht back to the entries of such a copy: entries added since are
+ * removed (and freed if ht owns them), overwritten values are freed the same way and set back
+ * to the copied ones
+ */
+void hashtable_copy(struct hashtable *dest, struct hashtable *src);
+void hashtable_restore(struct hashtable *ht, struct hashtable *saved);
 void hashtable_remove(struct hashtable *ht, const char *key);
 void hashtable_remove_p(struct hashtable *ht, void *key);
 void hashtable_remove_g(struct hashtable *ht, void *key, size_t key_size);
@@ -9,6 +9,7 @@
 #define __CLIB_REGEX_H__
 
 #include "stdbool.h"
+#include "clib/typedef.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +20,16 @@ void *regex_new(const char *re_pattern);
 int regex_match(void *re, const char *text, size_t *matched_len);
 void regex_free(void *re);
 
+/*
+ * table-driven dfa merged from a list of regexes, dfa_match does the longest match and
+ * reports the index of the matched regex, the regex with lower index wins when matched length is equal
+ */
+struct dfa;
+struct dfa *dfa_new(void **regexes, int re_count);
+int dfa_match(struct dfa *dfa, const char *text, int *matched_re);
+u32 dfa_state_count(struct dfa *dfa);
+void dfa_free(struct dfa *dfa);
+
 #ifdef __cplusplus
 }
 #endif
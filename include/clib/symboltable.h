@@ -36,6 +36,9 @@ void symboltable_init(symboltable *st);
 void symboltable_deinit(symboltable *st);
 void symboltable_push(symboltable *st, symbol s, void *data);
 symbol symboltable_pop(symboltable *st);
+//the most recent push, symboltable_pop_to pops every symbol pushed after it
+struct symbol_list_entry *symboltable_top(symboltable *st);
+void symboltable_pop_to(symboltable *st, struct symbol_list_entry *top);
 void *symboltable_get(symboltable *st, symbol s);
 bool has_symbol(symboltable *st, symbol s);
 bool has_symbol_in_scope(symboltable *st, symbol s, symbol end_s);
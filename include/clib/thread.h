@@ -0,0 +1,88 @@
+/*
+ * thread.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * minimal thread, mutex and thread local storage wrappers over pthread and win32 threads
+ * and a small work-stealing thread pool. the wasm build is single threaded: mutexes are
+ * no-ops there and threads run inline
+ */
+#ifndef __CLIB_THREAD_H__
+#define __CLIB_THREAD_H__
+
+#include "clib/typedef.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(WASM)
+#elif defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOGDI
+#define NOGDI //wingdi.h defines ERROR which clashes with LogLevel
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *(*thread_fun)(void *arg);
+typedef void (*task_fun)(void *arg);
+
+struct mutex {
+#if defined(WASM)
+    int unused;
+#elif defined(_WIN32)
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+struct thread {
+#if defined(WASM)
+    void *result;
+#elif defined(_WIN32)
+    HANDLE handle;
+    thread_fun fun;
+    void *arg;
+    void *result;
+#else
+    pthread_t handle;
+#endif
+};
+
+void mutex_init(struct mutex *mutex);
+void mutex_deinit(struct mutex *mutex);
+void mutex_lock(struct mutex *mutex);
+void mutex_unlock(struct mutex *mutex);
+
+//start fun(arg) on a new thread, the wasm build runs it inline
+bool thread_start(struct thread *thread, thread_fun fun, void *arg);
+//wait for the thread to finish and return the value returned by its thread function
+void *thread_join(struct thread *thread);
+//number of hardware threads, at least 1
+unsigned int thread_hardware_concurrency(void);
+
+struct task {
+    task_fun fun;
+    void *arg;
+};
+
+/*
+ * run all tasks on a pool of workers and return when they are all done. tasks are dealt out
+ * to per-worker deques, a worker pops from the back of its own deque and steals from the front
+ * of the others once it runs dry. the calling thread is one of the workers.
+ */
+void thread_pool_run(struct task *tasks, size_t task_count, unsigned int workers);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
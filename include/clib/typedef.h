@@ -26,6 +26,15 @@ typedef int64_t i64;
 typedef float f32;
 typedef double f64;
 
+#if defined(WASM)
+#define THREAD_LOCAL
+#elif defined(__cplusplus)
+#define THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL _Thread_local
+#endif
 
 #ifdef __cplusplus
 }
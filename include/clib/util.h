@@ -15,6 +15,7 @@ extern "C" {
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "clib/typedef.h"
 #include "clib/array.h"
 #include "clib/string.h"
 #include <stdlib.h>
@@ -56,10 +57,24 @@ char *get_basename(char *filename);
 #define MMEM_CALLOC calloc
 #define MMEM_REALLOC realloc
 
+//heap allocations made by the current thread through MALLOC/CALLOC/REALLOC, arena chunks included
+struct alloc_stats {
+    u64 count;
+    u64 bytes;
+};
+extern THREAD_LOCAL struct alloc_stats g_alloc_stats;
+
+#define COUNT_ALLOC(_size)                                                       \
+    do {                                                                         \
+        g_alloc_stats.count++;                                                   \
+        g_alloc_stats.bytes += (_size);                                          \
+    } while (0)
+
 #define ARRAY_SIZE(x) (sizeof(x) / sizeof((x)[0]))
 #define ERROR_MSG_MAX 512
 #define MALLOC(_ptr, _size)                                                      \
     do {                                                                         \
+        COUNT_ALLOC(_size);                                                      \
         if (NULL == (_ptr = MMEM_MALLOC(_size))) {                                    \
             printf("no enough memory to malloc !\n");                     \
             exit(1);                                                  \
@@ -68,6 +83,7 @@ char *get_basename(char *filename);
 
 #define CALLOC(_ptr, _element_count, element_size)                                                      \
     do {                                                                         \
+        COUNT_ALLOC((_element_count) * (element_size));                          \
         if (NULL == (_ptr = MMEM_CALLOC(_element_count, element_size))) {                                    \
             printf("no enough memory to calloc !\n");                     \
             exit(1);                                                  \
@@ -76,6 +92,7 @@ char *get_basename(char *filename);
 
 #define REALLOC(_ptr, old_mem, _size)                                                      \
     do {                                                                         \
+        COUNT_ALLOC(_size);                                                      \
         if (NULL == (_ptr = MMEM_REALLOC(old_mem, _size))) {                                    \
             exit(1);                                                  \
         }                                                                        \
@@ -86,8 +103,14 @@ char *get_basename(char *filename);
 char *get_exec_path(void);
 
 bool is_power_of2_64(uint64_t Value);
+/*monotonic clock in nanoseconds for timing*/
+uint64_t get_time_ns(void);
 
 const char *read_text_file(const char *file_path);
+/*map the text file into memory, read the whole file instead if memory mapping is not available.
+  the text is always NUL-terminated at size*/
+const char *map_text_file(const char *file_path, size_t *size);
+void unmap_text_file(const char *text, size_t size);
 
 #ifdef __cplusplus
 }
@@ -9,6 +9,7 @@
 #define __MLANG_CG_LLVM_H__
 
 #include <llvm-c/Core.h>
+#include <llvm-c/Orc.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/TargetMachine.h>
 
@@ -61,6 +62,33 @@ struct ops {
     unary_op neg_op;
 };
 
+enum llvm_opt_level {
+    LLVM_OPT_O0, //no IR passes, the code generator does not optimize
+    LLVM_OPT_O1,
+    LLVM_OPT_O2,
+    LLVM_OPT_O3,
+    LLVM_OPT_OS, //O2 without the passes that grow code
+};
+
+enum llvm_pipeline {
+    LLVM_PIPELINE_DEFAULT, //a module compiled on its own
+    LLVM_PIPELINE_LTO_PRE_LINK, //a module linked with others before it is compiled, inlining is left to the link
+    LLVM_PIPELINE_LTO, //the module linked from all of them
+};
+
+/*
+ * how native code is generated: the level of the IR pass pipeline and of the code generator,
+ * and the cpu with its features, e.g. "+avx2,-fma". cpu "native" is the host cpu, with the
+ * host features unless features are given. lto modules are optimized with the pre-link
+ * pipeline and emitted as bitcode to be linked by link_bitcode_modules
+ */
+struct llvm_target_options {
+    enum llvm_opt_level opt_level;
+    const char *cpu;
+    const char *features;
+    bool lto;
+};
+
 #define BLOCK_LEVELS 128
 struct block_context {
     LLVMBasicBlockRef cont_bb;
@@ -69,11 +97,15 @@ struct block_context {
 
 struct cg_llvm {
     struct codegen base;
+    //the jit shares the context with the modules it takes, the context is freed by the last of them
+    LLVMOrcThreadSafeContextRef ts_context;
     LLVMContextRef context;
     LLVMBuilderRef builder;
     LLVMModuleRef module;
     LLVMTargetMachineRef target_machine;
     LLVMTargetDataRef target_data;
+    //target machine of the modules created after it is set
+    struct llvm_target_options target_options;
     /* 
      *  symboltable of <symbol, LLVMTypeRef>
      *  binding type name to IR Type
@@ -114,16 +146,33 @@ struct cg_llvm {
     LLVMValueRef free_fun;
     LLVMValueRef calloc_fun;
     LLVMValueRef realloc_fun;
+    symbol pow_fun_symbol;
 };
 
 struct cg_llvm *cg_llvm_new(struct sema_context *sema_context);
+void llvm_init_native_target(void);
 void cg_llvm_free(struct cg_llvm *cg);
 
 void emit_code(struct cg_llvm *cg, struct ast_node *node);
 void emit_sp_code(struct cg_llvm *cg);
 void* create_ir_module(void *cg, const char *module_name);
 LLVMValueRef emit_ir_code(struct cg_llvm *cg, struct ast_node *node);
-LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, LLVMTargetDataRef* target_data_out);
+//run the IR pass pipeline of the opt level of the target options on the module, returns false if it failed
+bool optimize_ir_module(struct cg_llvm *cg);
+bool run_ir_pipeline(LLVMModuleRef module, LLVMTargetMachineRef target_machine, enum llvm_opt_level opt_level, enum llvm_pipeline pipeline);
+/*
+ * read the bitcode of the modules into the context and link them into one module, returns 0 if
+ * one can not be read or a symbol is defined by two of them. the buffers are still owned by the caller
+ */
+LLVMModuleRef link_bitcode_modules(LLVMContextRef context, LLVMMemoryBufferRef *bitcodes, size_t count);
+//generic cpu at O2
+void llvm_target_options_init(struct llvm_target_options *options);
+//level is what follows -O: 0, 1, 2, 3 or s, returns false and leaves opt_level as is for anything else
+bool parse_opt_level(const char *level, enum llvm_opt_level *opt_level);
+//options 0 for the defaults
+LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, const struct llvm_target_options *options, LLVMTargetDataRef* target_data_out);
+//the host cpu with its features, for code run in the process, e.g. by the jit
+LLVMTargetMachineRef create_host_target_machine(enum llvm_opt_level opt_level);
 LLVMTypeRef get_backend_type(struct cg_llvm *cg, struct type_item *type);
 
 #ifdef __cplusplus
@@ -15,6 +15,7 @@
 #include "codegen/fun_info.h"
 #include "codegen/fun_context.h"
 #include "codegen/codegen.h"
+#include "codegen/wasm/wasm_ir.h"
 #include "parser/ast.h"
 #include <assert.h>
 
@@ -25,9 +26,6 @@ extern "C" {
 #include "wasm-core.h"
 
 
-#define FUN_LEVELS 512
-#define LOCAL_VARS 1024 //TODO: need to eliminate this limitation
-
 struct imports{
     struct ast_node *import_block;
     u32 num_global;
@@ -42,12 +40,12 @@ struct cg_wasm {
     struct hashtable func_name_2_idx;
     struct hashtable func_name_2_ast;
     /*
-     *  symboltable of <symbol, struct fun_context>
-     *  binding variable name to index of variable in the function
-     *  used in function codegen
+     *  stacks of the functions being emitted and of their local variables. the entries are
+     *  allocated on first use and kept for the next functions, their addresses do not change
+     *  as the stacks grow
      */
-    struct fun_context fun_contexts[FUN_LEVELS];
-    struct var_info local_vars[LOCAL_VARS];
+    struct array fun_contexts; //struct fun_context *, fun_top of them are in use
+    struct array local_vars; //struct var_info *, var_top of them are in use
 
     u32 fun_top;
     u32 var_top;
@@ -70,11 +68,33 @@ struct cg_wasm {
     struct ast_node *funs;
 
     /*
-     * data section, for example: string literal
+     * content of the data section, for example: string literals and constant arrays
+     */
+    struct byte_array data;
+
+    /*
+     * optimization level of the emitted code, see wasm_pass.h
+     */
+    u32 opt_level;
+
+    /*
+     * features beyond the core wasm 1.0 the emitted code may use, bits of enum wasm_feature
+     */
+    u32 target_features;
+
+    /*
+     * the function being emitted: its instructions as emitted from the ast, and the IR
+     * they are decoded into for the passes, both reused across functions
      */
-    struct ast_node *data_block;
+    struct byte_array fun_code;
+    struct wasm_function_ir fun_ir;
 
-    u32 data_offset;
+    /*
+     * well-known symbols used in codegen
+     */
+    symbol memory_symbol;
+    symbol memory_base_symbol;
+    symbol pow_fun_symbol;
 };
 extern u8 type_2_store_op[TYPE_TYPES];
 extern u8 type_2_wtype[TYPE_TYPES];
@@ -82,9 +102,28 @@ extern u8 type_2_load_op[TYPE_TYPES];
 
 #define ASSERT_TYPE(type_index) assert(type_index > TYPE_NULL && type_index < TYPE_TYPES);
 
+//for loops with a constant trip count up to this are unrolled
+#define FOR_UNROLL_MAX_TRIPS 4
+
+//structs and constant arrays of at least this many bytes are copied with memory.copy
+#define WASM_BULK_COPY_MIN_SIZE 256
+//arrays of at least this many bytes of one byte value are filled with memory.fill
+#define WASM_BULK_FILL_MIN_SIZE 128
+
+enum wasm_feature {
+    WASM_FEATURE_SIMD = 1, //128-bit vector instructions
+};
+
 struct cg_wasm * cg_wasm_new(struct sema_context *context);
 void wasm_emit_module(struct cg_wasm *cg, struct ast_node *node);
 void wasm_emit_code(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node);
+bool wasm_is_unrolled_loop(struct ast_node *node);
+/*
+ * with simd, run a for loop of step 1 over the innermost dimension of arrays with vectors of
+ * their elements as long as there are enough elements left. nothing is emitted if the loop
+ * does not take vectors, the scalar loop after it does the remaining elements
+ */
+void wasm_emit_simd_for_loop(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node, u32 var_index, u32 end_index);
 void wasm_emit_call(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node);
 void wasm_emit_func(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node);
 void wasm_emit_var(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node);
@@ -95,11 +134,20 @@ void wasm_emit_store_scalar_value_at(struct cg_wasm *cg, struct byte_array *ba,
 void wasm_emit_store_scalar_value(struct cg_wasm *cg, struct byte_array *ba, u32 align, u32 offset, struct ast_node *node);
 void wasm_emit_store_struct_value(struct cg_wasm *cg, struct byte_array *ba, u32 local_address_var_index, u32 offset, struct struct_layout *sl, struct ast_node *block);
 void wasm_emit_store_array_value(struct cg_wasm *cg, struct byte_array *ba, u32 local_address_var_index, u32 offset, u32 elm_align, u32 elm_type_size, struct ast_node *array_init);
+/*
+ * append size bytes to the data section at a multiple of align, returns their offset in it
+ * or InvalidIndex if the data section has no room for them
+ */
+u32 wasm_add_data(struct cg_wasm *cg, const u8 *bytes, u32 size, u32 align);
+//the address of the data at data_offset in the data section
+void wasm_emit_data_address(struct cg_wasm *cg, struct byte_array *ba, u32 data_offset);
 void wasm_emit_addr_offset_by_expr(struct cg_wasm *cg, struct byte_array *ba, u32 var_index, bool is_global, struct ast_node *offset_expr);
 
 struct fun_context *cg_get_top_fun_context(struct cg_wasm *cg);
 
 void cg_wasm_free(struct cg_wasm *cg);
+//drop the state of the last emitted module, imports and sys block are kept
+void cg_wasm_reset(struct cg_wasm *cg);
 bool is_variadic_call_with_optional_arguments(struct cg_wasm *cg, struct ast_node *node);
 
 void fc_init(struct fun_context *fc);
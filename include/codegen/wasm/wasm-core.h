@@ -146,6 +146,14 @@ enum WasmInstrMem {
 
 };
 
+// 0xFC prefixed memory instructions
+enum WasmInstrMemOpcode {
+    WasmInstrMemInit = 8,     // dataidx 0x00
+    WasmInstrMemDataDrop = 9, // dataidx
+    WasmInstrMemCopy = 10,    // 0x00 0x00
+    WasmInstrMemFill = 11,    // 0x00
+};
+
 // numeric instructions
 enum WasmInstrNum {
     WasmInstrNumI32Const = 0x41,
@@ -298,6 +306,49 @@ enum WasmInstrNum {
 };
 
 // vector instructions
+// the prefix is followed by the u32 vector instruction
+enum WasmInstrVec {
+    WasmInstrVecOp = 0xFD,
+};
+
+enum WasmInstrVecOpcode {
+    WasmInstrVecV128Load = 0x00,   // memarg
+    WasmInstrVecV128Store = 0x0B,  // memarg
+    WasmInstrVecV128Const = 0x0C,  // 16 bytes
+    WasmInstrVecI8x16Shuffle = 0x0D, // 16 lane indices
+    WasmInstrVecI8x16Splat = 0x0F,
+    WasmInstrVecI16x8Splat = 0x10,
+    WasmInstrVecI32x4Splat = 0x11,
+    WasmInstrVecI64x2Splat = 0x12,
+    WasmInstrVecF32x4Splat = 0x13,
+    WasmInstrVecF64x2Splat = 0x14,
+    WasmInstrVecI8x16ExtractLaneS = 0x15, // lane index, up to f64x2.replace_lane 0x22
+    WasmInstrVecF64x2ReplaceLane = 0x22,
+    WasmInstrVecV128Load8Lane = 0x54,   // memarg and lane index, up to v128.store64_lane 0x5B
+    WasmInstrVecV128Store64Lane = 0x5B,
+    WasmInstrVecV128Load32Zero = 0x5C, // memarg
+    WasmInstrVecV128Load64Zero = 0x5D, // memarg
+    WasmInstrVecI8x16Add = 0x6E,
+    WasmInstrVecI8x16Sub = 0x71,
+    WasmInstrVecI16x8Add = 0x8E,
+    WasmInstrVecI16x8Sub = 0x91,
+    WasmInstrVecI16x8Mul = 0x95,
+    WasmInstrVecI32x4Add = 0xAE,
+    WasmInstrVecI32x4Sub = 0xB1,
+    WasmInstrVecI32x4Mul = 0xB5,
+    WasmInstrVecI64x2Add = 0xCE,
+    WasmInstrVecI64x2Sub = 0xD1,
+    WasmInstrVecI64x2Mul = 0xD5,
+    WasmInstrVecF32x4Add = 0xE4,
+    WasmInstrVecF32x4Sub = 0xE5,
+    WasmInstrVecF32x4Mul = 0xE6,
+    WasmInstrVecF32x4Div = 0xE7,
+    WasmInstrVecF64x2Add = 0xF0,
+    WasmInstrVecF64x2Sub = 0xF1,
+    WasmInstrVecF64x2Mul = 0xF2,
+    WasmInstrVecF64x2Div = 0xF3,
+};
+
 enum WasmSection {
     WasmSectionCustom = 0,
     WasmSectionType,
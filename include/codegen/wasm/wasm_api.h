@@ -20,10 +20,27 @@ extern "C" {
 typedef struct byte_array* WasmModule;
 typedef u8 Instruction;
 
+//bytes of the LEB128 encoding of a u32 at most
+#define MAX_U32_LEB128_SIZE 5
+
 void wasm_emit_instruction(WasmModule module, Instruction ins);
+//bytes of the unsigned or signed LEB128 encoding of value
 u8 wasm_get_emit_size(u64 value);
+u8 wasm_get_emit_int_size(i64 value);
 u8 wasm_emit_uint(WasmModule module, u64 value);
 u8 wasm_emit_int(WasmModule module, i64 value);
+//decode the LEB128 value at bytes, size is set to the number of bytes read
+u64 wasm_read_uint(const u8 *bytes, u32 *size);
+i64 wasm_read_int(const u8 *bytes, u32 *size);
+/*
+ * content with its size ahead, e.g. a section or a function body, is emitted in place: begin
+ * leaves room for the largest u32 size, end writes the size and closes up the unused room.
+ * end_padded writes the size over all of the room instead, wasm accepts a LEB128 with zero
+ * padding, so the content is not moved. it is for the many small ones, e.g. function bodies
+ */
+u32 wasm_begin_size(WasmModule module);
+void wasm_end_size(WasmModule module, u32 start);
+void wasm_end_padded_size(WasmModule module, u32 start);
 
 u8 wasm_emit_f32(WasmModule module, f32 value);
 u8 wasm_emit_f64(WasmModule module, f64 value);
@@ -40,7 +57,16 @@ void wasm_emit_change_var(WasmModule ba, u8 op, u32 operand, u32 var_index, bool
 void wasm_emit_load_mem_from(WasmModule ba, u32 addr_var_index, bool is_global, u32 align, u32 offset, enum type type);
 void wasm_emit_load_mem(WasmModule ba, u32 align, u32 offset, enum type type);
 void wasm_emit_store_mem(WasmModule ba, u32 align, u32 offset, enum type type);
+//0xFD prefixed instruction without immediates
+void wasm_emit_vector_op(WasmModule ba, u32 op);
+//v128 load and store, align is the one of the lane type
+void wasm_emit_load_vector(WasmModule ba, u32 align, u32 offset);
+void wasm_emit_store_vector(WasmModule ba, u32 align, u32 offset);
 
+//bulk memory instructions of memory 0: memory.copy takes to, from and size, memory.fill takes to, byte and size
+void wasm_emit_memory_copy(WasmModule ba);
+void wasm_emit_memory_fill(WasmModule ba);
+//structs of WASM_BULK_COPY_MIN_SIZE bytes or more are copied with memory.copy, smaller ones field by field
 void wasm_emit_copy_struct_value(struct type_context *tc, WasmModule ba, u32 to_var_index, u32 to_offset, struct type_item *type, u32 from_var_index, u32 from_offset);
 
 void wasm_emit_get_var(WasmModule ba, u32 var_index, bool is_global);
@@ -0,0 +1,87 @@
+/*
+ * wasm_ir.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the wasm IR: the body of one function as an array of decoded instructions
+ * with structured control flow and its local declarations. cg_wasm lowers each function into
+ * it, the passes in wasm_pass.h rewrite it and wasm_ir_encode writes the binary format.
+ */
+#ifndef __MLANG_WASM_IR_H__
+#define __MLANG_WASM_IR_H__
+
+#include "clib/array.h"
+#include "clib/byte_array.h"
+#include "clib/typedef.h"
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WASM_IR_NO_MATCH 0xFFFFFFFF
+
+struct wasm_instr {
+    u8 opcode;
+    /*
+     * immediates by opcode:
+     *   block, loop, if:             value is the block type
+     *   br, br_if:                   value is the label
+     *   br_table:                    value is the label count, labels indexes the first label
+     *                                in the label array, the default label follows them
+     *   call:                        value is the function index
+     *   call_indirect:               value is the type index, extra the table index
+     *   local, global, table ops:    value is the index
+     *   loads and stores:            value is the align, extra the offset
+     *   memory.size, memory.grow:    value is the memory index
+     *   i32.const, i64.const:        value is the constant
+     *   f32.const, f64.const:        value is the IEEE 754 bits of the constant
+     *   0xFC prefixed:               sub is the instruction, value and extra its indices
+     *   0xFD prefixed:               sub is the instruction, value and extra the align and
+     *                                offset of loads and stores, value the lane index of lane
+     *                                instructions, labels indexes the 16 bytes of v128.const
+     *                                and i8x16.shuffle as 4 u32 in the label array
+     */
+    u32 sub;
+    i64 value;
+    u32 extra;
+    u32 labels;
+    //index of the end of block, loop and if, of the else or end of else, WASM_IR_NO_MATCH if not linked
+    u32 match;
+};
+
+struct wasm_function_ir {
+    u32 params; //number of parameters, the index of the first local
+    struct array locals; //u8 value types of the locals declared after the parameters
+    struct array instrs; //struct wasm_instr, the last one is the end of the function
+    struct array labels; //u32 labels of br_table instructions and immediates of v128.const and i8x16.shuffle
+};
+
+void wasm_ir_init(struct wasm_function_ir *fun);
+void wasm_ir_deinit(struct wasm_function_ir *fun);
+//empty the function to lower the next one into it, the storage is kept
+void wasm_ir_reset(struct wasm_function_ir *fun);
+void wasm_ir_add_local(struct wasm_function_ir *fun, u8 value_type);
+u8 wasm_ir_local_type(struct wasm_function_ir *fun, u32 local_index);
+u32 wasm_ir_size(struct wasm_function_ir *fun);
+struct wasm_instr *wasm_ir_at(struct wasm_function_ir *fun, u32 index);
+u32 wasm_ir_label(struct wasm_function_ir *fun, struct wasm_instr *br_table, u32 index);
+void wasm_ir_set_label(struct wasm_function_ir *fun, struct wasm_instr *br_table, u32 index, u32 label);
+bool wasm_ir_is_block_start(u8 opcode);
+
+/*
+ * append the instructions encoded in code to the function. returns false if there is an
+ * instruction the IR does not know, the function is then left with the ones before it
+ */
+bool wasm_ir_decode(struct wasm_function_ir *fun, const u8 *code, u32 size);
+//set match of block, loop, if and else instructions, returns false if they are not balanced
+bool wasm_ir_link(struct wasm_function_ir *fun);
+//the function body without its size: local declarations grouped by runs of one type, and instructions
+void wasm_ir_encode(struct wasm_function_ir *fun, struct byte_array *ba);
+void wasm_ir_encode_instr(struct wasm_function_ir *fun, struct wasm_instr *ins, struct byte_array *ba);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__MLANG_WASM_IR_H__
@@ -0,0 +1,49 @@
+/*
+ * wasm_pass.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the pass manager of the wasm IR
+ */
+#ifndef __MLANG_WASM_PASS_H__
+#define __MLANG_WASM_PASS_H__
+
+#include "codegen/wasm/wasm_ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * optimization levels of the wasm backend:
+ *   0: function bodies as emitted from the ast
+ *   1: control flow clean up, local coalescing and peephole optimizations over each function body
+ */
+#define WASM_OPT_LEVEL_MAX 1
+#define WASM_OPT_LEVEL_DEFAULT 1
+
+struct wasm_pass {
+    const char *name;
+    u32 opt_level; //the lowest optimization level the pass runs at
+    //returns true if the function is changed
+    bool (*run)(struct wasm_function_ir *fun);
+};
+
+//code after br, br_table, return and unreachable up to the end of its block
+bool wasm_remove_unreachable(struct wasm_function_ir *fun);
+//unwrap void blocks no branch targets, labels crossing them are adjusted
+bool wasm_unwrap_blocks(struct wasm_function_ir *fun);
+//share one local between locals of a type which are never live at the same time
+bool wasm_coalesce_locals(struct wasm_function_ir *fun);
+
+/*
+ * run the passes of the optimization level in order over a linked function, the
+ * function is linked again after each pass changing it
+ */
+void wasm_run_passes(struct wasm_function_ir *fun, u32 opt_level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__MLANG_WASM_PASS_H__
@@ -0,0 +1,24 @@
+/*
+ * wasm_peephole.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the peephole optimizer of wasm function bodies
+ */
+#ifndef __MLANG_WASM_PEEPHOLE_H__
+#define __MLANG_WASM_PEEPHOLE_H__
+
+#include "codegen/wasm/wasm_ir.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//rewrite short instruction sequences of the function, returns true if anything changed
+bool wasm_peephole(struct wasm_function_ir *fun);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //__MLANG_WASM_PEEPHOLE_H__
@@ -0,0 +1,56 @@
+/*
+ * compile_cache.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the on-disk cache of compiled modules. an artifact is keyed by the content
+ * hash of its source together with the sys prelude and the compiler version, so a module is
+ * only compiled again when itself or anything it is analyzed against has changed
+ */
+#ifndef __MLANG_COMPILE_CACHE_H__
+#define __MLANG_COMPILE_CACHE_H__
+
+#include "clib/string.h"
+#include "clib/thread.h"
+#include "clib/typedef.h"
+#include "sema/frontend.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct compile_cache {
+    string dir;
+    u64 prelude_hash; //sys prelude sources, compiler version and options, mixed into every key
+    struct mutex lock; //guards the statistics, compile jobs share one cache
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t temps; //numbers the temp files an artifact is written to before it is renamed
+};
+
+//the cache directory is created if it does not exist, prelude is 0 when keys hash compiled code instead of sources
+void compile_cache_init(struct compile_cache *cache, const char *dir, struct sys_prelude *prelude);
+void compile_cache_deinit(struct compile_cache *cache);
+//the options artifacts are compiled with, e.g. the opt level and cpu, are part of their keys
+void compile_cache_add_options(struct compile_cache *cache, const char *options);
+/*
+ * copy the cached artifact of source_file with the extension ext to output_path. the key of the
+ * source is written to *key either way so that a miss can store the artifact after compiling.
+ * returns false on a miss
+ */
+bool compile_cache_fetch(struct compile_cache *cache, const char *source_file, const char *ext, const char *output_path, u64 *key);
+//save the artifact at output_path under key, returns false if it could not be written
+bool compile_cache_store(struct compile_cache *cache, u64 key, const char *ext, const char *output_path);
+/*
+ * artifacts keyed by a hash of what they are compiled from, e.g. an IR module, instead of by a
+ * source file. lookup initializes path to the artifact of content_hash and returns false on a miss
+ */
+bool compile_cache_lookup(struct compile_cache *cache, u64 content_hash, const char *ext, string *path);
+bool compile_cache_store_data(struct compile_cache *cache, u64 content_hash, const char *ext, const char *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
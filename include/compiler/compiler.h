@@ -9,7 +9,10 @@
 #define __MLANG_COMPILER_H__
 
 #include "codegen/llvm/cg_llvm.h"
+#include "compiler/compile_cache.h"
+#include "app/time_report.h"
 #include "parser/ast.h"
+#include "sema/frontend.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -22,6 +25,37 @@ enum object_file_type {
     FT_OBJECT = 3
 };
 
+struct compile_job {
+    const char *source_file;
+    const char *output_filepath; //0 to derive it from source_file
+    enum object_file_type file_type;
+    const struct llvm_target_options *target; //0 for the defaults
+    struct compile_cache *cache; //0 to always compile
+    int result;
+    bool cached; //the output was copied from the cache instead of compiled
+    /*
+     * phases of compiling the source file: frontend is creating the engine including analyzing
+     * the sys prelude, optimize is running the IR passes, emit is writing the object, bitcode
+     * or ir file
+     */
+    struct time_report time_report;
+};
+
+/*
+ * compile one job with its own engine built from the shared prelude. the prelude is only read,
+ * so jobs can run on different threads at the same time
+ */
+int compile_prelude(struct sys_prelude *prelude, struct compile_job *job);
+//compile all jobs on a pool of workers, returns the number of failed jobs
+int compile_jobs(struct sys_prelude *prelude, struct compile_job *jobs, size_t job_count, unsigned int workers);
+//the file starts with the magic of llvm bitcode, e.g. written by -f bc or by clang -flto
+bool is_bitcode_file(const char *filename);
+/*
+ * link time optimization: link the bitcode files of the m modules and of C compiled to bitcode
+ * into one module, run the lto pipeline of the target options over it, so calls across the
+ * modules can be inlined, and write it as one object file. target 0 for the defaults
+ */
+int link_time_optimize(const char **bitcode_files, size_t count, const struct llvm_target_options *target, const char *output_filepath);
 int compile(const char *sys_path, const char *fn, enum object_file_type file_type, const char *output_filepath);
 void free_ir_string(char *ir_string);
 
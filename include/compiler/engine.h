@@ -10,6 +10,7 @@
 
 #include "sema/frontend.h"
 #include "codegen/backend.h"
+#include "app/time_report.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -18,15 +19,39 @@ extern "C" {
 struct engine{
     struct frontend *fe;
     struct backend *be;
+    /*
+     * arena of ast nodes and types created by the engine, released by engine_free in one go,
+     * 0 for REPL engines where nodes are allocated and freed one by one
+     */
+    struct arena *arena;
+    /*
+     * state right after the prelude is parsed and analyzed, engine_reset rolls the engine
+     * back to it so that one engine compiles any number of modules. 0 if not taken
+     */
+    struct sema_checkpoint *prelude;
+    struct arena_mark prelude_mark;
+    /*
+     * phases of the last module compiled by compile_to_wasm, the frontend phase is the one
+     * time engine setup including the prelude analysis
+     */
+    struct time_report time_report;
     char *(*emit_ir_string)(void*, struct ast_node *);
     void* (*create_ir_module)(void*, const char *module_name);
 };
 
 struct engine *engine_llvm_new(const char *sys_path, bool is_repl);
+struct engine *engine_llvm_new_with_prelude(struct sys_prelude *prelude, bool is_repl);
 struct engine *engine_mlir_new(const char *sys_path, bool is_repl);
 struct engine *engine_wasm_new(void);
+//roll the engine back to its prelude checkpoint, no-op for engines without one
 void engine_reset(struct engine *engine);
+/*
+ * compile one module, the engine is reset afterwards so it can compile the next one.
+ * the returned module bytes stay valid until the next compile unless taken from cg->ba
+ */
 u8* compile_to_wasm(struct engine *cg, const char *expr);
+//same as compile_to_wasm for a module saved by ast_serialize, returns 0 if data is not a valid ast file
+u8* compile_ast_to_wasm(struct engine *engine, const u8 *data, size_t size);
 const char *engine_version(void);
 void engine_free(struct engine *engine);
 
@@ -0,0 +1,105 @@
+/*
+ * interp.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for the tier-0 interpreter: the analyzed AST of a module is lowered to a tree of
+ * compact typed codes which run right away without any code generation. each function counts
+ * its calls and loop iterations, a hot function is handed to the promote callback, the tier
+ * above the interpreter, and is called as native code from then on
+ */
+#ifndef __MLANG_INTERP_H__
+#define __MLANG_INTERP_H__
+
+#include "clib/arena.h"
+#include "clib/array.h"
+#include "clib/hashtable.h"
+#include "clib/typedef.h"
+#include "parser/ast.h"
+#include "sema/sema_context.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//calls and loop iterations of a function before it is promoted
+#define INTERP_HOT_THRESHOLD 10000
+//values of all frames, and the nested calls, a deeper program leaves the interpreter
+#define INTERP_STACK_SLOTS (64 * 1024)
+#define INTERP_MAX_DEPTH 2000
+
+//the types the interpreter runs, a module using any other type is not lowered
+enum interp_type {
+    INTERP_UNIT,
+    INTERP_BOOL,
+    INTERP_CHAR,
+    INTERP_INT,
+    INTERP_F64,
+    INTERP_NONE,
+};
+
+//ints are kept sign extended, bool and char in the low byte
+union interp_value {
+    i64 i;
+    f64 d;
+};
+
+/*
+ * native code of a promoted function: the arguments are read from args, one value per
+ * parameter, and the result is written to ret
+ */
+typedef void (*interp_native_fun)(union interp_value *args, union interp_value *ret);
+
+struct icode;
+
+struct interp_fun {
+    symbol name;
+    struct ast_node *node; //the FUNC_NODE lowered
+    struct icode *body;
+    enum interp_type *param_types;
+    enum interp_type ret_type;
+    u32 params;
+    u32 slots; //parameters first, then the local variables
+    u32 heat; //calls and loop iterations counted toward promotion
+    bool is_promotion_failed; //the promote callback could not compile it, it stays interpreted
+    interp_native_fun native;
+};
+
+struct interp {
+    struct sema_context *context;
+    struct arena arena; //codes and functions, released together by interp_deinit
+    struct hashtable funs; //symbol of the function name -> struct interp_fun *
+    struct array lowered; //struct interp_fun * in the order lowered
+    union interp_value *stack;
+    u32 sp;
+    u32 depth;
+    u32 hot_threshold; //0 never promotes
+    //compiles fun to native code, 0 if it can not. it is called once per function
+    interp_native_fun (*promote)(void *promote_context, struct interp_fun *fun);
+    void *promote_context;
+    size_t promotions;
+    //control flow unwinding through the codes
+    int jump;
+    union interp_value ret;
+};
+
+void interp_init(struct interp *in, struct sema_context *context);
+void interp_deinit(struct interp *in);
+/*
+ * lower the function entry of the analyzed module block and the functions it calls. returns 0
+ * if any of them uses what the interpreter does not run, e.g. strings, structs or calls to
+ * external functions other than the math library
+ */
+struct interp_fun *interp_load(struct interp *in, struct ast_node *block, symbol entry);
+/*
+ * call fun with args, returns false if the interpreter ran out of its stack, then the program
+ * has to be run by the jit. interpreted code has no side effect other than the result, so it
+ * is safe to run the program again
+ */
+bool interp_call(struct interp *in, struct interp_fun *fun, union interp_value *args, union interp_value *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,6 +10,7 @@
 #define __MLANG_JIT_H__
 
 #include "clib/util.h"
+#include "compiler/compile_cache.h"
 #include "compiler/engine.h"
 #include "sema/sema_context.h"
 
@@ -17,9 +18,20 @@
 extern "C" {
 #endif
 
+//suffix of the name a lazily compiled function is defined by, its own name is the stub calling it
+#define JIT_LAZY_BODY_SUFFIX ".body"
+
 struct JIT {
     struct engine *engine;
     void *instance;
+    //stubs of the functions added by jit_add_module_lazy, they compile the module on the first call
+    void *call_through_manager;
+    void *stubs_manager;
+    //objects of modules compiled before are loaded from the cache instead of compiled, 0 to always compile
+    struct compile_cache *cache;
+    u64 target_hash; //triple, cpu, features and opt level of the host code, part of every module key
+    u64 compiling_hash; //key of the module being compiled, its object is stored under it
+    size_t exprs; //expressions evaluated, numbering their functions keeps a session's modules the same
 };
 
 struct fun_pointer
@@ -34,7 +46,16 @@ struct fun_pointer
 
 struct JIT *jit_new(struct engine *engine);
 void jit_free(struct JIT *jit);
+/*
+ * the module is compiled when a symbol of it is looked up, with the modules whose symbols it
+ * references, and the returned resource tracker removes it
+ */
 void *jit_add_module(struct JIT *jit, void *module);
+/*
+ * the functions of the module are compiled on their first call instead of when a module
+ * referencing them is compiled. the module is kept until the jit is freed
+ */
+void jit_add_module_lazy(struct JIT *jit, void *module);
 void jit_remove_module(void *resource_tracker);
 typedef f64 (*target_address_double)(void);
 typedef int (*target_address_int)(void);
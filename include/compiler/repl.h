@@ -32,7 +32,10 @@ void eval_node(void *p_jit, struct ast_node *node);
 void eval_statement(void *p_jit, struct ast_node *node);
 struct eval_result eval_exp(struct JIT *jit, struct ast_node *node);
 struct eval_result eval_module(struct JIT *jit, struct ast_node *node);
-int run_repl(void);
+//evaluate the module analyzed before, e.g. by a tier that could not interpret it
+struct eval_result eval_analyzed_module(struct JIT *jit, struct ast_node *node);
+//sys_path is the dir of the sys modules, cache_dir keeps the objects the jit compiles across sessions, 0 to always compile
+int run_repl(const char *sys_path, const char *cache_dir);
 
 #ifdef __cplusplus
 }
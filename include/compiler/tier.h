@@ -0,0 +1,44 @@
+/*
+ * tier.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * header file for tiered execution of a module: it is interpreted first, so the first result
+ * does not wait for the jit to start and compile, and the functions the interpreter finds hot
+ * are compiled by the jit and called natively. a module the interpreter can not run is
+ * evaluated by the jit from the start
+ */
+#ifndef __MLANG_TIER_H__
+#define __MLANG_TIER_H__
+
+#include "compiler/engine.h"
+#include "compiler/interp.h"
+#include "compiler/jit.h"
+#include "compiler/repl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//suffix of the function a promoted function is called by from the interpreter
+#define TIER_ENTRY_SUFFIX ".entry"
+
+struct tier {
+    struct engine *engine;
+    struct interp interp;
+    struct JIT *jit; //created by the first promotion, or for a module the interpreter can not run
+    bool is_jit_failed; //the functions could not be compiled, the interpreter runs all of them
+    bool is_interpreted; //the last module was run by the interpreter
+};
+
+//the engine is a llvm engine, a tier evaluates one module
+struct tier *tier_new(struct engine *engine);
+void tier_free(struct tier *tier);
+//analyze and evaluate the module of split_ast_nodes_with_start_func
+struct eval_result tier_eval_module(struct tier *tier, struct ast_node *node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
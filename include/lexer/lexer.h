@@ -24,13 +24,17 @@
 extern "C" {
 #endif
 
-#define MAX_PATTERNS_PER_CHAR   16
-struct pattern_matches {
-    struct token_pattern *patterns[MAX_PATTERNS_PER_CHAR];
-    int pattern_match_count;
-};
-
-#define CODE_BUFF_SIZE 40960
+/*
+ * the lexer reads text from one of two kinds of sources:
+ *   - in-memory text (a string or a memory-mapped file), which is lexed in place
+ *     without any copy and without size limit. the text must be NUL-terminated at code_size.
+ *   - a FILE stream, which is read into a window buffer in chunks of LEXER_STREAM_CHUNK bytes.
+ *     the window always ends at a line boundary so that a token never straddles a refill
+ *     unless it is a multi-line string or block comment, in which case the window grows
+ *     to keep the whole token. buff_base is the absolute offset of buff[0] in the source,
+ *     so tok.loc.start/end stay as absolute source offsets across refills.
+ */
+#define LEXER_STREAM_CHUNK 4096
 
 #define MAX_INDENTS     254
 #define INVALID_INDENTS 255
@@ -43,15 +47,19 @@ struct indent_level_stack{
 struct lexer {
     FILE *file;
     const char *filename;
-    char buff[CODE_BUFF_SIZE + 1];
+    const char *buff; //current window of the source text, NUL-terminated at buff_size
+    char *stream_buff; //window storage owned by the lexer for FILE stream
+    int stream_cap;
+    int buff_size;
     struct indent_level_stack indent_stack;
     struct token tok;
     enum token_type last_token_type; //last effective token type, excluding comments token
     int pos;  //current text position in the buffer
-    int buff_base;
+    int buff_base; //absolute source offset of buff[0]
     int line;
     int col;
-    struct pattern_matches char_matches[128];
+    struct dfa *dfa; //token pattern dfa
+    struct token_pattern **dfa_patterns;
     int pending_dedents;
     struct array open_closes; //group match 
 };
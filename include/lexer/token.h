@@ -50,6 +50,8 @@ struct token_pattern{
 struct token_patterns{
     struct token_pattern *patterns;
     size_t pattern_count;
+    struct dfa *dfa;   //dfa merged from all token patterns
+    struct token_pattern **dfa_patterns; //token pattern indexed by regex index matched in dfa
 };
 
 struct token {
@@ -10,6 +10,7 @@
 
 #include <stdio.h>
 
+#include "clib/arena.h"
 #include "clib/symbol.h"
 #include "clib/util.h"
 #include "sema/type.h"
@@ -99,6 +100,17 @@ struct for_node {
     struct ast_node *var;
     struct ast_node *range;
     struct ast_node *body;
+    /*
+     * generated in Analyzer for codegen:
+     * step_sign: sign of the step if it is a compile-time constant, 0 otherwise
+     * trip_count: iterations of an int loop with constant start, end and step, whose body
+     * neither breaks nor continues, -1 otherwise
+     * is_end_invariant: the end is a constant or an immutable variable, evaluating it once
+     * before the loop gives the value of each iteration
+     */
+    i8 step_sign;
+    i32 trip_count;
+    bool is_end_invariant;
 };
 
 struct while_node {
@@ -269,6 +281,7 @@ struct ast_node {
     bool is_lvalue;      //default is zero (read), for left side of assignment node, it will be set as 1
     bool is_addressable;     // is left value
     bool is_heap_alloc; // is heap allocated
+    bool is_arena_alloc; // node and its data are in the compilation arena, released with the arena
     union{
         void *data; //node data represents any of following pointer
         struct token_node *token;
@@ -315,6 +328,14 @@ struct ast_node {
 /*construct ast node with type enum directly*/
 struct ast_node *ast_node_new(enum node_type node_type, struct source_location loc);
 void ast_node_free(struct ast_node *node);
+/*
+ * nodes created while an arena is set are allocated from it and ast_node_free leaves
+ * their memory to the arena, returns the previous arena. without an arena (e.g. REPL
+ * where nodes outlive a compilation) nodes are allocated and freed one by one.
+ * the arena is per thread.
+ */
+struct arena *ast_set_arena(struct arena *arena);
+struct arena *ast_get_arena(void);
 struct type_item *get_ret_type(struct ast_node *fun_node);
 
 struct ast_node *function_node_new(struct ast_node *func_type,
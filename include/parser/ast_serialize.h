@@ -0,0 +1,81 @@
+/*
+ * ast_serialize.h
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * binary save/load of parsed ast trees so that a module can be reloaded without lexing and parsing.
+ *
+ * layout, in host byte order with the header 8-byte aligned and the sections after it 4-byte aligned:
+ *   header
+ *   u32 name_offsets[name_count]   offset of each zero terminated name in the name bytes
+ *   u32 lists[list_size]           child references of block nodes
+ *   struct ast_record[node_count]  nodes in post order, a node only refers to records before it
+ *   char names[names_size]         symbols and string literals, each stored once
+ * a reference is 1 + index of the record, name or list item, 0 is null. loading is one pass over
+ * the records turning references into pointers, each name is interned once. the buffer is only
+ * read, so it can be a mapped file.
+ *
+ * the trees are the ones produced by the parser: literal types are kept, other analysis results
+ * (inferred types, transformed nodes, specialized functions) are not saved and are recomputed
+ * by analyzing the loaded tree.
+ */
+#ifndef __MLANG_AST_SERIALIZE_H__
+#define __MLANG_AST_SERIALIZE_H__
+
+#include "parser/ast.h"
+#include "clib/byte_array.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AST_FILE_MAGIC 0x5453414D //"MAST"
+#define AST_FILE_VERSION 1
+
+struct ast_file_header {
+    u32 magic;
+    u16 version;
+    u16 record_size;
+    u32 name_count;
+    u32 names_size;
+    u32 node_count;
+    u32 list_size;
+    u32 root;
+    u32 reserved;
+    u64 checksum; //hash64 of everything after the header
+};
+
+#define AST_FLAG_ADDRESSED 0x01
+#define AST_FLAG_RET 0x02
+#define AST_FLAG_LVALUE 0x04
+#define AST_FLAG_ADDRESSABLE 0x08
+#define AST_FLAG_HEAP_ALLOC 0x10
+
+#define AST_RECORD_REFS 6
+
+struct ast_record {
+    u8 node_type;
+    u8 flags; //AST_FLAG_*
+    u8 kind;  //small node specific values, e.g. mutability or kind of a type item
+    u8 kind2;
+    u32 type; //1 + enum type of the nullary type set by the parser, 0 for none
+    struct source_location loc;
+    u32 refs[AST_RECORD_REFS]; //node, name and list references or literal values
+};
+
+/*
+ * append the serialized tree to out, returns false if the tree holds a node that cannot be
+ * saved. tc is the type context the tree was parsed with
+ */
+bool ast_serialize(struct type_context *tc, struct ast_node *node, struct byte_array *out);
+/*
+ * rebuild the tree from data, nodes are created as ast_node_new does (from the current arena
+ * if one is set). data has to be 8-byte aligned. returns 0 if data is not a valid ast file of this version
+ */
+struct ast_node *ast_deserialize(struct type_context *tc, const u8 *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -18,6 +18,8 @@ extern "C" {
 
 struct type_item *retrieve_type_for_var_name(struct sema_context *env, symbol name);
 struct type_item *analyze(struct sema_context *env, struct ast_node *node);
+//analyze nodes of the block in the current scope, used to analyze a module on top of an analyzed prelude
+struct type_item *analyze_block_nodes(struct sema_context *env, struct ast_node *block);
 struct type_item *create_type_from_type_item_node(struct sema_context *context, struct type_item_node *type_item_node, enum Mut mut);
 
 #ifdef __cplusplus
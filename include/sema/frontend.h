@@ -20,7 +20,19 @@ struct frontend{
     struct sema_context *sema_context;
 };
 
+/*
+ * sources of the files under the sys path, read once and shared read-only by the
+ * frontends of compilations running in parallel
+ */
+struct sys_prelude {
+    struct array codes; //string of each sys file
+};
+
+void sys_prelude_init(struct sys_prelude *prelude, const char *sys_path);
+void sys_prelude_deinit(struct sys_prelude *prelude);
+
 struct frontend *frontend_sys_init(const char *sys_path, bool is_repl);
+struct frontend *frontend_prelude_init(struct sys_prelude *prelude, bool is_repl);
 struct frontend *frontend_init(void);
 void frontend_deinit(struct frontend *fe);
 
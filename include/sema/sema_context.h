@@ -24,6 +24,7 @@ extern "C" {
  */
 struct loop_nested_level{
     u32 block_levels;
+    bool has_jump; //break or continue of the loop
 };
 
 struct sema_context {
@@ -128,6 +129,34 @@ struct sema_context {
     bool is_repl;
 };
 
+/*
+ * state of a sema context and its type context, taken once the prelude is analyzed.
+ * analyzing a module on top of it and rolling back leaves the context as it was, so one
+ * context serves any number of modules while the prelude is parsed and analyzed only once
+ */
+struct sema_checkpoint {
+    struct symbol_list_entry *varname_2_typexprs;
+    struct symbol_list_entry *varname_2_asts;
+    struct symbol_list_entry *typename_2_typexpr_pairs;
+    struct hashtable gvar_name_2_ast;
+    struct hashtable struct_typename_2_asts;
+    struct hashtable type_2_ref_symbol;
+    struct hashtable generic_ast;
+    struct hashtable specialized_ast;
+    struct hashtable func_types;
+    struct hashtable calls;
+    /*type context*/
+    struct hashtable symbol_2_type_items;
+    struct hashtable type_item_vars;
+    struct hashtable freshed_type_items;
+    struct hashtable ts_infos;
+    size_t scope_level;
+    size_t func_stack_size;
+    size_t nongens_size;
+    size_t used_builtin_names_size;
+    size_t nested_levels_size;
+};
+
 struct field_info{
     struct ast_node *offset_expr;  //offset expr
     u32 align;  //alignment of the field.
@@ -137,6 +166,9 @@ struct field_info{
 
 struct sema_context *sema_context_new(struct type_context *tc, struct ast_node *sys_block, bool is_repl);
 void sema_context_free(struct sema_context *env);
+void sema_checkpoint_init(struct sema_checkpoint *cp, struct sema_context *context);
+void sema_checkpoint_deinit(struct sema_checkpoint *cp);
+void sema_context_rollback(struct sema_context *context, struct sema_checkpoint *cp);
 size_t enter_scope(struct sema_context *env);
 size_t leave_scope(struct sema_context *env);
 struct ast_node *find_generic_fun(struct sema_context *context, symbol fun_name);
@@ -83,6 +83,7 @@ struct type_item {
     }; 
     struct array dims;  //dimensions for array type
     bool is_variadic;   //for function type, indicating whether it's vardiadic function
+    bool is_arena_alloc; //allocated from the compilation arena, released with the arena
     void *backend_type;  //backend type of the node, for example for backend LLVM, it's LLVMTypeRef 
 };
 
@@ -31,6 +31,7 @@ struct struct_layout {
 
     struct array field_offsets; //field offsets in bits
     struct array field_layouts; //field layout pointers (NULL if the field is not structure)
+    struct array owned_layouts; //layouts of unnamed field types, freed together with this layout
 };
 
 struct type_size_info get_type_size_info(struct type_context *tc, struct type_item *type);
@@ -1,6 +1,17 @@
 #include "wasm/libc.h"
 
+struct time_report;
+
 wasm_export_name(version) const char *version(void);
+//optimization level of the code compiled by compile_code, see codegen/wasm/wasm_pass.h
+wasm_export_name(set_opt_level) void set_opt_level(u32 level);
+//features beyond wasm 1.0 the code compiled by compile_code may use, see enum wasm_feature in codegen/wasm/cg_wasm.h
+wasm_export_name(set_target_features) void set_target_features(u32 features);
 wasm_export_name(compile_code) u8 *compile_code(const char *text);
 wasm_export_name(highlight_code) u8 *highlight_code(const char *text);
 wasm_export_name(get_code_size) u32 get_code_size(void);
+//phases of the last compile_code call, 0 before the first one. see app/time_report.h for the layout
+wasm_export_name(get_time_report) struct time_report *get_time_report(void);
+//the phases of the time report in their order, their names are those of -time-report
+wasm_export_name(get_phase_count) u32 get_phase_count(void);
+wasm_export_name(get_phase_name) const char *get_phase_name(u32 phase);
@@ -23,10 +23,12 @@ void app_init(void)
     symbols_init();
     token_init();
     error_init(&app.error_reports);
+    mutex_init(&app.error_reports_lock);
 }
 
 void app_deinit(void)
 {
+    mutex_deinit(&app.error_reports_lock);
     error_deinit(&app.error_reports);
     token_deinit();
     symbols_deinit();
@@ -34,8 +36,10 @@ void app_deinit(void)
 
 void app_reset_error_reports(void)
 {
+    mutex_lock(&app.error_reports_lock);
     error_deinit(&app.error_reports);
     error_init(&app.error_reports);
+    mutex_unlock(&app.error_reports_lock);
 }
 
 struct app *app_get(void)
@@ -3,8 +3,8 @@
  * 
  * Copyright (C) 2022 Ligang Wang <ligangwangs@gmail.com>
  *
- * error handling for mlang compiler, it is not thread safe, but as long as handle is unique per thread,
- * the chance of having race condition is pretty low.
+ * error handling for mlang compiler, reports are kept per handle in one table shared by all
+ * compiler threads, the table is guarded by a mutex.
  */
 
 #include "app/error.h"
@@ -60,7 +60,9 @@ struct error_reports get_error_reports(ErrorHandle handle)
 {
     struct app *app = app_get();
     struct error_reports reports;
+    mutex_lock(&app->error_reports_lock);
     struct array *arr = hashtable_get_p(&app->error_reports, handle);
+    mutex_unlock(&app->error_reports_lock);
     if(!arr||!array_size(arr)){
         reports.num_errors = 0;
         reports.reports = 0;
@@ -73,15 +75,26 @@ struct error_reports get_error_reports(ErrorHandle handle)
 struct error_report *get_last_error_report(ErrorHandle handle)
 {
     struct app *app = app_get();
+    mutex_lock(&app->error_reports_lock);
     struct array *arr = hashtable_get_p(&app->error_reports, handle);
+    mutex_unlock(&app->error_reports_lock);
     if(!arr||!array_size(arr))
         return 0;
     return array_back(arr);
 }
 
+void clear_error_reports(ErrorHandle handle)
+{
+    struct app *app = app_get();
+    mutex_lock(&app->error_reports_lock);
+    hashtable_remove_p(&app->error_reports, handle);
+    mutex_unlock(&app->error_reports_lock);
+}
+
 void report_error(ErrorHandle handle, enum error_code error_code, struct source_location loc, ...)
 {
     struct app *app = app_get();
+    mutex_lock(&app->error_reports_lock);
     struct array *arr = hashtable_get_p(&app->error_reports, handle);
     if(!arr){
         struct array new_array;
@@ -89,6 +102,7 @@ void report_error(ErrorHandle handle, enum error_code error_code, struct source_
         hashtable_set_p(&app->error_reports, handle, &new_array);
         arr = hashtable_get_p(&app->error_reports, handle);
     }
+    mutex_unlock(&app->error_reports_lock);
     const char *format = err_messages[error_code];
     struct error_report report;
     report.error_code = error_code;
@@ -0,0 +1,82 @@
+/*
+ * time_report.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * per phase compile time instrumentation
+ */
+#include "app/time_report.h"
+
+THREAD_LOCAL struct compile_counters g_compile_counters;
+
+static const char *phase_names[] = {
+    "frontend",
+    "parse",
+    "analyze",
+    "codegen",
+    "optimize",
+    "emit",
+};
+
+void time_report_init(struct time_report *report)
+{
+    memset(report, 0, sizeof(*report));
+    report->phase = PHASE_COUNT;
+}
+
+void time_report_end(struct time_report *report)
+{
+    if (report->phase == PHASE_COUNT)
+        return;
+    struct phase_stats *stats = &report->phases[report->phase];
+    stats->ns += get_time_ns() - report->start_ns;
+    stats->allocs += g_alloc_stats.count - report->start_allocs.count;
+    stats->alloc_bytes += g_alloc_stats.bytes - report->start_allocs.bytes;
+    stats->tokens += g_compile_counters.tokens - report->start_counters.tokens;
+    stats->nodes += g_compile_counters.nodes - report->start_counters.nodes;
+    stats->types += g_compile_counters.types - report->start_counters.types;
+    report->phase = PHASE_COUNT;
+}
+
+void time_report_begin(struct time_report *report, enum compile_phase phase)
+{
+    time_report_end(report);
+    report->phase = phase;
+    report->start_allocs = g_alloc_stats;
+    report->start_counters = g_compile_counters;
+    report->start_ns = get_time_ns();
+}
+
+void time_report_add(struct time_report *sum, struct time_report *report)
+{
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        struct phase_stats *to = &sum->phases[i], *from = &report->phases[i];
+        to->ns += from->ns;
+        to->allocs += from->allocs;
+        to->alloc_bytes += from->alloc_bytes;
+        to->tokens += from->tokens;
+        to->nodes += from->nodes;
+        to->types += from->types;
+    }
+}
+
+const char *compile_phase_name(enum compile_phase phase)
+{
+    return phase < PHASE_COUNT ? phase_names[phase] : "none";
+}
+
+void time_report_print(struct time_report *report, FILE *out)
+{
+    struct phase_stats total = { 0 };
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        total.ns += report->phases[i].ns;
+    }
+    fprintf(out, "%-10s %12s %7s %10s %12s %10s %10s %10s\n", "phase", "ms", "%", "allocs", "alloc bytes", "tokens", "nodes", "types");
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        struct phase_stats *stats = &report->phases[i];
+        fprintf(out, "%-10s %12.3f %6.1f%% %10llu %12llu %10llu %10llu %10llu\n", phase_names[i], stats->ns / 1e6,
+            total.ns ? stats->ns * 100.0 / total.ns : 0.0, (unsigned long long)stats->allocs, (unsigned long long)stats->alloc_bytes,
+            (unsigned long long)stats->tokens, (unsigned long long)stats->nodes, (unsigned long long)stats->types);
+    }
+    fprintf(out, "%-10s %12.3f\n", "total", total.ns / 1e6);
+}
@@ -0,0 +1,109 @@
+/*
+ * arena.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * arena (bump) allocator in C
+ */
+#include "clib/arena.h"
+#include "clib/util.h"
+
+#define _ALIGN_UP(n) (((n) + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1))
+#define _CHUNK_HEADER_SIZE _ALIGN_UP(sizeof(struct arena_chunk))
+
+void arena_init(struct arena *arena)
+{
+    arena->chunks = 0;
+    arena->pos = 0;
+    arena->end = 0;
+    arena->allocated = 0;
+}
+
+void _arena_free_chunks(struct arena_chunk *chunk)
+{
+    while (chunk) {
+        struct arena_chunk *next = chunk->next;
+        FREE(chunk);
+        chunk = next;
+    }
+}
+
+void arena_deinit(struct arena *arena)
+{
+    _arena_free_chunks(arena->chunks);
+    arena_init(arena);
+}
+
+void _arena_add_chunk(struct arena *arena, size_t min_size)
+{
+    struct arena_chunk *chunk;
+    size_t size = min_size > ARENA_CHUNK_SIZE ? min_size : ARENA_CHUNK_SIZE;
+    MALLOC(chunk, _CHUNK_HEADER_SIZE + size);
+    chunk->size = size;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    arena->pos = (char *)chunk + _CHUNK_HEADER_SIZE;
+    arena->end = arena->pos + size;
+}
+
+void *arena_alloc(struct arena *arena, size_t size)
+{
+    size = _ALIGN_UP(size ? size : 1);
+    if ((size_t)(arena->end - arena->pos) < size)
+        _arena_add_chunk(arena, size);
+    void *p = arena->pos;
+    arena->pos += size;
+    arena->allocated += size;
+    return p;
+}
+
+void *arena_calloc(struct arena *arena, size_t count, size_t size)
+{
+    void *p = arena_alloc(arena, count * size);
+    memset(p, 0, count * size);
+    return p;
+}
+
+void arena_reset(struct arena *arena)
+{
+    struct arena_chunk *chunk = arena->chunks;
+    if (!chunk)
+        return;
+    //the oldest chunk is the last one in the chain, keep it for reuse
+    struct arena_chunk *first = chunk;
+    while (first->next) first = first->next;
+    for (chunk = arena->chunks; chunk != first;) {
+        struct arena_chunk *next = chunk->next;
+        FREE(chunk);
+        chunk = next;
+    }
+    arena->chunks = first;
+    arena->pos = (char *)first + _CHUNK_HEADER_SIZE;
+    arena->end = arena->pos + first->size;
+    arena->allocated = 0;
+}
+
+struct arena_mark arena_get_mark(struct arena *arena)
+{
+    struct arena_mark mark = {arena->chunks, arena->pos, arena->allocated};
+    return mark;
+}
+
+void arena_rollback(struct arena *arena, struct arena_mark *mark)
+{
+    while (arena->chunks != mark->chunk) {
+        struct arena_chunk *chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        FREE(chunk);
+    }
+    arena->pos = mark->pos;
+    arena->end = mark->chunk ? (char *)mark->chunk + _CHUNK_HEADER_SIZE + mark->chunk->size : 0;
+    arena->allocated = mark->allocated;
+}
+
+size_t arena_chunk_count(struct arena *arena)
+{
+    size_t count = 0;
+    for (struct arena_chunk *chunk = arena->chunks; chunk; chunk = chunk->next) count++;
+    return count;
+}
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "clib/byte_array.h"
 #include "clib/util.h"
@@ -27,33 +28,40 @@ void _ba_grow_to(struct byte_array *ba, u32 new_cap)
     ba->data = data;
 }
 
-void _ba_grow(struct byte_array *ba)
+void ba_reserve(struct byte_array *ba, u32 bytes)
 {
-    _ba_grow_to(ba, ba->cap * 1.5);
+    u32 need = ba->size + bytes;
+    if (need <= ba->cap)
+        return;
+    u32 new_cap = ba->cap * 2;
+    _ba_grow_to(ba, new_cap < need ? need : new_cap);
 }
 
 void ba_add(struct byte_array *ba, u8 byte)
 {
     if (ba->size == ba->cap) {
-        _ba_grow(ba);
+        ba_reserve(ba, 1);
     }
     ba->data[ba->size++] = byte;
 }
 
-void ba_add_array(struct byte_array *ba, u8* byte, u32 bytes)
+void ba_add_array(struct byte_array *ba, const u8 *byte, u32 bytes)
 {
-    for(u32 i=0;i<bytes; i++){
-        ba_add(ba, byte[i]);
-    }
+    ba_reserve(ba, bytes);
+    memcpy(&ba->data[ba->size], byte, bytes);
+    ba->size += bytes;
 }
 
 void ba_add2(struct byte_array *dst, struct byte_array *src)
 {
-    if (dst->cap < dst->size + src->size) {
-        _ba_grow_to(dst, dst->size + src->size);
-    }
-    memcpy(&dst->data[dst->size], src->data, src->size);
-    dst->size += src->size;
+    ba_add_array(dst, src->data, src->size);
+}
+
+void ba_remove(struct byte_array *ba, u32 index, u32 bytes)
+{
+    assert(index + bytes <= ba->size);
+    memmove(&ba->data[index], &ba->data[index + bytes], ba->size - index - bytes);
+    ba->size -= bytes;
 }
 
 void ba_set(struct byte_array *ba, u32 index, u8 byte)
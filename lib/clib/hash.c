@@ -8,20 +8,109 @@
 
 #include "clib/hash.h"
 #include <stddef.h>
+#include <string.h>
+
 /*
- * the hash function from Donald E. Knuth, The Art of Computer Proramming Vol 3.
- * 
+ * word-at-a-time hash: keys are read 8 bytes at a time, 32 byte blocks of long keys go through
+ * four independent lanes so they could be pipelined or vectorized, the result is avalanched
+ * so that any bits of it could be used to index a table.
  */
+#define HASH_P0 0x9E3779B185EBCA87ull
+#define HASH_P1 0xC2B2AE3D27D4EB4Full
+#define HASH_P2 0x165667B19E3779F9ull
+
+static inline u64 _read64(const unsigned char *p)
+{
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline u64 _rotl64(u64 x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline u64 _round(u64 acc, u64 input)
+{
+    acc += input * HASH_P1;
+    acc = _rotl64(acc, 31);
+    return acc * HASH_P0;
+}
+
+static inline u64 _avalanche(u64 h)
+{
+    h ^= h >> 33;
+    h *= HASH_P1;
+    h ^= h >> 29;
+    h *= HASH_P2;
+    h ^= h >> 32;
+    return h;
+}
+
+u64 hash64(unsigned char *data, size_t len)
+{
+    const unsigned char *p = data;
+    const unsigned char *end = data + len;
+    u64 h;
+    if (len >= 32) {
+        u64 v0 = HASH_P0 + HASH_P1, v1 = HASH_P1, v2 = 0, v3 = (u64)0 - HASH_P0;
+        const unsigned char *limit = end - 32;
+        do {
+            v0 = _round(v0, _read64(p));
+            v1 = _round(v1, _read64(p + 8));
+            v2 = _round(v2, _read64(p + 16));
+            v3 = _round(v3, _read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        h = _rotl64(v0, 1) + _rotl64(v1, 7) + _rotl64(v2, 12) + _rotl64(v3, 18);
+    } else {
+        h = HASH_P2;
+    }
+    h += (u64)len;
+    for (; p + 8 <= end; p += 8) {
+        h ^= _round(0, _read64(p));
+        h = _rotl64(h, 27) * HASH_P0 + HASH_P2;
+    }
+    size_t rest = (size_t)(end - p);
+    if (rest) {
+        //1 to 7 bytes: two overlapping 4 byte reads, or first, middle and last byte
+        u64 tail;
+        if (rest >= 4) {
+            u32 lo, hi;
+            memcpy(&lo, p, sizeof(lo));
+            memcpy(&hi, end - 4, sizeof(hi));
+            tail = ((u64)hi << 32) | lo;
+        } else {
+            tail = ((u64)p[0] << 16) | ((u64)p[rest >> 1] << 8) | p[rest - 1];
+        }
+        h ^= tail * HASH_P0;
+        h = _rotl64(h, 23) * HASH_P1;
+    }
+    return _avalanche(h);
+}
 
 unsigned int hash(unsigned char *data, size_t len)
 {
-    const char *str = (const char *)data;
-    unsigned hash = (unsigned)len;
-    unsigned i = 0;
-    for (i = 0; i < len; ++str, ++i) {
-        hash = ((hash << 5) ^ (hash >> 27)) ^ (*str);
+    return (unsigned int)hash64(data, len);
+}
+
+unsigned int hash_word(u64 key)
+{
+    return (unsigned int)_avalanche(key ^ HASH_P2);
+}
+
+//pointer and integer keys of one word go to hash_word, the other keys go to the byte hash
+unsigned int hash_key(unsigned char *data, size_t len)
+{
+    if (len == sizeof(u64))
+        return hash_word(_read64(data));
+    if (len == sizeof(u32)) {
+        u32 v;
+        memcpy(&v, data, sizeof(v));
+        return hash_word(v);
     }
-    return hash;
+    return hash(data, len);
 }
 
 void *hashbox_get_key(struct hashbox *box)
@@ -3,7 +3,9 @@
  * 
  * Copyright (C) 2020 Ligang Wang <ligangwangs@gmail.com>
  *
- * dynamic hashtable with collision resolution implemented using chaining (singly-linked list)
+ * dynamic hashtable with collision resolution implemented using open addressing:
+ * robin hood linear probing in a power of two table, deletion shifts the following
+ * entries back so no tombstone is needed
  */
 #include <assert.h>
 #include <stddef.h>
@@ -13,12 +15,11 @@
 #include "clib/hashtable.h"
 #include "clib/util.h"
 
-typedef void (*on_hash_entry)(struct hashtable *ht, struct hash_entry *entry);
-void hashtable_iterate(struct hashtable *ht, on_hash_entry on_entry);
+#define HASHTABLE_INIT_CAP 16
 
-bool match_entry(struct hash_entry *entry, const char *key, size_t key_size)
+bool _match_box(struct hashbox *box, const char *key, size_t key_size)
 {
-    return (entry->data.key_store_size == key_size || entry->data.key_store_size == key_size + 1) && !memcmp(entry->data.key_value_pair, key, key_size);
+    return (box->key_store_size == key_size || box->key_store_size == key_size + 1) && !memcmp(box->key_value_pair, key, key_size);
 }
 
 void hashtable_init(struct hashtable *ht)
@@ -38,14 +39,27 @@ void *_get_data(struct hashtable *ht, unsigned char *data)
         return 0;
     return ht->value_size ? data : *(void **)data;
 }
+
+void _hashtable_alloc_slots(struct hashtable *ht, size_t cap)
+{
+    ht->cap = cap;
+    ht->shift = 32;
+    while (cap > 1) {
+        cap >>= 1;
+        ht->shift--;
+    }
+    CALLOC(ht->slots, ht->cap, sizeof(struct hash_slot));
+}
+
 //assuming owning the object
 void hashtable_init_with_value_size(struct hashtable *ht, size_t value_size, free_fun free_element)
 {
-    ht->cap = 19;
     ht->size = 0;
     ht->value_size = value_size;
+    ht->key_size = 0;
     ht->key_is_c_str = false;
-    CALLOC(ht->heads, ht->cap, sizeof(struct hash_head));
+    ht->key_hash = hash_key;
+    _hashtable_alloc_slots(ht, HASHTABLE_INIT_CAP);
     ht->free_element = free_element;
 }
 
@@ -55,154 +69,147 @@ void hashtable_init_with_size(struct hashtable *ht, size_t key_size, size_t valu
     ht->key_size = key_size;
 }
 
-size_t _get_index(struct hashtable *ht, unsigned char *key, size_t key_size)
+void hashtable_set_hash_fun(struct hashtable *ht, hash_fun fun)
 {
-    return hash(key, key_size) % ht->cap;
+    assert(!ht->size);
+    ht->key_hash = fun;
 }
 
-void _hashtable_grow(struct hashtable *ht)
+//fibonacci hashing spreads the hash bits over the top bits used as the home slot
+size_t _home_slot(struct hashtable *ht, unsigned int h)
 {
-    struct hash_head *head, *heads, *new_head;
-    struct hash_entry *entry, *next;
-    size_t cap, index;
-
-    if (ht->size > 0.75 * ht->cap) {
-        cap = ht->cap;
-        heads = ht->heads;
-        ht->cap *= 2;
-        CALLOC(ht->heads, ht->cap, sizeof(struct hash_head));
-        for (size_t i = 0; i < cap; i++) {
-            head = &heads[i];
-            entry = head->first;
-            while (entry) {
-                next = entry->list.next;
-                size_t key_size = ht->key_is_c_str ? entry->data.key_store_size - 1 : entry->data.key_store_size;
-                index = _get_index(ht, (unsigned char *)entry->data.key_value_pair, key_size);
-                new_head = &ht->heads[index];
-                list_insert_head(new_head, entry);
-                entry = next;
-            }
+    return ht->shift >= 32 ? 0 : (unsigned int)(h * 2654435769u) >> ht->shift;
+}
+
+size_t _probe_distance(struct hashtable *ht, size_t index, unsigned int h)
+{
+    return (index - _home_slot(ht, h)) & (ht->cap - 1);
+}
+
+//robin hood insert of an entry known to be absent: takes the slot from any entry closer to its home
+void _hashtable_place(struct hashtable *ht, unsigned int h, struct hashbox *box)
+{
+    size_t mask = ht->cap - 1;
+    size_t index = _home_slot(ht, h);
+    size_t dist = 0;
+    struct hash_slot slot = {h, box};
+    while (ht->slots[index].box) {
+        size_t existing_dist = _probe_distance(ht, index, ht->slots[index].hash);
+        if (existing_dist < dist) {
+            struct hash_slot t = ht->slots[index];
+            ht->slots[index] = slot;
+            slot = t;
+            dist = existing_dist;
         }
-        FREE(heads);
+        index = (index + 1) & mask;
+        dist++;
     }
+    ht->slots[index] = slot;
 }
 
-struct hashbox *_get_hashbox(struct hash_head *head, const char *key, size_t key_size)
+void _hashtable_grow(struct hashtable *ht)
 {
-    struct hash_entry *entry;
-    list_foreach(entry, head)
-    {
-        if (match_entry(entry, key, key_size)) {
-            return &entry->data;
-        }
+    if ((ht->size + 1) * 5 <= ht->cap * 4)
+        return;
+    struct hash_slot *slots = ht->slots;
+    size_t cap = ht->cap;
+    _hashtable_alloc_slots(ht, cap * 2);
+    for (size_t i = 0; i < cap; i++) {
+        if (slots[i].box)
+            _hashtable_place(ht, slots[i].hash, slots[i].box);
+    }
+    FREE(slots);
+}
+
+//returns the slot index of the key, or -1 if not found
+long _hashtable_find(struct hashtable *ht, void *key, size_t key_size, unsigned int h)
+{
+    size_t mask = ht->cap - 1;
+    size_t index = _home_slot(ht, h);
+    for (size_t dist = 0;; dist++) {
+        struct hash_slot *slot = &ht->slots[index];
+        //robin hood invariant: the key would have been placed before any entry closer to its home
+        if (!slot->box || _probe_distance(ht, index, slot->hash) < dist)
+            return -1;
+        if (slot->hash == h && _match_box(slot->box, key, key_size))
+            return (long)index;
+        index = (index + 1) & mask;
     }
-    return 0;
 }
 
 struct hashbox *_hashtable_get_hashbox(struct hashtable *ht, void *key, size_t key_size)
 {
-    struct hash_head *head;
-    head = &ht->heads[_get_index(ht, (unsigned char *)key, key_size)];
-    return _get_hashbox(head, key, key_size);
+    long index = _hashtable_find(ht, key, key_size, ht->key_hash((unsigned char *)key, key_size));
+    return index < 0 ? 0 : ht->slots[index].box;
 }
 
-struct hash_entry *_hash_entry_new(size_t key_store_size, size_t value_size)
+//the hashbox, key and value are in one allocation
+struct hashbox *_hashbox_new(size_t key_store_size, size_t value_size)
 {
-    struct hash_entry *entry;
-    CALLOC(entry, 1, sizeof(struct hash_entry));
-    entry->data.status = HASH_EXIST;
-    entry->data.key_store_size = (unsigned)key_store_size;
-    entry->data.value_size = (unsigned)value_size;
-    void *kv;
-    MALLOC(kv, key_store_size + value_size);
-    entry->data.key_value_pair = kv;
-    return entry;
+    struct hashbox *box;
+    MALLOC(box, sizeof(struct hashbox) + key_store_size + value_size);
+    box->status = HASH_EXIST;
+    box->key_store_size = (unsigned)key_store_size;
+    box->value_size = (unsigned)value_size;
+    box->key_value_pair = (unsigned char *)(box + 1);
+    return box;
 }
 
-void _hash_entry_free(struct hashtable *ht, struct hash_entry *entry)
+void _hashbox_free_value(struct hashtable *ht, struct hashbox *box)
 {
     if (ht->free_element) {
-        void *data = entry->data.key_value_pair + entry->data.key_store_size;
+        void *data = box->key_value_pair + box->key_store_size;
         if (!ht->value_size)
             ht->free_element(*(void**)data);
         else
             ht->free_element(data);
     }
-    FREE(entry->data.key_value_pair);
-    FREE(entry);
 }
 
-void hashtable_iterate(struct hashtable *ht, on_hash_entry on_entry)
+void _hashbox_free(struct hashtable *ht, struct hashbox *box)
 {
-    struct hash_head *head;
-    struct hash_entry *entry, *next;
-    for (size_t i = 0; i < ht->cap; i++) {
-        head = &ht->heads[i];
-        entry = head->first;
-        while (entry) {
-            next = entry->list.next;
-            on_entry(ht, entry);
-            entry = next;
-        }
-        head->first = 0;
-    }
+    _hashbox_free_value(ht, box);
+    FREE(box);
 }
 
 void hashtable_clear(struct hashtable *ht)
 {
-    hashtable_iterate(ht, _hash_entry_free);
+    for (size_t i = 0; i < ht->cap; i++) {
+        if (ht->slots[i].box) {
+            _hashbox_free(ht, ht->slots[i].box);
+            ht->slots[i].box = 0;
+        }
+    }
+    ht->size = 0;
 }
 
 void hashtable_remove(struct hashtable *ht, const char *key)
 {
-    struct hash_head *head;
-    struct hash_entry *entry;
-    struct hash_entry *prev = 0;
-    size_t key_size = strlen(key);
-    head = &ht->heads[_get_index(ht, (unsigned char *)key, key_size)];
-    list_foreach(entry, head)
-    {
-        if (match_entry(entry, key, key_size)) {
-            break;
-        }
-        prev = entry;
-    }
-    if (entry) {
-        if (prev)
-            list_remove_next(prev);
-        else
-            list_remove_head(head);
-        _hash_entry_free(ht, entry);
-        ht->size--;
-    }
+    hashtable_remove_g(ht, (void *)key, strlen(key));
 }
 
 void hashtable_remove_g(struct hashtable *ht, void *key, size_t key_size)
 {
-    struct hash_head *head;
-    struct hash_entry *entry;
-    struct hash_entry *prev = 0;
-    head = &ht->heads[_get_index(ht, (unsigned char *)key, key_size)];
-    list_foreach(entry, head)
-    {
-        if (match_entry(entry, key, key_size)) {
-            break;
-        }
-        prev = entry;
-    }
-    if (entry) {
-        if (prev)
-            list_remove_next(prev);
-        else
-            list_remove_head(head);
-        _hash_entry_free(ht, entry);
-        ht->size--;
+    long found = _hashtable_find(ht, key, key_size, ht->key_hash((unsigned char *)key, key_size));
+    if (found < 0)
+        return;
+    size_t mask = ht->cap - 1;
+    size_t index = (size_t)found;
+    _hashbox_free(ht, ht->slots[index].box);
+    //backward shift: move following entries one slot closer to their home until an empty slot or a home slot
+    size_t next = (index + 1) & mask;
+    while (ht->slots[next].box && _probe_distance(ht, next, ht->slots[next].hash)) {
+        ht->slots[index] = ht->slots[next];
+        index = next;
+        next = (next + 1) & mask;
     }
+    ht->slots[index].box = 0;
+    ht->size--;
 }
 
 void hashtable_remove_p(struct hashtable *ht, void *key)
 {
-    hashtable_remove_g(ht, key, sizeof(void *));
+    hashtable_remove_g(ht, (void *)&key, sizeof(void *));
 }
 
 void hashtable_set(struct hashtable *ht, const char *key, void *value)
@@ -238,23 +245,23 @@ void hashtable_set_g(struct hashtable *ht, void *key, size_t key_size, void *val
     bool copy_value = (bool)value_size;
     if (!value_size)
         value_size = sizeof(value);
-    _hashtable_grow(ht);
-    size_t index = _get_index(ht, (unsigned char *)key, key_size);
-    struct hash_head *head = &ht->heads[index];
-    struct hashbox *box = _get_hashbox(head, key, key_size);
-    if (!box) {
-        struct hash_entry *entry;
+    unsigned int h = ht->key_hash((unsigned char *)key, key_size);
+    long index = _hashtable_find(ht, key, key_size, h);
+    struct hashbox *box;
+    if (index >= 0) {
+        box = ht->slots[index].box;
+    } else {
         if(ht->key_is_c_str){
-            entry = _hash_entry_new(key_size + 1, value_size);
-            memcpy(entry->data.key_value_pair, key, key_size);
-            entry->data.key_value_pair[key_size] = 0;//append zero
+            box = _hashbox_new(key_size + 1, value_size);
+            memcpy(box->key_value_pair, key, key_size);
+            box->key_value_pair[key_size] = 0;//append zero
         }else{
-            entry = _hash_entry_new(key_size, value_size);
-            memcpy(entry->data.key_value_pair, key, key_size);
+            box = _hashbox_new(key_size, value_size);
+            memcpy(box->key_value_pair, key, key_size);
         }
-        list_insert_head(head, entry);
+        _hashtable_grow(ht);
+        _hashtable_place(ht, h, box);
         ht->size++;
-        box = &entry->data;
     }
     unsigned char *data = _get_data_ptr(ht, box, key_size);
     if (copy_value)
@@ -323,6 +330,63 @@ bool hashtable_in(struct hashtable *ht, const char *key)
     return hashtable_in_g(ht, (void *)key, strlen(key));
 }
 
+struct hashbox *_hashbox_copy(struct hashbox *box)
+{
+    struct hashbox *copy = _hashbox_new(box->key_store_size, box->value_size);
+    memcpy(copy->key_value_pair, box->key_value_pair, box->key_store_size + box->value_size);
+    return copy;
+}
+
+void hashtable_copy(struct hashtable *dest, struct hashtable *src)
+{
+    *dest = *src;
+    dest->free_element = 0;
+    CALLOC(dest->slots, src->cap, sizeof(struct hash_slot));
+    //same capacity and hash function, so every entry keeps its slot
+    for (size_t i = 0; i < src->cap; i++) {
+        if (src->slots[i].box) {
+            dest->slots[i].hash = src->slots[i].hash;
+            dest->slots[i].box = _hashbox_copy(src->slots[i].box);
+        }
+    }
+}
+
+size_t _box_key_size(struct hashtable *ht, struct hashbox *box)
+{
+    return ht->key_is_c_str ? box->key_store_size - 1 : box->key_store_size;
+}
+
+void hashtable_restore(struct hashtable *ht, struct hashtable *saved)
+{
+    for (size_t i = 0; i < ht->cap;) {
+        struct hashbox *box = ht->slots[i].box;
+        if (box && _hashtable_find(saved, box->key_value_pair, _box_key_size(ht, box), ht->slots[i].hash) < 0) {
+            //backward shift moves the next entry into slot i, look at it again
+            hashtable_remove_g(ht, box->key_value_pair, _box_key_size(ht, box));
+            continue;
+        }
+        i++;
+    }
+    for (size_t i = 0; i < saved->cap; i++) {
+        struct hashbox *box = saved->slots[i].box;
+        if (!box)
+            continue;
+        long index = _hashtable_find(ht, box->key_value_pair, _box_key_size(saved, box), saved->slots[i].hash);
+        if (index < 0) {
+            _hashtable_grow(ht);
+            _hashtable_place(ht, saved->slots[i].hash, _hashbox_copy(box));
+            ht->size++;
+        } else {
+            struct hashbox *current = ht->slots[index].box;
+            if (memcmp(hashbox_get_value(current), hashbox_get_value(box), box->value_size)) {
+                //the value set since the copy is owned by ht alone, the copied one is still alive
+                _hashbox_free_value(ht, current);
+                memcpy(hashbox_get_value(current), hashbox_get_value(box), box->value_size);
+            }
+        }
+    }
+}
+
 size_t hashtable_size(struct hashtable *ht)
 {
     return ht->size;
@@ -330,8 +394,8 @@ size_t hashtable_size(struct hashtable *ht)
 
 void hashtable_deinit(struct hashtable *ht)
 {
-    if(!ht->heads) return;
+    if(!ht->slots) return;
     hashtable_clear(ht);
-    FREE(ht->heads);
-    ht->heads = 0;
+    FREE(ht->slots);
+    ht->slots = 0;
 }
@@ -8,6 +8,9 @@
 #include "clib/util.h"
 #include "clib/regex.h"
 #include "clib/list.h"
+#include "clib/hashtable.h"
+#include "clib/thread.h"
+#include <assert.h>
 #include <ctype.h>
 
 #define RE_MAX_PAREN 100
@@ -17,7 +20,7 @@
 const char* to_postfix(const char *re)
 {
 	int nalt, natom, ncharset;
-	static char buf[8000];
+	static THREAD_LOCAL char buf[8000];
 	char *dst;
 	struct {
 		int nalt;
@@ -163,6 +166,7 @@ struct nstate{
     struct nstate *out1;
     struct nstate *out2;
     int last_listid;
+    int id; //state index in the regex, used to build dfa
 };
 
 union list_ptr{
@@ -202,6 +206,7 @@ struct nstate *nstate_new(struct re *re, int op, struct nstate *out1, struct nst
     s->out1 = out1;
     s->out2 = out2;
     s->last_listid = 0;
+    s->id = re->nstate_count;
     nstate_link_list_add_data_to_head(&re->states, s);
     re->nstate_count++;
     return s;
@@ -373,6 +378,8 @@ void *regex_new(const char *re_pattern)
     const char *re_postfix = to_postfix(re_pattern);
     if(!re_postfix) return 0;
     re->start = to_nfa(re, re_postfix);
+    re->accepted_state.op = NS_ACCEPT;
+    re->accepted_state.id = re->nstate_count;
 	MALLOC(re->l1.states, re->nstate_count*sizeof re->l1.states[0]);
 	MALLOC(re->l2.states, re->nstate_count*sizeof re->l2.states[0]);
     return re;
@@ -394,3 +401,316 @@ void regex_free(void *regex)
     }
     FREE(re);
 }
+
+/*
+ * dfa merging a list of regexes: built with subset construction over all of the regex NFAs,
+ * then minimized with Moore's partition refinement. bytes are mapped to character classes,
+ * bytes not used by any regex share class 0 which always goes to the dead state 0.
+ * an accepting state accepts the regex with the lowest index, so the index is the priority.
+ */
+#define DFA_DEAD 0
+
+struct dfa{
+    u16 start;
+    u16 state_count;
+    u16 class_count;
+    u8 classes[256];
+    u16 *transitions; //state_count * class_count
+    int *accepts;   //regex index accepted by the state, -1 for non-accepting state
+};
+
+struct dfa_builder{
+    struct nstate **nstates; //all NFA states indexed by global id
+    int *nstate_accepts; //regex index if the NFA state is an accepted state, otherwise -1
+    int nstate_count;
+    int words;  //number of u64 per NFA state set
+    u64 **sets; //NFA state set of each DFA state
+    u64 *moves; //closure of the NFA states reached from a char NFA state
+    u16 *transitions;
+    int *accepts;
+    int state_count;
+    int state_cap;
+    struct hashtable set_2_state;
+};
+
+void _dfa_add_nstate(struct dfa_builder *b, u64 *set, struct nstate *s, int *bases, int re_index)
+{
+    if(!s) return;
+    int id = bases[re_index] + s->id;
+    if(set[id / 64] & (1ull << (id % 64))) return;
+    set[id / 64] |= 1ull << (id % 64);
+    if(s->op == NS_SPLIT){
+        _dfa_add_nstate(b, set, s->out1, bases, re_index);
+        _dfa_add_nstate(b, set, s->out2, bases, re_index);
+    }
+}
+
+int _dfa_re_index(int *bases, int re_count, int id)
+{
+    int i = re_count - 1;
+    while(bases[i] > id) i--;
+    return i;
+}
+
+u16 _dfa_get_state(struct dfa_builder *b, u64 *set, u16 class_count)
+{
+    size_t set_size = b->words * sizeof(u64);
+    int *state = hashtable_get_g(&b->set_2_state, set, set_size);
+    if(state) return (u16)*state;
+    assert(b->state_count < 0xFFFF);
+    if(b->state_count == b->state_cap){
+        b->state_cap *= 2;
+        REALLOC(b->sets, b->sets, b->state_cap * sizeof(u64 *));
+        REALLOC(b->transitions, b->transitions, b->state_cap * class_count * sizeof(u16));
+        REALLOC(b->accepts, b->accepts, b->state_cap * sizeof(int));
+    }
+    int index = b->state_count++;
+    MALLOC(b->sets[index], set_size);
+    memcpy(b->sets[index], set, set_size);
+    b->accepts[index] = -1;
+    for(int w = 0; w < b->words; w++){
+        for(u64 bits = set[w]; bits; bits &= bits - 1){
+            int accept = b->nstate_accepts[w * 64 + __builtin_ctzll(bits)];
+            if(accept >= 0 && (b->accepts[index] < 0 || accept < b->accepts[index]))
+                b->accepts[index] = accept;
+        }
+    }
+    hashtable_set_g(&b->set_2_state, set, set_size, &index, sizeof(int));
+    return (u16)index;
+}
+
+bool _dfa_same_successors(struct dfa *dfa, int *block, int i, int j)
+{
+    int k = dfa->class_count;
+    if(block[i] != block[j]) return false;
+    for(int c = 0; c < k; c++){
+        if(block[dfa->transitions[i * k + c]] != block[dfa->transitions[j * k + c]]) return false;
+    }
+    return true;
+}
+
+/*Moore's algorithm: split blocks by (block, blocks of successors) until no more split*/
+void _dfa_minimize(struct dfa *dfa)
+{
+    int n = dfa->state_count, k = dfa->class_count;
+    int *block, *new_block, *rep;
+    u64 *rep_sig;
+    MALLOC(block, n * sizeof(int));
+    MALLOC(new_block, n * sizeof(int));
+    MALLOC(rep, n * sizeof(int));
+    MALLOC(rep_sig, n * sizeof(u64));
+    //initial blocks are the accepted regex of states
+    int block_count = 0;
+    for(int i = 0; i < n; i++){
+        int b = 0;
+        while(b < block_count && dfa->accepts[rep[b]] != dfa->accepts[i]) b++;
+        if(b == block_count) rep[block_count++] = i;
+        block[i] = b;
+    }
+    int last_count;
+    do{
+        last_count = block_count;
+        block_count = 0;
+        for(int i = 0; i < n; i++){
+            //signature is only a filter, _dfa_same_successors decides
+            u64 sig = (u64)block[i];
+            for(int c = 0; c < k; c++){
+                sig = (sig ^ (u64)block[dfa->transitions[i * k + c]]) * 0x100000001b3ULL;
+            }
+            int b = 0;
+            while(b < block_count && (rep_sig[b] != sig || !_dfa_same_successors(dfa, block, rep[b], i))) b++;
+            if(b == block_count){
+                rep[block_count] = i;
+                rep_sig[block_count++] = sig;
+            }
+            new_block[i] = b;
+        }
+        int *t = block; block = new_block; new_block = t;
+    }while(block_count != last_count);
+    //renumber blocks so that the dead state stays 0, then rebuild the table
+    int *block_2_state;
+    MALLOC(block_2_state, block_count * sizeof(int));
+    for(int i = 0; i < block_count; i++) block_2_state[i] = -1;
+    int state_count = 0;
+    block_2_state[block[DFA_DEAD]] = state_count++;
+    for(int i = 0; i < n; i++){
+        if(block_2_state[block[i]] < 0) block_2_state[block[i]] = state_count++;
+    }
+    u16 *transitions;
+    int *accepts;
+    MALLOC(transitions, state_count * k * sizeof(u16));
+    MALLOC(accepts, state_count * sizeof(int));
+    for(int i = 0; i < n; i++){
+        int s = block_2_state[block[i]];
+        accepts[s] = dfa->accepts[i];
+        for(int c = 0; c < k; c++){
+            transitions[s * k + c] = (u16)block_2_state[block[dfa->transitions[i * k + c]]];
+        }
+    }
+    dfa->start = (u16)block_2_state[block[dfa->start]];
+    dfa->state_count = (u16)state_count;
+    FREE(dfa->transitions);
+    FREE(dfa->accepts);
+    dfa->transitions = transitions;
+    dfa->accepts = accepts;
+    FREE(block_2_state);
+    FREE(rep_sig);
+    FREE(rep);
+    FREE(new_block);
+    FREE(block);
+}
+
+struct dfa *dfa_new(void **regexes, int re_count)
+{
+    struct dfa *dfa;
+    struct dfa_builder b;
+    struct nstate_link_entry *entry;
+    int *bases;
+    MALLOC(bases, re_count * sizeof(int));
+    //each regex's accepted state takes the id right after its own states
+    b.nstate_count = 0;
+    for(int i = 0; i < re_count; i++){
+        struct re *re = regexes[i];
+        bases[i] = b.nstate_count;
+        b.nstate_count += re->nstate_count + 1;
+    }
+    MALLOC(b.nstates, b.nstate_count * sizeof(struct nstate *));
+    MALLOC(b.nstate_accepts, b.nstate_count * sizeof(int));
+    for(int i = 0; i < re_count; i++){
+        struct re *re = regexes[i];
+        list_foreach(entry, &re->states){
+            b.nstates[bases[i] + entry->data->id] = entry->data;
+            b.nstate_accepts[bases[i] + entry->data->id] = -1;
+        }
+        b.nstates[bases[i] + re->nstate_count] = &re->accepted_state;
+        b.nstate_accepts[bases[i] + re->nstate_count] = i;
+    }
+    //character classes: each byte used by any NFA state gets its own class
+    MALLOC(dfa, sizeof(*dfa));
+    memset(dfa->classes, 0, sizeof(dfa->classes));
+    int class_count = 1;
+    for(int i = 0; i < b.nstate_count; i++){
+        int op = b.nstates[i]->op;
+        if(op > 0 && op < 256 && !dfa->classes[op]){
+            dfa->classes[op] = (u8)class_count++;
+        }
+    }
+    dfa->class_count = (u16)class_count;
+    b.words = (b.nstate_count + 63) / 64;
+    b.state_count = 0;
+    b.state_cap = 64;
+    MALLOC(b.sets, b.state_cap * sizeof(u64 *));
+    MALLOC(b.transitions, b.state_cap * class_count * sizeof(u16));
+    MALLOC(b.accepts, b.state_cap * sizeof(int));
+    hashtable_init_with_value_size(&b.set_2_state, sizeof(int), 0);
+    u64 *set;
+    CALLOC(set, b.words, sizeof(u64));
+    _dfa_get_state(&b, set, class_count); //dead state 0 is the empty set
+    for(int i = 0; i < re_count; i++){
+        _dfa_add_nstate(&b, set, ((struct re *)regexes[i])->start, bases, i);
+    }
+    dfa->start = _dfa_get_state(&b, set, class_count);
+    //subset construction, b.state_count grows while processing
+    //closure of the target of each char NFA state, so that moving a DFA state on a char class
+    //is OR-ing the closures of its NFA states on the char
+    CALLOC(b.moves, b.nstate_count * b.words, sizeof(u64));
+    for(int i = 0; i < b.nstate_count; i++){
+        struct nstate *s = b.nstates[i];
+        if(s->op > 0 && s->op < 256){
+            _dfa_add_nstate(&b, &b.moves[i * b.words], s->out1, bases, _dfa_re_index(bases, re_count, i));
+        }
+    }
+    u64 *next_sets;
+    bool *moved;
+    MALLOC(next_sets, class_count * b.words * sizeof(u64));
+    MALLOC(moved, class_count * sizeof(bool));
+    u64 *sigs;
+    MALLOC(sigs, class_count * sizeof(u64));
+    for(int d = 0; d < b.state_count; d++){
+        memset(moved, 0, class_count * sizeof(bool));
+        for(int w = 0; w < b.words; w++){
+            for(u64 bits = b.sets[d][w]; bits; bits &= bits - 1){
+                int i = w * 64 + __builtin_ctzll(bits);
+                struct nstate *s = b.nstates[i];
+                if(s->op <= 0 || s->op >= 256) continue;
+                int c = dfa->classes[s->op];
+                u64 *next_set = &next_sets[c * b.words];
+                u64 *move = &b.moves[i * b.words];
+                if(!moved[c]){
+                    memcpy(next_set, move, b.words * sizeof(u64));
+                    moved[c] = true;
+                }else{
+                    for(int k = 0; k < b.words; k++) next_set[k] |= move[k];
+                }
+            }
+        }
+        for(int c = 0; c < class_count; c++){
+            int to = d * class_count + c;
+            if(!moved[c]){
+                //no NFA state moves on the class, goes to the dead state
+                b.transitions[to] = DFA_DEAD;
+                continue;
+            }
+            //classes often move to the same set, e.g. letters inside an identifier,
+            //reuse the state of an earlier class before hashing the set
+            u64 *next_set = &next_sets[c * b.words];
+            u64 sig = 0;
+            for(int k = 0; k < b.words; k++) sig = (sig ^ next_set[k]) * 0x100000001b3ULL;
+            sigs[c] = sig;
+            int same = -1;
+            for(int c2 = 0; c2 < c && same < 0; c2++){
+                if(moved[c2] && sigs[c2] == sig && !memcmp(&next_sets[c2 * b.words], next_set, b.words * sizeof(u64)))
+                    same = c2;
+            }
+            //_dfa_get_state might grow b.transitions
+            u16 state = same >= 0 ? b.transitions[d * class_count + same] : _dfa_get_state(&b, next_set, class_count);
+            b.transitions[to] = state;
+        }
+    }
+    FREE(moved);
+    FREE(next_sets);
+    FREE(b.moves);
+    FREE(sigs);
+    dfa->state_count = (u16)b.state_count;
+    dfa->transitions = b.transitions;
+    dfa->accepts = b.accepts;
+    _dfa_minimize(dfa);
+    for(int i = 0; i < b.state_count; i++){
+        FREE(b.sets[i]);
+    }
+    FREE(b.sets);
+    FREE(set);
+    hashtable_deinit(&b.set_2_state);
+    FREE(b.nstate_accepts);
+    FREE(b.nstates);
+    FREE(bases);
+    return dfa;
+}
+
+int dfa_match(struct dfa *dfa, const char *text, int *matched_re)
+{
+    const u8 *p = (const u8 *)text;
+    const u16 *transitions = dfa->transitions;
+    u16 state = dfa->start;
+    int matched = 0;
+    *matched_re = -1;
+    while((state = transitions[state * dfa->class_count + dfa->classes[*p++]]) != DFA_DEAD){
+        if(dfa->accepts[state] >= 0){
+            matched = (int)(p - (const u8 *)text);
+            *matched_re = dfa->accepts[state];
+        }
+    }
+    return matched;
+}
+
+u32 dfa_state_count(struct dfa *dfa)
+{
+    return dfa->state_count;
+}
+
+void dfa_free(struct dfa *dfa)
+{
+    FREE(dfa->transitions);
+    FREE(dfa->accepts);
+    FREE(dfa);
+}
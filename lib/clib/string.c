@@ -17,11 +17,14 @@
 
 void _init_str(string *str)
 {
-    object_interface string_interface = {
-        string_eq_generic, string_init_generic,
-        string_deinit_generic, string_data_generic
-    };
-    register_object_interface(STRING, string_interface);
+    //registered by the first string ever created, before any compiler thread is started
+    if (get_eq(STRING) != string_eq_generic) {
+        object_interface string_interface = {
+            string_eq_generic, string_init_generic,
+            string_deinit_generic, string_data_generic
+        };
+        register_object_interface(STRING, string_interface);
+    }
     str->base.type = STRING;
     str->base.data.p_data = 0;
     str->base.size = 0;
@@ -6,34 +6,41 @@
  * symbol c file
  * symbol represents the pointer to string object, it's stored as global string
  * constant for performance improvement in symbol table(hash for the pointer or
- * integer is faster then string)
+ * integer is faster then string). the symbol table is shared by all compiler threads
+ * and guarded by a mutex, so that the same name is always the same symbol.
  */
 #include "clib/symbol.h"
 #include <assert.h>
 #include "clib/util.h"
+#include "clib/thread.h"
 
 struct hashtable *g_symbols = 0;
+static struct mutex g_symbols_lock;
 symbol EmptySymbol = 0;
 
 symbol to_symbol(const char *name)
 {
     assert(g_symbols);
+    mutex_lock(&g_symbols_lock);
     symbol sym = (symbol)hashtable_get(g_symbols, name);
     if (!sym) {
         sym = string_new(name);
         hashtable_set(g_symbols, name, sym);
     }
+    mutex_unlock(&g_symbols_lock);
     return sym;
 }
 
 symbol to_symbol2(const char *name, size_t name_size)
 {
     assert(g_symbols);
+    mutex_lock(&g_symbols_lock);
     symbol sym = (symbol)hashtable_get2(g_symbols, name, name_size);
     if (!sym) {
         sym = string_new2(name, name_size);
         hashtable_set2(g_symbols, name, name_size, sym);
     }
+    mutex_unlock(&g_symbols_lock);
     return sym;
 }
 
@@ -52,7 +59,7 @@ void _free_symbol(void *string)
 
 symbol get_temp_symbol(void)
 {
-    static int temp_index = 0;
+    static THREAD_LOCAL int temp_index = 0;
     char temp[128];
     sprintf(temp, "__temp%d", temp_index++);
     return to_symbol(temp);
@@ -64,6 +71,7 @@ void symbols_init(void)
         return;
     MALLOC(g_symbols, sizeof(*g_symbols));
     hashtable_c_str_key_init(g_symbols, _free_symbol);
+    mutex_init(&g_symbols_lock);
     EmptySymbol = to_symbol("");
 }
 
@@ -72,6 +80,7 @@ void symbols_deinit(void)
     if (!g_symbols)
         return;
     hashtable_deinit(g_symbols);
+    mutex_deinit(&g_symbols_lock);
     FREE(g_symbols);
     g_symbols = NULL;
 }
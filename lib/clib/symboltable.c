@@ -75,6 +75,18 @@ symbol symboltable_pop(symboltable *st)
     return s;
 }
 
+struct symbol_list_entry *symboltable_top(symboltable *st)
+{
+    return list_first(&st->symbols);
+}
+
+void symboltable_pop_to(symboltable *st, struct symbol_list_entry *top)
+{
+    while (list_first(&st->symbols) != top) {
+        symboltable_pop(st);
+    }
+}
+
 void *symboltable_get(symboltable *st, symbol s)
 {
     struct symbol_list *ll = hashtable_get_p(&st->ht, s);
@@ -0,0 +1,222 @@
+/*
+ * thread.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * minimal thread and mutex wrappers and a work-stealing thread pool in C
+ */
+#include "clib/thread.h"
+#include "clib/util.h"
+#if !defined(WASM) && !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+#if defined(WASM)
+
+void mutex_init(struct mutex *mutex)
+{
+    mutex->unused = 0;
+}
+
+void mutex_deinit(struct mutex *mutex)
+{
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+}
+
+bool thread_start(struct thread *thread, thread_fun fun, void *arg)
+{
+    thread->result = fun(arg);
+    return true;
+}
+
+void *thread_join(struct thread *thread)
+{
+    return thread->result;
+}
+
+unsigned int thread_hardware_concurrency(void)
+{
+    return 1;
+}
+
+#elif defined(_WIN32)
+
+void mutex_init(struct mutex *mutex)
+{
+    InitializeSRWLock(&mutex->lock);
+}
+
+void mutex_deinit(struct mutex *mutex)
+{
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+    AcquireSRWLockExclusive(&mutex->lock);
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+    ReleaseSRWLockExclusive(&mutex->lock);
+}
+
+DWORD WINAPI _thread_main(LPVOID param)
+{
+    struct thread *thread = param;
+    thread->result = thread->fun(thread->arg);
+    return 0;
+}
+
+bool thread_start(struct thread *thread, thread_fun fun, void *arg)
+{
+    thread->fun = fun;
+    thread->arg = arg;
+    thread->result = 0;
+    thread->handle = CreateThread(0, 0, _thread_main, thread, 0, 0);
+    return thread->handle != 0;
+}
+
+void *thread_join(struct thread *thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    return thread->result;
+}
+
+unsigned int thread_hardware_concurrency(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors ? info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+void mutex_init(struct mutex *mutex)
+{
+    pthread_mutex_init(&mutex->lock, 0);
+}
+
+void mutex_deinit(struct mutex *mutex)
+{
+    pthread_mutex_destroy(&mutex->lock);
+}
+
+void mutex_lock(struct mutex *mutex)
+{
+    pthread_mutex_lock(&mutex->lock);
+}
+
+void mutex_unlock(struct mutex *mutex)
+{
+    pthread_mutex_unlock(&mutex->lock);
+}
+
+bool thread_start(struct thread *thread, thread_fun fun, void *arg)
+{
+    return pthread_create(&thread->handle, 0, fun, arg) == 0;
+}
+
+void *thread_join(struct thread *thread)
+{
+    void *result = 0;
+    pthread_join(thread->handle, &result);
+    return result;
+}
+
+unsigned int thread_hardware_concurrency(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned int)n : 1;
+}
+
+#endif
+
+struct _task_deque {
+    struct mutex lock;
+    size_t front;
+    size_t back; //tasks[front, back) are queued
+};
+
+struct _task_pool {
+    struct task *tasks;
+    struct _task_deque *deques;
+    unsigned int workers;
+};
+
+struct _task_worker {
+    struct _task_pool *pool;
+    unsigned int id;
+    struct thread thread;
+};
+
+bool _pop_task(struct _task_deque *deque, bool steal, size_t *index)
+{
+    mutex_lock(&deque->lock);
+    bool found = deque->front < deque->back;
+    if (found)
+        *index = steal ? deque->front++ : --deque->back;
+    mutex_unlock(&deque->lock);
+    return found;
+}
+
+void *_task_worker_main(void *arg)
+{
+    struct _task_worker *worker = arg;
+    struct _task_pool *pool = worker->pool;
+    size_t index;
+    while (1) {
+        bool found = _pop_task(&pool->deques[worker->id], false, &index);
+        //no task is added while running, so all deques being empty means the pool is drained
+        for (unsigned int i = 1; !found && i < pool->workers; i++)
+            found = _pop_task(&pool->deques[(worker->id + i) % pool->workers], true, &index);
+        if (!found)
+            break;
+        pool->tasks[index].fun(pool->tasks[index].arg);
+    }
+    return 0;
+}
+
+void thread_pool_run(struct task *tasks, size_t task_count, unsigned int workers)
+{
+    if (!task_count)
+        return;
+    if (workers > task_count)
+        workers = (unsigned int)task_count;
+    if (!workers)
+        workers = 1;
+    struct _task_pool pool;
+    pool.tasks = tasks;
+    pool.workers = workers;
+    MALLOC(pool.deques, workers * sizeof(*pool.deques));
+    struct _task_worker *threads;
+    MALLOC(threads, workers * sizeof(*threads));
+    for (unsigned int i = 0; i < workers; i++) {
+        mutex_init(&pool.deques[i].lock);
+        pool.deques[i].front = task_count * i / workers;
+        pool.deques[i].back = task_count * (i + 1) / workers;
+        threads[i].pool = &pool;
+        threads[i].id = i;
+    }
+    unsigned int started = 1;
+    for (; started < workers; started++) {
+        if (!thread_start(&threads[started].thread, _task_worker_main, &threads[started]))
+            break; //the started workers and the caller steal the remaining tasks
+    }
+    _task_worker_main(&threads[0]);
+    for (unsigned int i = 1; i < started; i++) {
+        thread_join(&threads[i].thread);
+    }
+    for (unsigned int i = 0; i < workers; i++) {
+        mutex_deinit(&pool.deques[i].lock);
+    }
+    FREE(threads);
+    FREE(pool.deques);
+}
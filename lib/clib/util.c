@@ -6,8 +6,16 @@
 //#include <execinfo.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <time.h>
 
 #include "clib/util.h"
+#include "clib/thread.h"
+#if !defined(_WIN32) && !defined(WASM)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAS_MMAP 1
+#endif
 
 const char *log_level_strings[] = {
     "debug",
@@ -15,7 +23,9 @@ const char *log_level_strings[] = {
     "error"
 };
 
-static char id_name[512] = "a";
+THREAD_LOCAL struct alloc_stats g_alloc_stats;
+
+static THREAD_LOCAL char id_name[512] = "a";
 void reset_id_name(const char *idname)
 {
     strcpy(id_name, idname);
@@ -79,11 +89,12 @@ string make_unique_name(const char *name)
         }
         alpha_nums_init = true;
     }
-    char s[16];
+    char s[17];
     for (int i = 0; i < 16; i++) {
         int j = get_random(0, 35);
         s[i] = alpha_nums[j];
     }
+    s[16] = 0;
     string name_str;
     string_init_chars(&name_str, name);
     string_add_chars(&name_str, "-");
@@ -190,6 +201,17 @@ char *get_basename(char *filename)
     return filename;
 }
 
+uint64_t get_time_ns(void)
+{
+    struct timespec ts;
+#ifdef _WIN32
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 bool is_power_of2_64(uint64_t value)
 {
     return value && !(value & (value - 1));
@@ -215,3 +237,53 @@ const char *read_text_file(const char *file_path)
     }
     return buffer;
 }
+
+const char *map_text_file(const char *file_path, size_t *size)
+{
+#ifdef HAS_MMAP
+    int fd = open(file_path, O_RDONLY);
+    if (fd < 0) {
+        printf("cannot open file %s\n", file_path);
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return 0;
+    }
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t file_size = (size_t)st.st_size;
+    /*reserve one more zero page so that the mapped text is always NUL-terminated,
+      the tail of the last file page is zero-filled by the kernel*/
+    size_t map_size = (file_size / page_size + 1) * page_size;
+    char *text = mmap(0, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (text == MAP_FAILED) {
+        close(fd);
+        return 0;
+    }
+    if (file_size && mmap(text, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(text, map_size);
+        close(fd);
+        return 0;
+    }
+    close(fd);
+    *size = file_size;
+    return text;
+#else
+    const char *text = read_text_file(file_path);
+    *size = text ? strlen(text) : 0;
+    return text;
+#endif
+}
+
+void unmap_text_file(const char *text, size_t size)
+{
+    if (!text)
+        return;
+#ifdef HAS_MMAP
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    munmap((void *)text, (size / page_size + 1) * page_size);
+#else
+    free((void *)text);
+#endif
+}
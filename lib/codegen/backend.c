@@ -12,15 +12,12 @@
 #include "sema/type_size_info.h"
 #include <assert.h>
 
-struct backend *g_backend = 0;
-
 struct backend *backend_init(struct sema_context *sema_context, cg_alloc_fun cg_alloc, cg_free_fun cg_free)
 {
     struct backend *be;
     MALLOC(be, sizeof(*be));
     be->cg = cg_alloc(sema_context);
     be->cg_free = cg_free;
-    g_backend = be;
     return be;
 }
 
@@ -89,7 +89,8 @@ LLVMValueRef emit_call_node(struct cg_llvm *cg, struct ast_node *node)
         case AK_INDIRECT:
             break;
         }
-        arg_values[i] = arg_value;
+        //arguments follow the sret pointer
+        arg_values[has_sret ? i + 1 : i] = arg_value;
     }
     LLVMTypeRef fun_type = (LLVMTypeRef)get_backend_type(cg, node->call->callee_func_type->type);
     LLVMValueRef call_inst = LLVMBuildCall2(cg->builder, fun_type, callee, arg_values, (unsigned int)ir_arg_count, "");
@@ -19,8 +19,12 @@
 #include "sema/type_size_info.h"
 #include "sema/type.h"
 #include "sema/eval.h"
+#include <llvm-c/BitReader.h>
+#include <llvm-c/Linker.h>
 #include <llvm-c/Support.h>
 #include <llvm-c/TargetMachine.h>
+#include <llvm-c/Transforms/PassBuilder.h>
+#include <string.h>
 #include <llvm-c/Core.h>
 #include "parser/astdump.h"
 
@@ -304,7 +308,7 @@ struct ops double_ops = {
     LLVMBuildOr,
     LLVMBuildAnd,
     LLVMBuildNot,
-    LLVMBuildNeg,
+    LLVMBuildFNeg,
 };
 
 struct ops aggr_ops = {
@@ -415,21 +419,35 @@ void _llvm_cg_deinit_state(struct cg_llvm *cg)
     hashtable_deinit(&cg->varname_2_typename);
 }
 
-struct cg_llvm *cg_llvm_new(struct sema_context *sema_context)
+static bool _native_target_initialized = false;
+
+void llvm_init_native_target(void)
 {
-    LLVMContextRef context = LLVMContextCreate();
+    //the first call has to happen before compiler threads are started, later calls only read the flag
+    if (_native_target_initialized)
+        return;
    // LLVMInitializeCore(LLVMGetGlobalPassRegistry());
     LLVMInitializeNativeTarget();
     LLVMInitializeNativeAsmPrinter();
     LLVMInitializeNativeAsmParser();
+    _native_target_initialized = true;
+}
+
+struct cg_llvm *cg_llvm_new(struct sema_context *sema_context)
+{
+    llvm_init_native_target();
+    LLVMOrcThreadSafeContextRef ts_context = LLVMOrcCreateNewThreadSafeContext();
+    LLVMContextRef context = LLVMOrcThreadSafeContextGetContext(ts_context);
     struct cg_llvm *cg;
     MALLOC(cg, sizeof(*cg));
     cg->base.sema_context = sema_context;
+    cg->ts_context = ts_context;
     cg->context = context;
     cg->builder = LLVMCreateBuilderInContext(context);
     cg->module = 0;
     cg->target_machine = 0;
     cg->target_data = 0;
+    llvm_target_options_init(&cg->target_options);
     cg->current_loop_block = -1;
     _set_bin_ops(cg);
     _llvm_cg_init_state(cg);
@@ -442,6 +460,7 @@ struct cg_llvm *cg_llvm_new(struct sema_context *sema_context)
     cg->free_fun = 0;
     cg->calloc_fun = 0;
     cg->realloc_fun = 0;
+    cg->pow_fun_symbol = to_symbol("pow");
     return cg;
 }
 
@@ -466,10 +485,10 @@ void cg_llvm_free(struct cg_llvm *cg)
 {
     delete_current_module(cg);
     LLVMDisposeBuilder(cg->builder);
-    LLVMContextDispose(cg->context);
+    LLVMOrcDisposeThreadSafeContext(cg->ts_context);
     _llvm_cg_deinit_state(cg);
     FREE(cg);
-    LLVMShutdown();
+    //no LLVMShutdown here: it tears down LLVM's global state which other engines (possibly on other threads) still use
 }
 
 LLVMTypeRef _get_llvm_type(struct cg_llvm *cg, struct type_item *type)
@@ -524,7 +543,7 @@ LLVMValueRef _emit_literal_node(struct cg_llvm *cg, struct ast_node *node)
 LLVMValueRef _emit_new_node(struct cg_llvm *cg, struct ast_node *node)
 {
     LLVMTypeRef type = get_backend_type(cg, node->type);
-    LLVMValueRef size = LLVMConstInt(LLVMInt64Type(), LLVMABISizeOfType(cg->target_data, type), 0);
+    LLVMValueRef size = LLVMConstInt(LLVMInt64TypeInContext(cg->context), LLVMABISizeOfType(cg->target_data, type), 0);
     LLVMValueRef ptr = LLVMBuildCall2(cg->builder, LLVMGlobalGetValueType(cg->malloc_fun), cg->malloc_fun, &size, 1, "malloc");
     LLVMValueRef casted_ptr = LLVMBuildBitCast(cg->builder, ptr, LLVMPointerType(type, 0), "casted_ptr");
     return casted_ptr;
@@ -556,6 +575,12 @@ LLVMValueRef _emit_assign_node(struct cg_llvm *cg, struct ast_node *node)
 {
     LLVMValueRef assignee = emit_ir_code(cg, node->binop->lhs);
     LLVMValueRef expr = emit_ir_code(cg, node->binop->rhs);
+    if (is_aggregate_type(node->binop->lhs->type)) {
+        //both sides are addresses of aggregate values, copy the value
+        struct type_size_info tsi = get_type_size_info(cg->base.sema_context->tc, node->binop->lhs->type);
+        LLVMValueRef size = LLVMConstInt(LLVMInt64TypeInContext(cg->context), tsi.width_bits / 8, false);
+        return LLVMBuildMemCpy(cg->builder, assignee, tsi.align_bits / 8, expr, tsi.align_bits / 8, size);
+    }
     return LLVMBuildStore(cg->builder, expr, assignee);
 }
 
@@ -566,7 +591,8 @@ LLVMValueRef _emit_unary_node(struct cg_llvm *cg, struct ast_node *node)
     if (node->unop->opcode == OP_PLUS)
         return operand_v;
     else if (node->unop->opcode == OP_MINUS) {
-        return cg->ops->neg_op(cg->builder, operand_v, "negtmp");
+        struct type_context *tc = cg->base.sema_context->tc;
+        return cg->ops[prune(tc, node->type)->type].neg_op(cg->builder, operand_v, "negtmp");
     } else if (node->unop->opcode == OP_NOT) {
         if(node->type->type == TYPE_BOOL){
             //downcast to 1 bit bool
@@ -589,13 +615,14 @@ LLVMValueRef _emit_unary_node(struct cg_llvm *cg, struct ast_node *node)
 
 LLVMValueRef _emit_array_index(struct cg_llvm *cg, struct ast_node *node)
 {
-    int index = eval(node->index->index);
     LLVMValueRef obj = emit_ir_code(cg, node->index->object);
-    LLVMValueRef zero = LLVMConstInt(LLVMInt32TypeInContext(cg->context), 0, false);
-    LLVMValueRef index_value = LLVMConstInt(LLVMInt32TypeInContext(cg->context), index, false);
-    LLVMValueRef indexes[2] = { zero, index_value };
-    LLVMValueRef v = LLVMBuildInBoundsGEP2(cg->builder, get_backend_type(cg, node->index->object->type), obj, indexes, 2, "");
-    if(node->is_lvalue){
+    //the index is any int expression, a constant index is folded by the builder
+    LLVMValueRef index_value = emit_ir_code(cg, node->index->index);
+    //multi-dimensional array is laid out flat, so the address is stepped by the element type,
+    //which is the sub array for all but the last dimension
+    LLVMValueRef v = LLVMBuildInBoundsGEP2(cg->builder, get_backend_type(cg, node->type), obj, &index_value, 1, "");
+    //an element of multi-dimensional array is indexed again by its address
+    if(node->is_lvalue || is_aggregate_type(node->type)){
         return v;
     }
     return LLVMBuildLoad2(cg->builder, get_backend_type(cg, node->type), v, "");
@@ -629,15 +656,19 @@ LLVMValueRef _emit_field_access_node(struct cg_llvm *cg, struct ast_node *node)
 LLVMValueRef _emit_binary_node(struct cg_llvm *cg, struct ast_node *node)
 {
     struct type_context *tc = cg->base.sema_context->tc;
-    LLVMValueRef lv = emit_ir_code(cg, node->binop->lhs);
-    LLVMValueRef rv = emit_ir_code(cg, node->binop->rhs);
+    //operands of different types are casted to the result type by the analyzer
+    struct ast_node *lhs = node->binop->lhs->transformed ? node->binop->lhs->transformed : node->binop->lhs;
+    struct ast_node *rhs = node->binop->rhs->transformed ? node->binop->rhs->transformed : node->binop->rhs;
+    LLVMValueRef lv = emit_ir_code(cg, lhs);
+    LLVMValueRef rv = emit_ir_code(cg, rhs);
     // assert(LLVMGetValueKind(lv) == LLVMGetValueKind(rv));
-    assert(node->binop->lhs->type && prune(tc, node->binop->lhs->type)->type == prune(tc, node->binop->rhs->type)->type);
+    assert(lhs->type && prune(tc, lhs->type)->type == prune(tc, rhs->type)->type);
     assert(lv && rv);
     assert(LLVMTypeOf(lv) == LLVMTypeOf(rv));
-    struct ops *ops = &cg->ops[prune(tc, node->binop->lhs->type)->type];
+    struct ops *ops = &cg->ops[prune(tc, lhs->type)->type];
     string f_name;
     enum type type = TYPE_BOOL;    
+    LLVMValueRef fun;
     switch(node->binop->opcode){
         case OP_PLUS:
             return ops->add(cg->builder, lv, rv, "");
@@ -681,17 +712,56 @@ LLVMValueRef _emit_binary_node(struct cg_llvm *cg, struct ast_node *node)
             lv = ops->and_op(cg->builder, lv, rv, "andtmp");
             lv = LLVMBuildZExt(cg->builder, lv, cg->ops[type].get_type(cg, cg->context, 0), "ret_val_int");
             return lv;
+        case OP_BITOR:
+            return LLVMBuildOr(cg->builder, lv, rv, "");
+        case OP_BITEXOR:
+            return LLVMBuildXor(cg->builder, lv, rv, "");
+        case OP_BAND:
+            return LLVMBuildAnd(cg->builder, lv, rv, "");
+        case OP_BSL:
+            return LLVMBuildShl(cg->builder, lv, rv, "");
+        case OP_BSR:
+            return LLVMBuildAShr(cg->builder, lv, rv, "");
+        case OP_POW:
+            fun = get_llvm_function(cg, cg->pow_fun_symbol);
+            assert(fun && "pow function is not declared!");
+            LLVMValueRef args[2] = { lv, rv };
+            return LLVMBuildCall2(cg->builder, LLVMGlobalGetValueType(fun), fun, args, 2, "powtmp");
         default:
             string_init_chars(&f_name, "binary");
             string_add_chars(&f_name, get_opcode(node->binop->opcode));
             symbol op = to_symbol(string_get(&f_name));
-            LLVMValueRef fun = get_llvm_function(cg, op);
+            fun = get_llvm_function(cg, op);
             assert(fun && "binary operator not found!");
             LLVMValueRef lrv[2] = { lv, rv };
             return LLVMBuildCall2(cg->builder, LLVMGetElementType(LLVMTypeOf(fun)), fun, lrv, 2, "binop");
     }
 }
 
+bool _is_unsigned_type(enum type type)
+{
+    return type == TYPE_BOOL || type == TYPE_U8 || type == TYPE_U16 || type == TYPE_U32 || type == TYPE_U64;
+}
+
+LLVMValueRef _emit_cast_node(struct cg_llvm *cg, struct ast_node *node)
+{
+    struct type_context *tc = cg->base.sema_context->tc;
+    struct ast_node *expr = node->cast->expr->transformed ? node->cast->expr->transformed : node->cast->expr;
+    LLVMValueRef v = emit_ir_code(cg, expr);
+    enum type from = prune(tc, expr->type)->type;
+    enum type to = prune(tc, node->type)->type;
+    if (from == to)
+        return v;
+    LLVMTypeRef to_type = get_backend_type(cg, node->type);
+    if (is_int_type(from) && is_int_type(to))
+        return LLVMBuildIntCast2(cg->builder, v, to_type, !_is_unsigned_type(from), "");
+    if (is_int_type(from))
+        return _is_unsigned_type(from) ? LLVMBuildUIToFP(cg->builder, v, to_type, "") : LLVMBuildSIToFP(cg->builder, v, to_type, "");
+    if (is_int_type(to))
+        return _is_unsigned_type(to) ? LLVMBuildFPToUI(cg->builder, v, to_type, "") : LLVMBuildFPToSI(cg->builder, v, to_type, "");
+    return LLVMBuildFPCast(cg->builder, v, to_type, "");
+}
+
 LLVMValueRef _emit_condition_node(struct cg_llvm *cg, struct ast_node *node)
 {
     struct type_context *tc = cg->base.sema_context->tc;
@@ -737,9 +807,11 @@ LLVMValueRef _emit_condition_node(struct cg_llvm *cg, struct ast_node *node)
     }
     LLVMAppendExistingBasicBlock(fun, merge_bb);
     LLVMPositionBuilderAtEnd(cg->builder, merge_bb);
-    if(has_else){
-        enum type type = get_type(tc, node->cond->then_node->type);
-        LLVMValueRef phi_node = LLVMBuildPhi(cg->builder, cg->ops[type].get_type(cg, cg->context, node->cond->then_node->type), "iftmp");
+    enum type type = get_type(tc, node->cond->then_node->type);
+    LLVMTypeRef phi_type = cg->ops[type].get_type(cg, cg->context, node->cond->then_node->type);
+    //branches ending with a statement like assignment have no value to merge
+    if(has_else && LLVMTypeOf(then_v) == phi_type && LLVMTypeOf(else_v) == phi_type){
+        LLVMValueRef phi_node = LLVMBuildPhi(cg->builder, phi_type, "iftmp");
         LLVMAddIncoming(phi_node, &then_v, &then_bb, 1);
         LLVMAddIncoming(phi_node, &else_v, &else_bb, 1);
         return phi_node;
@@ -789,6 +861,52 @@ LLVMValueRef _emit_while_node(struct cg_llvm *cg, struct ast_node *node)
     return 0;
 }
 
+/*
+ * the step is a constant and the end does not change in the loop: the end is evaluated once,
+ * the range is tested before the loop and then at the bottom after the step with one compare
+ * and branch
+ */
+LLVMValueRef _emit_const_step_for_node(struct cg_llvm *cg, struct ast_node *node, LLVMValueRef alloca, LLVMValueRef start_v)
+{
+    symbol var_name = node->forloop->var->var->var->ident->name;
+    LLVMValueRef fun = LLVMGetBasicBlockParent(LLVMGetInsertBlock(cg->builder));
+    LLVMTypeRef at = cg->ops[TYPE_INT].get_type(cg, cg->context, 0);
+    LLVMIntPredicate in_range = node->forloop->step_sign > 0 ? LLVMIntSLT : LLVMIntSGT;
+    LLVMValueRef end_v = emit_ir_code(cg, node->forloop->range->range->end);
+    LLVMValueRef step_v = emit_ir_code(cg, node->forloop->range->range->step);
+    assert(end_v && step_v);
+    cg->current_loop_block++;
+    LLVMBasicBlockRef start_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "loop");
+    LLVMBasicBlockRef cont_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "contloop");
+    LLVMBasicBlockRef end_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "afterloop");
+    cg->loop_blocks[cg->current_loop_block].cont_bb = cont_bb;
+    cg->loop_blocks[cg->current_loop_block].end_bb = end_bb;
+    LLVMValueRef guard = LLVMBuildICmp(cg->builder, in_range, start_v, end_v, "loopguard");
+    LLVMBuildCondBr(cg->builder, guard, start_bb, end_bb);
+
+    LLVMValueRef old_alloca = (LLVMValueRef)hashtable_get_p(&cg->varname_2_irvalues, var_name);
+    hashtable_set_p(&cg->varname_2_irvalues, var_name, alloca);
+    LLVMPositionBuilderAtEnd(cg->builder, start_bb);
+    emit_ir_code(cg, node->forloop->body);
+    LLVMBuildBr(cg->builder, cont_bb);
+
+    LLVMPositionBuilderAtEnd(cg->builder, cont_bb);
+    LLVMValueRef cur_var = LLVMBuildLoad2(cg->builder, at, alloca, string_get(var_name));
+    LLVMValueRef next_var = LLVMBuildAdd(cg->builder, cur_var, step_v, "nextvar");
+    LLVMBuildStore(cg->builder, next_var, alloca);
+    LLVMValueRef end_cond = LLVMBuildICmp(cg->builder, in_range, next_var, end_v, "loopcond");
+    LLVMBuildCondBr(cg->builder, end_cond, start_bb, end_bb);
+    LLVMPositionBuilderAtEnd(cg->builder, end_bb);
+
+    if (old_alloca)
+        hashtable_set_p(&cg->varname_2_irvalues, var_name, old_alloca);
+    else
+        hashtable_remove_p(&cg->varname_2_irvalues, var_name);
+
+    cg->current_loop_block--;
+    return LLVMConstNull(at);
+}
+
 LLVMValueRef _emit_for_node(struct cg_llvm *cg, struct ast_node *node)
 {
     struct type_context *tc = cg->base.sema_context->tc;
@@ -806,32 +924,21 @@ LLVMValueRef _emit_for_node(struct cg_llvm *cg, struct ast_node *node)
     assert(start_v);
 
     LLVMBuildStore(cg->builder, start_v, alloca);
+    if (node->forloop->step_sign && node->forloop->is_end_invariant && node->forloop->var->type->type == TYPE_INT)
+        return _emit_const_step_for_node(cg, node, alloca, start_v);
     cg->current_loop_block++;
+    //the end condition is checked before the body, so an empty range runs no iteration
+    LLVMBasicBlockRef cond_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "loopcond");
     LLVMBasicBlockRef start_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "loop");
     LLVMBasicBlockRef cont_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "contloop");
     LLVMBasicBlockRef end_bb = LLVMAppendBasicBlockInContext(cg->context, fun, "afterloop");
     cg->loop_blocks[cg->current_loop_block].cont_bb = cont_bb;
     cg->loop_blocks[cg->current_loop_block].end_bb = end_bb;
-    LLVMBuildBr(cg->builder, start_bb);
-    LLVMPositionBuilderAtEnd(cg->builder, start_bb);
+    LLVMBuildBr(cg->builder, cond_bb);
+    LLVMPositionBuilderAtEnd(cg->builder, cond_bb);
 
     LLVMValueRef old_alloca = (LLVMValueRef)hashtable_get_p(&cg->varname_2_irvalues, var_name);
     hashtable_set_p(&cg->varname_2_irvalues, var_name, alloca);
-    emit_ir_code(cg, node->forloop->body);
-
-    LLVMBuildBr(cg->builder, cont_bb);
-    LLVMPositionBuilderAtEnd(cg->builder, cont_bb);
-
-    LLVMValueRef step_v;
-    if (node->forloop->range->range->step) {
-        step_v = emit_ir_code(cg, node->forloop->range->range->step);
-        assert(step_v);
-    } else {
-        step_v = get_int_one(cg, cg->context);
-    }
-    LLVMValueRef cur_var = LLVMBuildLoad2(cg->builder, at, alloca, string_get(var_name));
-    LLVMValueRef next_var = LLVMBuildAdd(cg->builder, cur_var, step_v, "nextvar");
-    LLVMBuildStore(cg->builder, next_var, alloca);
 
     struct ast_node *id = ident_node_new(var_name, node->forloop->var->loc);
     id->type = node->forloop->var->type;
@@ -848,9 +955,28 @@ LLVMValueRef _emit_for_node(struct cg_llvm *cg, struct ast_node *node)
 
     //if end_cond (id < end != 0) then start_bb else end_bb
     LLVMBuildCondBr(cg->builder, end_cond, start_bb, end_bb);
+    LLVMPositionBuilderAtEnd(cg->builder, start_bb);
+    emit_ir_code(cg, node->forloop->body);
+
+    LLVMBuildBr(cg->builder, cont_bb);
+    LLVMPositionBuilderAtEnd(cg->builder, cont_bb);
+
+    LLVMValueRef step_v;
+    if (node->forloop->range->range->step) {
+        step_v = emit_ir_code(cg, node->forloop->range->range->step);
+        assert(step_v);
+    } else {
+        step_v = get_int_one(cg, cg->context);
+    }
+    LLVMValueRef cur_var = LLVMBuildLoad2(cg->builder, at, alloca, string_get(var_name));
+    LLVMValueRef next_var = LLVMBuildAdd(cg->builder, cur_var, step_v, "nextvar");
+    LLVMBuildStore(cg->builder, next_var, alloca);
+    LLVMBuildBr(cg->builder, cond_bb);
     LLVMPositionBuilderAtEnd(cg->builder, end_bb);
 
-    if (!old_alloca)
+    if (old_alloca)
+        hashtable_set_p(&cg->varname_2_irvalues, var_name, old_alloca);
+    else
         hashtable_remove_p(&cg->varname_2_irvalues, var_name);
 
     cg->current_loop_block--;
@@ -863,7 +989,7 @@ void* create_ir_module(void* gcg,
     struct cg_llvm *cg = (struct cg_llvm *)gcg;
     delete_current_module(cg);
     cg->module = LLVMModuleCreateWithNameInContext(module_name, cg->context);
-    cg->target_machine = create_target_machine(cg->module, &cg->target_data);
+    cg->target_machine = create_target_machine(cg->module, &cg->target_options, &cg->target_data);
     return cg->module;
 }
 
@@ -934,6 +1060,8 @@ LLVMValueRef emit_ir_code(struct cg_llvm *cg, struct ast_node *node)
             value = _emit_block_node(cg, node);
             break;
         case CAST_NODE:
+            value = _emit_cast_node(cg, node);
+            break;
         case MATCH_NODE:
             break;
 
@@ -957,8 +1085,127 @@ LLVMValueRef emit_ir_code(struct cg_llvm *cg, struct ast_node *node)
     return value;
 }
 
-LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, LLVMTargetDataRef* target_data_out)
+void llvm_target_options_init(struct llvm_target_options *options)
+{
+    options->opt_level = LLVM_OPT_O2;
+    options->cpu = "generic";
+    options->features = "";
+    options->lto = false;
+}
+
+bool parse_opt_level(const char *level, enum llvm_opt_level *opt_level)
 {
+    if (!strcmp(level, "s")) {
+        *opt_level = LLVM_OPT_OS;
+        return true;
+    }
+    if (level[0] < '0' || level[0] > '3' || level[1])
+        return false;
+    *opt_level = (enum llvm_opt_level)(LLVM_OPT_O0 + level[0] - '0');
+    return true;
+}
+
+static const char *pass_pipelines[][LLVM_OPT_OS + 1] = {
+    [LLVM_PIPELINE_DEFAULT] = {
+        [LLVM_OPT_O0] = 0,
+        [LLVM_OPT_O1] = "default<O1>",
+        [LLVM_OPT_O2] = "default<O2>",
+        [LLVM_OPT_O3] = "default<O3>",
+        [LLVM_OPT_OS] = "default<Os>",
+    },
+    [LLVM_PIPELINE_LTO_PRE_LINK] = {
+        [LLVM_OPT_O0] = 0,
+        [LLVM_OPT_O1] = "lto-pre-link<O1>",
+        [LLVM_OPT_O2] = "lto-pre-link<O2>",
+        [LLVM_OPT_O3] = "lto-pre-link<O3>",
+        [LLVM_OPT_OS] = "lto-pre-link<Os>",
+    },
+    [LLVM_PIPELINE_LTO] = {
+        [LLVM_OPT_O0] = 0,
+        [LLVM_OPT_O1] = "lto<O1>",
+        [LLVM_OPT_O2] = "lto<O2>",
+        [LLVM_OPT_O3] = "lto<O3>",
+        [LLVM_OPT_OS] = "lto<Os>",
+    },
+};
+
+static const LLVMCodeGenOptLevel codegen_levels[] = {
+    [LLVM_OPT_O0] = LLVMCodeGenLevelNone,
+    [LLVM_OPT_O1] = LLVMCodeGenLevelLess,
+    [LLVM_OPT_O2] = LLVMCodeGenLevelDefault,
+    [LLVM_OPT_O3] = LLVMCodeGenLevelAggressive,
+    [LLVM_OPT_OS] = LLVMCodeGenLevelDefault,
+};
+
+bool optimize_ir_module(struct cg_llvm *cg)
+{
+    enum llvm_pipeline pipeline = cg->target_options.lto ? LLVM_PIPELINE_LTO_PRE_LINK : LLVM_PIPELINE_DEFAULT;
+    return run_ir_pipeline(cg->module, cg->target_machine, cg->target_options.opt_level, pipeline);
+}
+
+bool run_ir_pipeline(LLVMModuleRef module, LLVMTargetMachineRef target_machine, enum llvm_opt_level opt_level, enum llvm_pipeline pipeline)
+{
+    const char *passes = pass_pipelines[pipeline][opt_level];
+    if (!passes)
+        return true;
+    LLVMPassBuilderOptionsRef options = LLVMCreatePassBuilderOptions();
+    //the vectorizers are on from O2 as clang has them
+    LLVMPassBuilderOptionsSetLoopVectorization(options, opt_level >= LLVM_OPT_O2);
+    LLVMPassBuilderOptionsSetSLPVectorization(options, opt_level == LLVM_OPT_O2 || opt_level == LLVM_OPT_O3);
+    LLVMErrorRef err = LLVMRunPasses(module, passes, target_machine, options);
+    LLVMDisposePassBuilderOptions(options);
+    if (err) {
+        char *message = LLVMGetErrorMessage(err);
+        log_info(ERROR, "error in optimizing module: %s", message);
+        LLVMDisposeErrorMessage(message);
+        return false;
+    }
+    return true;
+}
+
+static void _log_link_diagnostic(LLVMDiagnosticInfoRef info, void *context)
+{
+    (void)context;
+    if (LLVMGetDiagInfoSeverity(info) != LLVMDSError)
+        return;
+    char *message = LLVMGetDiagInfoDescription(info);
+    log_info(ERROR, "error in linking modules: %s", message);
+    LLVMDisposeMessage(message);
+}
+
+LLVMModuleRef link_bitcode_modules(LLVMContextRef context, LLVMMemoryBufferRef *bitcodes, size_t count)
+{
+    //the linker reports a symbol defined twice to the context instead of returning the error
+    LLVMContextSetDiagnosticHandler(context, _log_link_diagnostic, 0);
+    LLVMModuleRef linked = 0;
+    for (size_t i = 0; i < count; i++) {
+        LLVMModuleRef module;
+        if (LLVMParseBitcodeInContext2(context, bitcodes[i], &module)) {
+            log_info(ERROR, "error in reading bitcode of module %zu", i);
+            if (linked)
+                LLVMDisposeModule(linked);
+            return 0;
+        }
+        if (!linked) {
+            linked = module;
+            continue;
+        }
+        //the source module is destroyed by linking
+        if (LLVMLinkModules2(linked, module)) {
+            LLVMDisposeModule(linked);
+            return 0;
+        }
+    }
+    return linked;
+}
+
+LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, const struct llvm_target_options *options, LLVMTargetDataRef* target_data_out)
+{
+    struct llvm_target_options default_options;
+    if (!options) {
+        llvm_target_options_init(&default_options);
+        options = &default_options;
+    }
     char *target_triple = LLVMGetDefaultTargetTriple();
     LLVMSetTarget(module, target_triple);
     char *error;
@@ -968,12 +1215,19 @@ LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, LLVMTargetDataR
         free(target_triple);
         return 0;
     }
-    const char *cpu = "generic";
-    const char *features = "";
-    LLVMCodeGenOptLevel opt = LLVMCodeGenLevelDefault;
+    bool is_native = !strcmp(options->cpu, "native");
+    char *host_cpu = is_native ? LLVMGetHostCPUName() : 0;
+    char *host_features = is_native && !*options->features ? LLVMGetHostCPUFeatures() : 0;
+    const char *cpu = host_cpu ? host_cpu : options->cpu;
+    const char *features = host_features ? host_features : options->features;
+    LLVMCodeGenOptLevel opt = codegen_levels[options->opt_level];
     LLVMRelocMode rm = LLVMRelocPIC; // LLVMRelocDefault;
     LLVMCodeModel cm = LLVMCodeModelDefault;
     LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(target, target_triple, cpu, features, opt, rm, cm);
+    if (host_cpu)
+        LLVMDisposeMessage(host_cpu);
+    if (host_features)
+        LLVMDisposeMessage(host_features);
     LLVMTargetDataRef target_data = LLVMCreateTargetDataLayout(target_machine);
     LLVMSetModuleDataLayout(module, target_data);
     *target_data_out = target_data;
@@ -981,6 +1235,27 @@ LLVMTargetMachineRef create_target_machine(LLVMModuleRef module, LLVMTargetDataR
     return target_machine;
 }
 
+LLVMTargetMachineRef create_host_target_machine(enum llvm_opt_level opt_level)
+{
+    char *target_triple = LLVMGetDefaultTargetTriple();
+    char *error;
+    LLVMTargetRef target;
+    if (LLVMGetTargetFromTriple(target_triple, &target, &error)) {
+        log_info(ERROR, "error in creating target machine: %s", error);
+        LLVMDisposeMessage(error);
+        LLVMDisposeMessage(target_triple);
+        return 0;
+    }
+    char *cpu = LLVMGetHostCPUName();
+    char *features = LLVMGetHostCPUFeatures();
+    LLVMTargetMachineRef target_machine = LLVMCreateTargetMachine(target, target_triple, cpu, features,
+        codegen_levels[opt_level], LLVMRelocDefault, LLVMCodeModelJITDefault);
+    LLVMDisposeMessage(cpu);
+    LLVMDisposeMessage(features);
+    LLVMDisposeMessage(target_triple);
+    return target_machine;
+}
+
 LLVMTypeRef get_backend_type(struct cg_llvm *cg, struct type_item *type)
 {
     if(type->backend_type)
@@ -123,7 +123,12 @@ LLVMValueRef _emit_local_var_array_node(struct cg_llvm *cg, struct ast_node *nod
     symbol var_name = node->var->var->ident->name;
     LLVMValueRef alloca = 0;
 
-    if (node->var->init_value->node_type == ARRAY_INIT_NODE) {
+    if (!node->var->init_value) {
+        //declared with array type only, the elements are not initialized
+        struct type_size_info tsi = get_type_size_info(cg->base.sema_context->tc, node->type);
+        LLVMValueRef fun = LLVMGetBasicBlockParent(LLVMGetInsertBlock(cg->builder));
+        alloca = create_alloca(get_backend_type(cg, node->type), tsi.align_bits / 8, fun, string_get(var_name));
+    } else if (node->var->init_value->node_type == ARRAY_INIT_NODE) {
         assert(node->type->name == node->var->init_value->type->name);
         alloca = emit_array_init_node(cg, node->var->init_value, node->is_ret, string_get(var_name));
     } else {
@@ -19,6 +19,7 @@
 #include <assert.h>
 #include <stdint.h>
 #include <float.h>
+#include <string.h>
 
 void wasm_emit_store_struct_value(struct cg_wasm *cg, struct byte_array *ba, u32 local_address_var_index, u32 offset, struct struct_layout *sl, struct ast_node *block)
 {
@@ -52,6 +53,82 @@ void wasm_emit_store_array_value(struct cg_wasm *cg, struct byte_array *ba, u32
     }
 }
 
+static bool _is_number_type(enum type type)
+{
+    return is_int_type(type) || type == TYPE_F32 || type == TYPE_F64;
+}
+
+//the bytes of the elements as elm_type values, false if an element is not a number literal
+static bool _encode_const_array(struct ast_node *array_init, enum type elm_type, u32 elm_type_size, u8 *bytes)
+{
+    struct ast_node *element;
+    for (u32 i = 0; i < array_size(&array_init->block->nodes); i++) {
+        element = array_get_ptr(&array_init->block->nodes, i);
+        if (element->node_type != LITERAL_NODE || !_is_number_type(element->type->type))
+            return false;
+        bool is_float_literal = element->type->type == TYPE_F32 || element->type->type == TYPE_F64;
+        u8 *elm_bytes = &bytes[i * elm_type_size];
+        if (elm_type == TYPE_F64 || elm_type == TYPE_F32) {
+            f64 value = is_float_literal ? element->liter->double_val : element->liter->int_val;
+            if (elm_type == TYPE_F64) {
+                memcpy(elm_bytes, &value, sizeof(f64));
+            } else {
+                f32 value32 = (f32)value;
+                memcpy(elm_bytes, &value32, sizeof(f32));
+            }
+        } else {
+            if (is_float_literal)
+                return false;
+            u64 value = (u64)(i64)element->liter->int_val;
+            for (u32 j = 0; j < elm_type_size; j++) {
+                elm_bytes[j] = (u8)(value >> (j * 8));
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * an array of constant elements is filled with memory.fill if its bytes are all the same and
+ * there are WASM_BULK_FILL_MIN_SIZE of them, or else copied from the data section with
+ * memory.copy if there are WASM_BULK_COPY_MIN_SIZE. returns false if the elements are to be
+ * stored one by one
+ */
+static bool _emit_bulk_array_value(struct cg_wasm *cg, struct byte_array *ba, u32 local_address_var_index, struct type_item *elm_type, struct ast_node *array_init)
+{
+    if (array_init->node_type != BLOCK_NODE || !_is_number_type(elm_type->type))
+        return false;
+    struct type_size_info tsi = get_type_size_info(cg->base.sema_context->tc, elm_type);
+    u32 elm_type_size = (u32)(tsi.width_bits / 8);
+    u32 size = array_size(&array_init->block->nodes) * elm_type_size;
+    if (size < WASM_BULK_FILL_MIN_SIZE)
+        return false;
+    u8 *bytes;
+    MALLOC(bytes, size);
+    bool is_bulk = _encode_const_array(array_init, elm_type->type, elm_type_size, bytes);
+    u32 i = 1;
+    while (is_bulk && i < size && bytes[i] == bytes[0]) i++;
+    if (is_bulk && i == size) {
+        wasm_emit_get_var(ba, local_address_var_index, false);
+        wasm_emit_const_i32(ba, bytes[0]);
+        wasm_emit_const_i32(ba, size);
+        wasm_emit_memory_fill(ba);
+    } else if (is_bulk && size >= WASM_BULK_COPY_MIN_SIZE) {
+        u32 data_offset = wasm_add_data(cg, bytes, size, tsi.align_bits / 8);
+        is_bulk = data_offset != InvalidIndex;
+        if (is_bulk) {
+            wasm_emit_get_var(ba, local_address_var_index, false);
+            wasm_emit_data_address(cg, ba, data_offset);
+            wasm_emit_const_i32(ba, size);
+            wasm_emit_memory_copy(ba);
+        }
+    } else {
+        is_bulk = false;
+    }
+    FREE(bytes);
+    return is_bulk;
+}
+
 void wasm_emit_adt_init(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node)
 {
     struct type_context *tc = cg->base.sema_context->tc;
@@ -94,6 +171,8 @@ void wasm_emit_array_init(struct cg_wasm *cg, struct byte_array *ba, struct ast_
         wasm_emit_assign_var(ba, vi->var_index, false, WasmInstrNumI32ADD, stack_offset, fc->local_sp->var_index, false);
         addr_var_index = vi->var_index;
     }
+    if (_emit_bulk_array_value(cg, ba, addr_var_index, node->type->val_type, node->array_init))
+        return;
     struct type_size_info tsi = get_type_size_info(tc, node->type->val_type);
     wasm_emit_store_array_value(cg, ba, addr_var_index, 0, tsi.align_bits/8, tsi.width_bits / 8, node->array_init);
 }
@@ -65,8 +65,10 @@ void wasm_emit_call(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *
                     /*rvalue or is parameter, we don't need to make a copy*/
                     wasm_emit_get_var(ba, vi->var_index, false);
                 }else{
-                    u32 temp_var_index = vi->var_index + 1; //TODO: we should do it explicity in collect_local_variables
-                    u32 field_offset = *(u64*)array_get(&fc->stack_size_info.sl->field_offsets, temp_var_index) / 8;
+                    //the copy is requested for the argument node by collect_local_variables
+                    struct var_info *copy_vi = hashtable_get_p(&fc->ast_2_index, arg);
+                    u32 temp_var_index = copy_vi->var_index;
+                    u32 field_offset = *(u64*)array_get(&fc->stack_size_info.sl->field_offsets, copy_vi->alloc_index) / 8;
                     wasm_emit_assign_var(ba, temp_var_index, false, WasmInstrNumI32ADD, field_offset, fc->local_sp->var_index, false);
                     wasm_emit_copy_struct_value(tc, ba, temp_var_index, 0, arg->type, vi->var_index, 0);
                     wasm_emit_get_var(ba, temp_var_index, false);
@@ -7,6 +7,7 @@
 #include "codegen/wasm/cg_wasm.h"
 #include "codegen/wasm/wasm_abi.h"
 #include "codegen/wasm/wasm_api.h"
+#include "codegen/wasm/wasm_pass.h"
 #include "clib/array.h"
 #include "clib/string.h"
 #include "clib/symbol.h"
@@ -24,7 +25,12 @@
 
 struct fun_context *_func_enter(struct cg_wasm *cg, struct ast_node *fun)
 {
-    struct fun_context *fc = &cg->fun_contexts[cg->fun_top];
+    if (cg->fun_top == array_size(&cg->fun_contexts)) {
+        struct fun_context *new_fc;
+        MALLOC(new_fc, sizeof(*new_fc));
+        array_push_ptr(&cg->fun_contexts, new_fc);
+    }
+    struct fun_context *fc = array_get_ptr(&cg->fun_contexts, cg->fun_top);
     fc_init(fc);
     fc->fun = fun;
     cg->fun_top ++;
@@ -34,10 +40,10 @@ struct fun_context *_func_enter(struct cg_wasm *cg, struct ast_node *fun)
 void _func_leave(struct cg_wasm *cg, struct ast_node *fun)
 {
     cg->fun_top--;
-    struct fun_context *fc = &cg->fun_contexts[cg->fun_top];
+    struct fun_context *fc = array_get_ptr(&cg->fun_contexts, cg->fun_top);
     cg->var_top -= fc->local_vars;
     fc_deinit(fc);
-    assert(cg->fun_contexts[cg->fun_top].fun == fun);
+    assert(fc->fun == fun);
 }
 
 
@@ -45,13 +51,18 @@ struct var_info *_req_new_local_var(struct cg_wasm *cg, struct type_item *type,
 {
     struct fun_context *fc = cg_get_top_fun_context(cg);
     if (is_aggregate_type(type) && is_local_var && is_ret){
-        return &cg->local_vars[0];//return first sret
+        return array_get_ptr(&cg->local_vars, 0);//return first sret
     }
     u32 index = fc->local_vars++;
     if (!is_local_var) {
         fc->local_params++;
     }
-    struct var_info *vi = &cg->local_vars[cg->var_top];
+    if (cg->var_top == array_size(&cg->local_vars)) {
+        struct var_info *new_vi;
+        MALLOC(new_vi, sizeof(*new_vi));
+        array_push_ptr(&cg->local_vars, new_vi);
+    }
+    struct var_info *vi = array_get_ptr(&cg->local_vars, cg->var_top);
     vi->var_index = index;
     ASSERT_TYPE(type->type);
     vi->target_type = type_2_wtype[type->type];
@@ -64,9 +75,44 @@ struct var_info *_req_new_local_var(struct cg_wasm *cg, struct type_item *type,
     return vi;
 }
 
-void collect_local_variables(struct cg_wasm *cg, struct ast_node *node)
+static void _collect_call_args(struct cg_wasm *cg, struct ast_node *node)
 {
     struct ast_node *arg_node;
+    for(u32 i = 0; i < array_size(&node->call->arg_block->block->nodes); i++){
+        arg_node = array_get_ptr(&node->call->arg_block->block->nodes, i);
+        collect_local_variables(cg, arg_node);
+        if(is_struct_like_type(arg_node->type) && is_refered_later(arg_node)){
+            /*not for array type, array type is always reference type*/
+            /*struct type is value type, we need to make copy of it to prevent being changed by 
+             *callee
+            */
+            struct fun_context *fc = cg_get_top_fun_context(cg);
+            struct var_info *vi = fc_get_var_info(fc, arg_node);
+            if(vi->var_index>=fc->local_params){
+            //this is local variable
+            //only for lvalue, and local variable (not parameter)
+            //request a temp variable for copy-by-value struct pass style 
+            //to prevent callee from changing the argument, bound to the argument node
+                struct var_info *copy_vi = _req_new_local_var(cg, arg_node->type, true, arg_node->is_ret, true);
+                hashtable_set_p(&fc->ast_2_index, arg_node, copy_vi);
+            }
+        }
+    }
+}
+
+static void _collect_operand(struct cg_wasm *cg, struct ast_node *node)
+{
+    if(node->transformed) node = node->transformed;
+    if(node->node_type == CALL_NODE && is_struct_like_type(node->type)){
+        //the returned struct is registered with the binary node, only arguments are left
+        _collect_call_args(cg, node);
+    }else{
+        collect_local_variables(cg, node);
+    }
+}
+
+void collect_local_variables(struct cg_wasm *cg, struct ast_node *node)
+{
     if(node->transformed) node = node->transformed;
     switch(node->node_type)
     {
@@ -90,6 +136,8 @@ void collect_local_variables(struct cg_wasm *cg, struct ast_node *node)
         case ASSIGN_NODE:
         case BINARY_NODE:
             func_register_local_variable(cg, node, true);
+            _collect_operand(cg, node->binop->lhs);
+            _collect_operand(cg, node->binop->rhs);
             break;
         case MEMBER_INDEX_NODE:
             /*get the root ast_node*/
@@ -100,6 +148,10 @@ void collect_local_variables(struct cg_wasm *cg, struct ast_node *node)
             func_register_local_variable(cg, node, true);
             collect_local_variables(cg, node->forloop->body);
             break;
+        case WHILE_NODE:
+            collect_local_variables(cg, node->whileloop->expr);
+            collect_local_variables(cg, node->whileloop->body);
+            break;
         case VAR_NODE:
             func_register_local_variable(cg, node, true);
             if(node->var->init_value){
@@ -116,25 +168,7 @@ void collect_local_variables(struct cg_wasm *cg, struct ast_node *node)
             break;
         case CALL_NODE:
             func_register_local_variable(cg, node, true);
-            for(u32 i = 0; i < array_size(&node->call->arg_block->block->nodes); i++){
-                arg_node = array_get_ptr(&node->call->arg_block->block->nodes, i);
-                collect_local_variables(cg, arg_node);
-                if(is_struct_like_type(arg_node->type) && is_refered_later(arg_node)){
-                    /*not for array type, array type is always reference type*/
-                    /*struct type is value type, we need to make copy of it to prevent being changed by 
-                     *callee
-                    */
-                    struct fun_context *fc = cg_get_top_fun_context(cg);
-                    struct var_info *vi = fc_get_var_info(fc, arg_node);
-                    if(vi->var_index>=fc->local_params){
-                    //this is local variable
-                    //only for lvalue, and local variable (not parameter)
-                    //request a temp variable for copy-by-value struct pass style 
-                    //to prevent callee from changing the argument
-                        _req_new_local_var(cg, arg_node->type, true, arg_node->is_ret, true);
-                    }
-                }
-            }
+            _collect_call_args(cg, node);
             break;
         case BLOCK_NODE:
             for(u32 i = 0; i < array_size(&node->block->nodes); i++){
@@ -208,8 +242,13 @@ void func_register_local_variable(struct cg_wasm *cg, struct ast_node *node, boo
         vi = _req_new_local_var(cg, node->forloop->range->range->start->type, is_local_var, node->forloop->range->range->start->is_ret, node->forloop->range->range->start->is_addressed);
         symboltable_push(&fc->varname_2_index, node->forloop->var->var->var->ident->name, vi);
         hashtable_set_p(&fc->ast_2_index, node->forloop->var, vi);
-        vi = _req_new_local_var(cg, node->forloop->range->range->step->type, true, node->forloop->range->range->step->is_ret, node->forloop->range->range->step->is_addressed);
-        hashtable_set_p(&fc->ast_2_index, node->forloop->range->range->step, vi);
+        if(wasm_is_unrolled_loop(node))
+            break;
+        //a constant step is emitted in place
+        if(!node->forloop->step_sign){
+            vi = _req_new_local_var(cg, node->forloop->range->range->step->type, true, node->forloop->range->range->step->is_ret, node->forloop->range->range->step->is_addressed);
+            hashtable_set_p(&fc->ast_2_index, node->forloop->range->range->step, vi);
+        }
         vi = _req_new_local_var(cg, node->forloop->range->range->end->type, true, node->forloop->range->range->end->is_ret, node->forloop->range->range->end->is_addressed);
         hashtable_set_p(&fc->ast_2_index, node->forloop->range->range->end, vi);
         break;
@@ -262,34 +301,47 @@ void wasm_emit_func(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *
         fc->local_sp = _req_new_local_var(cg, to_sp, true, false, false);
     }
     
-    struct byte_array func;
-    ba_init(&func, 17);
     u32 local_vars = _func_get_local_var_nums(cg);
-    wasm_emit_uint(&func, local_vars); // num local variables
     u32 start_pos = cg->var_top - local_vars;
+    struct wasm_function_ir *fun = &cg->fun_ir;
+    wasm_ir_reset(fun);
+    fun->params = fc->local_params;
     for(u32 i = 0; i < local_vars; i++){
-        wasm_emit_uint(&func, 1); // num local following types
-        ba_add(&func, cg->local_vars[start_pos + i].target_type);
+        struct var_info *vi = array_get_ptr(&cg->local_vars, start_pos + i);
+        wasm_ir_add_local(fun, vi->target_type);
     }
 
+    //the instructions are emitted into fun_code, then lowered into the IR
+    struct byte_array *code = &cg->fun_code;
+    ba_reset(code);
     if(stack_size){
         //adjust sp
-        wasm_emit_assign_var(&func, fc->local_sp->var_index, false, WasmInstrNumI32SUB, stack_size, STACK_POINTER_VAR_INDEX, true);
+        wasm_emit_assign_var(code, fc->local_sp->var_index, false, WasmInstrNumI32SUB, stack_size, STACK_POINTER_VAR_INDEX, true);
         
         //set global sp to the new address
-        wasm_emit_assign_var(&func, STACK_POINTER_VAR_INDEX, true, 0, 0, fc->local_sp->var_index, false);
+        wasm_emit_assign_var(code, STACK_POINTER_VAR_INDEX, true, 0, 0, fc->local_sp->var_index, false);
     }
     //function body
-    wasm_emit_code(cg, &func, node->func->body);
+    wasm_emit_code(cg, code, node->func->body);
     if(stack_size){
         //adjustment back to original sp
-        wasm_emit_assign_var(&func, STACK_POINTER_VAR_INDEX, true, WasmInstrNumI32ADD, stack_size, fc->local_sp->var_index, false);
+        wasm_emit_assign_var(code, STACK_POINTER_VAR_INDEX, true, WasmInstrNumI32ADD, stack_size, fc->local_sp->var_index, false);
     }
     //end of function
-    ba_add(&func, WasmInstrControlEnd);
-    wasm_emit_uint(ba, func.size); //function body size
-    ba_add2(ba, &func);
-    ba_deinit(&func);
+    ba_add(code, WasmInstrControlEnd);
+
+    //the body is encoded in place after its size
+    u32 body_start = wasm_begin_size(ba);
+    if(wasm_ir_decode(fun, code->data, code->size) && wasm_ir_link(fun)){
+        wasm_run_passes(fun, cg->opt_level);
+        wasm_ir_encode(fun, ba);
+    } else {
+        //instructions the IR does not decode are kept as emitted
+        array_reset(&fun->instrs);
+        wasm_ir_encode(fun, ba);
+        ba_add_array(ba, code->data, code->size);
+    }
+    wasm_end_padded_size(ba, body_start); //function body size, padded so that the body is not moved
 
     _func_leave(cg, node);
     node_free(p0);
@@ -0,0 +1,324 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * wasm simd lowering of for loops: each statement of the loop body stores an expression of
+ * elements at the loop variable into an array element at the loop variable, so lanes of one
+ * vector are the elements of consecutive iterations
+ */
+#include "codegen/wasm/cg_wasm.h"
+#include "codegen/wasm/wasm_api.h"
+#include "codegen/fun_context.h"
+#include "sema/sema_context.h"
+#include "sema/type_size_info.h"
+#include "sema/eval.h"
+#include <assert.h>
+
+struct vector_type {
+    u8 lanes; //0 if arrays of the element type are not vectorized
+    u8 splat;
+    u8 add, sub, mul, div; //0 if the lanes have no such instruction
+};
+
+static struct vector_type vector_types[TYPE_TYPES] = {
+    /*UNK*/ {0},
+    /*GENERIC*/ {0},
+    /*UNIT*/ {0},
+    /*BOOL*/ {0},
+    /*CHAR*/ {0},
+    /*i8*/ {16, WasmInstrVecI8x16Splat, WasmInstrVecI8x16Add, WasmInstrVecI8x16Sub, 0, 0},
+    /*u8*/ {16, WasmInstrVecI8x16Splat, WasmInstrVecI8x16Add, WasmInstrVecI8x16Sub, 0, 0},
+    /*i16*/ {8, WasmInstrVecI16x8Splat, WasmInstrVecI16x8Add, WasmInstrVecI16x8Sub, WasmInstrVecI16x8Mul, 0},
+    /*u16*/ {8, WasmInstrVecI16x8Splat, WasmInstrVecI16x8Add, WasmInstrVecI16x8Sub, WasmInstrVecI16x8Mul, 0},
+    /*i32*/ {4, WasmInstrVecI32x4Splat, WasmInstrVecI32x4Add, WasmInstrVecI32x4Sub, WasmInstrVecI32x4Mul, 0},
+    /*u32*/ {4, WasmInstrVecI32x4Splat, WasmInstrVecI32x4Add, WasmInstrVecI32x4Sub, WasmInstrVecI32x4Mul, 0},
+    /*i64*/ {0},
+    /*u64*/ {0},
+    /*INT*/ {4, WasmInstrVecI32x4Splat, WasmInstrVecI32x4Add, WasmInstrVecI32x4Sub, WasmInstrVecI32x4Mul, 0},
+    /*F32*/ {4, WasmInstrVecF32x4Splat, WasmInstrVecF32x4Add, WasmInstrVecF32x4Sub, WasmInstrVecF32x4Mul, WasmInstrVecF32x4Div},
+    /*F64*/ {2, WasmInstrVecF64x2Splat, WasmInstrVecF64x2Add, WasmInstrVecF64x2Sub, WasmInstrVecF64x2Mul, WasmInstrVecF64x2Div},
+    /*STRING*/ {0},
+    /*FUNCTION*/ {0},
+    /*STRUCT*/ {0},
+    /*TUPLE*/ {0},
+    /*ARRAY*/ {0},
+    /*UNION*/ {0},
+    /*COMPLEX*/ {0},
+    /*REF*/ {0},
+};
+
+//the loop being vectorized
+struct vector_loop {
+    struct type_context *tc;
+    symbol var_name;
+    u8 lanes;
+    //MEMBER_INDEX_NODE *, the array elements accessed, and the stored ones
+    struct array reads;
+    struct array writes;
+};
+
+static u8 _vector_op(struct vector_type *vt, enum op_code opcode)
+{
+    switch (opcode) {
+    case OP_PLUS:
+        return vt->add;
+    case OP_MINUS:
+        return vt->sub;
+    case OP_STAR:
+        return vt->mul;
+    case OP_DIVISION:
+        return vt->div;
+    default:
+        return 0;
+    }
+}
+
+static enum type _get_type(struct vector_loop *vl, struct ast_node *node)
+{
+    return prune(vl->tc, node->type)->type;
+}
+
+//the value does not change in the loop: a scalar expression without the loop variable and calls
+static bool _is_invariant(struct vector_loop *vl, struct ast_node *node)
+{
+    if (node->transformed)
+        node = node->transformed;
+    switch (node->node_type) {
+    case LITERAL_NODE:
+        return true;
+    case IDENT_NODE:
+        return node->ident->name != vl->var_name && _get_type(vl, node) != TYPE_REF && !is_aggregate_type(prune(vl->tc, node->type));
+    case UNARY_NODE:
+        return node->unop->opcode == OP_MINUS && _is_invariant(vl, node->unop->operand);
+    case BINARY_NODE:
+        return node->binop->opcode != OP_POW && _is_invariant(vl, node->binop->lhs) && _is_invariant(vl, node->binop->rhs);
+    case CAST_NODE:
+        return _is_invariant(vl, node->cast->expr);
+    default:
+        return false;
+    }
+}
+
+//a[j][i] of array a with i the loop variable and invariant indices of the other dimensions
+static bool _is_vector_element(struct vector_loop *vl, struct ast_node *node, enum type elm_type)
+{
+    if (node->node_type != MEMBER_INDEX_NODE || node->index->object->type->type != TYPE_ARRAY)
+        return false;
+    if (_get_type(vl, node) != elm_type || node->index->index->node_type != IDENT_NODE || node->index->index->ident->name != vl->var_name)
+        return false;
+    struct ast_node *object = node->index->object;
+    while (object->node_type == MEMBER_INDEX_NODE && object->index->object->type->type == TYPE_ARRAY) {
+        if (!_is_invariant(vl, object->index->index))
+            return false;
+        object = object->index->object;
+    }
+    return object->node_type == IDENT_NODE && object->type->type == TYPE_ARRAY;
+}
+
+static bool _is_vector_expr(struct vector_loop *vl, struct ast_node *node, enum type elm_type)
+{
+    if (node->transformed)
+        node = node->transformed;
+    if (type_2_wtype[_get_type(vl, node)] != type_2_wtype[elm_type])
+        return false;
+    if (_is_invariant(vl, node))
+        return true;
+    if (node->node_type == MEMBER_INDEX_NODE) {
+        if (!_is_vector_element(vl, node, elm_type))
+            return false;
+        array_push_ptr(&vl->reads, node);
+        return true;
+    }
+    return node->node_type == BINARY_NODE && _vector_op(&vector_types[elm_type], node->binop->opcode) &&
+           _is_vector_expr(vl, node->binop->lhs, elm_type) && _is_vector_expr(vl, node->binop->rhs, elm_type);
+}
+
+static bool _is_vector_statement(struct vector_loop *vl, struct ast_node *node)
+{
+    if (node->transformed)
+        node = node->transformed;
+    if (node->node_type != ASSIGN_NODE || node->binop->opcode != OP_ASSIGN)
+        return false;
+    struct ast_node *lhs = node->binop->lhs;
+    if (lhs->node_type != MEMBER_INDEX_NODE)
+        return false;
+    enum type elm_type = _get_type(vl, lhs);
+    u8 lanes = vector_types[elm_type].lanes;
+    if (!lanes || (vl->lanes && lanes != vl->lanes) || !_is_vector_element(vl, lhs, elm_type))
+        return false;
+    vl->lanes = lanes;
+    array_push_ptr(&vl->writes, lhs);
+    return _is_vector_expr(vl, node->binop->rhs, elm_type);
+}
+
+static bool _is_same_expr(struct ast_node *a, struct ast_node *b)
+{
+    if (a->transformed)
+        a = a->transformed;
+    if (b->transformed)
+        b = b->transformed;
+    if (a->node_type != b->node_type)
+        return false;
+    switch (a->node_type) {
+    case LITERAL_NODE:
+        return a->liter->type == b->liter->type && a->liter->type != TYPE_F64 && a->liter->type != TYPE_F32 && eval(a) == eval(b);
+    case IDENT_NODE:
+        return a->ident->name == b->ident->name;
+    case UNARY_NODE:
+        return a->unop->opcode == b->unop->opcode && _is_same_expr(a->unop->operand, b->unop->operand);
+    case BINARY_NODE:
+        return a->binop->opcode == b->binop->opcode && _is_same_expr(a->binop->lhs, b->binop->lhs) && _is_same_expr(a->binop->rhs, b->binop->rhs);
+    default:
+        return false;
+    }
+}
+
+//both access the array of the same name
+static bool _is_same_array(struct ast_node *a, struct ast_node *b)
+{
+    while (a->node_type == MEMBER_INDEX_NODE)
+        a = a->index->object;
+    while (b->node_type == MEMBER_INDEX_NODE)
+        b = b->index->object;
+    return a->ident->name == b->ident->name;
+}
+
+static bool _is_same_element(struct ast_node *a, struct ast_node *b)
+{
+    while (a->node_type == MEMBER_INDEX_NODE && b->node_type == MEMBER_INDEX_NODE) {
+        if (!_is_same_expr(a->index->index, b->index->index))
+            return false;
+        a = a->index->object;
+        b = b->index->object;
+    }
+    return a->node_type == IDENT_NODE && b->node_type == IDENT_NODE && a->ident->name == b->ident->name;
+}
+
+/*
+ * a store to one element of a row and a load of another element of the row would be
+ * reordered by the vectors, so the elements of the arrays written are only accessed at the
+ * element written
+ */
+static bool _has_no_dependency(struct vector_loop *vl)
+{
+    for (u32 i = 0; i < array_size(&vl->writes); i++) {
+        struct ast_node *write = array_get_ptr(&vl->writes, i);
+        for (u32 j = 0; j < array_size(&vl->writes); j++) {
+            struct ast_node *other = array_get_ptr(&vl->writes, j);
+            if (_is_same_array(write, other) && !_is_same_element(write, other))
+                return false;
+        }
+        for (u32 j = 0; j < array_size(&vl->reads); j++) {
+            struct ast_node *read = array_get_ptr(&vl->reads, j);
+            if (_is_same_array(write, read) && !_is_same_element(write, read))
+                return false;
+        }
+    }
+    return true;
+}
+
+static bool _is_vector_loop(struct vector_loop *vl, struct ast_node *node)
+{
+    struct for_node *forloop = node->forloop;
+    if (forloop->step_sign <= 0 || eval(forloop->range->range->step) != 1 || _get_type(vl, forloop->var) != TYPE_INT)
+        return false;
+    struct ast_node *body = forloop->body;
+    if (body->node_type != BLOCK_NODE)
+        return _is_vector_statement(vl, body) && _has_no_dependency(vl);
+    for (u32 i = 0; i < array_size(&body->block->nodes); i++) {
+        if (!_is_vector_statement(vl, array_get_ptr(&body->block->nodes, i)))
+            return false;
+    }
+    return array_size(&body->block->nodes) && _has_no_dependency(vl);
+}
+
+static void _free_field_info(void *fi)
+{
+    struct field_info *field = fi;
+    node_free(field->offset_expr);
+}
+
+static void _emit_element_address(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node, u32 *align)
+{
+    struct fun_context *fc = cg_get_top_fun_context(cg);
+    struct array field_infos;
+    array_init_free(&field_infos, sizeof(struct field_info), _free_field_info);
+    sc_get_field_infos_from_root(cg->base.sema_context, node, &field_infos);
+    struct field_info *field = array_front(&field_infos);
+    struct var_info *vi = fc_get_var_info(fc, field->aggr_root);
+    wasm_emit_addr_offset_by_expr(cg, ba, vi->var_index, false, field->offset_expr);
+    *align = field->align;
+    array_deinit(&field_infos);
+}
+
+static void _emit_vector_expr(struct cg_wasm *cg, struct byte_array *ba, struct vector_loop *vl, struct ast_node *node, enum type elm_type)
+{
+    if (node->transformed)
+        node = node->transformed;
+    u32 align;
+    if (_is_invariant(vl, node)) {
+        wasm_emit_code(cg, ba, node);
+        wasm_emit_vector_op(ba, vector_types[elm_type].splat);
+    } else if (node->node_type == MEMBER_INDEX_NODE) {
+        _emit_element_address(cg, ba, node, &align);
+        wasm_emit_load_vector(ba, align, 0);
+    } else {
+        _emit_vector_expr(cg, ba, vl, node->binop->lhs, elm_type);
+        _emit_vector_expr(cg, ba, vl, node->binop->rhs, elm_type);
+        wasm_emit_vector_op(ba, _vector_op(&vector_types[elm_type], node->binop->opcode));
+    }
+}
+
+static void _emit_vector_statement(struct cg_wasm *cg, struct byte_array *ba, struct vector_loop *vl, struct ast_node *node)
+{
+    if (node->transformed)
+        node = node->transformed;
+    struct ast_node *lhs = node->binop->lhs;
+    u32 align;
+    _emit_element_address(cg, ba, lhs, &align);
+    _emit_vector_expr(cg, ba, vl, node->binop->rhs, _get_type(vl, lhs));
+    wasm_emit_store_vector(ba, align, 0);
+}
+
+void wasm_emit_simd_for_loop(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node, u32 var_index, u32 end_index)
+{
+    if (!(cg->target_features & WASM_FEATURE_SIMD))
+        return;
+    struct vector_loop vl;
+    vl.tc = cg->base.sema_context->tc;
+    vl.var_name = node->forloop->var->var->var->ident->name;
+    vl.lanes = 0;
+    array_init(&vl.reads, sizeof(struct ast_node *));
+    array_init(&vl.writes, sizeof(struct ast_node *));
+    if (_is_vector_loop(&vl, node)) {
+        ba_add(ba, WasmInstrControlBlock);
+        ba_add(ba, WasmTypeVoid);
+        ba_add(ba, WasmInstrControlLoop);
+        ba_add(ba, WasmTypeVoid);
+        //leave when fewer elements than lanes are left
+        wasm_emit_get_var(ba, var_index, false);
+        wasm_emit_const_i32(ba, vl.lanes);
+        ba_add(ba, WasmInstrNumI32ADD);
+        wasm_emit_get_var(ba, end_index, false);
+        ba_add(ba, WasmInstrNumI32GTS);
+        ba_add(ba, WasmInstrControlBrIf);
+        wasm_emit_uint(ba, 1);
+        struct ast_node *body = node->forloop->body;
+        if (body->node_type != BLOCK_NODE) {
+            _emit_vector_statement(cg, ba, &vl, body);
+        } else {
+            for (u32 i = 0; i < array_size(&body->block->nodes); i++) {
+                _emit_vector_statement(cg, ba, &vl, array_get_ptr(&body->block->nodes, i));
+            }
+        }
+        wasm_emit_get_var(ba, var_index, false);
+        wasm_emit_const_i32(ba, vl.lanes);
+        ba_add(ba, WasmInstrNumI32ADD);
+        wasm_emit_set_var(ba, var_index, false);
+        ba_add(ba, WasmInstrControlBr);
+        wasm_emit_uint(ba, 0);
+        ba_add(ba, WasmInstrControlEnd);
+        ba_add(ba, WasmInstrControlEnd);
+    }
+    array_deinit(&vl.reads);
+    array_deinit(&vl.writes);
+}
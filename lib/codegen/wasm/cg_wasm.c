@@ -7,6 +7,7 @@
 #include "codegen/wasm/cg_wasm.h"
 #include "codegen/wasm/wasm_abi.h"
 #include "codegen/wasm/wasm_api.h"
+#include "codegen/wasm/wasm_pass.h"
 #include "clib/array.h"
 #include "clib/string.h"
 #include "clib/symbol.h"
@@ -265,13 +266,11 @@ u8 op_maps[OP_TOTAL][TYPE_TYPES] = {
 
 #define DATA_SECTION_START_ADDRESS 1024
 #define STACK_BASE_ADDRESS  66592
+//the data section is below the stack
+#define DATA_SECTION_MAX_SIZE (STACK_BASE_ADDRESS - DATA_SECTION_START_ADDRESS)
 
 #define MEMORY_BASE_VAR_INDEX 1
 
-symbol MEMORY = 0;
-symbol __MEMORY_BASE = 0;
-symbol POW_FUN_NAME = 0;
-
 void _imports_init(struct imports *imports)
 {
     imports->import_block = 0;
@@ -289,6 +288,11 @@ void _imports_deinit(struct imports *imports)
     imports->num_memory = 0;
 }
 
+static void _free_stack_entry(void *entry)
+{
+    FREE(entry);
+}
+
 void _cg_wasm_init(struct cg_wasm *cg)
 {
     ba_init(&cg->ba, 17);
@@ -296,13 +300,18 @@ void _cg_wasm_init(struct cg_wasm *cg)
     hashtable_init(&cg->func_name_2_ast);
     _imports_init(&cg->imports);
     cg->sys_block = 0;
+    array_init_free(&cg->fun_contexts, sizeof(struct fun_context *), _free_stack_entry);
+    array_init_free(&cg->local_vars, sizeof(struct var_info *), _free_stack_entry);
     cg->fun_top = 0;
     cg->var_top = 0;
     cg->func_idx = 0;
-    cg->data_offset = 0;
+    ba_init(&cg->data, 17);
+    cg->opt_level = WASM_OPT_LEVEL_DEFAULT;
+    cg->target_features = 0;
+    ba_init(&cg->fun_code, 17);
+    wasm_ir_init(&cg->fun_ir);
     cg->fun_types = block_node_new_empty();
     cg->funs = block_node_new_empty();
-    cg->data_block = block_node_new_empty();
 }
 
 void _cg_wasm_deinit(struct cg_wasm *cg)
@@ -310,12 +319,61 @@ void _cg_wasm_deinit(struct cg_wasm *cg)
     _imports_deinit(&cg->imports);
     node_free(cg->sys_block);
     cg->fun_top = 0;
+    array_deinit(&cg->fun_contexts);
+    array_deinit(&cg->local_vars);
     hashtable_deinit(&cg->func_name_2_ast);
     hashtable_deinit(&cg->func_name_2_idx);
     ba_deinit(&cg->ba);
+    ba_deinit(&cg->fun_code);
+    wasm_ir_deinit(&cg->fun_ir);
     free_block_node(cg->fun_types, false); //container only
     free_block_node(cg->funs, false); //container only
-    free_block_node(cg->data_block, false); //container only
+    ba_deinit(&cg->data);
+}
+
+void cg_wasm_reset(struct cg_wasm *cg)
+{
+    if (cg->ba.data) {
+        ba_reset(&cg->ba);
+    } else {
+        //the module bytes were taken by the caller
+        ba_init(&cg->ba, 17);
+    }
+    hashtable_clear(&cg->func_name_2_idx);
+    hashtable_clear(&cg->func_name_2_ast);
+    hashtable_clear(&cg->base.target_info->fun_infos);
+    array_reset(&cg->fun_types->block->nodes);
+    array_reset(&cg->funs->block->nodes);
+    cg->fun_top = 0;
+    cg->var_top = 0;
+    cg->func_idx = 0;
+    ba_reset(&cg->data);
+}
+
+u32 wasm_add_data(struct cg_wasm *cg, const u8 *bytes, u32 size, u32 align)
+{
+    u32 data_offset = (cg->data.size + align - 1) / align * align;
+    if (data_offset + size > DATA_SECTION_MAX_SIZE)
+        return InvalidIndex;
+    while (cg->data.size < data_offset) {
+        ba_add(&cg->data, 0);
+    }
+    ba_add_array(&cg->data, bytes, size);
+    return data_offset;
+}
+
+void wasm_emit_data_address(struct cg_wasm *cg, struct byte_array *ba, u32 data_offset)
+{
+    if(cg->imports.num_memory){
+        ba_add(ba, WasmInstrVarGlobalGet);
+        wasm_emit_uint(ba, MEMORY_BASE_VAR_INDEX);
+        if(data_offset){
+            wasm_emit_const_i32(ba, data_offset);
+            ba_add(ba, WasmInstrNumI32ADD);
+        }
+    } else {
+        wasm_emit_const_i32(ba, DATA_SECTION_START_ADDRESS + data_offset);
+    }
 }
 
 void wasm_emit_store_scalar_value_at(struct cg_wasm *cg, struct byte_array *ba, u32 local_address_var_index, u32 align, u32 offset, struct ast_node *node)
@@ -385,9 +443,9 @@ struct cg_wasm *cg_wasm_new(struct sema_context *context)
     struct cg_wasm *cg;
     MALLOC(cg, sizeof(*cg));
     _cg_wasm_init(cg);
-    MEMORY = to_symbol("memory");
-    __MEMORY_BASE = to_symbol("__memory_base");
-    POW_FUN_NAME = to_symbol("pow");
+    cg->memory_symbol = to_symbol("memory");
+    cg->memory_base_symbol = to_symbol("__memory_base");
+    cg->pow_fun_symbol = to_symbol("pow");
     cg->base.compute_fun_info = wasm_compute_fun_info;
     cg->base.sema_context = context;
     cg->base.target_info = ti_new("wasm32");
@@ -404,7 +462,7 @@ void cg_wasm_free(struct cg_wasm *cg)
 
 struct fun_context *cg_get_top_fun_context(struct cg_wasm *cg)
 {
-    return cg->fun_top >= 1 ? &cg->fun_contexts[cg->fun_top - 1] : 0;
+    return cg->fun_top >= 1 ? array_get_ptr(&cg->fun_contexts, cg->fun_top - 1) : 0;
 }
 
 void _emit_literal(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node)
@@ -435,20 +493,12 @@ void _emit_literal(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *n
             break;
         case TYPE_STRING:
             len = strlen(node->liter->str_val);
+            wasm_emit_data_address(cg, ba, cg->data.size);
             if(cg->imports.num_memory){
-                ba_add(ba, WasmInstrVarGlobalGet);
-                wasm_emit_uint(ba, MEMORY_BASE_VAR_INDEX);
-                if(cg->data_offset){
-                    wasm_emit_const_i32(ba, cg->data_offset);
-                    ba_add(ba, WasmInstrNumI32ADD);
-                }
-                cg->data_offset += len + 1; //null terminated string
+                wasm_emit_null_terminated_string(&cg->data, node->liter->str_val, len);
             } else {
-                ba_add(ba, type_2_const[node->type->type]);
-                wasm_emit_uint(ba, DATA_SECTION_START_ADDRESS + cg->data_offset);
-                cg->data_offset += wasm_get_emit_size(len) + len;
+                wasm_emit_chars(&cg->data, node->liter->str_val, len);
             }
-            block_node_add(cg->data_block, node);
             break;
     }
     
@@ -504,9 +554,9 @@ void _emit_unary(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *nod
             wasm_emit_code(cg, ba, new_node);
             break;
         case OP_NOT:
-            new_node = int_node_new(tc, 1, node->loc);
-            new_node->type = node->type;
-            wasm_emit_code(cg, ba, new_node);
+            //the operand is a bool
+            wasm_emit_code(cg, ba, node->unop->operand);
+            ba_add(ba, WasmInstrNumI32EQZ);
             break;
         case OP_BITNOT:
             new_node = int_node_new(tc, -1, node->loc);
@@ -720,7 +770,7 @@ void _emit_binary(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *no
         }
     }else{
         //call pow function
-        u32 func_index = hashtable_get_int(&cg->func_name_2_idx, POW_FUN_NAME);
+        u32 func_index = hashtable_get_int(&cg->func_name_2_idx, cg->pow_fun_symbol);
         ba_add(ba, WasmInstrControlCall);
         wasm_emit_uint(ba, func_index);
     }
@@ -884,21 +934,90 @@ void _emit_if_local_var_ge_zero(struct byte_array *ba, u32 var_index, enum type
     ba_add(ba, WasmTypeI32);
 }
 
+bool wasm_is_unrolled_loop(struct ast_node *node)
+{
+    return node->forloop->trip_count >= 0 && node->forloop->trip_count <= FOR_UNROLL_MAX_TRIPS;
+}
+
+//the loop body as often as the constant trip count, the variable is left at its value after the loop
+void _emit_unrolled_for_loop(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node, u32 var_index)
+{
+    i32 start = eval(node->forloop->range->range->start);
+    i32 step = eval(node->forloop->range->range->step);
+    for(i32 i = 0; i <= node->forloop->trip_count; i++){
+        wasm_emit_const_i32(ba, (i32)((u32)start + (u32)i * (u32)step));
+        ba_add(ba, WasmInstrVarLocalSet);
+        wasm_emit_uint(ba, var_index);
+        if(i < node->forloop->trip_count)
+            wasm_emit_code(cg, ba, node->forloop->body);
+    }
+}
+
+/*
+ * the step is a constant: the range is tested once before the loop, then at the bottom after
+ * the step with one compare and branch. break and continue keep the labels of the general form
+ */
+void _emit_const_step_for_loop(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node, u32 var_index, u32 end_index)
+{
+    enum type type = node->forloop->var->type->type;
+    bool is_up = node->forloop->step_sign > 0;
+    ba_add(ba, WasmInstrControlBlock); // outside block branch labelidx 1
+    ba_add(ba, WasmTypeVoid);
+    //skip the loop if the range is empty
+    wasm_emit_get_var(ba, var_index, false);
+    wasm_emit_get_var(ba, end_index, false);
+    ba_add(ba, op_maps[is_up ? OP_GE : OP_LE][type]);
+    ba_add(ba, WasmInstrControlBrIf);
+    wasm_emit_uint(ba, 0);
+
+    ba_add(ba, WasmInstrControlLoop);  // loop branch, branch labelidx 0
+    ba_add(ba, WasmTypeVoid);
+    ba_add(ba, WasmInstrControlBlock); // body block, the target of continue
+    ba_add(ba, WasmTypeVoid);
+    wasm_emit_code(cg, ba, node->forloop->body);
+    ba_add(ba, WasmInstrControlEnd); //end of body block
+
+    //var += step, loop again while var is in the range
+    wasm_emit_get_var(ba, var_index, false);
+    wasm_emit_code(cg, ba, node->forloop->range->range->step);
+    ba_add(ba, op_maps[OP_PLUS][type]);
+    ba_add(ba, WasmInstrVarLocalTee);
+    wasm_emit_uint(ba, var_index);
+    wasm_emit_get_var(ba, end_index, false);
+    ba_add(ba, op_maps[is_up ? OP_LT : OP_GT][type]);
+    ba_add(ba, WasmInstrControlBrIf);
+    wasm_emit_uint(ba, 0);
+    ba_add(ba, WasmInstrControlEnd); //end of loop branch
+    ba_add(ba, WasmInstrControlEnd); //end of outside branch
+}
+
 void _emit_for_loop(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *node)
 {
     struct fun_context *fc = cg_get_top_fun_context(cg);
     assert(node->node_type == FOR_NODE);
     u32 var_index = fc_get_var_info(fc, node->forloop->var)->var_index;
-    u32 step_index = fc_get_var_info(fc, node->forloop->range->range->step)->var_index;
-    u32 end_index = fc_get_var_info(fc, node->forloop->range->range->end)->var_index;
     enum type type = node->forloop->var->type->type;
     //enum type body_type = node->forloop->body->type->type;
     ASSERT_TYPE(type);
     //ASSERT_TYPE(body_type);
+    if(wasm_is_unrolled_loop(node)){
+        _emit_unrolled_for_loop(cg, ba, node, var_index);
+        return;
+    }
     // initializing start value
     wasm_emit_code(cg, ba, node->forloop->range->range->start);
     ba_add(ba, WasmInstrVarLocalSet);
     wasm_emit_uint(ba, var_index);  //1
+    u32 end_index = fc_get_var_info(fc, node->forloop->range->range->end)->var_index;
+    if(node->forloop->step_sign){
+        wasm_emit_code(cg, ba, node->forloop->range->range->end);
+        ba_add(ba, WasmInstrVarLocalSet);
+        wasm_emit_uint(ba, end_index);
+        wasm_emit_simd_for_loop(cg, ba, node, var_index, end_index);
+        _emit_const_step_for_loop(cg, ba, node, var_index, end_index);
+        return;
+    }
+    u32 step_index = fc_get_var_info(fc, node->forloop->range->range->step)->var_index;
 
     // set step value
     wasm_emit_code(cg, ba, node->forloop->range->range->step);
@@ -1137,12 +1256,6 @@ void wasm_emit_code(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *
     }
 }
 
-void _append_section(struct byte_array *ba, struct byte_array *section)
-{
-    wasm_emit_uint(ba, section->size); // set size
-    ba_add2(ba, section); // copy data
-    ba_reset(section);
-}
 
 void _emit_type_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *block)
 {
@@ -1208,14 +1321,14 @@ void _emit_import_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_
             ba_add(ba, WasmImportTypeGlobal);
             ASSERT_TYPE(node->type->type);
             ba_add(ba, type_2_wtype[node->type->type]);
-            if (__MEMORY_BASE == node->var->var->ident->name){
+            if (cg->memory_base_symbol == node->var->var->ident->name){
                 ba_add(ba, WasmGlobalTypeConst); // immutable
             }else{
                 ba_add(ba, WasmGlobalTypeVar); // mutable
             }
             break;
         case MEMORY_NODE:
-            wasm_emit_string(ba, MEMORY);
+            wasm_emit_string(ba, cg->memory_symbol);
             ba_add(ba, WasmImportTypeMemory);
             if(node->memory->max){
                 ba_add(ba, WasmLimitsTypeMinMax);
@@ -1233,7 +1346,7 @@ void _emit_import_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_
 void _emit_function_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *block)
 {
     u32 num_func = array_size(&block->block->nodes);
-    ba_add(ba, num_func); // num functions
+    wasm_emit_uint(ba, num_func); // num functions
     for (u32 i = 0; i < num_func; i++) {
         wasm_emit_uint(ba, i + cg->imports.num_func); // function index
     }
@@ -1268,7 +1381,7 @@ void _emit_export_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_
         ba_add(ba, WasmExportTypeFunc);
         wasm_emit_uint(ba, i + cg->imports.num_func); // func index
     }
-    wasm_emit_string(ba, MEMORY);
+    wasm_emit_string(ba, cg->memory_symbol);
     ba_add(ba, WasmExportTypeMemory);
     wasm_emit_uint(ba, 0); //export memory 0
 }
@@ -1280,9 +1393,8 @@ void _emit_code_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_no
     wasm_emit_code(cg, ba, block);
 }
 
-void _emit_data_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_node *block)
+void _emit_data_section(struct cg_wasm *cg, struct byte_array *ba, struct byte_array *data)
 {
-    u32 num_data = array_size(&block->block->nodes);
     wasm_emit_uint(ba, 1); //1 data segment
     wasm_emit_uint(ba, WasmDataSegmentTypeActive);
     // offset of memory
@@ -1294,32 +1406,17 @@ void _emit_data_section(struct cg_wasm *cg, struct byte_array *ba, struct ast_no
         wasm_emit_uint(ba, DATA_SECTION_START_ADDRESS);
     }
     ba_add(ba, WasmInstrControlEnd);
-    wasm_emit_uint(ba, cg->data_offset);
-    for (u32 i = 0; i < num_data; i++) {
-        struct ast_node *node = array_get_p(&block->block->nodes, i);
-        assert(node->node_type == LITERAL_NODE);
-        //data array size and content
-        u32 str_length = strlen(node->liter->str_val);
-        if (cg->imports.num_memory) {
-            wasm_emit_null_terminated_string(ba, node->liter->str_val, str_length);
-        } else {
-            wasm_emit_chars(ba, node->liter->str_val, str_length);
-        }
-    }
+    wasm_emit_uint(ba, data->size);
+    ba_add_array(ba, data->data, data->size);
 }
 
 void wasm_emit_module(struct cg_wasm *cg, struct ast_node *node)
 {
     assert(node->node_type == BLOCK_NODE);
-    struct byte_array section;
-    struct byte_array *ba = &cg->ba;    
-    ba_init(&section, 17);
-    for(size_t i = 0; i < ARRAY_SIZE(wasm_magic_number); i++){
-        ba_add(ba, wasm_magic_number[i]);
-    }
-    for(size_t i = 0; i < ARRAY_SIZE(wasm_version); i++){
-        ba_add(ba, wasm_version[i]);
-    }
+    struct byte_array *ba = &cg->ba;
+    u32 section_start; //sections are emitted in place after their size
+    ba_add_array(ba, (const u8 *)wasm_magic_number, ARRAY_SIZE(wasm_magic_number));
+    ba_add_array(ba, wasm_version, ARRAY_SIZE(wasm_version));
     // 0.    custom section
     // 1.    type section       : type signature of the function
     // 2.    import section
@@ -1335,58 +1432,65 @@ void wasm_emit_module(struct cg_wasm *cg, struct ast_node *node)
     // 12.   data count section
     // type section
     ba_add(ba, WasmSectionType);       // code: 1
-    _emit_type_section(cg, &section, cg->fun_types);
-    _append_section(ba, &section);
+    section_start = wasm_begin_size(ba);
+    _emit_type_section(cg, ba, cg->fun_types);
+    wasm_end_size(ba, section_start);
     // import section
     ba_add(ba, WasmSectionImport);     // code: 2
-    _emit_import_section(cg, &section, cg->imports.import_block);
-    _append_section(ba, &section);
+    section_start = wasm_begin_size(ba);
+    _emit_import_section(cg, ba, cg->imports.import_block);
+    wasm_end_size(ba, section_start);
 
     // function section
     ba_add(ba, WasmSectionFunction);   // code: 3
-    _emit_function_section(cg, &section, cg->funs);
-    _append_section(ba, &section);
+    section_start = wasm_begin_size(ba);
+    _emit_function_section(cg, ba, cg->funs);
+    wasm_end_size(ba, section_start);
 
     // table section                // code: 4
     // memory section               // code: 5
     if(!cg->imports.num_memory){
         ba_add(ba, WasmSectionMemory);
-        _emit_memory_section(cg, &section);
-        _append_section(ba, &section);
+        section_start = wasm_begin_size(ba);
+        _emit_memory_section(cg, ba);
+        wasm_end_size(ba, section_start);
     }
 
     // global section               // code: 6
     if(!cg->imports.num_global){
         ba_add(ba, WasmSectionGlobal);
-        _emit_global_section(cg, &section);
-        _append_section(ba, &section);
+        section_start = wasm_begin_size(ba);
+        _emit_global_section(cg, ba);
+        wasm_end_size(ba, section_start);
     }
     // export section               // code: 7
     ba_add(ba, WasmSectionExport); 
-    _emit_export_section(cg, &section, cg->funs);
-    _append_section(ba, &section);
+    section_start = wasm_begin_size(ba);
+    _emit_export_section(cg, ba, cg->funs);
+    wasm_end_size(ba, section_start);
 
     // start section                // code: 8
     // element section              // code: 9
 
     // data count section           // code: 12, data count must before code section
-    if (array_size(&cg->data_block->block->nodes)) {
+    if (cg->data.size) {
         ba_add(ba, WasmSectionDataCount); 
         wasm_emit_uint(ba, 1); //   data count size
         wasm_emit_uint(ba, 1); //   data count
     }
     // code section                 // code: 10
     ba_add(ba, WasmSectionCode); 
-    _emit_code_section(cg, &section, cg->funs);
-    _append_section(ba, &section);
+    section_start = wasm_begin_size(ba);
+    _emit_code_section(cg, ba, cg->funs);
+    wasm_end_size(ba, section_start);
 
     // data section                 // code: 11
-    if(array_size(&cg->data_block->block->nodes)){
+    if(cg->data.size){
         ba_add(ba, WasmSectionData);
-        _emit_data_section(cg, &section, cg->data_block);
-        _append_section(ba, &section);
+        section_start = wasm_begin_size(ba);
+        _emit_data_section(cg, ba, &cg->data);
+        wasm_end_size(ba, section_start);
     }
 
     // custom secion                // code: 0
-    ba_deinit(&section);
 }
@@ -18,80 +18,125 @@ void wasm_emit_instruction(WasmModule module, Instruction ins)
     ba_add(module, ins);
 }
 
+//7 bits a byte: the bits of value up to the highest 1, at least one byte for 0
 u8 wasm_get_emit_size(u64 value)
 {
-    u8 index = 0;
-    do{
+    return (u8)((64 - __builtin_clzll(value | 1) + 6) / 7);
+}
+
+//the bits of value up to the highest bit different from the sign bit, plus the sign bit
+u8 wasm_get_emit_int_size(i64 value)
+{
+    return (u8)((64 - __builtin_clrsbll(value) + 6) / 7);
+}
+
+//the size is known ahead, so every byte but the last gets the continuation bit without testing the rest of value
+static inline void _write_leb128(u8 *bytes, u64 value, u8 size)
+{
+    u8 last = size - 1;
+    for (u8 i = 0; i < last; i++) {
+        bytes[i] = 0x80 | (0x7F & value);
         value >>= 7;
-        index++;
-    }while(value!=0);
-    return index;
+    }
+    bytes[last] = 0x7F & value;
 }
 
 u8 wasm_emit_uint(WasmModule module, u64 value)
 {
-    u8 byte;
-    u8 index = 0;
-    do{
-        byte = 0x7F & value; //low 7 bits of value
-        value >>= 7;
-        if(value != 0){
-            byte |= 0x80;    //set bit 7 as 1, more bytes to come
-        }
-        ba_add(module, byte);
-        index++;
-    }while(value!=0);
-    return index;
+    if (value < 0x80) {
+        ba_add(module, (u8)value);
+        return 1;
+    }
+    u8 size = wasm_get_emit_size(value);
+    ba_reserve(module, size);
+    _write_leb128(&module->data[module->size], value, size);
+    module->size += size;
+    return size;
 }
 
 u8 wasm_emit_int(WasmModule module, i64 value)
 {
-    int more = 1;
+    u8 size = wasm_get_emit_int_size(value);
+    ba_reserve(module, size);
+    u8 *bytes = &module->data[module->size];
+    _write_leb128(bytes, (u64)value, size);
+    //arithmetic shift keeps the sign bits in the last byte
+    bytes[size - 1] = 0x7F & (value >> (7 * (size - 1)));
+    module->size += size;
+    return size;
+}
+
+u64 wasm_read_uint(const u8 *bytes, u32 *size)
+{
+    u64 value = 0;
+    u32 i = 0;
     u8 byte;
-    u8 sign_bit;
-    u8 index = 0;
-    while(more) {
-        byte = 0x7F & value; // low 7 bits of value
-        sign_bit = byte & 0x40;
-        value >>= 7; // this is arithmetic shift
-        if ((value == 0 && !sign_bit) || (value == -1 && sign_bit)) {
-            more = 0;
-        }else{
-            byte |= 0x80;
-        }
-        ba_add(module, byte);
-        index++;
-    };
-    return index;
+    do {
+        byte = bytes[i];
+        value |= (u64)(byte & 0x7F) << (7 * i);
+        i++;
+    } while (byte & 0x80);
+    *size = i;
+    return value;
+}
+
+i64 wasm_read_int(const u8 *bytes, u32 *size)
+{
+    u64 value = wasm_read_uint(bytes, size);
+    u32 bits = 7 * *size;
+    if (bits < 64 && (bytes[*size - 1] & 0x40))
+        value |= ~(u64)0 << bits; //sign extension
+    return (i64)value;
 }
 
 /*IEEE 754 2019 little endian in bytes*/
+static inline u8 _emit_le_bytes(WasmModule module, u64 bits, u8 size)
+{
+    ba_reserve(module, size);
+    u8 *bytes = &module->data[module->size];
+    for (u8 i = 0; i < size; i++) {
+        bytes[i] = 0xFF & (bits >> (i * 8));
+    }
+    module->size += size;
+    return size;
+}
+
 u8 wasm_emit_f32(WasmModule module, f32 value)
 {
-    u8 size = sizeof(value);
-    u8 byte;
     u32 bits;
-    memcpy(&bits, &value, size);
-    for(u8 i = 0; i < size; i++) {
-        byte = 0xFF & bits; // low 7 bits of value
-        bits >>= 8;
-        ba_add(module, byte);
-    } 
-    return size;//return 
+    memcpy(&bits, &value, sizeof(value));
+    return _emit_le_bytes(module, bits, sizeof(value));
 }
 
 u8 wasm_emit_f64(WasmModule module, f64 value)
 {
-    u8 size = sizeof(value);
-    u8 byte;
     u64 bits;
-    memcpy(&bits, &value, size);
-    for (u8 i = 0; i < size; i++) {
-        byte = 0xFF & bits; // low 7 bits of value
-        bits >>= 8;
-        ba_add(module, byte);
-    }
-    return size; // return
+    memcpy(&bits, &value, sizeof(value));
+    return _emit_le_bytes(module, bits, sizeof(value));
+}
+
+u32 wasm_begin_size(WasmModule module)
+{
+    u32 start = module->size;
+    ba_reserve(module, MAX_U32_LEB128_SIZE);
+    module->size += MAX_U32_LEB128_SIZE;
+    return start;
+}
+
+void wasm_end_size(WasmModule module, u32 start)
+{
+    u32 content_start = start + MAX_U32_LEB128_SIZE;
+    u32 size = module->size - content_start;
+    u8 leb_size = wasm_get_emit_size(size);
+    _write_leb128(&module->data[start], size, leb_size);
+    if (leb_size < MAX_U32_LEB128_SIZE)
+        ba_remove(module, start + leb_size, MAX_U32_LEB128_SIZE - leb_size);
+}
+
+void wasm_end_padded_size(WasmModule module, u32 start)
+{
+    u32 size = module->size - (start + MAX_U32_LEB128_SIZE);
+    _write_leb128(&module->data[start], size, MAX_U32_LEB128_SIZE);
 }
 
 void wasm_emit_const_i32(WasmModule module, i32 const_value)
@@ -115,16 +160,12 @@ void wasm_emit_const_f32(WasmModule module, f32 const_value)
 void wasm_emit_chars(WasmModule module, const char *str, u32 len)
 {
     wasm_emit_uint(module, len);
-    for (u32 j = 0; j < len; j++) {
-        ba_add(module, str[j]);
-    }
+    ba_add_array(module, (const u8 *)str, len);
 }
 
 void wasm_emit_null_terminated_string(WasmModule module, const char *str, u32 len)
 {
-    for (u32 j = 0; j < len; j++) {
-        ba_add(module, str[j]);
-    }
+    ba_add_array(module, (const u8 *)str, len);
     ba_add(module, 0);
 }
 
@@ -201,6 +242,53 @@ void wasm_emit_store_mem(WasmModule ba, u32 align, u32 offset, enum type type)
     wasm_emit_uint(ba, offset);
 }
 
+void wasm_emit_vector_op(WasmModule ba, u32 op)
+{
+    ba_add(ba, WasmInstrVecOp);
+    wasm_emit_uint(ba, op);
+}
+
+void wasm_emit_load_vector(WasmModule ba, u32 align, u32 offset)
+{
+    assert(align <= 8);
+    wasm_emit_vector_op(ba, WasmInstrVecV128Load);
+    wasm_emit_uint(ba, aligns[align]);
+    wasm_emit_uint(ba, offset);
+}
+
+void wasm_emit_store_vector(WasmModule ba, u32 align, u32 offset)
+{
+    assert(align <= 8);
+    wasm_emit_vector_op(ba, WasmInstrVecV128Store);
+    wasm_emit_uint(ba, aligns[align]);
+    wasm_emit_uint(ba, offset);
+}
+
+//the address at offset of the one in the variable
+static void _emit_address(WasmModule ba, u32 var_index, u32 offset)
+{
+    wasm_emit_get_var(ba, var_index, false);
+    if (offset) {
+        wasm_emit_const_i32(ba, offset);
+        ba_add(ba, WasmInstrNumI32ADD);
+    }
+}
+
+void wasm_emit_memory_copy(WasmModule ba)
+{
+    ba_add(ba, WasmInstrMemOp);
+    wasm_emit_uint(ba, WasmInstrMemCopy);
+    ba_add(ba, 0); //to memory 0
+    ba_add(ba, 0); //from memory 0
+}
+
+void wasm_emit_memory_fill(WasmModule ba)
+{
+    ba_add(ba, WasmInstrMemOp);
+    wasm_emit_uint(ba, WasmInstrMemFill);
+    ba_add(ba, 0); //memory 0
+}
+
 void wasm_emit_copy_scalar_value(WasmModule ba, u32 to_var_index, u32 to_offset, u32 from_var_index, u32 from_offset, u32 align, enum type type)
 {
     wasm_emit_get_var(ba, to_var_index, false); 
@@ -214,6 +302,15 @@ void wasm_emit_copy_struct_value(struct type_context *tc, WasmModule ba, u32 to_
     struct type_item *field_type;
     u32 field_offset;
     struct type_size_info tsi = get_type_size_info(tc, type);
+    u32 size = (u32)(tsi.width_bits / 8);
+    if (size >= WASM_BULK_COPY_MIN_SIZE) {
+        //one memory.copy is smaller and faster than a load and store per field
+        _emit_address(ba, to_var_index, to_offset);
+        _emit_address(ba, from_var_index, from_offset);
+        wasm_emit_const_i32(ba, size);
+        wasm_emit_memory_copy(ba);
+        return;
+    }
     for (u32 i = 0; i < array_size(&type->args); i++) {
         field_type = array_get_ptr(&type->args, i);
         field_offset = *(u64*)array_get(&tsi.sl->field_offsets, i) / 8;
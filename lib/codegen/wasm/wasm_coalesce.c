@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * local variable coalescing of the wasm IR. liveness of the locals is solved over the basic
+ * blocks of the structured control flow, locals of one type which are never live at the same
+ * time share one slot, and the slots are declared grouped by type.
+ */
+#include "codegen/wasm/wasm_pass.h"
+#include "codegen/wasm/wasm-core.h"
+#include "clib/util.h"
+#include <string.h>
+
+//the interference matrix is quadratic in the number of locals, larger functions are left as they are
+#define MAX_COALESCE_LOCALS 4096
+
+struct basic_block {
+    u32 start;
+    u32 end; //the last instruction in the block
+    u32 succs[2];
+    u32 succ_count;
+    u32 targets; //index of the br_table successors in the target array, succ_count of them
+};
+
+#define NO_BLOCK 0xFFFFFFFF
+
+struct liveness {
+    struct wasm_function_ir *fun;
+    u32 locals;
+    u32 words; //u64 words of a local set
+    struct array blocks; //struct basic_block
+    struct array targets; //u32 basic blocks targeted by br_table
+    u32 *block_of; //basic block starting at each instruction, NO_BLOCK if none starts there
+    u64 *uses; //per block: locals read before written in the block
+    u64 *defs; //per block: locals written in the block
+    u64 *live_in;
+    u64 *live_out;
+};
+
+static bool _test(u64 *set, u32 i)
+{
+    return (set[i >> 6] >> (i & 63)) & 1;
+}
+
+static void _add(u64 *set, u32 i)
+{
+    set[i >> 6] |= (u64)1 << (i & 63);
+}
+
+static void _remove(u64 *set, u32 i)
+{
+    set[i >> 6] &= ~((u64)1 << (i & 63));
+}
+
+static bool _is_control(u8 opcode)
+{
+    switch (opcode) {
+    case WasmInstrControlBlock:
+    case WasmInstrControlLoop:
+    case WasmInstrControlIf:
+    case WasmInstrControlElse:
+    case WasmInstrControlEnd:
+    case WasmInstrControlBr:
+    case WasmInstrControlBrIf:
+    case WasmInstrControlBrTable:
+    case WasmInstrControlReturn:
+    case WasmInstrControlUnreachable:
+        return true;
+    }
+    return false;
+}
+
+static bool _is_local_access(struct wasm_instr *ins)
+{
+    return ins->opcode == WasmInstrVarLocalGet || ins->opcode == WasmInstrVarLocalSet || ins->opcode == WasmInstrVarLocalTee;
+}
+
+//the basic block control continues in after the instruction at index, NO_BLOCK for the function exit
+static u32 _block_after(struct liveness *lv, u32 index)
+{
+    return index + 1 < wasm_ir_size(lv->fun) ? lv->block_of[index + 1] : NO_BLOCK;
+}
+
+//the basic block a branch with label continues in, frames are the enclosing block, loop and if
+static u32 _branch_target(struct liveness *lv, struct array *frames, u32 label)
+{
+    u32 depth = array_size(frames);
+    if (label >= depth)
+        return NO_BLOCK;
+    u32 start = array_get_u32(frames, depth - 1 - label);
+    struct wasm_instr *ins = wasm_ir_at(lv->fun, start);
+    if (ins->opcode == WasmInstrControlLoop)
+        return _block_after(lv, start);
+    //the end of if is linked through its else
+    u32 end = ins->match;
+    if (wasm_ir_at(lv->fun, end)->opcode == WasmInstrControlElse)
+        end = wasm_ir_at(lv->fun, end)->match;
+    return _block_after(lv, end);
+}
+
+static void _add_succ(struct basic_block *bb, u32 succ)
+{
+    if (succ != NO_BLOCK)
+        bb->succs[bb->succ_count++] = succ;
+}
+
+static void _build_blocks(struct liveness *lv)
+{
+    struct wasm_function_ir *fun = lv->fun;
+    u32 size = wasm_ir_size(fun);
+    for (u32 i = 0; i < size; i++) {
+        lv->block_of[i] = NO_BLOCK;
+    }
+    for (u32 i = 0; i < size;) {
+        struct basic_block bb;
+        memset(&bb, 0, sizeof(bb));
+        bb.start = i;
+        while (i + 1 < size && !_is_control(wasm_ir_at(fun, i)->opcode))
+            i++;
+        bb.end = i++;
+        lv->block_of[bb.start] = array_size(&lv->blocks);
+        array_push(&lv->blocks, &bb);
+    }
+    struct array frames;
+    array_init(&frames, sizeof(u32));
+    for (u32 b = 0; b < array_size(&lv->blocks); b++) {
+        struct basic_block *bb = array_get(&lv->blocks, b);
+        struct wasm_instr *ins = wasm_ir_at(fun, bb->end);
+        switch (ins->opcode) {
+        case WasmInstrControlBlock:
+        case WasmInstrControlLoop:
+            array_push_u32(&frames, bb->end);
+            _add_succ(bb, _block_after(lv, bb->end));
+            break;
+        case WasmInstrControlIf: {
+            array_push_u32(&frames, bb->end);
+            _add_succ(bb, _block_after(lv, bb->end));
+            //the else branch, or after the end if there is none
+            _add_succ(bb, _block_after(lv, ins->match));
+            break;
+        }
+        case WasmInstrControlElse:
+            //end of the then branch
+            _add_succ(bb, _block_after(lv, ins->match));
+            break;
+        case WasmInstrControlEnd:
+            if (array_size(&frames))
+                array_pop(&frames);
+            _add_succ(bb, _block_after(lv, bb->end));
+            break;
+        case WasmInstrControlBr:
+            _add_succ(bb, _branch_target(lv, &frames, (u32)ins->value));
+            break;
+        case WasmInstrControlBrIf:
+            _add_succ(bb, _branch_target(lv, &frames, (u32)ins->value));
+            _add_succ(bb, _block_after(lv, bb->end));
+            break;
+        case WasmInstrControlBrTable:
+            bb->targets = array_size(&lv->targets);
+            for (u32 l = 0; l <= ins->value; l++) {
+                u32 target = _branch_target(lv, &frames, wasm_ir_label(fun, ins, l));
+                if (target != NO_BLOCK) {
+                    array_push_u32(&lv->targets, target);
+                    bb->succ_count++;
+                }
+            }
+            break;
+        case WasmInstrControlReturn:
+        case WasmInstrControlUnreachable:
+            break;
+        default:
+            //the last block ending at the end of the function
+            _add_succ(bb, _block_after(lv, bb->end));
+            break;
+        }
+    }
+    array_deinit(&frames);
+}
+
+static u32 _succ(struct liveness *lv, struct basic_block *bb, u32 i)
+{
+    if (wasm_ir_at(lv->fun, bb->end)->opcode == WasmInstrControlBrTable)
+        return array_get_u32(&lv->targets, bb->targets + i);
+    return bb->succs[i];
+}
+
+static void _solve(struct liveness *lv)
+{
+    struct wasm_function_ir *fun = lv->fun;
+    u32 blocks = array_size(&lv->blocks);
+    for (u32 b = 0; b < blocks; b++) {
+        struct basic_block *bb = array_get(&lv->blocks, b);
+        u64 *uses = &lv->uses[b * lv->words], *defs = &lv->defs[b * lv->words];
+        for (u32 i = bb->start; i <= bb->end; i++) {
+            struct wasm_instr *ins = wasm_ir_at(fun, i);
+            if (!_is_local_access(ins) || ins->value < fun->params)
+                continue;
+            u32 local = (u32)ins->value - fun->params;
+            if (ins->opcode == WasmInstrVarLocalGet) {
+                if (!_test(defs, local))
+                    _add(uses, local);
+            } else {
+                _add(defs, local);
+            }
+        }
+    }
+    //blocks are visited backward until no live set changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (u32 b = blocks; b-- > 0;) {
+            struct basic_block *bb = array_get(&lv->blocks, b);
+            u64 *in = &lv->live_in[b * lv->words], *out = &lv->live_out[b * lv->words];
+            for (u32 s = 0; s < bb->succ_count; s++) {
+                u64 *succ_in = &lv->live_in[_succ(lv, bb, s) * lv->words];
+                for (u32 w = 0; w < lv->words; w++) {
+                    out[w] |= succ_in[w];
+                }
+            }
+            u64 *uses = &lv->uses[b * lv->words], *defs = &lv->defs[b * lv->words];
+            for (u32 w = 0; w < lv->words; w++) {
+                u64 live = uses[w] | (out[w] & ~defs[w]);
+                if (live != in[w]) {
+                    in[w] = live;
+                    changed = true;
+                }
+            }
+        }
+    }
+}
+
+//locals written while another one is live interfere, both can't share a slot
+static void _interfere(struct liveness *lv, u64 *matrix, u64 *live)
+{
+    struct wasm_function_ir *fun = lv->fun;
+    for (u32 b = 0; b < array_size(&lv->blocks); b++) {
+        struct basic_block *bb = array_get(&lv->blocks, b);
+        memcpy(live, &lv->live_out[b * lv->words], lv->words * sizeof(u64));
+        for (u32 i = bb->end + 1; i-- > bb->start;) {
+            struct wasm_instr *ins = wasm_ir_at(fun, i);
+            if (!_is_local_access(ins) || ins->value < fun->params)
+                continue;
+            u32 local = (u32)ins->value - fun->params;
+            if (ins->opcode == WasmInstrVarLocalGet) {
+                _add(live, local);
+                continue;
+            }
+            _remove(live, local);
+            u64 *row = &matrix[local * lv->words];
+            for (u32 w = 0; w < lv->words; w++) {
+                row[w] |= live[w];
+            }
+        }
+    }
+    //a local interferes with the ones written while it is live too
+    for (u32 local = 0; local < lv->locals; local++) {
+        u64 *row = &matrix[local * lv->words];
+        for (u32 other = 0; other < lv->locals; other++) {
+            if (_test(row, other))
+                _add(&matrix[other * lv->words], local);
+        }
+    }
+}
+
+bool wasm_coalesce_locals(struct wasm_function_ir *fun)
+{
+    u32 locals = array_size(&fun->locals);
+    if (locals < 2 || locals > MAX_COALESCE_LOCALS)
+        return false;
+    struct liveness lv;
+    lv.fun = fun;
+    lv.locals = locals;
+    lv.words = (locals + 63) / 64;
+    array_init(&lv.blocks, sizeof(struct basic_block));
+    array_init(&lv.targets, sizeof(u32));
+    MALLOC(lv.block_of, wasm_ir_size(fun) * sizeof(u32));
+    _build_blocks(&lv);
+    u32 blocks = array_size(&lv.blocks);
+    u32 set_words = blocks * lv.words;
+    CALLOC(lv.uses, set_words * 4, sizeof(u64));
+    lv.defs = lv.uses + set_words;
+    lv.live_in = lv.defs + set_words;
+    lv.live_out = lv.live_in + set_words;
+    _solve(&lv);
+
+    u64 *matrix, *slot_matrix, *live;
+    CALLOC(matrix, (size_t)locals * lv.words, sizeof(u64));
+    CALLOC(slot_matrix, (size_t)locals * lv.words, sizeof(u64));
+    CALLOC(live, lv.words, sizeof(u64));
+    _interfere(&lv, matrix, live);
+
+    //locals live at the entry read their zero initial value, they are kept in their own slot
+    u64 *entry = lv.live_in;
+    u32 *slot_of, slots = 0;
+    u8 *slot_types;
+    MALLOC(slot_of, locals * sizeof(u32));
+    MALLOC(slot_types, locals);
+    for (u32 local = 0; local < locals; local++) {
+        u8 type = wasm_ir_local_type(fun, local);
+        u32 slot = slots;
+        if (!_test(entry, local)) {
+            for (u32 s = 0; s < slots; s++) {
+                if (slot_types[s] == type && !_test(&slot_matrix[s * lv.words], local)) {
+                    slot = s;
+                    break;
+                }
+            }
+        }
+        if (slot == slots) {
+            slot_types[slots++] = type;
+            //no other local shares a slot with a zero initialized one
+            if (_test(entry, local))
+                memset(&slot_matrix[slot * lv.words], 0xFF, lv.words * sizeof(u64));
+        }
+        slot_of[local] = slot;
+        u64 *row = &matrix[local * lv.words], *slot_row = &slot_matrix[slot * lv.words];
+        for (u32 w = 0; w < lv.words; w++) {
+            slot_row[w] |= row[w];
+        }
+    }
+
+    //the slots are ordered by type so the declarations group into one run per type
+    u32 *order;
+    MALLOC(order, slots * sizeof(u32));
+    for (u32 slot = 0; slot < slots; slot++) {
+        order[slot] = NO_BLOCK;
+    }
+    array_reset(&fun->locals);
+    for (u32 slot = 0; slot < slots; slot++) {
+        if (order[slot] != NO_BLOCK)
+            continue;
+        for (u32 same = slot; same < slots; same++) {
+            if (order[same] == NO_BLOCK && slot_types[same] == slot_types[slot]) {
+                order[same] = array_size(&fun->locals);
+                wasm_ir_add_local(fun, slot_types[same]);
+            }
+        }
+    }
+    bool changed = false;
+    for (u32 i = 0; i < wasm_ir_size(fun); i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        if (!_is_local_access(ins) || ins->value < fun->params)
+            continue;
+        u32 local = order[slot_of[ins->value - fun->params]];
+        changed |= local != ins->value - fun->params;
+        ins->value = fun->params + local;
+    }
+    changed |= slots < locals;
+    FREE(order);
+    FREE(slot_types);
+    FREE(slot_of);
+    FREE(live);
+    FREE(slot_matrix);
+    FREE(matrix);
+    FREE(lv.uses);
+    FREE(lv.block_of);
+    array_deinit(&lv.targets);
+    array_deinit(&lv.blocks);
+    return changed;
+}
@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * wasm IR of function bodies: decoding of the instructions emitted by cg_wasm, structured
+ * control flow links and the encoder to the binary format
+ */
+#include "codegen/wasm/wasm_ir.h"
+#include "codegen/wasm/wasm_api.h"
+#include "codegen/wasm/wasm-core.h"
+#include "clib/util.h"
+#include <assert.h>
+#include <string.h>
+
+void wasm_ir_init(struct wasm_function_ir *fun)
+{
+    fun->params = 0;
+    array_init(&fun->locals, sizeof(u8));
+    array_init(&fun->instrs, sizeof(struct wasm_instr));
+    array_init(&fun->labels, sizeof(u32));
+}
+
+void wasm_ir_deinit(struct wasm_function_ir *fun)
+{
+    array_deinit(&fun->locals);
+    array_deinit(&fun->instrs);
+    array_deinit(&fun->labels);
+}
+
+void wasm_ir_reset(struct wasm_function_ir *fun)
+{
+    fun->params = 0;
+    array_reset(&fun->locals);
+    array_reset(&fun->instrs);
+    array_reset(&fun->labels);
+}
+
+void wasm_ir_add_local(struct wasm_function_ir *fun, u8 value_type)
+{
+    array_push(&fun->locals, &value_type);
+}
+
+u8 wasm_ir_local_type(struct wasm_function_ir *fun, u32 local_index)
+{
+    return *(u8 *)array_get(&fun->locals, local_index);
+}
+
+u32 wasm_ir_size(struct wasm_function_ir *fun)
+{
+    return array_size(&fun->instrs);
+}
+
+struct wasm_instr *wasm_ir_at(struct wasm_function_ir *fun, u32 index)
+{
+    return array_get(&fun->instrs, index);
+}
+
+u32 wasm_ir_label(struct wasm_function_ir *fun, struct wasm_instr *br_table, u32 index)
+{
+    return array_get_u32(&fun->labels, br_table->labels + index);
+}
+
+void wasm_ir_set_label(struct wasm_function_ir *fun, struct wasm_instr *br_table, u32 index, u32 label)
+{
+    array_set(&fun->labels, br_table->labels + index, &label);
+}
+
+bool wasm_ir_is_block_start(u8 opcode)
+{
+    return opcode == WasmInstrControlBlock || opcode == WasmInstrControlLoop || opcode == WasmInstrControlIf;
+}
+
+static bool _is_memory_access(u8 opcode)
+{
+    return opcode >= WasmInstrMemI32Load && opcode <= WasmInstrMemI64Store32;
+}
+
+static bool _is_numeric(u8 opcode)
+{
+    return opcode >= WasmInstrNumI32EQZ && opcode <= WasmInstrNumI64EXTEND32S;
+}
+
+static u32 _read_uint(const u8 *code, u32 *pos)
+{
+    u32 n;
+    u32 value = (u32)wasm_read_uint(&code[*pos], &n);
+    *pos += n;
+    return value;
+}
+
+static u64 _read_le_bytes(const u8 *code, u32 *pos, u32 size)
+{
+    u64 bits = 0;
+    for (u32 i = 0; i < size; i++) {
+        bits |= (u64)code[*pos + i] << (i * 8);
+    }
+    *pos += size;
+    return bits;
+}
+
+//0xFC prefixed instructions
+static bool _decode_prefixed(struct wasm_instr *ins, const u8 *code, u32 *pos)
+{
+    ins->sub = _read_uint(code, pos);
+    switch (ins->sub) {
+    case 0: case 1: case 2: case 3: case 4: case 5: case 6: case 7: //saturating truncations
+        return true;
+    case 8: //memory.init dataidx 0x00
+        ins->value = _read_uint(code, pos);
+        ins->extra = code[(*pos)++];
+        return true;
+    case 9: //data.drop dataidx
+    case 13: //elem.drop elemidx
+    case 15: //table.grow tableidx
+    case 16: //table.size tableidx
+    case 17: //table.fill tableidx
+        ins->value = _read_uint(code, pos);
+        return true;
+    case 10: //memory.copy 0x00 0x00
+        ins->value = code[(*pos)++];
+        ins->extra = code[(*pos)++];
+        return true;
+    case 11: //memory.fill 0x00
+        ins->value = code[(*pos)++];
+        return true;
+    case 12: //table.init elemidx tableidx
+    case 14: //table.copy tableidx tableidx
+        ins->value = _read_uint(code, pos);
+        ins->extra = _read_uint(code, pos);
+        return true;
+    }
+    return false;
+}
+
+static bool _is_vector_memory_access(u32 sub)
+{
+    return sub <= WasmInstrVecV128Store || sub == WasmInstrVecV128Load32Zero || sub == WasmInstrVecV128Load64Zero;
+}
+
+static bool _is_vector_lane_access(u32 sub)
+{
+    return sub >= WasmInstrVecI8x16ExtractLaneS && sub <= WasmInstrVecF64x2ReplaceLane;
+}
+
+//0xFD prefixed instructions, the lane accesses of memory are not known
+static bool _decode_vector(struct wasm_function_ir *fun, struct wasm_instr *ins, const u8 *code, u32 *pos)
+{
+    ins->sub = _read_uint(code, pos);
+    if (_is_vector_memory_access(ins->sub)) {
+        ins->value = _read_uint(code, pos);
+        ins->extra = _read_uint(code, pos);
+    } else if (ins->sub == WasmInstrVecV128Const || ins->sub == WasmInstrVecI8x16Shuffle) {
+        ins->labels = array_size(&fun->labels);
+        for (u32 i = 0; i < 4; i++) {
+            array_push_u32(&fun->labels, (u32)_read_le_bytes(code, pos, 4));
+        }
+    } else if (_is_vector_lane_access(ins->sub)) {
+        ins->value = code[(*pos)++];
+    } else if (ins->sub >= WasmInstrVecV128Load8Lane && ins->sub <= WasmInstrVecV128Store64Lane) {
+        return false;
+    }
+    return ins->sub <= 0xFF;
+}
+
+bool wasm_ir_decode(struct wasm_function_ir *fun, const u8 *code, u32 size)
+{
+    u32 pos = 0, n;
+    while (pos < size) {
+        struct wasm_instr ins;
+        memset(&ins, 0, sizeof(ins));
+        ins.match = WASM_IR_NO_MATCH;
+        ins.opcode = code[pos++];
+        switch (ins.opcode) {
+        case WasmInstrControlBlock:
+        case WasmInstrControlLoop:
+        case WasmInstrControlIf:
+            if (code[pos] == WasmTypeVoid || (code[pos] >= WasmTypeExternRef && code[pos] <= WasmTypeI32)) {
+                ins.value = code[pos++];
+            } else { //type index
+                ins.value = wasm_read_int(&code[pos], &n);
+                pos += n;
+            }
+            break;
+        case WasmInstrControlUnreachable:
+        case WasmInstrControlNop:
+        case WasmInstrControlElse:
+        case WasmInstrControlEnd:
+        case WasmInstrControlReturn:
+        case WasmInstrRefDrop:
+        case WasmInstrRefSelect:
+            break;
+        case WasmInstrControlBr:
+        case WasmInstrControlBrIf:
+        case WasmInstrControlCall:
+        case WasmInstrVarLocalGet:
+        case WasmInstrVarLocalSet:
+        case WasmInstrVarLocalTee:
+        case WasmInstrVarGlobalGet:
+        case WasmInstrVarGlobalSet:
+        case WasmInstrTableGet:
+        case WasmInstrTableSet:
+            ins.value = _read_uint(code, &pos);
+            break;
+        case WasmInstrControlBrTable:
+            ins.value = _read_uint(code, &pos);
+            ins.labels = array_size(&fun->labels);
+            for (u32 i = 0; i <= ins.value; i++) {
+                array_push_u32(&fun->labels, _read_uint(code, &pos));
+            }
+            break;
+        case WasmInstrControlCallInd:
+            ins.value = _read_uint(code, &pos);
+            ins.extra = _read_uint(code, &pos);
+            break;
+        case WasmInstrMemSize:
+        case WasmInstrMemGrow:
+            ins.value = code[pos++];
+            break;
+        case WasmInstrNumI32Const:
+        case WasmInstrNumI64Const:
+            ins.value = wasm_read_int(&code[pos], &n);
+            pos += n;
+            break;
+        case WasmInstrNumF32Const:
+            ins.value = (i64)_read_le_bytes(code, &pos, 4);
+            break;
+        case WasmInstrNumF64Const:
+            ins.value = (i64)_read_le_bytes(code, &pos, 8);
+            break;
+        case WasmInstrMemOp:
+            if (!_decode_prefixed(&ins, code, &pos))
+                return false;
+            break;
+        case WasmInstrVecOp:
+            if (!_decode_vector(fun, &ins, code, &pos))
+                return false;
+            break;
+        default:
+            if (_is_memory_access(ins.opcode)) {
+                ins.value = _read_uint(code, &pos);
+                ins.extra = _read_uint(code, &pos);
+            } else if (!_is_numeric(ins.opcode)) {
+                return false;
+            }
+            break;
+        }
+        array_push(&fun->instrs, &ins);
+    }
+    return pos == size;
+}
+
+bool wasm_ir_link(struct wasm_function_ir *fun)
+{
+    struct array starts;
+    array_init(&starts, sizeof(u32));
+    bool balanced = true;
+    u32 size = wasm_ir_size(fun);
+    for (u32 i = 0; i < size; i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        ins->match = WASM_IR_NO_MATCH;
+        if (wasm_ir_is_block_start(ins->opcode)) {
+            array_push_u32(&starts, i);
+        } else if (ins->opcode == WasmInstrControlElse) {
+            if (!array_size(&starts)) {
+                balanced = false;
+                break;
+            }
+            //the if is linked to the else, the else takes its place to be linked to the end
+            u32 *start = array_back(&starts);
+            wasm_ir_at(fun, *start)->match = i;
+            *start = i;
+        } else if (ins->opcode == WasmInstrControlEnd) {
+            if (!array_size(&starts)) {
+                //the end of the function
+                balanced = i == size - 1;
+                break;
+            }
+            u32 start = array_pop_u32(&starts);
+            wasm_ir_at(fun, start)->match = i;
+            ins->match = start;
+        }
+    }
+    balanced = balanced && !array_size(&starts);
+    array_deinit(&starts);
+    return balanced;
+}
+
+static void _encode_le_bytes(struct byte_array *ba, u64 bits, u32 size)
+{
+    for (u32 i = 0; i < size; i++) {
+        ba_add(ba, 0xFF & (bits >> (i * 8)));
+    }
+}
+
+void wasm_ir_encode_instr(struct wasm_function_ir *fun, struct wasm_instr *ins, struct byte_array *ba)
+{
+    ba_add(ba, ins->opcode);
+    switch (ins->opcode) {
+    case WasmInstrControlBlock:
+    case WasmInstrControlLoop:
+    case WasmInstrControlIf:
+        if (ins->value == WasmTypeVoid || (ins->value >= WasmTypeExternRef && ins->value <= WasmTypeI32))
+            ba_add(ba, (u8)ins->value);
+        else
+            wasm_emit_int(ba, ins->value);
+        break;
+    case WasmInstrControlBr:
+    case WasmInstrControlBrIf:
+    case WasmInstrControlCall:
+    case WasmInstrVarLocalGet:
+    case WasmInstrVarLocalSet:
+    case WasmInstrVarLocalTee:
+    case WasmInstrVarGlobalGet:
+    case WasmInstrVarGlobalSet:
+    case WasmInstrTableGet:
+    case WasmInstrTableSet:
+        wasm_emit_uint(ba, (u64)ins->value);
+        break;
+    case WasmInstrControlBrTable:
+        wasm_emit_uint(ba, (u64)ins->value);
+        for (u32 i = 0; i <= ins->value; i++) {
+            wasm_emit_uint(ba, wasm_ir_label(fun, ins, i));
+        }
+        break;
+    case WasmInstrControlCallInd:
+        wasm_emit_uint(ba, (u64)ins->value);
+        wasm_emit_uint(ba, ins->extra);
+        break;
+    case WasmInstrMemSize:
+    case WasmInstrMemGrow:
+        ba_add(ba, (u8)ins->value);
+        break;
+    case WasmInstrNumI32Const:
+    case WasmInstrNumI64Const:
+        wasm_emit_int(ba, ins->value);
+        break;
+    case WasmInstrNumF32Const:
+        _encode_le_bytes(ba, (u64)ins->value, 4);
+        break;
+    case WasmInstrNumF64Const:
+        _encode_le_bytes(ba, (u64)ins->value, 8);
+        break;
+    case WasmInstrMemOp:
+        wasm_emit_uint(ba, ins->sub);
+        switch (ins->sub) {
+        case 8:
+            wasm_emit_uint(ba, (u64)ins->value);
+            ba_add(ba, (u8)ins->extra);
+            break;
+        case 9: case 13: case 15: case 16: case 17:
+            wasm_emit_uint(ba, (u64)ins->value);
+            break;
+        case 10:
+            ba_add(ba, (u8)ins->value);
+            ba_add(ba, (u8)ins->extra);
+            break;
+        case 11:
+            ba_add(ba, (u8)ins->value);
+            break;
+        case 12: case 14:
+            wasm_emit_uint(ba, (u64)ins->value);
+            wasm_emit_uint(ba, ins->extra);
+            break;
+        }
+        break;
+    case WasmInstrVecOp:
+        wasm_emit_uint(ba, ins->sub);
+        if (_is_vector_memory_access(ins->sub)) {
+            wasm_emit_uint(ba, (u64)ins->value);
+            wasm_emit_uint(ba, ins->extra);
+        } else if (ins->sub == WasmInstrVecV128Const || ins->sub == WasmInstrVecI8x16Shuffle) {
+            for (u32 i = 0; i < 4; i++) {
+                _encode_le_bytes(ba, wasm_ir_label(fun, ins, i), 4);
+            }
+        } else if (_is_vector_lane_access(ins->sub)) {
+            ba_add(ba, (u8)ins->value);
+        }
+        break;
+    default:
+        if (_is_memory_access(ins->opcode)) {
+            wasm_emit_uint(ba, (u64)ins->value);
+            wasm_emit_uint(ba, ins->extra);
+        }
+        break;
+    }
+}
+
+void wasm_ir_encode(struct wasm_function_ir *fun, struct byte_array *ba)
+{
+    u32 locals = array_size(&fun->locals);
+    u32 runs = 0;
+    for (u32 i = 0; i < locals; i++) {
+        runs += !i || wasm_ir_local_type(fun, i) != wasm_ir_local_type(fun, i - 1);
+    }
+    wasm_emit_uint(ba, runs); // num local declarations
+    for (u32 i = 0; i < locals;) {
+        u8 type = wasm_ir_local_type(fun, i);
+        u32 run = 1;
+        while (i + run < locals && wasm_ir_local_type(fun, i + run) == type)
+            run++;
+        wasm_emit_uint(ba, run); // num locals of the type
+        ba_add(ba, type);
+        i += run;
+    }
+    u32 size = wasm_ir_size(fun);
+    for (u32 i = 0; i < size; i++) {
+        wasm_ir_encode_instr(fun, wasm_ir_at(fun, i), ba);
+    }
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * pass manager of the wasm IR and the passes cleaning up structured control flow
+ */
+#include "codegen/wasm/wasm_pass.h"
+#include "codegen/wasm/wasm_peephole.h"
+#include "codegen/wasm/wasm-core.h"
+#include "clib/util.h"
+
+static struct wasm_pass passes[] = {
+    { "remove-unreachable", 1, wasm_remove_unreachable },
+    { "unwrap-blocks", 1, wasm_unwrap_blocks },
+    { "coalesce-locals", 1, wasm_coalesce_locals },
+    { "peephole", 1, wasm_peephole },
+};
+
+//branch frame of a block, loop or if
+struct wasm_frame {
+    u32 index;
+    bool is_targeted;
+    bool is_removed;
+};
+
+static bool _is_unconditional_jump(u8 opcode)
+{
+    return opcode == WasmInstrControlBr || opcode == WasmInstrControlBrTable ||
+           opcode == WasmInstrControlReturn || opcode == WasmInstrControlUnreachable;
+}
+
+bool wasm_remove_unreachable(struct wasm_function_ir *fun)
+{
+    u32 size = wasm_ir_size(fun);
+    u32 live = 0;
+    for (u32 i = 0; i < size; i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        if (live != i)
+            array_set(&fun->instrs, live, ins);
+        live++;
+        if (!_is_unconditional_jump(ins->opcode))
+            continue;
+        u32 depth = 0;
+        for (; i + 1 < size; i++) {
+            struct wasm_instr *next = wasm_ir_at(fun, i + 1);
+            if (wasm_ir_is_block_start(next->opcode)) {
+                depth++;
+            } else if (next->opcode == WasmInstrControlEnd || next->opcode == WasmInstrControlElse) {
+                if (!depth)
+                    break;
+                if (next->opcode == WasmInstrControlEnd)
+                    depth--;
+            }
+        }
+    }
+    fun->instrs.base.size = live;
+    return live != size;
+}
+
+static void _target_label(struct array *frames, u32 label)
+{
+    u32 depth = array_size(frames);
+    if (label < depth) { //otherwise the function body is the target
+        struct wasm_frame *frame = array_get(frames, depth - 1 - label);
+        frame->is_targeted = true;
+    }
+}
+
+//the label with the removed blocks between the branch and its target left out
+static u32 _adjust_label(struct array *frames, u32 label)
+{
+    u32 depth = array_size(frames);
+    u32 inner = label < depth ? label : depth;
+    u32 removed = 0;
+    for (u32 i = 0; i < inner; i++) {
+        struct wasm_frame *frame = array_get(frames, depth - 1 - i);
+        removed += frame->is_removed;
+    }
+    return label - removed;
+}
+
+//the blocks are removed as nops, which are dropped with any other nop
+static void _remove_nops(struct wasm_function_ir *fun)
+{
+    u32 size = wasm_ir_size(fun);
+    u32 live = 0;
+    for (u32 i = 0; i < size; i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        if (ins->opcode == WasmInstrControlNop)
+            continue;
+        if (live != i)
+            array_set(&fun->instrs, live, ins);
+        live++;
+    }
+    fun->instrs.base.size = live;
+}
+
+/*
+ * a void block is only needed as a branch target, e.g. the body block of loops is the target of
+ * continue. blocks without any branch to them are unwrapped
+ */
+bool wasm_unwrap_blocks(struct wasm_function_ir *fun)
+{
+    struct array frames;
+    array_init(&frames, sizeof(struct wasm_frame));
+    u32 size = wasm_ir_size(fun);
+    u32 removed = 0;
+    for (u32 i = 0; i < size; i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        if (wasm_ir_is_block_start(ins->opcode)) {
+            struct wasm_frame frame = { i, false, false };
+            array_push(&frames, &frame);
+        } else if (ins->opcode == WasmInstrControlBr || ins->opcode == WasmInstrControlBrIf) {
+            _target_label(&frames, (u32)ins->value);
+        } else if (ins->opcode == WasmInstrControlBrTable) {
+            for (u32 l = 0; l <= ins->value; l++) {
+                _target_label(&frames, wasm_ir_label(fun, ins, l));
+            }
+        } else if (ins->opcode == WasmInstrControlEnd && array_size(&frames)) {
+            struct wasm_frame *frame = array_pop(&frames);
+            struct wasm_instr *block = wasm_ir_at(fun, frame->index);
+            if (block->opcode == WasmInstrControlBlock && block->value == WasmTypeVoid && !frame->is_targeted) {
+                block->match = WASM_IR_NO_MATCH;
+                removed++;
+            }
+        }
+    }
+    if (!removed) {
+        array_deinit(&frames);
+        return false;
+    }
+    //labels are adjusted before the removed blocks and their ends are turned into nops
+    array_reset(&frames);
+    for (u32 i = 0; i < size; i++) {
+        struct wasm_instr *ins = wasm_ir_at(fun, i);
+        if (wasm_ir_is_block_start(ins->opcode)) {
+            bool is_removed = ins->opcode == WasmInstrControlBlock && ins->match == WASM_IR_NO_MATCH;
+            struct wasm_frame frame = { i, true, is_removed };
+            array_push(&frames, &frame);
+        } else if (ins->opcode == WasmInstrControlEnd) {
+            if (array_size(&frames)) {
+                struct wasm_frame *frame = array_pop(&frames);
+                if (frame->is_removed) {
+                    wasm_ir_at(fun, frame->index)->opcode = WasmInstrControlNop;
+                    ins->opcode = WasmInstrControlNop;
+                }
+            }
+        } else if (ins->opcode == WasmInstrControlBr || ins->opcode == WasmInstrControlBrIf) {
+            ins->value = _adjust_label(&frames, (u32)ins->value);
+        } else if (ins->opcode == WasmInstrControlBrTable) {
+            for (u32 l = 0; l <= ins->value; l++) {
+                wasm_ir_set_label(fun, ins, l, _adjust_label(&frames, wasm_ir_label(fun, ins, l)));
+            }
+        }
+    }
+    array_deinit(&frames);
+    _remove_nops(fun);
+    return true;
+}
+
+void wasm_run_passes(struct wasm_function_ir *fun, u32 opt_level)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(passes); i++) {
+        struct wasm_pass *pass = &passes[i];
+        if (pass->opt_level > opt_level)
+            continue;
+        if (pass->run(fun))
+            wasm_ir_link(fun);
+    }
+}
@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * peephole optimizer of the wasm IR. instructions are appended to the live prefix of the
+ * function one at a time, and short sequences at its tail are rewritten as they form.
+ */
+#include "codegen/wasm/wasm_peephole.h"
+#include "codegen/wasm/wasm-core.h"
+#include "clib/util.h"
+
+//the rewritten instructions, a prefix of the instructions of the function
+struct wasm_tail {
+    struct wasm_instr *instrs;
+    u32 size;
+};
+
+//push one value without side effects
+static bool _is_pure_push(u8 opcode)
+{
+    return opcode == WasmInstrVarLocalGet || opcode == WasmInstrVarGlobalGet ||
+           opcode == WasmInstrNumI32Const || opcode == WasmInstrNumI64Const ||
+           opcode == WasmInstrNumF32Const || opcode == WasmInstrNumF64Const;
+}
+
+//the comparison giving the negated result, 0 if there is none
+static u8 _inverse_comparison(u8 opcode)
+{
+    switch (opcode) {
+    case WasmInstrNumI32EQ: return WasmInstrNumI32NE;
+    case WasmInstrNumI32NE: return WasmInstrNumI32EQ;
+    case WasmInstrNumI32LTS: return WasmInstrNumI32GES;
+    case WasmInstrNumI32LTU: return WasmInstrNumI32GEU;
+    case WasmInstrNumI32GTS: return WasmInstrNumI32LES;
+    case WasmInstrNumI32GTU: return WasmInstrNumI32LEU;
+    case WasmInstrNumI32LES: return WasmInstrNumI32GTS;
+    case WasmInstrNumI32LEU: return WasmInstrNumI32GTU;
+    case WasmInstrNumI32GES: return WasmInstrNumI32LTS;
+    case WasmInstrNumI32GEU: return WasmInstrNumI32LTU;
+    case WasmInstrNumI64EQ: return WasmInstrNumI64NE;
+    case WasmInstrNumI64NE: return WasmInstrNumI64EQ;
+    case WasmInstrNumI64LTS: return WasmInstrNumI64GES;
+    case WasmInstrNumI64LTU: return WasmInstrNumI64GEU;
+    case WasmInstrNumI64GTS: return WasmInstrNumI64LES;
+    case WasmInstrNumI64GTU: return WasmInstrNumI64LEU;
+    case WasmInstrNumI64LES: return WasmInstrNumI64GTS;
+    case WasmInstrNumI64LEU: return WasmInstrNumI64GTU;
+    case WasmInstrNumI64GES: return WasmInstrNumI64LTS;
+    case WasmInstrNumI64GEU: return WasmInstrNumI64LTU;
+    //float ordering is not inverted, any comparison with NaN is false
+    case WasmInstrNumF32EQ: return WasmInstrNumF32NE;
+    case WasmInstrNumF32NE: return WasmInstrNumF32EQ;
+    case WasmInstrNumF64EQ: return WasmInstrNumF64NE;
+    case WasmInstrNumF64NE: return WasmInstrNumF64EQ;
+    }
+    return 0;
+}
+
+//x op c is x
+static bool _is_identity(u8 opcode, i32 c)
+{
+    switch (opcode) {
+    case WasmInstrNumI32ADD:
+    case WasmInstrNumI32SUB:
+    case WasmInstrNumI32OR:
+    case WasmInstrNumI32XOR:
+    case WasmInstrNumI32SHL:
+    case WasmInstrNumI32SHRS:
+    case WasmInstrNumI32SHRU:
+        return c == 0;
+    case WasmInstrNumI32MUL:
+    case WasmInstrNumI32DIVS:
+    case WasmInstrNumI32DIVU:
+        return c == 1;
+    }
+    return false;
+}
+
+//i32 operations folded with the wrapping semantics of wasm, divisions are left as they may trap
+static bool _fold_i32(u8 opcode, i32 a, i32 b, i32 *result)
+{
+    u32 ua = (u32)a, ub = (u32)b;
+    switch (opcode) {
+    case WasmInstrNumI32ADD: *result = (i32)(ua + ub); break;
+    case WasmInstrNumI32SUB: *result = (i32)(ua - ub); break;
+    case WasmInstrNumI32MUL: *result = (i32)(ua * ub); break;
+    case WasmInstrNumI32AND: *result = a & b; break;
+    case WasmInstrNumI32OR: *result = a | b; break;
+    case WasmInstrNumI32XOR: *result = a ^ b; break;
+    case WasmInstrNumI32SHL: *result = (i32)(ua << (ub & 31)); break;
+    case WasmInstrNumI32SHRS: *result = a >> (ub & 31); break;
+    case WasmInstrNumI32SHRU: *result = (i32)(ua >> (ub & 31)); break;
+    case WasmInstrNumI32EQ: *result = a == b; break;
+    case WasmInstrNumI32NE: *result = a != b; break;
+    case WasmInstrNumI32LTS: *result = a < b; break;
+    case WasmInstrNumI32LTU: *result = ua < ub; break;
+    case WasmInstrNumI32GTS: *result = a > b; break;
+    case WasmInstrNumI32GTU: *result = ua > ub; break;
+    case WasmInstrNumI32LES: *result = a <= b; break;
+    case WasmInstrNumI32LEU: *result = ua <= ub; break;
+    case WasmInstrNumI32GES: *result = a >= b; break;
+    case WasmInstrNumI32GEU: *result = ua >= ub; break;
+    default: return false;
+    }
+    return true;
+}
+
+static struct wasm_instr *_tail(struct wasm_tail *out, u32 back)
+{
+    return back < out->size ? &out->instrs[out->size - 1 - back] : 0;
+}
+
+static void _set_i32_const(struct wasm_instr *ins, i32 value)
+{
+    ins->opcode = WasmInstrNumI32Const;
+    ins->value = value;
+}
+
+//rewrite the last instructions of out, returns true if anything changed
+static bool _rewrite_tail(struct wasm_tail *out)
+{
+    struct wasm_instr *last = _tail(out, 0), *prev = _tail(out, 1), *first = _tail(out, 2);
+    if (!last || !prev)
+        return false;
+    //local.set x, local.get x => local.tee x
+    if (last->opcode == WasmInstrVarLocalGet && prev->opcode == WasmInstrVarLocalSet && last->value == prev->value) {
+        prev->opcode = WasmInstrVarLocalTee;
+        out->size--;
+        return true;
+    }
+    //local.get x, local.set x is a copy of x to itself, left by coalesced locals
+    if (last->opcode == WasmInstrVarLocalSet && prev->opcode == WasmInstrVarLocalGet && last->value == prev->value) {
+        out->size -= 2;
+        return true;
+    }
+    if (last->opcode == WasmInstrVarLocalTee && prev->opcode == WasmInstrVarLocalGet && last->value == prev->value) {
+        out->size--;
+        return true;
+    }
+    if (last->opcode == WasmInstrRefDrop) {
+        if (prev->opcode == WasmInstrVarLocalTee) {
+            prev->opcode = WasmInstrVarLocalSet;
+            out->size--;
+            return true;
+        }
+        if (_is_pure_push(prev->opcode)) {
+            out->size -= 2;
+            return true;
+        }
+    }
+    if (prev->opcode == WasmInstrNumI32Const) {
+        i32 c = (i32)prev->value;
+        if (last->opcode == WasmInstrNumI32EQZ) {
+            _set_i32_const(prev, c == 0);
+            out->size--;
+            return true;
+        }
+        i32 result;
+        if (first && first->opcode == WasmInstrNumI32Const && _fold_i32(last->opcode, (i32)first->value, c, &result)) {
+            _set_i32_const(first, result);
+            out->size -= 2;
+            return true;
+        }
+        if (_is_identity(last->opcode, c)) {
+            out->size -= 2;
+            return true;
+        }
+    }
+    //negated comparison => inverse comparison
+    if (last->opcode == WasmInstrNumI32EQZ) {
+        u8 inverse = _inverse_comparison(prev->opcode);
+        if (inverse) {
+            prev->opcode = inverse;
+            out->size--;
+            return true;
+        }
+    }
+    //double negation of a condition
+    if ((last->opcode == WasmInstrControlBrIf || last->opcode == WasmInstrControlIf) && first &&
+        prev->opcode == WasmInstrNumI32EQZ && first->opcode == WasmInstrNumI32EQZ) {
+        *first = *last;
+        out->size -= 2;
+        return true;
+    }
+    return false;
+}
+
+bool wasm_peephole(struct wasm_function_ir *fun)
+{
+    u32 size = wasm_ir_size(fun);
+    struct wasm_tail out = { array_data(&fun->instrs), 0 };
+    for (u32 i = 0; i < size; i++) {
+        if (out.size != i)
+            out.instrs[out.size] = out.instrs[i];
+        out.size++;
+        while (_rewrite_tail(&out))
+            ;
+    }
+    fun->instrs.base.size = out.size;
+    return out.size != size;
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * on-disk cache of compiled modules: <dir>/<64 bit key in hex><ext>
+ */
+#include "compiler/compile_cache.h"
+#include "compiler/engine.h"
+#include "clib/hash.h"
+#include "clib/util.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+void _make_dir(const char *dir)
+{
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    mkdir(dir, 0755);
+#endif
+}
+
+bool _copy_file(const char *from, const char *to)
+{
+    FILE *in = fopen(from, "rb");
+    if (!in)
+        return false;
+    FILE *out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return false;
+    }
+    char buffer[64 * 1024];
+    size_t n;
+    bool ok = true;
+    while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        if (fwrite(buffer, 1, n, out) != n) {
+            ok = false;
+            break;
+        }
+    }
+    fclose(in);
+    ok = !fclose(out) && ok;
+    return ok;
+}
+
+void _artifact_path(struct compile_cache *cache, u64 key, const char *ext, string *path)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx", (unsigned long long)key);
+    string_init_chars(path, string_get(&cache->dir));
+    string_add_chars(path, name);
+    string_add_chars(path, ext);
+}
+
+void compile_cache_init(struct compile_cache *cache, const char *dir, struct sys_prelude *prelude)
+{
+    string_init_chars(&cache->dir, dir);
+    _make_dir(dir);
+    const char *version = engine_version();
+    cache->prelude_hash = hash64((unsigned char *)version, strlen(version));
+    //sum of the file hashes so that the order sys files are listed in does not matter
+    for (size_t i = 0; prelude && i < array_size(&prelude->codes); i++) {
+        string *code = array_get(&prelude->codes, i);
+        cache->prelude_hash += hash64((unsigned char *)string_get(code), string_size(code));
+    }
+    mutex_init(&cache->lock);
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->stores = 0;
+    cache->temps = 0;
+}
+
+void compile_cache_deinit(struct compile_cache *cache)
+{
+    mutex_deinit(&cache->lock);
+    string_deinit(&cache->dir);
+}
+
+void compile_cache_add_options(struct compile_cache *cache, const char *options)
+{
+    cache->prelude_hash += hash64((unsigned char *)options, strlen(options));
+}
+
+u64 _artifact_key(struct compile_cache *cache, u64 content_hash, const char *ext)
+{
+    return hash64((unsigned char *)ext, strlen(ext)) ^ (content_hash + cache->prelude_hash);
+}
+
+void _count_lookup(struct compile_cache *cache, bool hit)
+{
+    mutex_lock(&cache->lock);
+    if (hit)
+        cache->hits++;
+    else
+        cache->misses++;
+    mutex_unlock(&cache->lock);
+}
+
+bool compile_cache_fetch(struct compile_cache *cache, const char *source_file, const char *ext, const char *output_path, u64 *key)
+{
+    size_t size;
+    const char *text = map_text_file(source_file, &size);
+    if (!text)
+        return false;
+    u64 h = hash64((unsigned char *)text, size);
+    unmap_text_file(text, size);
+    h = _artifact_key(cache, h, ext);
+    *key = h;
+    string path;
+    _artifact_path(cache, h, ext, &path);
+    bool hit = _copy_file(string_get(&path), output_path);
+    string_deinit(&path);
+    _count_lookup(cache, hit);
+    return hit;
+}
+
+bool compile_cache_lookup(struct compile_cache *cache, u64 content_hash, const char *ext, string *path)
+{
+    _artifact_path(cache, _artifact_key(cache, content_hash, ext), ext, path);
+    struct stat st;
+    bool hit = !stat(string_get(path), &st);
+    _count_lookup(cache, hit);
+    return hit;
+}
+
+bool _write_file(const char *path, const char *data, size_t size)
+{
+    FILE *out = fopen(path, "wb");
+    if (!out)
+        return false;
+    bool ok = fwrite(data, 1, size, out) == size;
+    ok = !fclose(out) && ok;
+    return ok;
+}
+
+//the artifact is written by copying the file at from, or data when from is 0
+bool _store(struct compile_cache *cache, u64 key, const char *ext, const char *from, const char *data, size_t size)
+{
+    string path, tmp_path;
+    _artifact_path(cache, key, ext, &path);
+    //write under a unique name first so that a concurrent fetch never sees a partial artifact
+    string_init_chars(&tmp_path, string_get(&path));
+    //pid and a serial number of the cache: other processes and other jobs of this one write their own files
+    mutex_lock(&cache->lock);
+    size_t serial = cache->temps++;
+    mutex_unlock(&cache->lock);
+    char suffix[64];
+    snprintf(suffix, sizeof(suffix), ".%ld.%zu.tmp", (long)getpid(), serial);
+    string_add_chars(&tmp_path, suffix);
+    bool stored = from ? _copy_file(from, string_get(&tmp_path)) : _write_file(string_get(&tmp_path), data, size);
+    if (stored) {
+        remove(string_get(&path));
+        stored = !rename(string_get(&tmp_path), string_get(&path));
+    }
+    if (!stored)
+        remove(string_get(&tmp_path));
+    string_deinit(&tmp_path);
+    string_deinit(&path);
+    if (stored) {
+        mutex_lock(&cache->lock);
+        cache->stores++;
+        mutex_unlock(&cache->lock);
+    }
+    return stored;
+}
+
+bool compile_cache_store(struct compile_cache *cache, u64 key, const char *ext, const char *output_path)
+{
+    return _store(cache, key, ext, output_path, 0, 0);
+}
+
+bool compile_cache_store_data(struct compile_cache *cache, u64 content_hash, const char *ext, const char *data, size_t size)
+{
+    return _store(cache, _artifact_key(cache, content_hash, ext), ext, 0, data, size);
+}
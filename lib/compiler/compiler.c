@@ -5,6 +5,7 @@
  */
 #include "compiler/compiler.h"
 #include "clib/util.h"
+#include "clib/thread.h"
 #include "compiler/jit.h"
 #include "sema/analyzer.h"
 #include "sema/sema_context.h"
@@ -26,11 +27,7 @@ int gof_emit_file(LLVMModuleRef module, LLVMTargetMachineRef target_machine, con
 
 int gof_initialize(void)
 {
-    //LLVMInitializeCore(LLVMGetGlobalPassRegistry());
-
-    LLVMInitializeNativeTarget();
-    LLVMInitializeNativeAsmPrinter();
-    LLVMInitializeNativeAsmParser();
+    llvm_init_native_target();
     // InitializeAllTargetInfos();
     // InitializeAllTargets();
     // InitializeAllTargetMCs();
@@ -39,17 +36,12 @@ int gof_initialize(void)
     return 0;
 }
 
-int generate_object_file(LLVMModuleRef module, const char *filename)
+int generate_object_file(LLVMModuleRef module, LLVMTargetMachineRef target_machine, const char *filename)
 {
     gof_initialize();
-    LLVMTargetDataRef target_data = 0;
-    LLVMTargetMachineRef target_machine = create_target_machine(module, &target_data);
     if (!target_machine)
         return 1;
-    int result = gof_emit_file(module, target_machine, filename);
-    LLVMDisposeTargetMachine(target_machine);
-    LLVMDisposeTargetData(target_data);
-    return result;
+    return gof_emit_file(module, target_machine, filename);
 }
 
 int generate_bitcode_file(LLVMModuleRef module, const char *filename)
@@ -65,41 +57,186 @@ int generate_ir_file(LLVMModuleRef module, const char *filename)
     return 0;
 }
 
-int compile(const char *sys_path, const char *source_file, enum object_file_type file_type, const char *output_filepath)
+const char *_file_type_ext(enum object_file_type file_type)
+{
+    switch (file_type) {
+    case FT_OBJECT:
+        return ".o";
+    case FT_BITCODE:
+        return ".bc";
+    case FT_IR:
+        return ".ir";
+    default:
+        return 0;
+    }
+}
+
+int compile_prelude(struct sys_prelude *prelude, struct compile_job *job)
 {
+    const char *output_filepath = job->output_filepath;
+    const char *ext = _file_type_ext(job->file_type);
     string filename;
-    string_init_chars(&filename, source_file);
+    string_init_chars(&filename, job->source_file);
     string_substr(&filename, '.');
-    struct engine *engine = engine_llvm_new(sys_path, false);
+    time_report_init(&job->time_report);
+    job->result = 0;
+    job->cached = false;
+    u64 cache_key = 0;
+    if (job->cache && ext) {
+        string artifact;
+        string_init_chars(&artifact, string_get(&filename));
+        string_add_chars(&artifact, ext);
+        job->cached = compile_cache_fetch(job->cache, job->source_file, ext, output_filepath ? output_filepath : string_get(&artifact), &cache_key);
+        string_deinit(&artifact);
+        if (job->cached) {
+            string_deinit(&filename);
+            return 0;
+        }
+    }
+    struct time_report *report = &job->time_report;
+    time_report_begin(report, PHASE_FRONTEND);
+    struct engine *engine = engine_llvm_new_with_prelude(prelude, false);
     struct cg_llvm *cg = (struct cg_llvm*)engine->be->cg;
+    if (job->target)
+        cg->target_options = *job->target;
     create_ir_module(cg, string_get(&filename));
-    struct ast_node *block = parse_file(engine->fe->parser, source_file);
+    time_report_begin(report, PHASE_PARSE);
+    struct ast_node *block = parse_file(engine->fe->parser, job->source_file);
+    time_report_begin(report, PHASE_ANALYZE);
     analyze(cg->base.sema_context, block);
+    time_report_begin(report, PHASE_CODEGEN);
     emit_code(cg, block);
     if (block) {
         for (size_t i = 0; i < array_size(&block->block->nodes); i++) {
             struct ast_node *node = array_get_ptr(&block->block->nodes, i);
             emit_ir_code(cg, node);
         }
-        if (file_type == FT_OBJECT) {
-            string_add_chars(&filename, ".o");
-            if(!output_filepath) output_filepath = string_get(&filename);
-            generate_object_file(cg->module, output_filepath);
-        } else if (file_type == FT_BITCODE) {
-            string_add_chars(&filename, ".bc");
+        time_report_begin(report, PHASE_OPTIMIZE);
+        bool is_optimized = optimize_ir_module(cg);
+        time_report_begin(report, PHASE_EMIT);
+        if (ext) {
+            string_add_chars(&filename, ext);
             if(!output_filepath) output_filepath = string_get(&filename);
-            generate_bitcode_file(cg->module, output_filepath);
-        } else if (file_type == FT_IR) {
-            string_add_chars(&filename, ".ir");
-            if(!output_filepath) output_filepath = string_get(&filename);
-            generate_ir_file(cg->module, output_filepath);
         }
+        if (!is_optimized) {
+            job->result = 1;
+        } else if (job->file_type == FT_OBJECT) {
+            job->result = generate_object_file(cg->module, cg->target_machine, output_filepath);
+        } else if (job->file_type == FT_BITCODE) {
+            job->result = generate_bitcode_file(cg->module, output_filepath);
+        } else if (job->file_type == FT_IR) {
+            job->result = generate_ir_file(cg->module, output_filepath);
+        }
+        if (job->cache && ext && !job->result)
+            compile_cache_store(job->cache, cache_key, ext, output_filepath);
+        node_free(block);
     } else {
         log_info(INFO, "no statement is found.");
     }
+    time_report_end(report);
     engine_free(engine);
     string_deinit(&filename);
-    return 0;
+    return job->result;
+}
+
+struct _compile_task {
+    struct sys_prelude *prelude;
+    struct compile_job *job;
+};
+
+void _compile_job_task(void *arg)
+{
+    struct _compile_task *task = arg;
+    compile_prelude(task->prelude, task->job);
+}
+
+int compile_jobs(struct sys_prelude *prelude, struct compile_job *jobs, size_t job_count, unsigned int workers)
+{
+    if (!job_count)
+        return 0;
+    //LLVM target registration is not thread safe, do it once before workers are started
+    llvm_init_native_target();
+    struct _compile_task *compile_tasks;
+    struct task *tasks;
+    MALLOC(compile_tasks, job_count * sizeof(*compile_tasks));
+    MALLOC(tasks, job_count * sizeof(*tasks));
+    for (size_t i = 0; i < job_count; i++) {
+        compile_tasks[i].prelude = prelude;
+        compile_tasks[i].job = &jobs[i];
+        tasks[i].fun = _compile_job_task;
+        tasks[i].arg = &compile_tasks[i];
+    }
+    thread_pool_run(tasks, job_count, workers);
+    int failed = 0;
+    for (size_t i = 0; i < job_count; i++) {
+        if (jobs[i].result)
+            failed++;
+    }
+    FREE(tasks);
+    FREE(compile_tasks);
+    return failed;
+}
+
+bool is_bitcode_file(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (!file)
+        return false;
+    unsigned char magic[4] = {0};
+    size_t read = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+    return read == sizeof(magic) && magic[0] == 'B' && magic[1] == 'C' && magic[2] == 0xC0 && magic[3] == 0xDE;
+}
+
+int link_time_optimize(const char **bitcode_files, size_t count, const struct llvm_target_options *target, const char *output_filepath)
+{
+    llvm_init_native_target();
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMMemoryBufferRef *bitcodes;
+    MALLOC(bitcodes, count * sizeof(*bitcodes));
+    size_t read = 0;
+    for (; read < count; read++) {
+        char *error = 0;
+        if (LLVMCreateMemoryBufferWithContentsOfFile(bitcode_files[read], &bitcodes[read], &error)) {
+            printf("can't read bitcode file %s: %s\n", bitcode_files[read], error);
+            LLVMDisposeMessage(error);
+            break;
+        }
+    }
+    LLVMModuleRef module = read == count ? link_bitcode_modules(context, bitcodes, count) : 0;
+    for (size_t i = 0; i < read; i++)
+        LLVMDisposeMemoryBuffer(bitcodes[i]);
+    FREE(bitcodes);
+    int result = 1;
+    if (module) {
+        LLVMTargetDataRef target_data;
+        LLVMTargetMachineRef target_machine = create_target_machine(module, target, &target_data);
+        enum llvm_opt_level opt_level = target ? target->opt_level : LLVM_OPT_O2;
+        if (target_machine && run_ir_pipeline(module, target_machine, opt_level, LLVM_PIPELINE_LTO))
+            result = generate_object_file(module, target_machine, output_filepath);
+        if (target_machine) {
+            LLVMDisposeTargetData(target_data);
+            LLVMDisposeTargetMachine(target_machine);
+        }
+        LLVMDisposeModule(module);
+    }
+    LLVMContextDispose(context);
+    return result;
+}
+
+int compile(const char *sys_path, const char *source_file, enum object_file_type file_type, const char *output_filepath)
+{
+    struct sys_prelude prelude;
+    sys_prelude_init(&prelude, sys_path);
+    struct compile_job job;
+    job.source_file = source_file;
+    job.output_filepath = output_filepath;
+    job.file_type = file_type;
+    job.target = 0;
+    job.cache = 0;
+    compile_prelude(&prelude, &job);
+    sys_prelude_deinit(&prelude);
+    return job.result;
 }
 
 void free_ir_string(char *ir_string)
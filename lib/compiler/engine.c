@@ -7,10 +7,29 @@
 
 const char *_engine_version = "m - 0.0.45";
 
+void engine_reset(struct engine *engine)
+{
+    if (!engine->prelude)
+        return;
+    sema_context_rollback(engine->fe->sema_context, engine->prelude);
+    if (engine->arena)
+        arena_rollback(engine->arena, &engine->prelude_mark);
+}
+
 void engine_free(struct engine *engine)
 {
+    if (engine->prelude) {
+        sema_checkpoint_deinit(engine->prelude);
+        FREE(engine->prelude);
+    }
     backend_deinit(engine->be);
     frontend_deinit(engine->fe);
+    if(engine->arena){
+        if(ast_get_arena() == engine->arena)
+            ast_set_arena(0);
+        arena_deinit(engine->arena);
+        FREE(engine->arena);
+    }
     free(engine);
 }
 
@@ -29,13 +29,26 @@ char *_cg_llvm_emit_ir_string(void *gcg, struct ast_node *ast_node)
     return LLVMPrintModuleToString(cg->module);
 }
 
-struct engine *engine_llvm_new(const char *sys_path, bool is_repl)
+struct engine *_engine_llvm_new(struct frontend *fe)
 {
     struct engine *engine;
     MALLOC(engine, sizeof(*engine));
-    engine->fe = frontend_sys_init(sys_path, is_repl);
+    engine->arena = 0;
+    engine->prelude = 0;
+    time_report_init(&engine->time_report);
+    engine->fe = fe;
     engine->be = backend_init(engine->fe->sema_context, _cg_llvm_new, _cg_llvm_free);
     engine->emit_ir_string = _cg_llvm_emit_ir_string;
     engine->create_ir_module = create_ir_module;
     return engine;
 }
+
+struct engine *engine_llvm_new(const char *sys_path, bool is_repl)
+{
+    return _engine_llvm_new(frontend_sys_init(sys_path, is_repl));
+}
+
+struct engine *engine_llvm_new_with_prelude(struct sys_prelude *prelude, bool is_repl)
+{
+    return _engine_llvm_new(frontend_prelude_init(prelude, is_repl));
+}
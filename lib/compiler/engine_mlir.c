@@ -76,6 +76,9 @@ struct engine *engine_mlir_new(const char *sys_path, bool is_repl)
 {
     struct engine *engine;
     MALLOC(engine, sizeof(*engine));
+    engine->arena = 0;
+    engine->prelude = 0;
+    time_report_init(&engine->time_report);
     engine->fe = frontend_sys_init(sys_path, is_repl);
     engine->be = backend_init(engine->fe->sema_context, _cg_mlir_new, _cg_mlir_free);
     engine->emit_ir_string = _cg_mlir_emit_ir_string;
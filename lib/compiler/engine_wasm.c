@@ -6,6 +6,7 @@
 #include "compiler/engine.h"
 #include "codegen/wasm/cg_wasm.h"
 #include "sema/analyzer.h"
+#include "parser/ast_serialize.h"
 #include "app/error.h"
 #include <assert.h>
 
@@ -54,16 +55,40 @@ void _categorize_imports(struct imports *imports)
     }
 }
 
+void _analyze_prelude(struct sema_context *context, struct ast_node *block)
+{
+    if (!block)
+        return;
+    for (u32 i = 0; i < array_size(&block->block->nodes); i++) {
+        analyze(context, array_get_ptr(&block->block->nodes, i));
+    }
+}
+
 struct engine *engine_wasm_new(void)
 {
     struct engine *engine;
     MALLOC(engine, sizeof(*engine));
+    time_report_init(&engine->time_report);
+    time_report_begin(&engine->time_report, PHASE_FRONTEND);
+    MALLOC(engine->arena, sizeof(*engine->arena));
+    arena_init(engine->arena);
+    struct arena *prev_arena = ast_set_arena(engine->arena);
     engine->fe = frontend_init();
     engine->be = backend_init(engine->fe->sema_context, _cg_wasm_new, _cg_wasm_free);
     struct cg_wasm *cg = engine->be->cg;
     cg->imports.import_block = parse_code(engine->fe->parser, g_imports);
     cg->sys_block = parse_code(engine->fe->parser, g_sys);
     _categorize_imports(&cg->imports);
+    //the prelude is analyzed once in the module scope, each module is analyzed on top of it
+    struct sema_context *context = engine->fe->sema_context;
+    enter_scope(context);
+    _analyze_prelude(context, cg->sys_block);
+    _analyze_prelude(context, cg->imports.import_block);
+    MALLOC(engine->prelude, sizeof(*engine->prelude));
+    sema_checkpoint_init(engine->prelude, context);
+    engine->prelude_mark = arena_get_mark(engine->arena);
+    ast_set_arena(prev_arena);
+    time_report_end(&engine->time_report);
     return engine;
 }
 
@@ -109,29 +134,65 @@ struct ast_node *_decorate_as_module(struct cg_wasm *cg, struct ast_node *block)
     return wmodule;
 }
 
-u8* compile_to_wasm(struct engine *engine, const char *expr)
+//expr_ast is the module block allocated from the engine arena, it is released with the engine reset
+void _compile_module(struct engine *engine, struct ast_node *expr_ast)
 {
     struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
-    struct ast_node *expr_ast = parse_code(engine->fe->parser, expr);
-    if (!expr_ast){
-        return 0;
-    }
     struct ast_node *user_global_block = split_ast_nodes_with_start_func(engine->fe->parser->tc, expr_ast);
     struct ast_node *ast_block = block_node_new_empty();
     block_node_add_block(ast_block, cg->sys_block);
     block_node_add_block(ast_block, cg->imports.import_block);
     block_node_add_block(ast_block, user_global_block);
-    analyze(engine->fe->sema_context, ast_block);
+    time_report_begin(&engine->time_report, PHASE_ANALYZE);
+    analyze_block_nodes(engine->fe->sema_context, user_global_block);
     struct error_report *er = get_last_error_report(engine->fe->sema_context);
     if(er){
         printf("%s loc (line, col): (%d, %d)\n", er->error_msg, er->loc.line, er->loc.col);
         goto exit;
     }
+    time_report_begin(&engine->time_report, PHASE_CODEGEN);
     struct ast_node *ast = _decorate_as_module(cg, ast_block);
     wasm_emit_module(cg, ast);
     free_block_node(ast, false);
 exit:
     free_block_node(ast_block, false);
     node_free(user_global_block);
-    return cg->ba.data;
+}
+
+void _begin_module_report(struct engine *engine)
+{
+    struct phase_stats frontend = engine->time_report.phases[PHASE_FRONTEND];
+    time_report_init(&engine->time_report);
+    engine->time_report.phases[PHASE_FRONTEND] = frontend;
+    time_report_begin(&engine->time_report, PHASE_PARSE);
+}
+
+u8* compile_to_wasm(struct engine *engine, const char *expr)
+{
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg_wasm_reset(cg);
+    struct arena *prev_arena = ast_set_arena(engine->arena);
+    _begin_module_report(engine);
+    struct ast_node *expr_ast = parse_code(engine->fe->parser, expr);
+    if (expr_ast)
+        _compile_module(engine, expr_ast);
+    engine_reset(engine);
+    time_report_end(&engine->time_report);
+    ast_set_arena(prev_arena);
+    return expr_ast ? cg->ba.data : 0;
+}
+
+u8* compile_ast_to_wasm(struct engine *engine, const u8 *data, size_t size)
+{
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg_wasm_reset(cg);
+    struct arena *prev_arena = ast_set_arena(engine->arena);
+    _begin_module_report(engine);
+    struct ast_node *expr_ast = ast_deserialize(engine->fe->parser->tc, data, size);
+    if (expr_ast)
+        _compile_module(engine, expr_ast);
+    engine_reset(engine);
+    time_report_end(&engine->time_report);
+    ast_set_arena(prev_arena);
+    return expr_ast ? cg->ba.data : 0;
 }
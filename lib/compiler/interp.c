@@ -0,0 +1,893 @@
+/*
+ * interp.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * tier-0 interpreter of the analyzed AST. a function is lowered once to a tree of codes whose
+ * types are resolved, with the variables in slots of its frame, and then walked. the codes
+ * follow the semantics of the llvm backend, so a function promoted to the jit computes
+ * the same values
+ */
+#include "compiler/interp.h"
+#include "clib/util.h"
+#include "sema/type.h"
+#include <math.h>
+#include <string.h>
+
+enum icode_op {
+    IC_CONST,
+    IC_LOCAL,
+    IC_SET_LOCAL,
+    IC_BINARY,
+    IC_NEG,
+    IC_NOT,
+    IC_CAST,
+    IC_IF,
+    IC_WHILE,
+    IC_FOR,
+    IC_BREAK,
+    IC_CONTINUE,
+    IC_RETURN,
+    IC_CALL,
+    IC_CALL_MATH,
+    IC_BLOCK,
+};
+
+enum interp_jump {
+    INTERP_NEXT,
+    INTERP_BREAK,
+    INTERP_CONTINUE,
+    INTERP_RETURN,
+    INTERP_ABORT, //out of stack, the program is left to the jit
+};
+
+struct icode {
+    enum icode_op op;
+    enum interp_type type; //type of the value
+    union {
+        union interp_value value;
+        u32 slot;
+        struct {
+            u32 slot;
+            struct icode *expr;
+        } set;
+        struct {
+            enum op_code opcode;
+            enum interp_type kind; //type of the operands
+            struct icode *lhs, *rhs;
+        } binary;
+        struct {
+            enum interp_type from;
+            struct icode *operand;
+        } unary;
+        struct {
+            struct icode *cond, *then_code, *else_code;
+        } cond;
+        struct {
+            struct icode *cond, *body;
+            struct interp_fun *fun;
+        } loop;
+        struct {
+            u32 slot;
+            i8 step_sign; //nonzero if the step is a constant and the end invariant, it is evaluated once
+            struct icode *start, *end, *step, *body;
+            struct interp_fun *fun;
+        } for_loop;
+        struct {
+            u32 arg_count;
+            struct icode **args;
+            struct interp_fun *fun;
+        } call;
+        struct {
+            u32 arg_count;
+            struct icode **args;
+            f64 (*unary)(f64);
+            f64 (*binary)(f64, f64);
+        } math;
+        struct {
+            u32 count;
+            struct icode **codes;
+        } block;
+    };
+};
+
+struct math_fun {
+    const char *name;
+    f64 (*unary)(f64);
+    f64 (*binary)(f64, f64);
+};
+
+//external functions the interpreter calls, the rest are left to the jit
+static struct math_fun math_funs[] = {
+    { "sqrt", sqrt, 0 },
+    { "sin", sin, 0 },
+    { "cos", cos, 0 },
+    { "tan", tan, 0 },
+    { "asin", asin, 0 },
+    { "acos", acos, 0 },
+    { "atan", atan, 0 },
+    { "sinh", sinh, 0 },
+    { "cosh", cosh, 0 },
+    { "tanh", tanh, 0 },
+    { "exp", exp, 0 },
+    { "log", log, 0 },
+    { "log2", log2, 0 },
+    { "log10", log10, 0 },
+    { "fabs", fabs, 0 },
+    { "floor", floor, 0 },
+    { "ceil", ceil, 0 },
+    { "round", round, 0 },
+    { "trunc", trunc, 0 },
+    { "pow", 0, pow },
+    { "atan2", 0, atan2 },
+    { "fmod", 0, fmod },
+    { "fmin", 0, fmin },
+    { "fmax", 0, fmax },
+    { "hypot", 0, hypot },
+};
+
+struct lowering {
+    struct interp *in;
+    struct hashtable *fun_asts; //symbol of the function name -> FUNC_NODE of the module
+    struct interp_fun *fun;
+    struct hashtable var_slots; //symbol of the variable name -> slot in the frame
+};
+
+void interp_init(struct interp *in, struct sema_context *context)
+{
+    memset(in, 0, sizeof(*in));
+    in->context = context;
+    arena_init(&in->arena);
+    hashtable_init(&in->funs);
+    array_init(&in->lowered, sizeof(struct interp_fun *));
+    MALLOC(in->stack, INTERP_STACK_SLOTS * sizeof(union interp_value));
+    in->hot_threshold = INTERP_HOT_THRESHOLD;
+}
+
+void interp_deinit(struct interp *in)
+{
+    FREE(in->stack);
+    array_deinit(&in->lowered);
+    hashtable_deinit(&in->funs);
+    arena_deinit(&in->arena);
+}
+
+static enum interp_type _interp_type(struct type_context *tc, struct type_item *type)
+{
+    if (!type)
+        return INTERP_NONE;
+    type = prune(tc, type);
+    switch (type->type) {
+    case TYPE_UNIT:
+        return INTERP_UNIT;
+    case TYPE_BOOL:
+        return INTERP_BOOL;
+    case TYPE_CHAR:
+        return INTERP_CHAR;
+    case TYPE_INT:
+        return INTERP_INT;
+    case TYPE_F64:
+        return INTERP_F64;
+    default:
+        return INTERP_NONE;
+    }
+}
+
+static struct icode *_new_code(struct lowering *lw, enum icode_op op, enum interp_type type)
+{
+    struct icode *c = arena_calloc(&lw->in->arena, 1, sizeof(*c));
+    c->op = op;
+    c->type = type;
+    return c;
+}
+
+static u32 _new_slot(struct lowering *lw, symbol name)
+{
+    u32 slot = lw->fun->slots++;
+    hashtable_set_int(&lw->var_slots, name, (int)slot);
+    return slot;
+}
+
+static struct icode *_lower(struct lowering *lw, struct ast_node *node);
+static struct interp_fun *_lower_fun(struct interp *in, struct hashtable *fun_asts, struct ast_node *node);
+
+static struct icode **_lower_nodes(struct lowering *lw, struct array *nodes)
+{
+    u32 count = array_size(nodes);
+    struct icode **codes = arena_calloc(&lw->in->arena, count ? count : 1, sizeof(struct icode *));
+    for (u32 i = 0; i < count; i++) {
+        codes[i] = _lower(lw, array_get_ptr(nodes, i));
+        if (!codes[i])
+            return 0;
+    }
+    return codes;
+}
+
+static struct icode *_lower_literal(struct lowering *lw, struct ast_node *node)
+{
+    enum interp_type type = _interp_type(lw->in->context->tc, node->type);
+    if (type == INTERP_NONE || type == INTERP_UNIT)
+        return 0;
+    struct icode *c = _new_code(lw, IC_CONST, type);
+    if (type == INTERP_F64)
+        c->value.d = node->liter->double_val;
+    else
+        c->value.i = node->liter->int_val;
+    return c;
+}
+
+static struct icode *_lower_ident(struct lowering *lw, struct ast_node *node)
+{
+    //names are resolved like the llvm backend does, the last variable of the name emitted
+    int slot = hashtable_get_int(&lw->var_slots, node->ident->name);
+    enum interp_type type = _interp_type(lw->in->context->tc, node->type);
+    if (slot < 0 || type == INTERP_NONE || type == INTERP_UNIT)
+        return 0;
+    struct icode *c = _new_code(lw, IC_LOCAL, type);
+    c->slot = (u32)slot;
+    return c;
+}
+
+static struct icode *_lower_var(struct lowering *lw, struct ast_node *node)
+{
+    //globals live in the jit
+    if (node->var->is_global || !node->var->init_value)
+        return 0;
+    enum interp_type type = _interp_type(lw->in->context->tc, node->type);
+    if (type == INTERP_NONE || type == INTERP_UNIT)
+        return 0;
+    struct icode *c = _new_code(lw, IC_SET_LOCAL, INTERP_UNIT);
+    c->set.expr = _lower(lw, node->var->init_value);
+    if (!c->set.expr)
+        return 0;
+    c->set.slot = _new_slot(lw, node->var->var->ident->name);
+    return c;
+}
+
+static struct icode *_lower_assign(struct lowering *lw, struct ast_node *node)
+{
+    struct ast_node *lhs = node->binop->lhs;
+    if (node->binop->opcode != OP_ASSIGN || lhs->node_type != IDENT_NODE)
+        return 0;
+    int slot = hashtable_get_int(&lw->var_slots, lhs->ident->name);
+    if (slot < 0)
+        return 0;
+    struct icode *c = _new_code(lw, IC_SET_LOCAL, INTERP_UNIT);
+    c->set.slot = (u32)slot;
+    c->set.expr = _lower(lw, node->binop->rhs);
+    return c->set.expr ? c : 0;
+}
+
+static struct icode *_lower_unary(struct lowering *lw, struct ast_node *node)
+{
+    struct icode *operand = _lower(lw, node->unop->operand);
+    if (!operand)
+        return 0;
+    switch (node->unop->opcode) {
+    case OP_PLUS:
+        return operand;
+    case OP_MINUS: {
+        if (operand->type != INTERP_INT && operand->type != INTERP_CHAR && operand->type != INTERP_F64)
+            return 0;
+        struct icode *c = _new_code(lw, IC_NEG, operand->type);
+        c->unary.from = operand->type;
+        c->unary.operand = operand;
+        return c;
+    }
+    case OP_NOT: {
+        if (operand->type != INTERP_BOOL)
+            return 0;
+        struct icode *c = _new_code(lw, IC_NOT, INTERP_BOOL);
+        c->unary.from = operand->type;
+        c->unary.operand = operand;
+        return c;
+    }
+    default:
+        return 0;
+    }
+}
+
+static bool _is_relational(enum op_code opcode)
+{
+    return opcode == OP_LT || opcode == OP_LE || opcode == OP_EQ || opcode == OP_GT || opcode == OP_GE || opcode == OP_NE;
+}
+
+static bool _is_supported_binary(enum op_code opcode, enum interp_type kind)
+{
+    if (_is_relational(opcode))
+        return true;
+    switch (opcode) {
+    case OP_PLUS:
+    case OP_MINUS:
+    case OP_STAR:
+    case OP_DIVISION:
+    case OP_MODULUS:
+        return kind != INTERP_BOOL;
+    case OP_POW:
+        return kind == INTERP_F64;
+    case OP_OR:
+    case OP_AND:
+        return kind == INTERP_BOOL;
+    case OP_BITOR:
+    case OP_BITEXOR:
+    case OP_BAND:
+    case OP_BSL:
+    case OP_BSR:
+        return kind == INTERP_INT || kind == INTERP_CHAR;
+    default:
+        return false;
+    }
+}
+
+static struct icode *_lower_binary(struct lowering *lw, struct ast_node *node)
+{
+    struct icode *lhs = _lower(lw, node->binop->lhs);
+    struct icode *rhs = lhs ? _lower(lw, node->binop->rhs) : 0;
+    //the binary node built for a compound assignment is not typed, its operands are
+    if (!rhs || lhs->type != rhs->type || !_is_supported_binary(node->binop->opcode, lhs->type))
+        return 0;
+    enum op_code opcode = node->binop->opcode;
+    enum interp_type type = _is_relational(opcode) || opcode == OP_OR || opcode == OP_AND ? INTERP_BOOL : lhs->type;
+    struct icode *c = _new_code(lw, IC_BINARY, type);
+    c->binary.opcode = opcode;
+    c->binary.kind = lhs->type;
+    c->binary.lhs = lhs;
+    c->binary.rhs = rhs;
+    return c;
+}
+
+static struct icode *_lower_cast(struct lowering *lw, struct ast_node *node)
+{
+    struct icode *operand = _lower(lw, node->cast->expr);
+    enum interp_type to = _interp_type(lw->in->context->tc, node->type);
+    if (!operand || to == INTERP_NONE || to == INTERP_UNIT || operand->type == INTERP_UNIT)
+        return 0;
+    if (operand->type == to)
+        return operand;
+    struct icode *c = _new_code(lw, IC_CAST, to);
+    c->unary.from = operand->type;
+    c->unary.operand = operand;
+    return c;
+}
+
+static struct icode *_lower_if(struct lowering *lw, struct ast_node *node)
+{
+    struct icode *c = _new_code(lw, IC_IF, _interp_type(lw->in->context->tc, node->type));
+    c->cond.cond = _lower(lw, node->cond->if_node);
+    c->cond.then_code = c->cond.cond ? _lower(lw, node->cond->then_node) : 0;
+    if (!c->cond.then_code)
+        return 0;
+    if (node->cond->else_node) {
+        c->cond.else_code = _lower(lw, node->cond->else_node);
+        if (!c->cond.else_code)
+            return 0;
+    }
+    return c;
+}
+
+static struct icode *_lower_while(struct lowering *lw, struct ast_node *node)
+{
+    struct icode *c = _new_code(lw, IC_WHILE, INTERP_UNIT);
+    c->loop.fun = lw->fun;
+    c->loop.cond = _lower(lw, node->whileloop->expr);
+    c->loop.body = c->loop.cond ? _lower(lw, node->whileloop->body) : 0;
+    return c->loop.body ? c : 0;
+}
+
+static bool _is_int_code(struct icode *c)
+{
+    return c && c->type == INTERP_INT;
+}
+
+static struct icode *_lower_for(struct lowering *lw, struct ast_node *node)
+{
+    struct type_context *tc = lw->in->context->tc;
+    struct range_node *range = node->forloop->range->range;
+    if (_interp_type(tc, node->forloop->var->type) != INTERP_INT)
+        return 0;
+    struct icode *c = _new_code(lw, IC_FOR, INTERP_UNIT);
+    c->for_loop.fun = lw->fun;
+    //the loops the jit runs in its constant-step form, any other evaluates the end each iteration
+    c->for_loop.step_sign = node->forloop->is_end_invariant ? node->forloop->step_sign : 0;
+    c->for_loop.start = _lower(lw, range->start);
+    c->for_loop.end = _lower(lw, range->end);
+    if (range->step) {
+        c->for_loop.step = _lower(lw, range->step);
+        if (!_is_int_code(c->for_loop.step))
+            return 0;
+    }
+    if (!_is_int_code(c->for_loop.start) || !_is_int_code(c->for_loop.end))
+        return 0;
+    //the loop variable hides a variable of the same name only in the body
+    symbol var_name = node->forloop->var->var->var->ident->name;
+    int old_slot = hashtable_get_int(&lw->var_slots, var_name);
+    c->for_loop.slot = _new_slot(lw, var_name);
+    c->for_loop.body = _lower(lw, node->forloop->body);
+    if (old_slot >= 0)
+        hashtable_set_int(&lw->var_slots, var_name, old_slot);
+    else
+        hashtable_remove_p(&lw->var_slots, var_name);
+    return c->for_loop.body ? c : 0;
+}
+
+static struct icode *_lower_jump(struct lowering *lw, struct ast_node *node)
+{
+    switch (node->jump->token_type) {
+    case TOKEN_BREAK:
+        return _new_code(lw, IC_BREAK, INTERP_UNIT);
+    case TOKEN_CONTINUE:
+        return _new_code(lw, IC_CONTINUE, INTERP_UNIT);
+    case TOKEN_RETURN: {
+        struct icode *c = _new_code(lw, IC_RETURN, INTERP_UNIT);
+        if (!node->jump->expr)
+            return c;
+        c->unary.operand = _lower(lw, node->jump->expr);
+        return c->unary.operand ? c : 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+static struct math_fun *_find_math_fun(struct type_context *tc, struct ast_node *func_type)
+{
+    if (!func_type)
+        return 0;
+    struct type_item *type = prune(tc, func_type->type);
+    if (!type || type->type != TYPE_FUNCTION || type->is_variadic)
+        return 0;
+    for (u32 i = 0; i < array_size(&type->args); i++) {
+        if (_interp_type(tc, array_get_ptr(&type->args, i)) != INTERP_F64)
+            return 0;
+    }
+    const char *name = string_get(func_type->ft->name);
+    for (u32 i = 0; i < ARRAY_SIZE(math_funs); i++) {
+        struct math_fun *mf = &math_funs[i];
+        if (!strcmp(mf->name, name) && array_size(&type->args) == (mf->unary ? 2 : 3))
+            return mf;
+    }
+    return 0;
+}
+
+static struct icode *_lower_call(struct lowering *lw, struct ast_node *node)
+{
+    struct type_context *tc = lw->in->context->tc;
+    symbol callee = get_callee(node);
+    struct array *arg_nodes = &node->call->arg_block->block->nodes;
+    u32 arg_count = array_size(arg_nodes);
+    struct icode **args = _lower_nodes(lw, arg_nodes);
+    if (!args)
+        return 0;
+    struct ast_node *fun_node = hashtable_get_p(lw->fun_asts, callee);
+    if (fun_node) {
+        struct interp_fun *fun = _lower_fun(lw->in, lw->fun_asts, fun_node);
+        if (!fun || fun->params != arg_count)
+            return 0;
+        for (u32 i = 0; i < arg_count; i++) {
+            if (args[i]->type != fun->param_types[i])
+                return 0;
+        }
+        struct icode *c = _new_code(lw, IC_CALL, fun->ret_type);
+        c->call.fun = fun;
+        c->call.args = args;
+        c->call.arg_count = arg_count;
+        return c;
+    }
+    struct math_fun *mf = _find_math_fun(tc, node->call->callee_func_type);
+    if (!mf || arg_count != (mf->unary ? 1 : 2))
+        return 0;
+    for (u32 i = 0; i < arg_count; i++) {
+        if (args[i]->type != INTERP_F64)
+            return 0;
+    }
+    struct icode *c = _new_code(lw, IC_CALL_MATH, INTERP_F64);
+    c->math.unary = mf->unary;
+    c->math.binary = mf->binary;
+    c->math.args = args;
+    c->math.arg_count = arg_count;
+    return c;
+}
+
+static struct icode *_lower_block(struct lowering *lw, struct ast_node *node)
+{
+    struct icode **codes = _lower_nodes(lw, &node->block->nodes);
+    if (!codes)
+        return 0;
+    u32 count = array_size(&node->block->nodes);
+    struct icode *c = _new_code(lw, IC_BLOCK, count ? codes[count - 1]->type : INTERP_UNIT);
+    c->block.codes = codes;
+    c->block.count = count;
+    return c;
+}
+
+static struct icode *_lower(struct lowering *lw, struct ast_node *node)
+{
+    if (node->transformed)
+        node = node->transformed;
+    switch (node->node_type) {
+    case LITERAL_NODE:
+        return _lower_literal(lw, node);
+    case IDENT_NODE:
+        return _lower_ident(lw, node);
+    case VAR_NODE:
+        return _lower_var(lw, node);
+    case ASSIGN_NODE:
+        return _lower_assign(lw, node);
+    case UNARY_NODE:
+        return _lower_unary(lw, node);
+    case BINARY_NODE:
+        return _lower_binary(lw, node);
+    case CAST_NODE:
+        return _lower_cast(lw, node);
+    case IF_NODE:
+        return _lower_if(lw, node);
+    case WHILE_NODE:
+        return _lower_while(lw, node);
+    case FOR_NODE:
+        return _lower_for(lw, node);
+    case JUMP_NODE:
+        return _lower_jump(lw, node);
+    case CALL_NODE:
+        return _lower_call(lw, node);
+    case BLOCK_NODE:
+        return _lower_block(lw, node);
+    case FUNC_TYPE_NODE:
+        //a declaration of an external function has nothing to run
+        return _new_code(lw, IC_BLOCK, INTERP_UNIT);
+    default:
+        return 0;
+    }
+}
+
+static struct interp_fun *_lower_fun(struct interp *in, struct hashtable *fun_asts, struct ast_node *node)
+{
+    struct type_context *tc = in->context->tc;
+    symbol name = node->func->func_type->ft->name;
+    //a function being lowered is found too, so that a recursive call refers to it
+    struct interp_fun *fun = hashtable_get_p(&in->funs, name);
+    if (fun)
+        return fun;
+    struct type_item *type = prune(tc, node->type);
+    struct array *params = &node->func->func_type->ft->params->block->nodes;
+    if (!type || type->type != TYPE_FUNCTION || array_size(&type->args) != array_size(params) + 1)
+        return 0;
+    fun = arena_calloc(&in->arena, 1, sizeof(*fun));
+    fun->name = name;
+    fun->node = node;
+    fun->params = array_size(params);
+    fun->param_types = arena_calloc(&in->arena, fun->params ? fun->params : 1, sizeof(enum interp_type));
+    fun->ret_type = _interp_type(tc, array_back_ptr(&type->args));
+    hashtable_set_p(&in->funs, name, fun);
+    struct lowering lw;
+    lw.in = in;
+    lw.fun_asts = fun_asts;
+    lw.fun = fun;
+    hashtable_init_with_value_size(&lw.var_slots, sizeof(int), 0);
+    bool is_supported = fun->ret_type != INTERP_NONE;
+    for (u32 i = 0; i < fun->params && is_supported; i++) {
+        struct ast_node *param = array_get_ptr(params, i);
+        fun->param_types[i] = _interp_type(tc, array_get_ptr(&type->args, i));
+        is_supported = fun->param_types[i] != INTERP_NONE && fun->param_types[i] != INTERP_UNIT;
+        _new_slot(&lw, param->var->var->ident->name);
+    }
+    if (is_supported)
+        fun->body = _lower_block(&lw, node->func->body);
+    hashtable_deinit(&lw.var_slots);
+    if (!fun->body)
+        return 0;
+    array_push(&in->lowered, &fun);
+    return fun;
+}
+
+struct interp_fun *interp_load(struct interp *in, struct ast_node *block, symbol entry)
+{
+    struct type_context *tc = in->context->tc;
+    struct hashtable fun_asts;
+    hashtable_init(&fun_asts);
+    for (u32 i = 0; i < array_size(&block->block->nodes); i++) {
+        struct ast_node *node = array_get_ptr(&block->block->nodes, i);
+        if (node->node_type == FUNC_NODE && !is_generic(tc, node->type))
+            hashtable_set_p(&fun_asts, node->func->func_type->ft->name, node);
+    }
+    //instances of generic functions specialized for the calls of the module
+    for (u32 i = 0; i < array_size(&in->context->new_specialized_asts); i++) {
+        struct ast_node *node = array_get_ptr(&in->context->new_specialized_asts, i);
+        hashtable_set_p(&fun_asts, node->func->func_type->ft->name, node);
+    }
+    struct ast_node *entry_node = hashtable_get_p(&fun_asts, entry);
+    struct interp_fun *fun = entry_node ? _lower_fun(in, &fun_asts, entry_node) : 0;
+    hashtable_deinit(&fun_asts);
+    if (!fun) {
+        //functions lowered before one failed are incomplete
+        hashtable_clear(&in->funs);
+        array_clear(&in->lowered);
+    }
+    return fun;
+}
+
+static i64 _wrap(enum interp_type type, i64 v)
+{
+    switch (type) {
+    case INTERP_BOOL:
+        return (u8)v;
+    case INTERP_CHAR:
+        return (i8)v;
+    case INTERP_INT:
+        return (i32)v;
+    default:
+        return v;
+    }
+}
+
+static union interp_value _binary(struct icode *c, union interp_value l, union interp_value r)
+{
+    union interp_value v;
+    if (c->binary.kind == INTERP_F64) {
+        f64 a = l.d, b = r.d;
+        //compares are unordered like the ones of the llvm backend, true if either is nan
+        switch (c->binary.opcode) {
+        case OP_PLUS: v.d = a + b; break;
+        case OP_MINUS: v.d = a - b; break;
+        case OP_STAR: v.d = a * b; break;
+        case OP_DIVISION: v.d = a / b; break;
+        case OP_MODULUS: v.d = fmod(a, b); break;
+        case OP_POW: v.d = pow(a, b); break;
+        case OP_LT: v.i = !(a >= b); break;
+        case OP_LE: v.i = !(a > b); break;
+        case OP_GT: v.i = !(a <= b); break;
+        case OP_GE: v.i = !(a < b); break;
+        case OP_EQ: v.i = !(a < b || a > b); break;
+        case OP_NE: v.i = a != b; break;
+        default: v.i = 0; break;
+        }
+        return v;
+    }
+    i64 a = l.i, b = r.i;
+    switch (c->binary.opcode) {
+    case OP_PLUS: v.i = a + b; break;
+    case OP_MINUS: v.i = a - b; break;
+    case OP_STAR: v.i = a * b; break;
+    case OP_DIVISION: v.i = a / b; break;
+    case OP_MODULUS: v.i = a % b; break;
+    case OP_BITOR: v.i = a | b; break;
+    case OP_BITEXOR: v.i = a ^ b; break;
+    case OP_BAND: v.i = a & b; break;
+    case OP_BSL: v.i = (i64)((u64)a << (b & 63)); break;
+    case OP_BSR: v.i = a >> (b & 63); break;
+    case OP_OR: v.i = a | b; break;
+    case OP_AND: v.i = a & b; break;
+    case OP_LT: v.i = a < b; break;
+    case OP_LE: v.i = a <= b; break;
+    case OP_GT: v.i = a > b; break;
+    case OP_GE: v.i = a >= b; break;
+    case OP_EQ: v.i = a == b; break;
+    case OP_NE: v.i = a != b; break;
+    default: v.i = 0; break;
+    }
+    v.i = _wrap(c->type, v.i);
+    return v;
+}
+
+static union interp_value _cast(struct icode *c, union interp_value v)
+{
+    enum interp_type from = c->unary.from;
+    if (from == INTERP_F64) {
+        v.i = _wrap(c->type, (i64)v.d);
+    } else if (c->type == INTERP_F64) {
+        v.d = (f64)v.i;
+    } else {
+        v.i = _wrap(c->type, v.i);
+    }
+    return v;
+}
+
+static void _promote(struct interp *in, struct interp_fun *fun)
+{
+    fun->native = in->promote(in->promote_context, fun);
+    if (fun->native)
+        in->promotions++;
+    else
+        fun->is_promotion_failed = true;
+}
+
+static union interp_value _exec(struct interp *in, struct icode *c, union interp_value *frame);
+
+static union interp_value _call(struct interp *in, struct interp_fun *fun, union interp_value *frame)
+{
+    union interp_value v;
+    if (!fun->native && in->hot_threshold && in->promote && !fun->is_promotion_failed && ++fun->heat >= in->hot_threshold)
+        _promote(in, fun);
+    if (fun->native) {
+        fun->native(frame, &v);
+        return v;
+    }
+    in->depth++;
+    v = _exec(in, fun->body, frame);
+    in->depth--;
+    if (in->jump == INTERP_RETURN) {
+        in->jump = INTERP_NEXT;
+        v = in->ret;
+    }
+    return v;
+}
+
+//the jump out of a loop body, returns true if the loop is left
+static bool _is_loop_left(struct interp *in)
+{
+    if (in->jump == INTERP_NEXT)
+        return false;
+    if (in->jump == INTERP_CONTINUE) {
+        in->jump = INTERP_NEXT;
+        return false;
+    }
+    if (in->jump == INTERP_BREAK)
+        in->jump = INTERP_NEXT;
+    return true;
+}
+
+static void _exec_for(struct interp *in, struct icode *c, union interp_value *frame)
+{
+    union interp_value *var = &frame[c->for_loop.slot];
+    i64 start = _exec(in, c->for_loop.start, frame).i;
+    if (in->jump)
+        return;
+    var->i = start;
+    if (c->for_loop.step_sign) {
+        i64 end = _exec(in, c->for_loop.end, frame).i;
+        i64 step = c->for_loop.step ? _exec(in, c->for_loop.step, frame).i : 1;
+        if (in->jump)
+            return;
+        bool is_up = c->for_loop.step_sign > 0;
+        if (is_up ? var->i >= end : var->i <= end)
+            return;
+        for (;;) {
+            _exec(in, c->for_loop.body, frame);
+            if (_is_loop_left(in))
+                return;
+            c->for_loop.fun->heat++;
+            var->i = _wrap(INTERP_INT, var->i + step);
+            if (is_up ? var->i >= end : var->i <= end)
+                return;
+        }
+    }
+    for (;;) {
+        i64 end = _exec(in, c->for_loop.end, frame).i;
+        if (in->jump || var->i >= end)
+            return;
+        _exec(in, c->for_loop.body, frame);
+        if (_is_loop_left(in))
+            return;
+        c->for_loop.fun->heat++;
+        i64 step = c->for_loop.step ? _exec(in, c->for_loop.step, frame).i : 1;
+        if (in->jump)
+            return;
+        var->i = _wrap(INTERP_INT, var->i + step);
+    }
+}
+
+static union interp_value _exec(struct interp *in, struct icode *c, union interp_value *frame)
+{
+    union interp_value v = { 0 };
+    switch (c->op) {
+    case IC_CONST:
+        return c->value;
+    case IC_LOCAL:
+        return frame[c->slot];
+    case IC_SET_LOCAL:
+        v = _exec(in, c->set.expr, frame);
+        frame[c->set.slot] = v;
+        return (union interp_value){ 0 };
+    case IC_BINARY: {
+        union interp_value l = _exec(in, c->binary.lhs, frame);
+        union interp_value r = _exec(in, c->binary.rhs, frame);
+        return _binary(c, l, r);
+    }
+    case IC_NEG:
+        v = _exec(in, c->unary.operand, frame);
+        if (c->type == INTERP_F64)
+            v.d = -v.d;
+        else
+            v.i = _wrap(c->type, -v.i);
+        return v;
+    case IC_NOT:
+        v = _exec(in, c->unary.operand, frame);
+        v.i = !(v.i & 1);
+        return v;
+    case IC_CAST:
+        return _cast(c, _exec(in, c->unary.operand, frame));
+    case IC_IF:
+        v = _exec(in, c->cond.cond, frame);
+        if (in->jump)
+            return v;
+        if (v.i)
+            return _exec(in, c->cond.then_code, frame);
+        //an if without else has no value to merge, it is the condition like the llvm backend gives
+        return c->cond.else_code ? _exec(in, c->cond.else_code, frame) : v;
+    case IC_WHILE:
+        for (;;) {
+            v = _exec(in, c->loop.cond, frame);
+            if (in->jump || !v.i)
+                break;
+            _exec(in, c->loop.body, frame);
+            if (_is_loop_left(in))
+                break;
+            c->loop.fun->heat++;
+        }
+        return (union interp_value){ 0 };
+    case IC_FOR:
+        _exec_for(in, c, frame);
+        return (union interp_value){ 0 };
+    case IC_BREAK:
+        in->jump = INTERP_BREAK;
+        return v;
+    case IC_CONTINUE:
+        in->jump = INTERP_CONTINUE;
+        return v;
+    case IC_RETURN:
+        if (c->unary.operand) {
+            v = _exec(in, c->unary.operand, frame);
+            if (in->jump)
+                return v;
+        }
+        in->ret = v;
+        in->jump = INTERP_RETURN;
+        return v;
+    case IC_CALL: {
+        struct interp_fun *fun = c->call.fun;
+        u32 sp = in->sp;
+        if (sp + fun->slots > INTERP_STACK_SLOTS || in->depth >= INTERP_MAX_DEPTH) {
+            in->jump = INTERP_ABORT;
+            return v;
+        }
+        union interp_value *callee_frame = in->stack + sp;
+        in->sp += fun->slots;
+        for (u32 i = 0; i < c->call.arg_count; i++) {
+            callee_frame[i] = _exec(in, c->call.args[i], frame);
+            if (in->jump) {
+                in->sp = sp;
+                return v;
+            }
+        }
+        v = _call(in, fun, callee_frame);
+        in->sp = sp;
+        return v;
+    }
+    case IC_CALL_MATH: {
+        union interp_value a = _exec(in, c->math.args[0], frame);
+        if (c->math.unary) {
+            v.d = c->math.unary(a.d);
+            return v;
+        }
+        union interp_value b = _exec(in, c->math.args[1], frame);
+        v.d = c->math.binary(a.d, b.d);
+        return v;
+    }
+    case IC_BLOCK:
+        for (u32 i = 0; i < c->block.count; i++) {
+            v = _exec(in, c->block.codes[i], frame);
+            if (in->jump)
+                break;
+        }
+        return v;
+    }
+    return v;
+}
+
+bool interp_call(struct interp *in, struct interp_fun *fun, union interp_value *args, union interp_value *result)
+{
+    u32 sp = in->sp;
+    if (sp + fun->slots > INTERP_STACK_SLOTS)
+        return false;
+    union interp_value *frame = in->stack + sp;
+    in->sp += fun->slots;
+    for (u32 i = 0; i < fun->params; i++)
+        frame[i] = args[i];
+    in->jump = INTERP_NEXT;
+    *result = _call(in, fun, frame);
+    in->sp = sp;
+    if (in->jump == INTERP_ABORT) {
+        in->jump = INTERP_NEXT;
+        return false;
+    }
+    return true;
+}
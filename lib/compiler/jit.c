@@ -5,25 +5,43 @@
  */
 
 #include "clib/util.h"
+#include "clib/string.h"
+#include "clib/hash.h"
 #include "compiler/jit.h"
+#include "codegen/llvm/cg_llvm.h"
 #include <llvm-c/Core.h>
 //#include <llvm-c/Initialization.h>
 #include <llvm-c/LLJIT.h>
 #include <llvm-c/Support.h>
 #include <llvm-c/Analysis.h>
+#include <llvm-c/BitWriter.h>
 #include <llvm-c/Target.h>
 #include <llvm-c/Error.h>
 #include <assert.h>
+#include <stdio.h>
+#include <string.h>
 
-void *_create_jit_instance(void)
+#define JIT_OBJECT_EXT ".jit.o"
+
+void *_create_jit_instance(enum llvm_opt_level opt_level)
 {
     // Create the JIT instance.
     LLVMOrcLLJITRef jit;
-
-    LLVMErrorRef err = LLVMOrcCreateLLJIT(&jit, 0);
+    LLVMOrcLLJITBuilderRef builder = LLVMOrcCreateLLJITBuilder();
+    //the code generator runs at the opt level of the engine, O0 selects instructions fast for code run once
+    LLVMTargetMachineRef target_machine = create_host_target_machine(opt_level);
+    if (target_machine)
+        LLVMOrcLLJITBuilderSetJITTargetMachineBuilder(builder, LLVMOrcJITTargetMachineBuilderCreateFromTargetMachine(target_machine));
+    LLVMErrorRef err = LLVMOrcCreateLLJIT(&jit, builder);
     if (err) {
+        LLVMConsumeError(err);
         return 0;
     }
+    //c library functions declared in the sys prelude, e.g. pow or log, are resolved from the process
+    LLVMOrcDefinitionGeneratorRef dg;
+    if (!LLVMOrcCreateDynamicLibrarySearchGeneratorForProcess(&dg, LLVMOrcLLJITGetGlobalPrefix(jit), 0, 0)) {
+        LLVMOrcJITDylibAddGenerator(LLVMOrcLLJITGetMainJITDylib(jit), dg);
+    }
     return jit;
 }
 
@@ -36,12 +54,92 @@ void _destroy_jit_instance(void *instance)
     }
 }
 
+int _handle_error(LLVMErrorRef Err) {
+  char *err_msg = LLVMGetErrorMessage(Err);
+  fprintf(stderr, "Error: %s\n", err_msg);
+  LLVMDisposeErrorMessage(err_msg);
+  return 1;
+}
+
+static LLVMErrorRef _read_module_hash(void *ctx, LLVMModuleRef module)
+{
+    struct JIT *jit = (struct JIT *)ctx;
+    size_t len;
+    unsigned long long hash;
+    if (sscanf(LLVMGetModuleIdentifier(module, &len), "jit.%llx", &hash) == 1)
+        jit->compiling_hash = hash;
+    return 0;
+}
+
+//runs right before the code generator compiles a module, on the same thread as _store_object after it
+static LLVMErrorRef _compiling_module(void *ctx, LLVMOrcThreadSafeModuleRef *module, LLVMOrcMaterializationResponsibilityRef mr)
+{
+    (void)mr;
+    struct JIT *jit = (struct JIT *)ctx;
+    jit->compiling_hash = 0;
+    if (!jit->cache)
+        return 0;
+    return LLVMOrcThreadSafeModuleWithModuleDo(*module, _read_module_hash, jit);
+}
+
+//objects loaded from the cache pass here too, they are not being compiled and have no key
+static LLVMErrorRef _store_object(void *ctx, LLVMMemoryBufferRef *object)
+{
+    struct JIT *jit = (struct JIT *)ctx;
+    if (jit->cache && jit->compiling_hash)
+        compile_cache_store_data(jit->cache, jit->compiling_hash, JIT_OBJECT_EXT, LLVMGetBufferStart(*object), LLVMGetBufferSize(*object));
+    jit->compiling_hash = 0;
+    return 0;
+}
+
+static u64 _target_hash(LLVMOrcLLJITRef j, enum llvm_opt_level opt_level)
+{
+    char *cpu = LLVMGetHostCPUName();
+    char *features = LLVMGetHostCPUFeatures();
+    string target;
+    string_init_chars(&target, LLVMOrcLLJITGetTripleString(j));
+    string_add_chars(&target, " ");
+    string_add_chars(&target, cpu);
+    string_add_chars(&target, " ");
+    string_add_chars(&target, features);
+    char level[8];
+    snprintf(level, sizeof(level), " -O%d", opt_level);
+    string_add_chars(&target, level);
+    u64 hash = hash64((unsigned char *)string_get(&target), string_size(&target));
+    string_deinit(&target);
+    LLVMDisposeMessage(cpu);
+    LLVMDisposeMessage(features);
+    return hash;
+}
+
 struct JIT *jit_new(struct engine *engine)
 {
     struct JIT *jit;
     MALLOC(jit, sizeof(*jit));
     jit->engine = engine;
-    jit->instance = _create_jit_instance();
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    jit->instance = _create_jit_instance(cg->target_options.opt_level);
+    jit->call_through_manager = 0;
+    jit->stubs_manager = 0;
+    jit->cache = 0;
+    jit->target_hash = 0;
+    jit->compiling_hash = 0;
+    jit->exprs = 0;
+    if (jit->instance) {
+        LLVMOrcLLJITRef j = (LLVMOrcLLJITRef)jit->instance;
+        jit->target_hash = _target_hash(j, cg->target_options.opt_level);
+        LLVMOrcIRTransformLayerSetTransform(LLVMOrcLLJITGetIRTransformLayer(j), _compiling_module, jit);
+        LLVMOrcObjectTransformLayerSetTransform(LLVMOrcLLJITGetObjTransformLayer(j), _store_object, jit);
+        const char *triple = LLVMOrcLLJITGetTripleString(j);
+        LLVMOrcLazyCallThroughManagerRef lctm;
+        LLVMErrorRef err = LLVMOrcCreateLocalLazyCallThroughManager(triple, LLVMOrcLLJITGetExecutionSession(j), 0, &lctm);
+        if (err) {
+            _handle_error(err);
+        } else {
+            jit->call_through_manager = lctm;
+            jit->stubs_manager = LLVMOrcCreateLocalIndirectStubsManager(triple);
+        }
+    }
     return jit;
 }
 
@@ -50,30 +148,80 @@ void jit_free(struct JIT *jit)
     if (jit->instance) {
         _destroy_jit_instance(jit->instance);
     }
+    //the stubs of lazy functions are freed after the jit which calls through them
+    if (jit->stubs_manager)
+        LLVMOrcDisposeIndirectStubsManager(jit->stubs_manager);
+    if (jit->call_through_manager)
+        LLVMOrcDisposeLazyCallThroughManager(jit->call_through_manager);
     FREE(jit);
 }
 
-int _handle_error(LLVMErrorRef Err) {
-  char *err_msg = LLVMGetErrorMessage(Err);
-  fprintf(stderr, "Error: %s\n", err_msg);
-  LLVMDisposeErrorMessage(err_msg);
-  return 1;
-}
-
-void* jit_add_module(struct JIT *jit, void *module)
+static void _verify_module(LLVMModuleRef module)
 {
     char *message = 0;
-    if(LLVMVerifyModule((LLVMModuleRef)module, LLVMPrintMessageAction, &message)) {
+    if(LLVMVerifyModule(module, LLVMPrintMessageAction, &message)) {
         printf("error: %s\n", message);
         exit(1);
     }
     if(message) {
         LLVMDisposeMessage(message);
     }
+}
+
+//the module is created in the context of the engine, all modules share it instead of a context each
+static LLVMOrcThreadSafeModuleRef _create_thread_safe_module(struct JIT *jit, LLVMModuleRef module)
+{
+    struct cg_llvm *cg = (struct cg_llvm *)jit->engine->be->cg;
+    return LLVMOrcCreateNewThreadSafeModule(module, cg->ts_context);
+}
+
+/*
+ * the key of a module is a hash of its bitcode without the module name, modules are named
+ * uniquely but the same code compiles to the same object. the module is renamed after its
+ * key for _compiling_module to find when it is compiled on a miss
+ */
+static u64 _module_hash(struct JIT *jit, LLVMModuleRef module)
+{
+    size_t len;
+    string source;
+    string_init_chars(&source, LLVMGetSourceFileName(module, &len));
+    LLVMSetModuleIdentifier(module, "", 0);
+    LLVMSetSourceFileName(module, "", 0);
+    LLVMMemoryBufferRef bitcode = LLVMWriteBitcodeToMemoryBuffer(module);
+    u64 hash = hash64((unsigned char *)LLVMGetBufferStart(bitcode), LLVMGetBufferSize(bitcode)) + jit->target_hash;
+    LLVMDisposeMemoryBuffer(bitcode);
+    char name[32];
+    snprintf(name, sizeof(name), "jit.%016llx", (unsigned long long)hash);
+    LLVMSetModuleIdentifier(module, name, strlen(name));
+    LLVMSetSourceFileName(module, string_get(&source), string_size(&source));
+    string_deinit(&source);
+    return hash;
+}
+
+//the object the module compiled to before, the module is freed on a hit. 0 on a miss
+static LLVMMemoryBufferRef _load_cached_object(struct JIT *jit, LLVMModuleRef module)
+{
+    if (!jit->cache)
+        return 0;
+    string path;
+    LLVMMemoryBufferRef object = 0;
+    if (compile_cache_lookup(jit->cache, _module_hash(jit, module), JIT_OBJECT_EXT, &path)) {
+        char *message = 0;
+        if (LLVMCreateMemoryBufferWithContentsOfFile(string_get(&path), &object, &message)) {
+            object = 0;
+            LLVMDisposeMessage(message);
+        } else {
+            LLVMDisposeModule(module);
+        }
+    }
+    string_deinit(&path);
+    return object;
+}
+
+void* jit_add_module(struct JIT *jit, void *module)
+{
+    _verify_module((LLVMModuleRef)module);
     LLVMOrcLLJITRef j = (LLVMOrcLLJITRef)jit->instance;
-    LLVMOrcThreadSafeContextRef tsc = LLVMOrcCreateNewThreadSafeContext();
-    LLVMOrcThreadSafeModuleRef tsm = LLVMOrcCreateNewThreadSafeModule((LLVMModuleRef)module, tsc);
-    LLVMOrcDisposeThreadSafeContext(tsc);
     LLVMOrcJITDylibRef jd = LLVMOrcLLJITGetMainJITDylib(j);
     LLVMOrcResourceTrackerRef rt = LLVMOrcJITDylibCreateResourceTracker(jd);
     //LLVMOrcDefinitionGeneratorRef dg;
@@ -88,6 +236,15 @@ void* jit_add_module(struct JIT *jit, void *module)
 #endif
     //LLVMOrcJITDylibAddGenerator(jd, dg);
     LLVMErrorRef err;
+    LLVMMemoryBufferRef object = _load_cached_object(jit, (LLVMModuleRef)module);
+    if (object) {
+        if ((err = LLVMOrcLLJITAddObjectFileWithRT(j, rt, object))) {
+            _handle_error(err);
+            assert(false);
+        }
+        return rt;
+    }
+    LLVMOrcThreadSafeModuleRef tsm = _create_thread_safe_module(jit, (LLVMModuleRef)module);
     if((err = LLVMOrcLLJITAddLLVMIRModuleWithRT(j, rt, tsm))){
         _handle_error(err);
         LLVMOrcDisposeThreadSafeModule(tsm);
@@ -96,6 +253,63 @@ void* jit_add_module(struct JIT *jit, void *module)
     return rt;
 }
 
+void jit_add_module_lazy(struct JIT *jit, void *module)
+{
+    LLVMModuleRef mod = (LLVMModuleRef)module;
+    _verify_module(mod);
+    LLVMOrcLLJITRef j = (LLVMOrcLLJITRef)jit->instance;
+    LLVMOrcJITDylibRef jd = LLVMOrcLLJITGetMainJITDylib(j);
+    /*
+     * each exported function gets a body name, its own name is a stub which compiles the module
+     * by looking up the body on the first call. calls inside the module go to the body directly
+     */
+    size_t count = 0;
+    for (LLVMValueRef fun = LLVMGetFirstFunction(mod); fun; fun = LLVMGetNextFunction(fun)) {
+        if (!LLVMIsDeclaration(fun) && LLVMGetLinkage(fun) == LLVMExternalLinkage)
+            count++;
+    }
+    LLVMOrcCSymbolAliasMapPairs aliases = 0;
+    if (count && jit->call_through_manager) {
+        MALLOC(aliases, count * sizeof(*aliases));
+        size_t i = 0;
+        for (LLVMValueRef fun = LLVMGetFirstFunction(mod); fun; fun = LLVMGetNextFunction(fun)) {
+            if (LLVMIsDeclaration(fun) || LLVMGetLinkage(fun) != LLVMExternalLinkage)
+                continue;
+            size_t len;
+            string body;
+            string_init_chars(&body, LLVMGetValueName2(fun, &len));
+            aliases[i].Name = LLVMOrcLLJITMangleAndIntern(j, string_get(&body));
+            string_add_chars(&body, JIT_LAZY_BODY_SUFFIX);
+            LLVMSetValueName2(fun, string_get(&body), string_size(&body));
+            aliases[i].Entry.Name = LLVMOrcLLJITMangleAndIntern(j, string_get(&body));
+            aliases[i].Entry.Flags.GenericFlags = LLVMJITSymbolGenericFlagsExported | LLVMJITSymbolGenericFlagsCallable;
+            aliases[i].Entry.Flags.TargetFlags = 0;
+            string_deinit(&body);
+            i++;
+        }
+    }
+    LLVMErrorRef err;
+    //a cached object holds the renamed bodies the same as the module does
+    LLVMMemoryBufferRef object = _load_cached_object(jit, mod);
+    if (object)
+        err = LLVMOrcLLJITAddObjectFile(j, jd, object);
+    else
+        err = LLVMOrcLLJITAddLLVMIRModule(j, jd, _create_thread_safe_module(jit, mod));
+    if (err) {
+        _handle_error(err);
+        assert(false);
+    }
+    if (!aliases)
+        return;
+    //the names are owned by the reexports, the array is not
+    LLVMOrcMaterializationUnitRef mu = LLVMOrcLazyReexports(jit->call_through_manager, jit->stubs_manager, jd, aliases, count);
+    FREE(aliases);
+    if ((err = LLVMOrcJITDylibDefine(jd, mu))) {
+        _handle_error(err);
+        LLVMOrcDisposeMaterializationUnit(mu);
+    }
+}
+
 void jit_remove_module(void *resource_tracker)
 {
     LLVMOrcResourceTrackerRemove(resource_tracker);
@@ -32,14 +32,13 @@ void _print(struct eval_result result)
     }
 }
 
-void* _add_current_module_to_jit(struct JIT *jit)
+void _add_current_module_to_jit(struct JIT *jit)
 {
     struct cg_llvm *cg = jit->engine->be->cg;
     assert(cg->module);
-    //the function takes the ownership of the module.
-    void *result = jit_add_module(jit, cg->module);
+    //the function takes the ownership of the module, the definitions are compiled on their first call
+    jit_add_module_lazy(jit, cg->module);
     cg->module = 0;
-    return result;
 }
 
 void _create_new_module(struct cg_llvm *cg)
@@ -53,7 +52,11 @@ struct eval_result eval_exp(struct JIT *jit, struct ast_node *node)
 {
     struct cg_llvm *cg = jit->engine->be->cg;
     struct type_context *tc = cg->base.sema_context->tc;
-    string fn = make_unique_name("main-fn");
+    //numbered instead of random so that the same session compiles to the same cached objects
+    char fn_name[32];
+    snprintf(fn_name, sizeof(fn_name), "main-fn%zu", jit->exprs++);
+    string fn;
+    string_init_chars(&fn, fn_name);
     symbol fn_symbol = string_2_symbol(&fn);
     enum node_type node_type = node->node_type;
     if (!node->type){
@@ -98,13 +101,20 @@ struct eval_result eval_exp(struct JIT *jit, struct ast_node *node)
 struct eval_result eval_module(struct JIT *jit, struct ast_node *node)
 {
     struct cg_llvm *cg = jit->engine->be->cg;
-    struct type_context *tc = cg->base.sema_context->tc;
     struct eval_result result = { 0 };
     analyze(cg->base.sema_context, node);
     struct error_report *er = get_last_error_report(jit->engine->fe->sema_context);
     if(er){
         return result;
     }
+    return eval_analyzed_module(jit, node);
+}
+
+struct eval_result eval_analyzed_module(struct JIT *jit, struct ast_node *node)
+{
+    struct cg_llvm *cg = jit->engine->be->cg;
+    struct type_context *tc = cg->base.sema_context->tc;
+    struct eval_result result = { 0 };
     _create_new_module(cg);
     enum node_type node_type = node->node_type;
     if (!node->type){
@@ -184,14 +194,25 @@ exit:
     fprintf(stderr, "m> ");
 }
 
-int run_repl(void)
+int run_repl(const char *sys_path, const char *cache_dir)
 {
-    struct engine *engine = engine_llvm_new(0, true);
+    struct engine *engine = engine_llvm_new(sys_path, true);
+    //each input is compiled to run once, the jit does not optimize it
+    ((struct cg_llvm *)engine->be->cg)->target_options.opt_level = LLVM_OPT_O0;
     struct JIT *jit = jit_new(engine);
+    struct compile_cache cache;
+    if (cache_dir) {
+        compile_cache_init(&cache, cache_dir, 0);
+        jit->cache = &cache;
+    }
     printf("m> ");
     parse_repl_code(engine->fe->parser, &eval_node, jit);
     printf("bye !\n");
     jit_free(jit);
+    if (cache_dir) {
+        printf("cache %s: %zu hits, %zu misses, %zu stored\n", cache_dir, cache.hits, cache.misses, cache.stores);
+        compile_cache_deinit(&cache);
+    }
     engine_free(engine);
     return 0;
 }
@@ -0,0 +1,190 @@
+/*
+ * tier.c
+ *
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * tiered execution: the interpreter runs the analyzed module right away and promotes its hot
+ * functions to the jit. on the first promotion all functions the interpreter lowered are
+ * emitted into one module, each with an entry taking the arguments and the result as
+ * interpreter values, so that the callees are inlined and the next promotions find their
+ * code compiled already. there is no on-stack replacement: a function running a hot loop is
+ * called natively from its next call
+ */
+#include "compiler/tier.h"
+#include "codegen/llvm/cg_llvm.h"
+#include "sema/analyzer.h"
+#include "app/error.h"
+#include "clib/string.h"
+#include "clib/util.h"
+#include <string.h>
+
+struct tier *tier_new(struct engine *engine)
+{
+    struct tier *tier;
+    MALLOC(tier, sizeof(*tier));
+    tier->engine = engine;
+    interp_init(&tier->interp, engine->fe->sema_context);
+    tier->jit = 0;
+    tier->is_jit_failed = false;
+    tier->is_interpreted = false;
+    return tier;
+}
+
+void tier_free(struct tier *tier)
+{
+    if (tier->jit)
+        jit_free(tier->jit);
+    interp_deinit(&tier->interp);
+    FREE(tier);
+}
+
+static LLVMValueRef _load_slot(struct cg_llvm *cg, LLVMValueRef slot, LLVMTypeRef type)
+{
+    if (LLVMGetTypeKind(type) == LLVMDoubleTypeKind) {
+        slot = LLVMBuildBitCast(cg->builder, slot, LLVMPointerType(type, 0), "");
+        return LLVMBuildLoad2(cg->builder, type, slot, "");
+    }
+    LLVMValueRef v = LLVMBuildLoad2(cg->builder, LLVMInt64TypeInContext(cg->context), slot, "");
+    return LLVMBuildTrunc(cg->builder, v, type, "");
+}
+
+static void _store_slot(struct cg_llvm *cg, LLVMValueRef slot, LLVMValueRef v, enum interp_type type)
+{
+    LLVMTypeRef v_type = LLVMTypeOf(v);
+    if (LLVMGetTypeKind(v_type) == LLVMDoubleTypeKind) {
+        slot = LLVMBuildBitCast(cg->builder, slot, LLVMPointerType(v_type, 0), "");
+    } else {
+        //the interpreter keeps ints sign extended and bools as 0 or 1
+        LLVMTypeRef i64_type = LLVMInt64TypeInContext(cg->context);
+        v = type == INTERP_BOOL ? LLVMBuildZExt(cg->builder, v, i64_type, "") : LLVMBuildSExt(cg->builder, v, i64_type, "");
+    }
+    LLVMBuildStore(cg->builder, v, slot);
+}
+
+static bool _is_scalar(LLVMTypeRef type)
+{
+    LLVMTypeKind kind = LLVMGetTypeKind(type);
+    return kind == LLVMDoubleTypeKind || (kind == LLVMIntegerTypeKind && LLVMGetIntTypeWidth(type) <= 64);
+}
+
+//void name.entry(i64 *args, i64 *ret), calling the function with the arguments loaded from args
+static bool _emit_entry(struct cg_llvm *cg, struct interp_fun *fun, LLVMValueRef f)
+{
+    LLVMTypeRef fun_type = LLVMGlobalGetValueType(f);
+    u32 param_count = LLVMCountParamTypes(fun_type);
+    LLVMTypeRef ret_type = LLVMGetReturnType(fun_type);
+    if (param_count != fun->params || (LLVMGetTypeKind(ret_type) != LLVMVoidTypeKind && !_is_scalar(ret_type)))
+        return false;
+    LLVMTypeRef *param_types;
+    LLVMValueRef *args;
+    MALLOC(param_types, (param_count + 1) * sizeof(LLVMTypeRef));
+    MALLOC(args, (param_count + 1) * sizeof(LLVMValueRef));
+    LLVMGetParamTypes(fun_type, param_types);
+    LLVMTypeRef i64_type = LLVMInt64TypeInContext(cg->context);
+    LLVMTypeRef slot_types[2] = { LLVMPointerType(i64_type, 0), LLVMPointerType(i64_type, 0) };
+    string name;
+    string_init_chars(&name, string_get(fun->name));
+    string_add_chars(&name, TIER_ENTRY_SUFFIX);
+    LLVMValueRef entry = LLVMAddFunction(cg->module, string_get(&name), LLVMFunctionType(LLVMVoidTypeInContext(cg->context), slot_types, 2, false));
+    string_deinit(&name);
+    LLVMPositionBuilderAtEnd(cg->builder, LLVMAppendBasicBlockInContext(cg->context, entry, "entry"));
+    bool is_scalar = true;
+    for (u32 i = 0; i < param_count && is_scalar; i++) {
+        is_scalar = _is_scalar(param_types[i]);
+        LLVMValueRef index = LLVMConstInt(i64_type, i, false);
+        LLVMValueRef slot = LLVMBuildInBoundsGEP2(cg->builder, i64_type, LLVMGetParam(entry, 0), &index, 1, "");
+        if (is_scalar)
+            args[i] = _load_slot(cg, slot, param_types[i]);
+    }
+    if (is_scalar) {
+        LLVMValueRef ret = LLVMBuildCall2(cg->builder, fun_type, f, args, param_count, "");
+        if (LLVMGetTypeKind(ret_type) != LLVMVoidTypeKind)
+            _store_slot(cg, LLVMGetParam(entry, 1), ret, fun->ret_type);
+        LLVMBuildRetVoid(cg->builder);
+    }
+    FREE(param_types);
+    FREE(args);
+    return is_scalar;
+}
+
+//emit the functions lowered by the interpreter but the entry of the module into one module
+static bool _add_lowered_functions(struct tier *tier)
+{
+    struct cg_llvm *cg = tier->engine->be->cg;
+    create_ir_module(cg, "tier");
+    bool is_emitted = true;
+    for (u32 i = 0; i < array_size(&tier->interp.lowered) && is_emitted; i++) {
+        struct interp_fun *fun = array_get_ptr(&tier->interp.lowered, i);
+        if (fun->name == to_symbol("_start"))
+            continue;
+        LLVMValueRef f = emit_ir_code(cg, fun->node);
+        is_emitted = f && _emit_entry(cg, fun, f);
+    }
+    if (!is_emitted || !optimize_ir_module(cg)) {
+        LLVMDisposeModule(cg->module);
+        cg->module = 0;
+        return false;
+    }
+    jit_add_module(tier->jit, cg->module);
+    cg->module = 0;
+    return true;
+}
+
+static interp_native_fun _promote(void *promote_context, struct interp_fun *fun)
+{
+    struct tier *tier = promote_context;
+    if (tier->is_jit_failed)
+        return 0;
+    if (!tier->jit) {
+        tier->jit = jit_new(tier->engine);
+        tier->is_jit_failed = !tier->jit->instance || !_add_lowered_functions(tier);
+        if (tier->is_jit_failed)
+            return 0;
+    }
+    string name;
+    string_init_chars(&name, string_get(fun->name));
+    string_add_chars(&name, TIER_ENTRY_SUFFIX);
+    struct fun_pointer fp = jit_find_symbol(tier->jit, string_get(&name));
+    string_deinit(&name);
+    //the address is an object pointer, ISO C has no cast from it to a function pointer
+    interp_native_fun native;
+    memcpy(&native, &fp.fp.address, sizeof(native));
+    return native;
+}
+
+static struct eval_result _to_eval_result(enum type type, union interp_value v)
+{
+    struct eval_result result = { 0 };
+    if (is_int_type(type)) {
+        result.i_value = (int)v.i;
+        result.type = type;
+    } else if (type == TYPE_F64) {
+        result.d_value = v.d;
+        result.type = TYPE_F64;
+    }
+    return result;
+}
+
+struct eval_result tier_eval_module(struct tier *tier, struct ast_node *node)
+{
+    struct sema_context *context = tier->engine->fe->sema_context;
+    struct eval_result result = { 0 };
+    analyze(context, node);
+    if (get_last_error_report(context))
+        return result;
+    tier->interp.promote = _promote;
+    tier->interp.promote_context = tier;
+    struct interp_fun *start = interp_load(&tier->interp, node, to_symbol("_start"));
+    union interp_value v;
+    tier->is_interpreted = start && interp_call(&tier->interp, start, 0, &v);
+    if (tier->is_interpreted)
+        return _to_eval_result(get_return_type(context->tc, node->type), v);
+    if (tier->jit && tier->interp.promotions) {
+        //the promoted functions are defined in the jit already, the module runs in a new one
+        jit_free(tier->jit);
+        tier->jit = 0;
+    }
+    if (!tier->jit)
+        tier->jit = jit_new(tier->engine);
+    return eval_analyzed_module(tier->jit, node);
+}
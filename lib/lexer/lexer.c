@@ -11,9 +11,23 @@
 #include "clib/regex.h"
 #include "clib/win/libfmemopen.h"
 #include "app/error.h"
+#include "app/time_report.h"
 
 
-char escape_2_char[128];
+char _escape_2_char(char ch)
+{
+    switch(ch){
+    case 'n': return '\n';
+    case 't': return '\t';
+    case 'v': return '\v';
+    case 'b': return '\b';
+    case 'r': return '\r';
+    case 'f': return '\f';
+    case 'a': return '\a';
+    case '0': return '\0';
+    default: return ch;
+    }
+}
 
 void indent_level_stack_init(struct indent_level_stack *stack)
 {
@@ -52,28 +66,50 @@ int indent_level_stack_match(struct indent_level_stack *stack, u32 leading_space
     return 0;
 }
 
-struct lexer *lexer_new(FILE *file, const char *filename, const char *code, size_t code_size)
+/*
+ * slide the stream window to drop the text before the current token, then append at least
+ * one chunk of text from the stream, always ending at a line boundary or end of the stream.
+ * returns false if there is no more text to read.
+ */
+bool _fill_stream(struct lexer *lexer)
 {
-    if (code && code_size > CODE_BUFF_SIZE){
-        printf("only %d bytes of m code is allowed to parse, but here is the size of the code: %zu.\n",  CODE_BUFF_SIZE, code_size);
-        return 0;
+    if(!lexer->file || feof(lexer->file)) return false;
+    int keep_from = lexer->tok.loc.start - lexer->buff_base;
+    if(keep_from < 0 || keep_from > lexer->pos){
+        keep_from = lexer->pos;
     }
-    for(int i = 0; i < 128; i++){
-        escape_2_char[i] = i;
+    if(keep_from){
+        lexer->buff_size -= keep_from;
+        memmove(lexer->stream_buff, lexer->stream_buff + keep_from, lexer->buff_size);
+        lexer->buff_base += keep_from;
+        lexer->pos -= keep_from;
     }
-    escape_2_char['n'] = '\n';
-    escape_2_char['t'] = '\t';
-    escape_2_char['v'] = '\v';
-    escape_2_char['b'] = '\b';
-    escape_2_char['r'] = '\r';
-    escape_2_char['f'] = '\f';
-    escape_2_char['a'] = '\a';
-    escape_2_char['\\'] = '\\';
-    escape_2_char['?'] = '\?';
-    escape_2_char['\''] = '\'';
-    escape_2_char['\"'] = '\"';
-    escape_2_char['0'] = '\0';
+    int read = 0;
+    do{
+        if(lexer->stream_cap - lexer->buff_size < LEXER_STREAM_CHUNK + 1){
+            //the current token is longer than the window, grow it to keep the whole token
+            lexer->stream_cap = lexer->stream_cap * 2 + LEXER_STREAM_CHUNK + 1;
+            REALLOC(lexer->stream_buff, lexer->stream_buff, lexer->stream_cap);
+        }
+        char *dst = lexer->stream_buff + lexer->buff_size;
+        size_t n;
+        if(!read){
+            n = fread(dst, 1, LEXER_STREAM_CHUNK, lexer->file);
+        }else{
+            //complete the last line of the chunk
+            n = fgets(dst, LEXER_STREAM_CHUNK + 1, lexer->file) ? strlen(dst) : 0;
+        }
+        if(!n) break;
+        lexer->buff_size += n;
+        read += n;
+    }while(lexer->stream_buff[lexer->buff_size - 1] != '\n');
+    lexer->stream_buff[lexer->buff_size] = '\0';
+    lexer->buff = lexer->stream_buff;
+    return read > 0;
+}
 
+struct lexer *lexer_new(FILE *file, const char *filename, const char *code, size_t code_size)
+{
     struct lexer *lexer;
     MALLOC(lexer, sizeof(*lexer));
     lexer->buff_base = 0;
@@ -82,45 +118,31 @@ struct lexer *lexer_new(FILE *file, const char *filename, const char *code, size
     lexer->col = 1;
     lexer->file = file;
     lexer->filename = filename;
-    memset(lexer->buff, '\0', CODE_BUFF_SIZE + 1);
+    lexer->stream_buff = 0;
+    lexer->stream_cap = 0;
     lexer->tok.token_type = TOKEN_EOF;
+    lexer->tok.loc.start = 0;
     lexer->last_token_type = TOKEN_EOF;
     if(lexer->file){
         //fmemopen in MacOs will open empty string as null file handle
-        fgets(lexer->buff, CODE_BUFF_SIZE + 1, lexer->file);
+        lexer->stream_cap = 2 * LEXER_STREAM_CHUNK + 1;
+        MALLOC(lexer->stream_buff, lexer->stream_cap);
+        lexer->stream_buff[0] = '\0';
+        lexer->buff = lexer->stream_buff;
+        lexer->buff_size = 0;
+        _fill_stream(lexer);
     }else{
-        memcpy(lexer->buff, code, code_size);
+        //in-memory text is lexed in place
+        lexer->buff = code ? code : "";
+        lexer->buff_size = code ? (int)code_size : 0;
     }
 
     //init indent level stack
     indent_level_stack_init(&lexer->indent_stack);
     lexer->pending_dedents = 0;
-    //register pattern matcher for each character
-    char test[2]; test[1] = 0;
     struct token_patterns tps = get_token_patterns();
-    for(int i=0; i < 128; i++){
-        test[0] = (char)i;
-        struct pattern_matches *pm = &lexer->char_matches[i];
-        pm->pattern_match_count = 0;
-        for(size_t j = 0; j < tps.pattern_count; j++){
-            size_t matched_len;
-            if(tps.patterns[j].re){
-                regex_match(tps.patterns[j].re, test, &matched_len);
-                if(!matched_len) continue;
-                assert(pm->pattern_match_count < MAX_PATTERNS_PER_CHAR);
-                pm->patterns[pm->pattern_match_count++] = &tps.patterns[j];
-
-                //switch ident token to be the last one
-                if (pm->pattern_match_count > 1){
-                    struct token_pattern *ident_tp = pm->patterns[pm->pattern_match_count-2];
-                    if(ident_tp->token_type == TOKEN_IDENT){
-                        pm->patterns[pm->pattern_match_count-2] = pm->patterns[pm->pattern_match_count-1];
-                        pm->patterns[pm->pattern_match_count-1] = ident_tp;
-                    }
-                }
-            }
-        }
-    }
+    lexer->dfa = tps.dfa;
+    lexer->dfa_patterns = tps.dfa_patterns;
     array_init(&lexer->open_closes, sizeof(enum token_type));
     return lexer;
 }
@@ -143,7 +165,11 @@ void lexer_free(struct lexer *lexer)
     if(lexer->file){
         fclose(lexer->file);
     }
+    if(lexer->stream_buff){
+        FREE(lexer->stream_buff);
+    }
     array_deinit(&lexer->open_closes);
+    clear_error_reports(lexer);
     FREE(lexer);
 }
 
@@ -159,14 +185,9 @@ void _move_ahead(struct lexer *lexer)
             break;
     }
     lexer->pos++;
-    if(!lexer->buff[lexer->pos]){
-        //fgets
-        if(lexer->file && fgets(lexer->buff, CODE_BUFF_SIZE + 1, lexer->file)){
-            lexer->buff_base += lexer->pos;
-            lexer->pos = 0;
-        }else{
-            //end of file, we've done
-        }
+    if(lexer->pos >= lexer->buff_size && lexer->file){
+        //refill the stream window, or end of file, we've done
+        _fill_stream(lexer);
     }
 }
 
@@ -197,13 +218,13 @@ void _scan_untils(struct lexer *lexer, char until0, char until1)
 
 bool _scan_until_no_digit(struct lexer *lexer)
 {
-    const char *p = &lexer->buff[lexer->pos];
     bool has_dot = false;
+    char ch;
     do {
-        if(!has_dot && *p == '.') has_dot = true;
-        p++;
+        if(!has_dot && lexer->buff[lexer->pos] == '.') has_dot = true;
         _move_ahead(lexer); 
-    } while (isdigit(*p) || *p == '.');
+        ch = lexer->buff[lexer->pos];
+    } while (isdigit(ch) || ch == '.');
     return has_dot;
 }
 
@@ -250,19 +271,9 @@ void _mark_regex_tok(struct lexer *lexer)
         report_error(lexer, EC_UNRECOGNIZED_CHAR, tok->loc);
         return;
     }
-    struct pattern_matches *pm = &lexer->char_matches[(int)ch];
-    int max_matched = 0;
-    struct token_pattern *used_tp = 0;
-    for(int i = 0; i < pm->pattern_match_count; i++){
-        int matched = 0;
-        struct token_pattern *tp = 0;
-        tp = pm->patterns[i];
-        matched = regex_match(tp->re, &lexer->buff[lexer->pos], 0);
-        if(matched > max_matched){
-            max_matched = matched;
-            used_tp = tp;
-        }
-    }
+    int matched_re;
+    int max_matched = dfa_match(lexer->dfa, &lexer->buff[lexer->pos], &matched_re);
+    struct token_pattern *used_tp = max_matched ? lexer->dfa_patterns[matched_re] : 0;
     if(max_matched){
         _mark_token(lexer, used_tp->token_type, used_tp->opcode);
         _move_ahead_n(lexer, max_matched);
@@ -292,7 +303,7 @@ const char * _copy_string_strip_escape(const char *text, size_t len, size_t *out
     for(i=0; i<len; i++){
         if(text[i] == '\\'){
             i++;
-            dst[j++] = escape_2_char[(int)text[i]];
+            dst[j++] = _escape_2_char(text[i]);
         }else{
             dst[j++] = text[i];
         }
@@ -306,7 +317,7 @@ bool _is_valid_char(struct lexer *lexer)
 {
     int len = lexer->buff_base + lexer->pos - lexer->tok.loc.start;
     if (len == 3) return true;
-    if ((len == 4) && lexer->buff[lexer->tok.loc.start + 1] == '\\') return true;
+    if ((len == 4) && lexer->buff[lexer->tok.loc.start - lexer->buff_base + 1] == '\\') return true;
     return false;
 }
 
@@ -333,6 +344,7 @@ struct token *get_tok(struct lexer *lexer)
     do{
         tok = get_tok_with_comments(lexer);
     }while(is_comment_token(tok->token_type));
+    g_compile_counters.tokens++;
     return tok;
 }
 
@@ -403,7 +415,7 @@ struct token *get_tok_with_comments(struct lexer *lexer)
             goto mark_end;
         }
         if(lexer->buff[tok->loc.start - lexer->buff_base + 1] == '\\'){
-            lexer->tok.int_val = escape_2_char[(int)lexer->buff[tok->loc.start - lexer->buff_base + 2]];
+            lexer->tok.int_val = _escape_2_char(lexer->buff[tok->loc.start - lexer->buff_base + 2]);
         }else{
             lexer->tok.int_val = lexer->buff[tok->loc.start - lexer->buff_base + 1];
         }
@@ -17,6 +17,32 @@ struct token_pattern _token_patterns[TERMINAL_COUNT] = {
     #include "./m/m_token.operator.def"
 };
 
+struct dfa *_token_dfa = 0;
+struct token_pattern *_dfa_patterns[TERMINAL_COUNT];
+
+void _token_dfa_init(void)
+{
+    //ident token has lowest priority so that keywords win with the same matched length
+    void *res[TERMINAL_COUNT];
+    struct token_pattern *ident_tp = 0;
+    int re_count = 0;
+    for (int i = 0; i < TERMINAL_COUNT; i++) {
+        struct token_pattern *tp = &_token_patterns[i];
+        if(!tp->re) continue;
+        if(tp->token_type == TOKEN_IDENT){
+            ident_tp = tp;
+            continue;
+        }
+        _dfa_patterns[re_count] = tp;
+        res[re_count++] = tp->re;
+    }
+    if(ident_tp){
+        _dfa_patterns[re_count] = ident_tp;
+        res[re_count++] = ident_tp->re;
+    }
+    _token_dfa = dfa_new(res, re_count);
+}
+
 void token_init(void)
 {
     for (int i = 0; i < TERMINAL_COUNT; i++) {
@@ -29,10 +55,17 @@ void token_init(void)
             tp->symbol_name = to_symbol(tp->token_name);
         }
     }
+    if(!_token_dfa){
+        _token_dfa_init();
+    }
 }
 
 void token_deinit(void)
 {
+    if(_token_dfa){
+        dfa_free(_token_dfa);
+        _token_dfa = 0;
+    }
     for (int i = 0; i < TERMINAL_COUNT; i++) {
         struct token_pattern *tp = &_token_patterns[i];
         if(tp->re){
@@ -52,7 +85,7 @@ void tok_clean(struct token *tok)
 
 struct token_patterns get_token_patterns(void)
 {
-    struct token_patterns tps = { _token_patterns, TERMINAL_COUNT };
+    struct token_patterns tps = { _token_patterns, TERMINAL_COUNT, _token_dfa, _dfa_patterns };
     return tps;
 }
 
@@ -9,11 +9,37 @@
 #include "clib/array.h"
 #include "clib/string.h"
 #include "sema/eval.h"
+#include "clib/thread.h"
+#include "app/time_report.h"
 
 #include <assert.h>
 
 struct source_location default_loc = {0, 0, 0, 0};
 
+/*arena of the current compilation on this thread, nodes are allocated from the heap if not set*/
+static THREAD_LOCAL struct arena *_node_arena = 0;
+
+struct arena *ast_set_arena(struct arena *arena)
+{
+    struct arena *prev = _node_arena;
+    _node_arena = arena;
+    return prev;
+}
+
+struct arena *ast_get_arena(void)
+{
+    return _node_arena;
+}
+
+//node data has the same allocation as the node
+#define NODE_DATA_ALLOC(node, size) \
+    do { \
+        if ((node)->is_arena_alloc) \
+            (node)->data = arena_alloc(_node_arena, size); \
+        else \
+            MALLOC((node)->data, size); \
+    } while (0)
+
 //forward decl
 void nodes_free(struct array *nodes);
 
@@ -21,7 +47,12 @@ void nodes_free(struct array *nodes);
 struct ast_node *ast_node_new(enum node_type node_type, struct source_location loc)
 {
     struct ast_node *node;
-    MALLOC(node, sizeof(*node)); 
+    if (_node_arena)
+        node = arena_alloc(_node_arena, sizeof(*node));
+    else
+        MALLOC(node, sizeof(*node));
+    g_compile_counters.nodes++;
+    node->is_arena_alloc = _node_arena != 0;
     node->node_type = node_type;
     node->type = 0;
     node->loc = loc;
@@ -38,11 +69,13 @@ struct ast_node *ast_node_new(enum node_type node_type, struct source_location l
 void ast_node_free(struct ast_node *node)
 {
     if(!node) return;
-    if(node->data)
-        FREE(node->data);
     if(node->transformed){
         node_free(node->transformed);
     }
+    //arena nodes are released with the arena
+    if(node->is_arena_alloc) return;
+    if(node->data)
+        FREE(node->data);
     FREE(node);
 }
 
@@ -70,7 +103,7 @@ struct type_item *get_ret_type(struct ast_node *fun_node)
 struct ast_node *token_node_new(enum token_type tt, enum op_code token_op, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TOKEN_NODE, loc);
-    MALLOC(node->token, sizeof(*node->token));
+    NODE_DATA_ALLOC(node, sizeof(*node->token));
     node->token->token_type = tt;
     node->token->token_op = token_op;
     return node;
@@ -128,7 +161,7 @@ struct array to_symbol_array(struct array arr)
 struct ast_node *ident_node_new(symbol name, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(IDENT_NODE, loc);
-    MALLOC(node->ident, sizeof(*node->ident));
+    NODE_DATA_ALLOC(node, sizeof(*node->ident));
     node->ident->name = name;
     node->ident->var = 0;
     node->ident->is_member_index_object = false;
@@ -151,7 +184,7 @@ void _free_ident_node(struct ast_node *node)
 struct ast_node *type_item_node_new_with_type_name(symbol type_name, enum Mut mut, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_ITEM_NODE, loc);
-    MALLOC(node->type_item_node, sizeof(*node->type_item_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_item_node));
     node->type_item_node->kind = TypeName;
     node->type_item_node->mut = mut;
     node->type_item_node->type_name = type_name;
@@ -161,7 +194,7 @@ struct ast_node *type_item_node_new_with_type_name(symbol type_name, enum Mut mu
 struct ast_node *type_item_node_new_with_array_type(struct array_type_node *array_type_node, enum Mut mut, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_ITEM_NODE, loc);
-    MALLOC(node->type_item_node, sizeof(*node->type_item_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_item_node));
     node->type_item_node->kind = ArrayType;
     node->type_item_node->mut = mut;
     node->type_item_node->array_type_node = array_type_node;
@@ -171,7 +204,7 @@ struct ast_node *type_item_node_new_with_array_type(struct array_type_node *arra
 struct ast_node *type_item_node_new_with_tuple_type(struct ast_node *tuple_block, enum Mut mut, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_ITEM_NODE, loc);
-    MALLOC(node->type_item_node, sizeof(*node->type_item_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_item_node));
     node->type_item_node->kind = TupleType;
     node->type_item_node->mut = mut;
     node->type_item_node->tuple_block = tuple_block;
@@ -181,7 +214,7 @@ struct ast_node *type_item_node_new_with_tuple_type(struct ast_node *tuple_block
 struct ast_node *type_item_node_new_with_ref_type(struct type_item_node *val_node, enum Mut mut, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_ITEM_NODE, loc);
-    MALLOC(node->type_item_node, sizeof(*node->type_item_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_item_node));
     node->type_item_node->kind = RefType;
     node->type_item_node->mut = mut;
     node->type_item_node->val_node = val_node;
@@ -191,7 +224,7 @@ struct ast_node *type_item_node_new_with_ref_type(struct type_item_node *val_nod
 struct ast_node *type_item_node_new_with_builtin_type(symbol type_name, enum Mut mut, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_ITEM_NODE, loc);
-    MALLOC(node->type_item_node, sizeof(*node->type_item_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_item_node));
     node->type_item_node->kind = BuiltinType;
     node->type_item_node->mut = mut;
     node->type_item_node->array_type_node = 0;
@@ -215,16 +248,20 @@ struct ast_node *_copy_type_item_node(struct ast_node *orig_node)
     }
 }
 
-void _free_real_type_item_node(struct type_item_node *type_item_node)
+//array type and ref type data are moved from other nodes created in the same parse, so they are
+//in the arena if the owning node is
+void _free_real_type_item_node(struct type_item_node *type_item_node, bool is_arena_alloc)
 {
     if(!type_item_node) return;
     if(type_item_node->kind == ArrayType){
         node_free(type_item_node->array_type_node->dims);
         node_free(type_item_node->array_type_node->elm_type);
-        FREE(type_item_node->array_type_node);
+        if(!is_arena_alloc)
+            FREE(type_item_node->array_type_node);
     } else if(type_item_node->kind == RefType){
-        _free_real_type_item_node(type_item_node->val_node);
-        FREE(type_item_node->val_node);
+        _free_real_type_item_node(type_item_node->val_node, is_arena_alloc);
+        if(!is_arena_alloc)
+            FREE(type_item_node->val_node);
     } else if(type_item_node->kind == TupleType){
         node_free(type_item_node->tuple_block);
     }
@@ -232,14 +269,14 @@ void _free_real_type_item_node(struct type_item_node *type_item_node)
 
 void _free_type_item_node(struct ast_node *node)
 {
-    _free_real_type_item_node(node->type_item_node);
+    _free_real_type_item_node(node->type_item_node, node->is_arena_alloc);
     ast_node_free(node);
 }
 
 struct ast_node *type_node_new(symbol type_name, struct ast_node *type_body, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_NODE, loc);
-    MALLOC(node->type_node, sizeof(*node->type_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_node));
     node->type_node->type_name = type_name;
     node->type_node->type_body = type_body;
     return node;
@@ -259,8 +296,10 @@ void _free_type_node(struct ast_node *node)
 struct ast_node *_create_literal_int_node(struct type_context *tc, int val, enum type type, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(LITERAL_NODE, loc);
-    MALLOC(node->liter, sizeof(*node->liter));
+    NODE_DATA_ALLOC(node, sizeof(*node->liter));
     node->type = create_nullary_type(tc, type);
+    //clear the whole value so an int literal later read as f64 does not pick up stale bytes
+    memset(node->liter, 0, sizeof(*node->liter));
     node->liter->type = type;
     switch (type){ 
         case TYPE_INT:
@@ -282,7 +321,7 @@ struct ast_node *_create_literal_int_node(struct type_context *tc, int val, enum
 struct ast_node *_create_literal_node(struct type_context *tc, void *val, enum type type, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(LITERAL_NODE, loc);
-    MALLOC(node->liter, sizeof(*node->liter));
+    NODE_DATA_ALLOC(node, sizeof(*node->liter));
     node->type = create_nullary_type(tc, type);
     node->liter->type = type;
     switch (type){ 
@@ -370,7 +409,7 @@ struct ast_node *var_node_new(struct ast_node *var, struct ast_node *is_of_type,
     struct ast_node *init_value, bool is_global, enum Mut mut, struct source_location loc)
 {   
     struct ast_node *node = ast_node_new(VAR_NODE, loc);
-    MALLOC(node->var, sizeof(*node->var));
+    NODE_DATA_ALLOC(node, sizeof(*node->var));
     node->var->var = var;
     node->var->init_value = init_value;
     node->var->is_of_type = is_of_type;
@@ -403,7 +442,7 @@ void _free_var_node(struct ast_node *node)
 struct ast_node *adt_node_new(enum node_type node_type, symbol name, struct ast_node *body, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(node_type, loc);
-    MALLOC(node->adt_type, sizeof(*node->adt_type));
+    NODE_DATA_ALLOC(node, sizeof(*node->adt_type));
     node->adt_type->name = name;
     node->adt_type->body = body;
     node->adt_type->kind = node_type == VARIANT_NODE ? Sum : Product;
@@ -425,7 +464,7 @@ void _free_adt_node(struct ast_node *node)
 struct ast_node *variant_type_node_new(enum UnionKind kind, symbol tag, struct ast_node *tag_value, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(VARIANT_TYPE_ITEM_NODE, loc);
-    MALLOC(node->variant_type_node, sizeof(*node->variant_type_node));
+    NODE_DATA_ALLOC(node, sizeof(*node->variant_type_node));
     node->variant_type_node->tag = tag;
     node->variant_type_node->tag_value=tag_value;
     node->variant_type_node->kind = kind;
@@ -447,7 +486,7 @@ void _free_variant_type_node(struct ast_node *node)
 struct ast_node *adt_init_node_new(enum ADTInitKind kind, struct ast_node *body, struct ast_node *type_item_node, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(ADT_INIT_NODE, loc);
-    MALLOC(node->adt_init, sizeof(*node->adt_init));
+    NODE_DATA_ALLOC(node, sizeof(*node->adt_init));
     node->adt_init->body = body;
     node->adt_init->kind = kind;
     node->adt_init->is_of_type = type_item_node;
@@ -471,7 +510,7 @@ void _free_adt_init_node(struct ast_node *node)
 struct ast_node *range_node_new(struct ast_node *start, struct ast_node *end, struct ast_node *step, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(RANGE_NODE, loc);
-    MALLOC(node->range, sizeof(*node->range));
+    NODE_DATA_ALLOC(node, sizeof(*node->range));
     node->range->start = start;
     node->range->end = end;
     node->range->step = step;
@@ -517,7 +556,7 @@ void _free_array_init_node(struct ast_node *node)
 struct ast_node *array_type_node_new(struct ast_node *elm_type, struct ast_node *dims, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(ARRAY_TYPE_NODE, loc);
-    MALLOC(node->array_type, sizeof(*node->array_type));
+    NODE_DATA_ALLOC(node, sizeof(*node->array_type));
     node->array_type->elm_type = elm_type;
     node->array_type->dims = dims;
     return node;
@@ -542,7 +581,7 @@ void _free_array_type_node(struct ast_node *node)
 struct ast_node *type_expr_item_node_new(struct ast_node *ident, struct ast_node *is_of_type, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(TYPE_EXPR_ITEM_NODE, loc);
-    MALLOC(node->type_expr_item, sizeof(*node->type_expr_item));
+    NODE_DATA_ALLOC(node, sizeof(*node->type_expr_item));
     node->type_expr_item->ident = ident;
     node->type_expr_item->is_of_type = is_of_type;
     return node;
@@ -565,7 +604,7 @@ void _free_type_expr_item_node(struct ast_node *node)
 struct ast_node *import_node_new(symbol from_module, struct ast_node *imported, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(IMPORT_NODE, loc);
-    MALLOC(node->import, sizeof(*node->import));
+    NODE_DATA_ALLOC(node, sizeof(*node->import));
     node->import->import = imported;
     node->import->from_module = from_module;
     return node;
@@ -587,7 +626,7 @@ void _free_import_node(struct ast_node *node)
 struct ast_node *memory_node_new(struct ast_node *initial, struct ast_node *max, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(MEMORY_NODE, loc);
-    MALLOC(node->memory, sizeof(*node->memory));
+    NODE_DATA_ALLOC(node, sizeof(*node->memory));
     node->memory->initial = initial;
     node->memory->max = max;
     return node;
@@ -614,7 +653,7 @@ struct ast_node *call_node_new(symbol callee,
 {
     assert(arg_block);
     struct ast_node *node = ast_node_new(CALL_NODE, loc);
-    MALLOC(node->call, sizeof(*node->call));
+    NODE_DATA_ALLOC(node, sizeof(*node->call));
     node->call->callee = callee;
     node->call->arg_block = arg_block;
     node->call->specialized_callee = 0;
@@ -653,7 +692,7 @@ struct ast_node *func_type_item_node_new(struct type_context *tc,
     bool is_variadic, bool is_external, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(FUNC_TYPE_NODE, loc);
-    MALLOC(node->ft, sizeof(*node->ft));
+    NODE_DATA_ALLOC(node, sizeof(*node->ft));
     node->ft->name = name;
     node->ft->params = params;
     node->ft->ret_type_item_node = ret_type_item_node;
@@ -675,7 +714,7 @@ struct ast_node *func_type_item_node_new(struct type_context *tc,
 struct ast_node *_copy_func_type_node(struct type_context *tc, struct ast_node *func_type)
 {
     struct ast_node *node = ast_node_new(func_type->node_type, func_type->loc);
-    MALLOC(node->ft, sizeof(*node->ft));
+    NODE_DATA_ALLOC(node, sizeof(*node->ft));
     node->ft->name = func_type->ft->name;
     node->ft->params = _copy_block_node(tc, func_type->ft->params);
     node->ft->is_operator = func_type->ft->is_operator;
@@ -709,7 +748,7 @@ struct ast_node *function_node_new(struct ast_node *func_type,
     struct ast_node *body, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(FUNC_NODE, loc);
-    MALLOC(node->func, sizeof(*node->func));
+    NODE_DATA_ALLOC(node, sizeof(*node->func));
     node->func->func_type = func_type;
     node->func->body = body;
     array_init_free(&node->func->sp_funs, sizeof(struct ast_node*), _free_sp);
@@ -749,7 +788,7 @@ struct ast_node *if_node_new(
     struct ast_node *if_node, struct ast_node *then_node, struct ast_node *else_node, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(IF_NODE, loc);
-    MALLOC(node->cond, sizeof(*node->cond));
+    NODE_DATA_ALLOC(node, sizeof(*node->cond));
     node->cond->if_node = if_node;
     node->cond->then_node = then_node;
     node->cond->else_node = else_node;
@@ -777,7 +816,7 @@ struct ast_node *match_node_new(struct ast_node *test_expr, struct ast_node *mat
     struct source_location loc)
 {
     struct ast_node *node = ast_node_new(MATCH_NODE, loc);
-    MALLOC(node->match, sizeof(*node->match));
+    NODE_DATA_ALLOC(node, sizeof(*node->match));
     node->match->test_expr = test_expr;
     node->match->match_cases = match_cases;
     return node;
@@ -802,7 +841,7 @@ struct ast_node *match_item_node_new(struct ast_node *pattern, struct ast_node *
     struct source_location loc)
 {
     struct ast_node *node = ast_node_new(MATCH_CASE_NODE, loc);
-    MALLOC(node->match_case, sizeof(*node->match_case));
+    NODE_DATA_ALLOC(node, sizeof(*node->match_case));
     node->match_case->pattern = pattern;
     node->match_case->guard = cond_expr;
     node->match_case->expr = expr;
@@ -827,7 +866,7 @@ void _free_match_item_node(struct ast_node *node)
 struct ast_node *unary_node_new(enum op_code opcode, struct ast_node *operand, bool is_postfix, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(UNARY_NODE, loc);
-    MALLOC(node->unop, sizeof(*node->unop));
+    NODE_DATA_ALLOC(node, sizeof(*node->unop));
     node->unop->opcode = opcode;
     node->unop->operand = operand;
     node->unop->is_postfix = is_postfix;
@@ -852,7 +891,7 @@ void _free_unary_node(struct ast_node *node)
 struct ast_node *binary_node_new(enum op_code opcode, struct ast_node *lhs, struct ast_node *rhs, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(BINARY_NODE, loc);
-    MALLOC(node->binop, sizeof(*node->binop));
+    NODE_DATA_ALLOC(node, sizeof(*node->binop));
     node->binop->opcode = opcode;
     node->binop->lhs = lhs;
     node->binop->rhs = rhs;
@@ -877,7 +916,7 @@ void _free_binary_node(struct ast_node *node)
 struct ast_node *assign_node_new(enum op_code opcode, struct ast_node *lhs, struct ast_node *rhs, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(ASSIGN_NODE, loc);
-    MALLOC(node->binop, sizeof(*node->binop));
+    NODE_DATA_ALLOC(node, sizeof(*node->binop));
     node->binop->opcode = opcode;
     node->binop->lhs = lhs;
     node->binop->rhs = rhs;
@@ -902,7 +941,7 @@ void _free_assign_node(struct ast_node *node)
 struct ast_node *cast_node_new(struct ast_node *to_type_item_node, struct ast_node *expr, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(CAST_NODE, loc);
-    MALLOC(node->cast, sizeof(*node->cast));
+    NODE_DATA_ALLOC(node, sizeof(*node->cast));
     node->cast->to_type_item_node = to_type_item_node;
     node->cast->expr = expr;
     return node;
@@ -926,7 +965,7 @@ void _free_cast_node(struct ast_node *node)
 struct ast_node *member_index_node_new(enum IndexType index_type, struct ast_node *object, struct ast_node *index, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(MEMBER_INDEX_NODE, loc);
-    MALLOC(node->index, sizeof(*node->index));
+    NODE_DATA_ALLOC(node, sizeof(*node->index));
     if(object->node_type == IDENT_NODE){
         object->ident->is_member_index_object = true;
     }
@@ -1001,10 +1040,13 @@ struct ast_node *for_node_new(struct ast_node *var, struct ast_node *range,
     struct ast_node *body, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(FOR_NODE, loc);
-    MALLOC(node->forloop, sizeof(*node->forloop));
+    NODE_DATA_ALLOC(node, sizeof(*node->forloop));
     node->forloop->var = var;
     node->forloop->range = range;
     node->forloop->body = body;
+    node->forloop->step_sign = 0;
+    node->forloop->trip_count = -1;
+    node->forloop->is_end_invariant = false;
     return node;
 }
 
@@ -1029,7 +1071,7 @@ void _free_for_node(struct ast_node *node)
 struct ast_node *while_node_new(struct ast_node *expr, struct ast_node *body, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(WHILE_NODE, loc);
-    MALLOC(node->whileloop, sizeof(*node->whileloop));
+    NODE_DATA_ALLOC(node, sizeof(*node->whileloop));
     node->whileloop->expr = expr;
     node->whileloop->body = body;
     return node;
@@ -1052,7 +1094,7 @@ void _free_while_node(struct ast_node *node)
 struct ast_node *jump_node_new(enum token_type token_type, struct ast_node *expr, struct source_location loc)
 {
     struct ast_node *node = ast_node_new(JUMP_NODE, loc);
-    MALLOC(node->jump, sizeof(*node->jump));
+    NODE_DATA_ALLOC(node, sizeof(*node->jump));
     node->jump->token_type = token_type;
     node->jump->expr = expr;
     node->jump->nested_block_levels = 0;
@@ -1076,7 +1118,7 @@ struct ast_node *block_node_new(struct array *nodes)
 {
     struct source_location loc = (nodes && array_size(nodes) > 0) ? ((struct ast_node*)array_front_ptr(nodes))->loc : default_loc;
     struct ast_node *node = ast_node_new(BLOCK_NODE, loc);
-    MALLOC(node->block, sizeof(*node->block));
+    NODE_DATA_ALLOC(node, sizeof(*node->block));
     if(nodes)
         node->block->nodes = *nodes;
     return node;
@@ -1215,7 +1257,7 @@ void node_free(struct ast_node *node)
     if (!node) return;
     switch (node->node_type) {
     case NULL_NODE:
-        FREE(node);
+        ast_node_free(node);
         break;
     case TOKEN_NODE:
         _free_token_node(node);
@@ -0,0 +1,727 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * binary save/load of parsed ast trees
+ */
+#include "parser/ast_serialize.h"
+#include "clib/array.h"
+#include "clib/hash.h"
+#include "clib/hashtable.h"
+#include "clib/string.h"
+#include <string.h>
+
+struct _ast_writer {
+    struct type_context *tc;
+    struct array records; //struct ast_record
+    struct array lists; //u32 child references of blocks
+    struct array name_offsets; //u32
+    struct byte_array names;
+    struct hashtable name_index; //name chars -> u32 reference
+    bool ok;
+};
+
+u32 _write_name(struct _ast_writer *w, const char *name)
+{
+    if (!name)
+        return 0;
+    size_t len = strlen(name);
+    u32 *ref = hashtable_get2(&w->name_index, name, len);
+    if (ref)
+        return *ref;
+    u32 offset = w->names.size;
+    ba_add_array(&w->names, (u8 *)name, (u32)len + 1);
+    array_push(&w->name_offsets, &offset);
+    u32 new_ref = (u32)array_size(&w->name_offsets);
+    hashtable_set_g(&w->name_index, (void *)name, len, &new_ref, sizeof(new_ref));
+    return new_ref;
+}
+
+u32 _write_symbol(struct _ast_writer *w, symbol name)
+{
+    return name ? _write_name(w, string_get(name)) : 0;
+}
+
+u32 _add_record(struct _ast_writer *w, struct ast_record *record)
+{
+    array_push(&w->records, record);
+    return (u32)array_size(&w->records);
+}
+
+void _init_record(struct ast_record *record, enum node_type node_type, struct source_location loc)
+{
+    memset(record, 0, sizeof(*record));
+    record->node_type = (u8)node_type;
+    record->loc = loc;
+}
+
+//only nullary types are created by the parser, others come from analysis and are not saved
+u32 _type_ref(struct type_context *tc, struct type_item *type)
+{
+    if (!type || type->kind != KIND_OPER || type->val_type || array_size(&type->args))
+        return 0;
+    if (type->name != get_type_symbol(tc, type->type))
+        return 0;
+    return (u32)type->type + 1;
+}
+
+u32 _write_node(struct _ast_writer *w, struct ast_node *node);
+
+//array type of a type item node, saved as an array type record whose data is taken over on load
+u32 _write_array_type_data(struct _ast_writer *w, struct array_type_node *array_type, struct source_location loc)
+{
+    struct ast_record record;
+    u32 elm_type = _write_node(w, array_type->elm_type);
+    u32 dims = _write_node(w, array_type->dims);
+    _init_record(&record, ARRAY_TYPE_NODE, loc);
+    record.refs[0] = elm_type;
+    record.refs[1] = dims;
+    return _add_record(w, &record);
+}
+
+u32 _write_type_item_data(struct _ast_writer *w, struct type_item_node *ti, struct source_location loc, u8 flags, u32 type)
+{
+    struct ast_record record;
+    u32 ref = 0;
+    switch (ti->kind) {
+    case BuiltinType:
+    case TypeName:
+        ref = _write_symbol(w, ti->type_name);
+        break;
+    case ArrayType:
+        ref = _write_array_type_data(w, ti->array_type_node, loc);
+        break;
+    case TupleType:
+        ref = _write_node(w, ti->tuple_block);
+        break;
+    case RefType:
+        //the value type item is saved as a type item record whose data is taken over on load
+        ref = _write_type_item_data(w, ti->val_node, loc, 0, 0);
+        break;
+    }
+    _init_record(&record, TYPE_ITEM_NODE, loc);
+    record.flags = flags;
+    record.type = type;
+    record.kind = (u8)ti->kind;
+    record.kind2 = (u8)ti->mut;
+    record.refs[0] = ref;
+    return _add_record(w, &record);
+}
+
+u8 _node_flags(struct ast_node *node)
+{
+    u8 flags = 0;
+    if (node->is_addressed)
+        flags |= AST_FLAG_ADDRESSED;
+    if (node->is_ret)
+        flags |= AST_FLAG_RET;
+    if (node->is_lvalue)
+        flags |= AST_FLAG_LVALUE;
+    if (node->is_addressable)
+        flags |= AST_FLAG_ADDRESSABLE;
+    if (node->is_heap_alloc)
+        flags |= AST_FLAG_HEAP_ALLOC;
+    return flags;
+}
+
+u32 _write_node(struct _ast_writer *w, struct ast_node *node)
+{
+    if (!node)
+        return 0;
+    struct ast_record record;
+    u32 refs[AST_RECORD_REFS] = { 0 };
+    u8 kind = 0, kind2 = 0;
+    switch (node->node_type) {
+    case NULL_NODE:
+    case WILDCARD_NODE:
+        break;
+    case TOKEN_NODE:
+        refs[0] = node->token->token_type;
+        refs[1] = node->token->token_op;
+        break;
+    case IMPORT_NODE:
+        refs[0] = _write_symbol(w, node->import->from_module);
+        refs[1] = _write_node(w, node->import->import);
+        break;
+    case MEMORY_NODE:
+        refs[0] = _write_node(w, node->memory->initial);
+        refs[1] = _write_node(w, node->memory->max);
+        break;
+    case LITERAL_NODE:
+        kind = (u8)node->liter->type;
+        if (node->liter->type == TYPE_STRING)
+            refs[0] = _write_name(w, node->liter->str_val);
+        else if (node->liter->type == TYPE_F64 || node->liter->type == TYPE_F32)
+            memcpy(refs, &node->liter->double_val, sizeof(node->liter->double_val));
+        else
+            refs[0] = (u32)node->liter->int_val;
+        break;
+    case IDENT_NODE:
+        refs[0] = _write_symbol(w, node->ident->name);
+        kind = node->ident->is_member_index_object;
+        break;
+    case VAR_NODE:
+        refs[0] = _write_node(w, node->var->var);
+        refs[1] = _write_node(w, node->var->is_of_type);
+        refs[2] = _write_node(w, node->var->init_value);
+        kind = (u8)node->var->mut;
+        kind2 = node->var->is_global;
+        break;
+    case CAST_NODE:
+        refs[0] = _write_node(w, node->cast->to_type_item_node);
+        refs[1] = _write_node(w, node->cast->expr);
+        break;
+    case STRUCT_NODE:
+    case VARIANT_NODE:
+        refs[0] = _write_symbol(w, node->adt_type->name);
+        refs[1] = _write_node(w, node->adt_type->body);
+        break;
+    case VARIANT_TYPE_ITEM_NODE:
+        refs[0] = _write_symbol(w, node->variant_type_node->tag);
+        refs[1] = _write_node(w, node->variant_type_node->tag_value);
+        refs[2] = (u32)node->variant_type_node->tag_repr;
+        kind = (u8)node->variant_type_node->kind;
+        break;
+    case ADT_INIT_NODE:
+        refs[0] = _write_node(w, node->adt_init->is_of_type);
+        refs[1] = _write_node(w, node->adt_init->body);
+        kind = (u8)node->adt_init->kind;
+        break;
+    case ARRAY_INIT_NODE:
+        refs[0] = _write_node(w, node->array_init);
+        break;
+    case NEW_NODE:
+        refs[0] = _write_node(w, node->new_node);
+        break;
+    case DEL_NODE:
+        refs[0] = _write_node(w, node->del_node);
+        break;
+    case ARRAY_TYPE_NODE:
+        if (node->array_type) {
+            refs[0] = _write_node(w, node->array_type->elm_type);
+            refs[1] = _write_node(w, node->array_type->dims);
+        }
+        break;
+    case TYPE_EXPR_ITEM_NODE:
+        refs[0] = _write_node(w, node->type_expr_item->ident);
+        refs[1] = _write_node(w, node->type_expr_item->is_of_type);
+        break;
+    case TYPE_ITEM_NODE:
+        return _write_type_item_data(w, node->type_item_node, node->loc, _node_flags(node), _type_ref(w->tc, node->type));
+    case TYPE_NODE:
+        refs[0] = _write_symbol(w, node->type_node->type_name);
+        refs[1] = _write_node(w, node->type_node->type_body);
+        break;
+    case RANGE_NODE:
+        refs[0] = _write_node(w, node->range->start);
+        refs[1] = _write_node(w, node->range->end);
+        refs[2] = _write_node(w, node->range->step);
+        break;
+    case UNARY_NODE:
+        refs[0] = _write_node(w, node->unop->operand);
+        refs[1] = node->unop->opcode;
+        kind = node->unop->is_postfix;
+        break;
+    case BINARY_NODE:
+    case ASSIGN_NODE:
+        refs[0] = _write_node(w, node->binop->lhs);
+        refs[1] = _write_node(w, node->binop->rhs);
+        refs[2] = node->binop->opcode;
+        break;
+    case MEMBER_INDEX_NODE:
+        refs[0] = _write_node(w, node->index->object);
+        refs[1] = _write_node(w, node->index->index);
+        kind = (u8)node->index->index_type;
+        break;
+    case IF_NODE:
+        refs[0] = _write_node(w, node->cond->if_node);
+        refs[1] = _write_node(w, node->cond->then_node);
+        refs[2] = _write_node(w, node->cond->else_node);
+        break;
+    case MATCH_NODE:
+        refs[0] = _write_node(w, node->match->test_expr);
+        refs[1] = _write_node(w, node->match->match_cases);
+        break;
+    case MATCH_CASE_NODE:
+        refs[0] = _write_node(w, node->match_case->pattern);
+        refs[1] = _write_node(w, node->match_case->guard);
+        refs[2] = _write_node(w, node->match_case->expr);
+        break;
+    case FOR_NODE:
+        refs[0] = _write_node(w, node->forloop->var);
+        refs[1] = _write_node(w, node->forloop->range);
+        refs[2] = _write_node(w, node->forloop->body);
+        break;
+    case WHILE_NODE:
+        refs[0] = _write_node(w, node->whileloop->expr);
+        refs[1] = _write_node(w, node->whileloop->body);
+        break;
+    case JUMP_NODE:
+        refs[0] = node->jump->token_type;
+        refs[1] = _write_node(w, node->jump->expr);
+        refs[2] = node->jump->nested_block_levels;
+        break;
+    case CALL_NODE:
+        refs[0] = _write_symbol(w, node->call->callee);
+        refs[1] = _write_symbol(w, node->call->specialized_callee);
+        refs[2] = _write_node(w, node->call->arg_block);
+        break;
+    case FUNC_TYPE_NODE:
+        refs[0] = _write_symbol(w, node->ft->name);
+        refs[1] = _write_symbol(w, node->ft->op);
+        refs[2] = _write_node(w, node->ft->params);
+        refs[3] = _write_node(w, node->ft->ret_type_item_node);
+        refs[4] = (u32)node->ft->precedence;
+        kind = (u8)node->ft->is_operator;
+        kind2 = (u8)(node->ft->is_variadic | node->ft->is_extern << 1);
+        break;
+    case FUNC_NODE:
+        refs[0] = _write_node(w, node->func->func_type);
+        refs[1] = _write_node(w, node->func->body);
+        break;
+    case BLOCK_NODE:
+    {
+        size_t count = array_size(&node->block->nodes);
+        u32 *children;
+        MALLOC(children, (count ? count : 1) * sizeof(u32));
+        for (size_t i = 0; i < count; i++) {
+            children[i] = _write_node(w, array_get_ptr(&node->block->nodes, i));
+        }
+        refs[0] = (u32)array_size(&w->lists) + 1;
+        refs[1] = (u32)count;
+        for (size_t i = 0; i < count; i++) {
+            array_push(&w->lists, &children[i]);
+        }
+        FREE(children);
+        break;
+    }
+    case TOTAL_NODE:
+        w->ok = false;
+        return 0;
+    }
+    _init_record(&record, node->node_type, node->loc);
+    record.flags = _node_flags(node);
+    record.type = _type_ref(w->tc, node->type);
+    record.kind = kind;
+    record.kind2 = kind2;
+    memcpy(record.refs, refs, sizeof(refs));
+    return _add_record(w, &record);
+}
+
+bool ast_serialize(struct type_context *tc, struct ast_node *node, struct byte_array *out)
+{
+    struct _ast_writer w;
+    w.tc = tc;
+    w.ok = true;
+    array_init(&w.records, sizeof(struct ast_record));
+    array_init(&w.lists, sizeof(u32));
+    array_init(&w.name_offsets, sizeof(u32));
+    ba_init(&w.names, 256);
+    hashtable_init_with_value_size(&w.name_index, sizeof(u32), 0);
+    struct ast_file_header header;
+    memset(&header, 0, sizeof(header));
+    header.root = _write_node(&w, node);
+    if (w.ok) {
+        header.magic = AST_FILE_MAGIC;
+        header.version = AST_FILE_VERSION;
+        header.record_size = sizeof(struct ast_record);
+        header.name_count = (u32)array_size(&w.name_offsets);
+        header.names_size = w.names.size;
+        header.node_count = (u32)array_size(&w.records);
+        header.list_size = (u32)array_size(&w.lists);
+        size_t offsets_size = header.name_count * sizeof(u32);
+        size_t lists_size = header.list_size * sizeof(u32);
+        size_t records_size = header.node_count * sizeof(struct ast_record);
+        struct byte_array body;
+        body.size = (u32)(offsets_size + lists_size + records_size + header.names_size);
+        body.cap = body.size;
+        MALLOC(body.data, body.size ? body.size : 1);
+        u8 *p = body.data;
+        memcpy(p, array_get(&w.name_offsets, 0), offsets_size);
+        p += offsets_size;
+        memcpy(p, array_get(&w.lists, 0), lists_size);
+        p += lists_size;
+        memcpy(p, array_get(&w.records, 0), records_size);
+        p += records_size;
+        memcpy(p, w.names.data, header.names_size);
+        header.checksum = hash64(body.data, body.size);
+        //the header is 8-byte aligned relative to the start of out, the sections follow it 4-byte aligned
+        while (out->size & 7)
+            ba_add(out, 0);
+        struct byte_array head = { sizeof(header), (u8 *)&header, sizeof(header) };
+        ba_add2(out, &head);
+        ba_add2(out, &body);
+        FREE(body.data);
+    }
+    hashtable_deinit(&w.name_index);
+    ba_deinit(&w.names);
+    array_deinit(&w.name_offsets);
+    array_deinit(&w.lists);
+    array_deinit(&w.records);
+    return w.ok;
+}
+
+struct _ast_reader {
+    struct type_context *tc;
+    const struct ast_file_header *header;
+    const u32 *name_offsets;
+    const u32 *lists;
+    const struct ast_record *records;
+    const char *names;
+    symbol *symbols; //interned names, created on first use
+    struct ast_node **nodes;
+};
+
+//checks that a reference to a node points to an earlier record and that each record is used once
+bool _check_node_ref(u32 ref, u32 index, u8 *used)
+{
+    if (!ref)
+        return true;
+    if (ref > index || used[ref - 1])
+        return false;
+    used[ref - 1] = 1;
+    return true;
+}
+
+//a child the constructors look into has to be present and of the expected node type
+bool _check_typed_ref(struct _ast_reader *r, u32 ref, u32 index, u8 *used, enum node_type node_type)
+{
+    return ref && _check_node_ref(ref, index, used) && r->records[ref - 1].node_type == node_type;
+}
+
+bool _check_name_ref(struct _ast_reader *r, u32 ref)
+{
+    return !ref || (ref <= r->header->name_count && r->name_offsets[ref - 1] < r->header->names_size);
+}
+
+//bound checks of every reference so that loading cannot go out of the buffer
+bool _check_records(struct _ast_reader *r)
+{
+    const struct ast_file_header *h = r->header;
+    if (h->names_size && r->names[h->names_size - 1])
+        return false;
+    for (u32 i = 0; i < h->name_count; i++) {
+        if (r->name_offsets[i] >= h->names_size)
+            return false;
+    }
+    u8 *used;
+    CALLOC(used, h->node_count + 1, 1);
+    bool ok = h->root && h->root <= h->node_count;
+    for (u32 i = 0; ok && i < h->node_count; i++) {
+        const struct ast_record *record = &r->records[i];
+        const u32 *refs = record->refs;
+        if (record->node_type >= TOTAL_NODE) {
+            ok = false;
+            break;
+        }
+        switch (record->node_type) {
+        case NULL_NODE:
+        case WILDCARD_NODE:
+        case TOKEN_NODE:
+            break;
+        case LITERAL_NODE:
+            ok = record->kind < TYPE_TYPES && (record->kind != TYPE_STRING || (refs[0] && _check_name_ref(r, refs[0])));
+            break;
+        case IDENT_NODE:
+        case TYPE_NODE:
+        case STRUCT_NODE:
+        case VARIANT_NODE:
+        case IMPORT_NODE:
+        case VARIANT_TYPE_ITEM_NODE:
+            ok = _check_name_ref(r, refs[0]) && _check_node_ref(refs[1], i, used);
+            break;
+        case TYPE_ITEM_NODE:
+            if (record->kind == BuiltinType || record->kind == TypeName)
+                ok = _check_name_ref(r, refs[0]);
+            else if (record->kind == ArrayType)
+                ok = _check_typed_ref(r, refs[0], i, used, ARRAY_TYPE_NODE);
+            else if (record->kind == RefType)
+                ok = _check_typed_ref(r, refs[0], i, used, TYPE_ITEM_NODE);
+            else if (record->kind == TupleType)
+                ok = _check_node_ref(refs[0], i, used);
+            else
+                ok = false;
+            break;
+        case CALL_NODE:
+            ok = _check_name_ref(r, refs[0]) && _check_name_ref(r, refs[1]) && _check_typed_ref(r, refs[2], i, used, BLOCK_NODE);
+            break;
+        case FUNC_TYPE_NODE:
+            ok = _check_name_ref(r, refs[0]) && _check_name_ref(r, refs[1]) &&
+                 _check_typed_ref(r, refs[2], i, used, BLOCK_NODE) && _check_node_ref(refs[3], i, used);
+            break;
+        case FUNC_NODE:
+            ok = _check_typed_ref(r, refs[0], i, used, FUNC_TYPE_NODE) && _check_node_ref(refs[1], i, used);
+            break;
+        case MEMBER_INDEX_NODE:
+            ok = refs[0] && _check_node_ref(refs[0], i, used) && _check_node_ref(refs[1], i, used);
+            break;
+        case BINARY_NODE:
+        case ASSIGN_NODE:
+            ok = _check_node_ref(refs[0], i, used) && _check_node_ref(refs[1], i, used);
+            break;
+        case UNARY_NODE:
+        case JUMP_NODE:
+            ok = _check_node_ref(record->node_type == UNARY_NODE ? refs[0] : refs[1], i, used);
+            break;
+        case BLOCK_NODE:
+            ok = (refs[0] || !refs[1]) && (!refs[0] || ((u64)refs[0] - 1 + refs[1] <= h->list_size));
+            for (u32 j = 0; ok && j < refs[1]; j++) {
+                u32 child = r->lists[refs[0] - 1 + j];
+                ok = child && _check_node_ref(child, i, used);
+            }
+            break;
+        default:
+            //nodes with up to three child nodes
+            ok = _check_node_ref(refs[0], i, used) && _check_node_ref(refs[1], i, used) && _check_node_ref(refs[2], i, used);
+            break;
+        }
+        if (ok && record->type)
+            ok = record->type <= TYPE_TYPES;
+    }
+    ok = ok && !used[h->root - 1];
+    FREE(used);
+    return ok;
+}
+
+symbol _read_symbol(struct _ast_reader *r, u32 ref)
+{
+    if (!ref)
+        return 0;
+    if (!r->symbols[ref - 1])
+        r->symbols[ref - 1] = to_symbol(r->names + r->name_offsets[ref - 1]);
+    return r->symbols[ref - 1];
+}
+
+#define NODE(ref) ((ref) ? r->nodes[(ref) - 1] : 0)
+
+struct ast_node *_read_literal(struct _ast_reader *r, const struct ast_record *record)
+{
+    struct ast_node *node;
+    enum type type = record->kind;
+    switch (type) {
+    case TYPE_F32:
+    case TYPE_F64:
+    {
+        f64 val;
+        memcpy(&val, record->refs, sizeof(val));
+        node = double_node_new(r->tc, val, record->loc);
+        break;
+    }
+    case TYPE_STRING:
+    {
+        const char *name = r->names + r->name_offsets[record->refs[0] - 1];
+        size_t len = strlen(name);
+        char *val;
+        MALLOC(val, len + 1);
+        memcpy(val, name, len + 1);
+        node = string_node_new(r->tc, val, record->loc);
+        break;
+    }
+    case TYPE_UNIT:
+        node = unit_node_new(r->tc, record->loc);
+        break;
+    default:
+        node = int_node_new(r->tc, (int)record->refs[0], record->loc);
+        break;
+    }
+    node->liter->type = type;
+    return node;
+}
+
+struct ast_node *_read_type_item(struct _ast_reader *r, const struct ast_record *record)
+{
+    const u32 *refs = record->refs;
+    enum Mut mut = record->kind2;
+    struct ast_node *node = 0;
+    struct ast_node *data_node = NODE(refs[0]);
+    switch ((enum TypeNodeKind)record->kind) {
+    case BuiltinType:
+        node = type_item_node_new_with_builtin_type(_read_symbol(r, refs[0]), mut, record->loc);
+        break;
+    case TypeName:
+        node = type_item_node_new_with_type_name(_read_symbol(r, refs[0]), mut, record->loc);
+        break;
+    case TupleType:
+        node = type_item_node_new_with_tuple_type(data_node, mut, record->loc);
+        break;
+    case ArrayType:
+        //take over the data of the array type record as the parser does
+        node = type_item_node_new_with_array_type(data_node->array_type, mut, record->loc);
+        data_node->array_type = 0;
+        node_free(data_node);
+        break;
+    case RefType:
+        node = type_item_node_new_with_ref_type(data_node->type_item_node, mut, record->loc);
+        data_node->type_item_node = 0;
+        node_free(data_node);
+        break;
+    }
+    return node;
+}
+
+struct ast_node *_read_node(struct _ast_reader *r, const struct ast_record *record)
+{
+    const u32 *refs = record->refs;
+    struct source_location loc = record->loc;
+    struct ast_node *node = 0;
+    switch ((enum node_type)record->node_type) {
+    case NULL_NODE:
+    case WILDCARD_NODE:
+    case TOTAL_NODE:
+        node = ast_node_new(record->node_type, loc);
+        break;
+    case TOKEN_NODE:
+        node = token_node_new(refs[0], refs[1], loc);
+        break;
+    case IMPORT_NODE:
+        node = import_node_new(_read_symbol(r, refs[0]), NODE(refs[1]), loc);
+        break;
+    case MEMORY_NODE:
+        node = memory_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case LITERAL_NODE:
+        node = _read_literal(r, record);
+        break;
+    case IDENT_NODE:
+        node = ident_node_new(_read_symbol(r, refs[0]), loc);
+        node->ident->is_member_index_object = record->kind;
+        break;
+    case VAR_NODE:
+        node = var_node_new(NODE(refs[0]), NODE(refs[1]), NODE(refs[2]), record->kind2, record->kind, loc);
+        break;
+    case CAST_NODE:
+        node = cast_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case STRUCT_NODE:
+    case VARIANT_NODE:
+        node = adt_node_new(record->node_type, _read_symbol(r, refs[0]), NODE(refs[1]), loc);
+        hashtable_set_int(&r->tc->symbol_2_int_types, node->adt_type->name, TYPE_STRUCT);
+        break;
+    case VARIANT_TYPE_ITEM_NODE:
+        node = variant_type_node_new(record->kind, _read_symbol(r, refs[0]), NODE(refs[1]), loc);
+        node->variant_type_node->tag_repr = (int)refs[2];
+        break;
+    case ADT_INIT_NODE:
+        node = adt_init_node_new(record->kind, NODE(refs[1]), NODE(refs[0]), loc);
+        break;
+    case ARRAY_INIT_NODE:
+        node = array_init_node_new(NODE(refs[0]), loc);
+        break;
+    case NEW_NODE:
+        node = new_node_new(NODE(refs[0]), loc);
+        break;
+    case DEL_NODE:
+        node = del_node_new(NODE(refs[0]), loc);
+        break;
+    case ARRAY_TYPE_NODE:
+        node = array_type_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case TYPE_EXPR_ITEM_NODE:
+        node = type_expr_item_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case TYPE_ITEM_NODE:
+        node = _read_type_item(r, record);
+        break;
+    case TYPE_NODE:
+        node = type_node_new(_read_symbol(r, refs[0]), NODE(refs[1]), loc);
+        break;
+    case RANGE_NODE:
+        node = range_node_new(NODE(refs[0]), NODE(refs[1]), NODE(refs[2]), loc);
+        break;
+    case UNARY_NODE:
+        node = unary_node_new(refs[1], NODE(refs[0]), record->kind, loc);
+        break;
+    case BINARY_NODE:
+        node = binary_node_new(refs[2], NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case ASSIGN_NODE:
+        node = assign_node_new(refs[2], NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case MEMBER_INDEX_NODE:
+        node = member_index_node_new(record->kind, NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case IF_NODE:
+        node = if_node_new(NODE(refs[0]), NODE(refs[1]), NODE(refs[2]), loc);
+        break;
+    case MATCH_NODE:
+        node = match_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case MATCH_CASE_NODE:
+        node = match_item_node_new(NODE(refs[0]), NODE(refs[1]), NODE(refs[2]), loc);
+        break;
+    case FOR_NODE:
+        node = for_node_new(NODE(refs[0]), NODE(refs[1]), NODE(refs[2]), loc);
+        break;
+    case WHILE_NODE:
+        node = while_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        break;
+    case JUMP_NODE:
+        node = jump_node_new(refs[0], NODE(refs[1]), loc);
+        node->jump->nested_block_levels = refs[2];
+        break;
+    case CALL_NODE:
+        node = call_node_new(_read_symbol(r, refs[0]), NODE(refs[2]), loc);
+        node->call->specialized_callee = _read_symbol(r, refs[1]);
+        break;
+    case FUNC_TYPE_NODE:
+        //the parameter added for variadic functions is saved with the others
+        node = func_type_item_node_new(r->tc, _read_symbol(r, refs[0]), NODE(refs[2]), 0, NODE(refs[3]), false, record->kind2 >> 1, loc);
+        node->ft->is_variadic = record->kind2 & 1;
+        node->ft->is_operator = (char)record->kind;
+        node->ft->precedence = (int)refs[4];
+        node->ft->op = _read_symbol(r, refs[1]);
+        break;
+    case FUNC_NODE:
+        node = function_node_new(NODE(refs[0]), NODE(refs[1]), loc);
+        hashtable_set_int(&r->tc->symbol_2_int_types, node->func->func_type->ft->name, TYPE_FUNCTION);
+        break;
+    case BLOCK_NODE:
+    {
+        struct array nodes;
+        array_init(&nodes, sizeof(struct ast_node *));
+        for (u32 i = 0; i < refs[1]; i++) {
+            struct ast_node *child = NODE(r->lists[refs[0] - 1 + i]);
+            array_push(&nodes, &child);
+        }
+        node = block_node_new(&nodes);
+        break;
+    }
+    }
+    node->loc = loc;
+    node->type = record->type ? create_nullary_type(r->tc, record->type - 1) : 0;
+    node->is_addressed = record->flags & AST_FLAG_ADDRESSED;
+    node->is_ret = record->flags & AST_FLAG_RET;
+    node->is_lvalue = record->flags & AST_FLAG_LVALUE;
+    node->is_addressable = record->flags & AST_FLAG_ADDRESSABLE;
+    node->is_heap_alloc = record->flags & AST_FLAG_HEAP_ALLOC;
+    return node;
+}
+
+struct ast_node *ast_deserialize(struct type_context *tc, const u8 *data, size_t size)
+{
+    const struct ast_file_header *h = (const struct ast_file_header *)data;
+    if (((size_t)data & 7) || size < sizeof(*h) || h->magic != AST_FILE_MAGIC ||
+        h->version != AST_FILE_VERSION || h->record_size != sizeof(struct ast_record))
+        return 0;
+    u64 body_size = (u64)h->name_count * sizeof(u32) + (u64)h->list_size * sizeof(u32) +
+                    (u64)h->node_count * sizeof(struct ast_record) + h->names_size;
+    if (body_size != size - sizeof(*h) || hash64((unsigned char *)data + sizeof(*h), body_size) != h->checksum)
+        return 0;
+    struct _ast_reader r;
+    r.tc = tc;
+    r.header = h;
+    r.name_offsets = (const u32 *)(data + sizeof(*h));
+    r.lists = r.name_offsets + h->name_count;
+    r.records = (const struct ast_record *)(r.lists + h->list_size);
+    r.names = (const char *)(r.records + h->node_count);
+    if (!_check_records(&r))
+        return 0;
+    CALLOC(r.symbols, h->name_count + 1, sizeof(symbol));
+    MALLOC(r.nodes, h->node_count * sizeof(struct ast_node *));
+    for (u32 i = 0; i < h->node_count; i++) {
+        r.nodes[i] = _read_node(&r, &r.records[i]);
+    }
+    struct ast_node *root = r.nodes[h->root - 1];
+    FREE(r.nodes);
+    FREE(r.symbols);
+    return root;
+}
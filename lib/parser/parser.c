@@ -14,6 +14,8 @@
 #include "parser/ast.h"
 #include "sema/type.h"
 #include <assert.h>
+#include <ctype.h>
+#include <string.h>
 
 struct parser *_parser_new(parsing_table *pt, parsing_rules *pr, parsing_symbols *psd, parsing_states *pstd)
 {
@@ -623,12 +625,19 @@ struct ast_node *_build_nonterm_ast(struct type_context *tc, struct parse_rule *
     return ast;
 }
 
-struct ast_node *parse_code(struct parser *parser, const char *code)
+//free the partially built nodes left on the stack so that the parser can be reused after an error
+void _clear_states(struct parser *parser)
+{
+    struct stack_item *s_item;
+    while((s_item = _pop_state(parser))){
+        node_free(s_item->ast);
+    }
+}
+
+struct ast_node *_parse(struct parser *parser, struct lexer *lexer)
 {
     struct ast_node *ast = 0;
     _push_state(parser, 0, 0); 
-    struct lexer *lexer = lexer_new_with_string(code);
-    if(!lexer) return 0;
     struct token *tok = get_tok(lexer);
     u8 ti = get_terminal_token_index(tok->token_type, tok->opcode);
     u16 si, tsi;
@@ -657,10 +666,13 @@ struct ast_node *parse_code(struct parser *parser, const char *code)
         }else if(pa->code == A){
             s_item = _pop_state(parser);
             ast = s_item->ast;
+            //drop the start state so that the parser can be reused for the next code
+            parser->stack_top = 0;
             break;
         }else if(tok->token_type == TOKEN_NULL){
             struct error_report *er = get_last_error_report(lexer);
             printf("%s location (line, col): (%d, %d)\n", er->error_msg, er->loc.line, er->loc.col);
+            _clear_states(parser);
             ast = 0;
             break;
         }else{
@@ -678,10 +690,7 @@ struct ast_node *parse_code(struct parser *parser, const char *code)
                     printf("symbol %s is expected to parse %s but got %s\n", next_symbol, psi->items[i].item_string, got_symbol);
                 }
             }
-            //clean stack items
-            while((s_item = _pop_state(parser))){
-                node_free(s_item->ast);
-            }
+            _clear_states(parser);
             ast = 0;
             break;
         }
@@ -690,15 +699,81 @@ struct ast_node *parse_code(struct parser *parser, const char *code)
     return ast;
 }
 
+struct ast_node *parse_code(struct parser *parser, const char *code)
+{
+    return _parse(parser, lexer_new_with_string(code));
+}
+
+//a line ending with ':' or 'with' opens a block, its indented lines follow until an empty line
+bool _repl_line_opens_block(const char *line)
+{
+    size_t len = strlen(line);
+    while (len && isspace((unsigned char)line[len - 1]))
+        len--;
+    if (len && line[len - 1] == ':')
+        return true;
+    return len >= 4 && !strncmp(line + len - 4, "with", 4) && (len == 4 || isspace((unsigned char)line[len - 5]));
+}
+
+bool _repl_line_is_empty(const char *line)
+{
+    for (; *line; line++) {
+        if (!isspace((unsigned char)*line))
+            return false;
+    }
+    return true;
+}
+
 struct ast_node *parse_repl_code(struct parser *parser, void (*fun)(void *, struct ast_node *), void *jit)
 {
-    return parse_file(parser, 0);
+    //the nodes evaluated stay alive for the session, later inputs refer to their definitions
+    struct array blocks;
+    array_init(&blocks, sizeof(struct ast_node *));
+    string code;
+    string_init(&code);
+    char line[1024];
+    bool in_block = false;
+    bool eof = false;
+    while (!eof) {
+        eof = !fgets(line, sizeof(line), stdin);
+        if (!eof) {
+            bool empty = _repl_line_is_empty(line);
+            if (!in_block && empty)
+                continue;
+            if (!empty)
+                string_add_chars(&code, line);
+            if (!in_block)
+                in_block = _repl_line_opens_block(line);
+            //a block is evaluated once it is closed by an empty line
+            if (in_block && !empty)
+                continue;
+        }
+        in_block = false;
+        if (!string_size(&code))
+            continue;
+        struct ast_node *block = parse_code(parser, string_get(&code));
+        string_copy_chars(&code, "");
+        if (!block)
+            continue;
+        array_push(&blocks, &block);
+        for (u32 i = 0; i < array_size(&block->block->nodes); i++) {
+            fun(jit, array_get_ptr(&block->block->nodes, i));
+        }
+    }
+    string_deinit(&code);
+    for (u32 i = 0; i < array_size(&blocks); i++) {
+        node_free(array_get_ptr(&blocks, i));
+    }
+    array_deinit(&blocks);
+    return 0;
 }
 
 struct ast_node *parse_file(struct parser *parser, const char *file_path)
 {
-    const char *code = read_text_file(file_path);
-    struct ast_node * block = parse_code(parser, code);
-    free((void*)code);
+    size_t size;
+    const char *code = map_text_file(file_path, &size);
+    if(!code) return 0;
+    struct ast_node * block = _parse(parser, lexer_new(0, file_path, code, size));
+    unmap_text_file(code, size);
     return block;
 }
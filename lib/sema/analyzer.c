@@ -702,6 +702,61 @@ struct type_item *_analyze_match_item(struct sema_context *context, struct ast_n
     return analyze(context, node->match_case->expr);
 }
 
+//value of a number literal, possibly negated
+static bool _eval_const_number(struct ast_node *node, f64 *value)
+{
+    if(node->transformed) node = node->transformed;
+    if(node->node_type == UNARY_NODE && (node->unop->opcode == OP_MINUS || node->unop->opcode == OP_PLUS)){
+        if(!_eval_const_number(node->unop->operand, value))
+            return false;
+        if(node->unop->opcode == OP_MINUS)
+            *value = -*value;
+        return true;
+    }
+    if(node->node_type != LITERAL_NODE)
+        return false;
+    if(node->liter->type == TYPE_F64){
+        *value = node->liter->double_val;
+        return true;
+    }
+    if(is_int_type(node->liter->type)){
+        *value = node->liter->int_val;
+        return true;
+    }
+    return false;
+}
+
+//the value does not change while the loop runs: a number literal or an immutable variable
+static bool _is_invariant(struct ast_node *node)
+{
+    f64 value;
+    if(node->transformed) node = node->transformed;
+    if(node->node_type == IDENT_NODE)
+        return node->ident->var && node->ident->var->node_type == VAR_NODE && node->ident->var->var->mut == Immutable;
+    return _eval_const_number(node, &value);
+}
+
+static void _analyze_const_range(struct ast_node *node, bool has_jump)
+{
+    struct range_node *range = node->forloop->range->range;
+    f64 step, start, end;
+    node->forloop->step_sign = 0;
+    node->forloop->trip_count = -1;
+    node->forloop->is_end_invariant = _is_invariant(range->end);
+    if(!_eval_const_number(range->step, &step) || step == 0)
+        return;
+    node->forloop->step_sign = step > 0 ? 1 : -1;
+    if(has_jump || node->forloop->var->type->type != TYPE_INT || node->forloop->var->var->mut == Mutable)
+        return;
+    if(!_eval_const_number(range->start, &start) || !_eval_const_number(range->end, &end))
+        return;
+    i64 distance = (i64)(step > 0 ? end - start : start - end);
+    i64 stride = (i64)(step > 0 ? step : -step);
+    i64 trips = distance > 0 ? (distance + stride - 1) / stride : 0;
+    if(trips <= INT32_MAX)
+        node->forloop->trip_count = (i32)trips;
+}
+
 struct type_item *_analyze_for(struct sema_context *context, struct ast_node *node)
 {
     struct loop_nested_level *bnl = enter_loop(context);
@@ -733,6 +788,8 @@ struct type_item *_analyze_for(struct sema_context *context, struct ast_node *no
     node->forloop->range->range->step->type = step_type;
     node->forloop->range->range->end->type = prune(context->tc, end_type);
     node->forloop->body->type = body_type;
+    //the level is taken again, the ones of nested loops may have moved it
+    _analyze_const_range(node, get_current_block_level(context)->has_jump);
     leave_loop(context);
     return create_unit_type(context->tc);
 }
@@ -762,15 +819,19 @@ struct type_item *_analyze_jump(struct sema_context *context, struct ast_node *n
         struct loop_nested_level *bnl = get_current_block_level(context);
         assert(bnl);
         node->jump->nested_block_levels = bnl->block_levels;
+        bnl->has_jump = true;
         type = create_unit_type(context->tc);
     }
     return type;
 }
 
-struct type_item *_analyze_block(struct sema_context *context, struct ast_node *node)
+struct type_item *analyze_block_nodes(struct sema_context *context, struct ast_node *node)
 {
-    enter_scope(context);
     struct type_item *type = 0;
+    if (!array_size(&node->block->nodes)) {
+        //e.g. start function of a module having definitions only
+        return create_unit_type(context->tc);
+    }
     for (size_t i = 0; i < array_size(&node->block->nodes); i++) {
         struct ast_node *n = array_get_ptr(&node->block->nodes, i);
         type = analyze(context, n);
@@ -781,6 +842,13 @@ struct type_item *_analyze_block(struct sema_context *context, struct ast_node *
     struct ast_node *var = _get_var_node(context, ret_node);
     if(var)
         var->is_ret = true;
+    return type;
+}
+
+struct type_item *_analyze_block(struct sema_context *context, struct ast_node *node)
+{
+    enter_scope(context);
+    struct type_item *type = analyze_block_nodes(context, node);
     leave_scope(context);
     return type;
 }
@@ -40,22 +40,55 @@ struct array _get_file_paths(const char *sys_path)
     return file_paths;
 }
 
-struct frontend *frontend_sys_init(const char *sys_path, bool is_repl)
+void sys_prelude_init(struct sys_prelude *prelude, const char *sys_path)
+{
+    array_init_free(&prelude->codes, sizeof(string), string_free_generic);
+    struct array file_paths = _get_file_paths(sys_path);
+    for (size_t i = 0; i < array_size(&file_paths); i++)
+    {
+        string *file_path = array_get(&file_paths, i);
+        size_t size;
+        const char *text = map_text_file(string_get(file_path), &size);
+        if (!text)
+            continue;
+        string code;
+        string_init_chars2(&code, text, size);
+        array_push(&prelude->codes, &code);
+        unmap_text_file(text, size);
+    }
+    array_deinit(&file_paths);
+}
+
+void sys_prelude_deinit(struct sys_prelude *prelude)
+{
+    array_deinit(&prelude->codes);
+}
+
+struct frontend *frontend_prelude_init(struct sys_prelude *prelude, bool is_repl)
 {
     struct frontend*fe;
     MALLOC(fe, sizeof(*fe));
     fe->parser = parser_new();
     struct ast_node *sys_block = block_node_new_empty();
-    struct array file_paths = _get_file_paths(sys_path);
-    for (size_t i = 0; i < array_size(&file_paths); i++)
+    for (size_t i = 0; i < array_size(&prelude->codes); i++)
     {
-        string *file_path = array_get(&file_paths, i);
-        struct ast_node *sys = parse_file(fe->parser, string_get(file_path));
+        string *code = array_get(&prelude->codes, i);
+        struct ast_node *sys = parse_code(fe->parser, string_get(code));
+        if (!sys)
+            continue;
         block_node_add_block(sys_block, sys);
         free_block_node(sys, false);
     }
     fe->sema_context = sema_context_new(fe->parser->tc, sys_block, is_repl);
     free_block_node(sys_block, false);
-    array_deinit(&file_paths);
+    return fe;
+}
+
+struct frontend *frontend_sys_init(const char *sys_path, bool is_repl)
+{
+    struct sys_prelude prelude;
+    sys_prelude_init(&prelude, sys_path);
+    struct frontend *fe = frontend_prelude_init(&prelude, is_repl);
+    sys_prelude_deinit(&prelude);
     return fe;
 }
@@ -11,6 +11,7 @@
 #include "clib/array.h"
 #include "sema/analyzer.h"
 #include "sema/type_size_info.h"
+#include "app/error.h"
 #include <assert.h>
 #include <limits.h>
 
@@ -97,6 +98,7 @@ struct sema_context *sema_context_new(struct type_context *tc, struct ast_node *
 
 void sema_context_free(struct sema_context *context)
 {
+    clear_error_reports(context);
     array_deinit(&context->nested_levels);
     hashtable_deinit(&context->struct_typename_2_asts);
     hashtable_deinit(&context->specialized_ast);
@@ -117,6 +119,76 @@ void sema_context_free(struct sema_context *context)
     FREE(context);
 }
 
+void sema_checkpoint_init(struct sema_checkpoint *cp, struct sema_context *context)
+{
+    struct type_context *tc = context->tc;
+    cp->varname_2_typexprs = symboltable_top(&context->varname_2_typexprs);
+    cp->varname_2_asts = symboltable_top(&context->varname_2_asts);
+    cp->typename_2_typexpr_pairs = symboltable_top(&context->typename_2_typexpr_pairs);
+    hashtable_copy(&cp->gvar_name_2_ast, &context->gvar_name_2_ast);
+    hashtable_copy(&cp->struct_typename_2_asts, &context->struct_typename_2_asts);
+    hashtable_copy(&cp->type_2_ref_symbol, &context->type_2_ref_symbol);
+    hashtable_copy(&cp->generic_ast, &context->generic_ast);
+    hashtable_copy(&cp->specialized_ast, &context->specialized_ast);
+    hashtable_copy(&cp->func_types, &context->func_types);
+    hashtable_copy(&cp->calls, &context->calls);
+    hashtable_copy(&cp->symbol_2_type_items, &tc->symbol_2_type_items);
+    hashtable_copy(&cp->type_item_vars, &tc->type_item_vars);
+    hashtable_copy(&cp->freshed_type_items, &tc->freshed_type_items);
+    hashtable_copy(&cp->ts_infos, &tc->ts_infos);
+    cp->scope_level = context->scope_level;
+    cp->func_stack_size = stack_size(&context->func_stack);
+    cp->nongens_size = array_size(&context->nongens);
+    cp->used_builtin_names_size = array_size(&context->used_builtin_names);
+    cp->nested_levels_size = array_size(&context->nested_levels);
+}
+
+void sema_checkpoint_deinit(struct sema_checkpoint *cp)
+{
+    hashtable_deinit(&cp->gvar_name_2_ast);
+    hashtable_deinit(&cp->struct_typename_2_asts);
+    hashtable_deinit(&cp->type_2_ref_symbol);
+    hashtable_deinit(&cp->generic_ast);
+    hashtable_deinit(&cp->specialized_ast);
+    hashtable_deinit(&cp->func_types);
+    hashtable_deinit(&cp->calls);
+    hashtable_deinit(&cp->symbol_2_type_items);
+    hashtable_deinit(&cp->type_item_vars);
+    hashtable_deinit(&cp->freshed_type_items);
+    hashtable_deinit(&cp->ts_infos);
+}
+
+void sema_context_rollback(struct sema_context *context, struct sema_checkpoint *cp)
+{
+    struct type_context *tc = context->tc;
+    clear_error_reports(context);
+    symboltable_pop_to(&context->varname_2_typexprs, cp->varname_2_typexprs);
+    symboltable_pop_to(&context->varname_2_asts, cp->varname_2_asts);
+    symboltable_pop_to(&context->typename_2_typexpr_pairs, cp->typename_2_typexpr_pairs);
+    hashtable_restore(&context->gvar_name_2_ast, &cp->gvar_name_2_ast);
+    hashtable_restore(&context->struct_typename_2_asts, &cp->struct_typename_2_asts);
+    hashtable_restore(&context->type_2_ref_symbol, &cp->type_2_ref_symbol);
+    hashtable_restore(&context->generic_ast, &cp->generic_ast);
+    hashtable_restore(&context->specialized_ast, &cp->specialized_ast);
+    hashtable_restore(&context->func_types, &cp->func_types);
+    hashtable_restore(&context->calls, &cp->calls);
+    hashtable_restore(&tc->symbol_2_type_items, &cp->symbol_2_type_items);
+    hashtable_restore(&tc->type_item_vars, &cp->type_item_vars);
+    hashtable_restore(&tc->freshed_type_items, &cp->freshed_type_items);
+    hashtable_restore(&tc->ts_infos, &cp->ts_infos);
+    //an analysis stopped by an error can leave functions and scopes open
+    context->scope_level = cp->scope_level;
+    while (stack_size(&context->func_stack) > cp->func_stack_size)
+        stack_pop(&context->func_stack);
+    while (array_size(&context->nongens) > cp->nongens_size)
+        array_pop(&context->nongens);
+    while (array_size(&context->used_builtin_names) > cp->used_builtin_names_size)
+        array_pop(&context->used_builtin_names);
+    while (array_size(&context->nested_levels) > cp->nested_levels_size)
+        array_deinit(array_pop(&context->nested_levels));
+    array_reset(&context->new_specialized_asts);
+}
+
 symbol get_ref_type_symbol(struct sema_context *context, symbol type_name)
 {
     symbol ref_name = hashtable_get_p(&context->type_2_ref_symbol, type_name);
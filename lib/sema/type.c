@@ -6,8 +6,10 @@
  */
 #include "sema/type.h"
 #include "sema/type_size_info.h"
+#include "parser/ast.h"
 #include "clib/hashtable.h"
 #include "clib/symboltable.h"
+#include "app/time_report.h"
 #include <assert.h>
 #include <stdio.h>
 
@@ -146,7 +148,8 @@ void type_item_free(struct type_item *type)
     if(type->type == TYPE_ARRAY){
         array_deinit(&type->dims);
     }
-    FREE(type);
+    if(!type->is_arena_alloc)
+        FREE(type);
 }
 
 struct type_context *type_context_new(void)
@@ -211,7 +214,13 @@ void struct_type_add_member(struct type_item *struct_type, struct type_item *typ
 struct type_item *_create_type_oper(enum kind kind, symbol canon_name, symbol type_name, enum type type, enum Mut mut, struct type_item *val_type, struct array *args)
 {
     struct type_item *oper;
-    MALLOC(oper, sizeof(*oper));
+    struct arena *arena = ast_get_arena();
+    if(arena)
+        oper = arena_alloc(arena, sizeof(*oper));
+    else
+        MALLOC(oper, sizeof(*oper));
+    g_compile_counters.types++;
+    oper->is_arena_alloc = arena != 0;
     oper->kind = kind;
     oper->type = type;
     oper->name = type_name;
@@ -21,6 +21,10 @@ void _layout_field(struct type_context *tc, struct struct_layout *sl, struct typ
 {
     struct type_size_info tsi = get_type_size_info(tc, field_type);
     array_push(&sl->field_layouts, &tsi.sl);
+    if (tsi.sl && !field_type->name) {
+        //unnamed field types are not cached in ts_infos, so the parent owns their layouts
+        array_push(&sl->owned_layouts, &tsi.sl);
+    }
     u64 field_offset_bits = 0;
     u64 field_offset_bytes = 0;
     u64 field_size_bytes, field_align_bytes;
@@ -193,6 +197,7 @@ struct struct_layout *sl_new(symbol type_name, enum ADTKind kind)
     sl->padded_field_size = 0;
     array_init(&sl->field_offsets, sizeof(u64));
     array_init(&sl->field_layouts, sizeof(struct struct_layout *));
+    array_init(&sl->owned_layouts, sizeof(struct struct_layout *));
     return sl;
 }
 
@@ -201,5 +206,9 @@ void sl_free(struct struct_layout *sl)
     if(!sl) return;
     array_deinit(&sl->field_offsets);
     array_deinit(&sl->field_layouts);
+    for (u32 i = 0; i < array_size(&sl->owned_layouts); i++) {
+        sl_free(array_get_ptr(&sl->owned_layouts, i));
+    }
+    array_deinit(&sl->owned_layouts);
     FREE(sl);
 }
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * unit test for clib arena functions
+ */
+#include "test.h"
+
+#include "clib/arena.h"
+#include "clib/typedef.h"
+#include <string.h>
+
+TEST(test_arena, alloc_aligned)
+{
+    struct arena arena;
+    arena_init(&arena);
+    char *a = arena_alloc(&arena, 1);
+    char *b = arena_alloc(&arena, 24);
+    ASSERT_EQ(0, (size_t)a % ARENA_ALIGN);
+    ASSERT_EQ(0, (size_t)b % ARENA_ALIGN);
+    ASSERT_TRUE(b >= a + 1);
+    memset(b, 0xFF, 24);
+    int *c = arena_calloc(&arena, 4, sizeof(int));
+    ASSERT_EQ(0, c[0] + c[1] + c[2] + c[3]);
+    ASSERT_EQ(1, arena_chunk_count(&arena));
+    arena_deinit(&arena);
+    ASSERT_EQ(0, arena_chunk_count(&arena));
+}
+
+TEST(test_arena, chain_and_reset)
+{
+    struct arena arena;
+    arena_init(&arena);
+    for (int i = 0; i < 1000; i++) {
+        int *p = arena_alloc(&arena, 1024);
+        *p = i;
+    }
+    ASSERT_TRUE(arena_chunk_count(&arena) > 1);
+    //larger than a chunk goes to its own chunk
+    char *big = arena_alloc(&arena, ARENA_CHUNK_SIZE * 2);
+    big[ARENA_CHUNK_SIZE * 2 - 1] = 1;
+    arena_reset(&arena);
+    ASSERT_EQ(1, arena_chunk_count(&arena));
+    ASSERT_EQ(0, arena.allocated);
+    int *p = arena_alloc(&arena, sizeof(int));
+    *p = 42;
+    ASSERT_EQ(42, *p);
+    arena_deinit(&arena);
+}
+
+TEST(test_arena, rollback)
+{
+    struct arena arena;
+    arena_init(&arena);
+    int *kept = arena_alloc(&arena, sizeof(int));
+    *kept = 7;
+    struct arena_mark mark = arena_get_mark(&arena);
+    size_t allocated = arena.allocated;
+    for (int i = 0; i < 1000; i++) {
+        arena_alloc(&arena, 1024);
+    }
+    ASSERT_TRUE(arena_chunk_count(&arena) > 1);
+    arena_rollback(&arena, &mark);
+    ASSERT_EQ(1, arena_chunk_count(&arena));
+    ASSERT_EQ(allocated, arena.allocated);
+    ASSERT_EQ(7, *kept);
+    //the next allocation reuses the space released by the rollback
+    int *p = arena_alloc(&arena, sizeof(int));
+    ASSERT_EQ((char *)kept + ARENA_ALIGN, (char *)p);
+    arena_deinit(&arena);
+}
+
+int test_arena(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_arena_alloc_aligned);
+    RUN_TEST(test_arena_chain_and_reset);
+    RUN_TEST(test_arena_rollback);
+    test_stats.total_failures += Unity.TestFailures;
+    test_stats.total_tests += Unity.NumberOfTests;
+    return UNITY_END();
+}
@@ -18,10 +18,47 @@ TEST(test_byte_array, init)
     ba_deinit(&ba);
 }
 
+TEST(test_byte_array, add_array)
+{
+    struct byte_array ba;
+    u8 bytes[100];
+    for (u8 i = 0; i < 100; i++) {
+        bytes[i] = i;
+    }
+    ba_init(&ba, 2);
+    ba_add(&ba, 200);
+    ba_add_array(&ba, bytes, 100);
+    ASSERT_EQ(101, ba.size);
+    ASSERT_TRUE(ba.cap >= 101);
+    ASSERT_EQ(200, ba.data[0]);
+    ASSERT_EQ(0, ba.data[1]);
+    ASSERT_EQ(99, ba.data[100]);
+    ba_deinit(&ba);
+}
+
+TEST(test_byte_array, reserve_and_remove)
+{
+    struct byte_array ba;
+    ba_init(&ba, 2);
+    ba_reserve(&ba, 10);
+    ASSERT_TRUE(ba.cap >= 10);
+    for (u8 i = 0; i < 10; i++) {
+        ba_add(&ba, i);
+    }
+    ba_remove(&ba, 2, 3);
+    ASSERT_EQ(7, ba.size);
+    ASSERT_EQ(1, ba.data[1]);
+    ASSERT_EQ(5, ba.data[2]);
+    ASSERT_EQ(9, ba.data[6]);
+    ba_deinit(&ba);
+}
+
 int test_byte_array(void)
 {
     UNITY_BEGIN();
     RUN_TEST(test_byte_array_init);
+    RUN_TEST(test_byte_array_add_array);
+    RUN_TEST(test_byte_array_reserve_and_remove);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
@@ -12,6 +12,7 @@
 #include "clib/string.h"
 #include "clib/symbol.h"
 #include "clib/util.h"
+#include <stdio.h>
 
 // TEST(testHashtable, TestAddAndGet)
 // {
@@ -167,6 +168,108 @@ TEST(test_hashtable, grow_with_collision)
     ASSERT_EQ(100, *(int *)hashtable_get(&ht, "int"));
     hashtable_deinit(&ht);
 }
+TEST(test_hashtable, grow_and_remove)
+{
+    struct hashtable ht;
+    hashtable_init_with_size(&ht, sizeof(int), sizeof(int));
+    int n = 10000;
+    for (int i = 0; i < n; i++) {
+        int value = i * 2;
+        hashtable_set_v(&ht, &i, &value);
+    }
+    ASSERT_EQ(n, hashtable_size(&ht));
+    for (int i = 0; i < n; i += 2) {
+        hashtable_remove_g(&ht, &i, sizeof(int));
+    }
+    ASSERT_EQ(n / 2, hashtable_size(&ht));
+    for (int i = 0; i < n; i++) {
+        int *value = hashtable_get_v(&ht, &i);
+        if (i % 2) {
+            ASSERT_EQ(i * 2, *value);
+        } else {
+            ASSERT_EQ(0, value);
+        }
+    }
+    hashtable_clear(&ht);
+    ASSERT_EQ(0, hashtable_size(&ht));
+    hashtable_deinit(&ht);
+}
+
+TEST(test_hashtable, value_address_stable_on_grow)
+{
+    struct hashtable ht;
+    hashtable_init_with_value_size(&ht, sizeof(int), 0);
+    char key[16];
+    int value = 7;
+    hashtable_set_g(&ht, "first", 5, &value, sizeof(int));
+    int *first = hashtable_get(&ht, "first");
+    for (int i = 0; i < 1000; i++) {
+        sprintf(key, "k%d", i);
+        hashtable_set_g(&ht, key, strlen(key), &i, sizeof(int));
+    }
+    ASSERT_EQ(first, hashtable_get(&ht, "first"));
+    ASSERT_EQ(7, *first);
+    hashtable_deinit(&ht);
+}
+
+static unsigned int _constant_hash(unsigned char *key, size_t len)
+{
+    (void)key;
+    (void)len;
+    return 42;
+}
+
+TEST(test_hashtable, custom_hash_fun)
+{
+    struct hashtable ht;
+    hashtable_init_with_size(&ht, sizeof(int), sizeof(int));
+    hashtable_set_hash_fun(&ht, _constant_hash);
+    for (int i = 0; i < 100; i++) {
+        hashtable_set_v(&ht, &i, &i);
+    }
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(i, *(int *)hashtable_get_v(&ht, &i));
+    }
+    hashtable_deinit(&ht);
+}
+
+TEST(test_hashtable, hash_distribution)
+{
+    //adjacent pointers and keys differing in one byte should not share hashes
+    char objects[256];
+    unsigned int hashes[256];
+    char key[40] = "a key longer than thirty-two bytes__";
+    for (int i = 0; i < 256; i++) {
+        hashes[i] = hash_word((u64)(size_t)&objects[i]);
+        for (int j = 0; j < i; j++) {
+            ASSERT_TRUE(hashes[j] != hashes[i]);
+        }
+    }
+    for (int i = 0; i < 256; i++) {
+        key[33] = (char)i;
+        hashes[i] = hash((unsigned char *)key, sizeof(key));
+        for (int j = 0; j < i; j++) {
+            ASSERT_TRUE(hashes[j] != hashes[i]);
+        }
+    }
+    void *p = objects;
+    ASSERT_EQ(hash_word((u64)(size_t)p), hash_key((unsigned char *)&p, sizeof(p)));
+}
+
+TEST(test_hashtable, remove_pointer_key)
+{
+    struct hashtable ht;
+    hashtable_init(&ht);
+    int a = 1, b = 2;
+    hashtable_set_p(&ht, &a, &a);
+    hashtable_set_p(&ht, &b, &b);
+    hashtable_remove_p(&ht, &a);
+    ASSERT_EQ(0, hashtable_get_p(&ht, &a));
+    ASSERT_EQ(&b, hashtable_get_p(&ht, &b));
+    ASSERT_EQ(1, hashtable_size(&ht));
+    hashtable_deinit(&ht);
+}
+
 /*
 TEST(testHashtable, TestHashtablePointerKey)
 {
@@ -207,6 +310,70 @@ TEST(testHashtable, TestHashtablePointerKeyWithCopyValue)
 }
 */
 
+TEST(test_hashtable, copy_and_restore)
+{
+    struct hashtable ht, saved;
+    hashtable_init_with_size(&ht, sizeof(int), sizeof(int));
+    for (int key = 0; key < 10; key++) {
+        int value = key * 10;
+        hashtable_set_v(&ht, &key, &value);
+    }
+    hashtable_copy(&saved, &ht);
+    for (int key = 5; key < 100; key++) {
+        int value = -key;
+        hashtable_set_v(&ht, &key, &value);
+    }
+    int key = 0;
+    hashtable_remove_g(&ht, &key, sizeof(key));
+    hashtable_restore(&ht, &saved);
+    ASSERT_EQ(10, hashtable_size(&ht));
+    for (key = 0; key < 10; key++) {
+        ASSERT_EQ(key * 10, *(int*)hashtable_get_v(&ht, &key));
+    }
+    key = 50;
+    ASSERT_FALSE(hashtable_in_v(&ht, &key));
+    hashtable_deinit(&saved);
+    hashtable_deinit(&ht);
+}
+
+static int _freed_values;
+
+static void _count_free(void *value)
+{
+    _freed_values++;
+    FREE(value);
+}
+
+static int *_new_int(int value)
+{
+    int *p;
+    MALLOC(p, sizeof(*p));
+    *p = value;
+    return p;
+}
+
+TEST(test_hashtable, restore_frees_overwritten_owned_value)
+{
+    struct hashtable ht, saved;
+    hashtable_init_with_value_size(&ht, 0, _count_free);
+    symbol key = to_symbol("key");
+    int *original = _new_int(1);
+    hashtable_set_p(&ht, key, original);
+    hashtable_copy(&saved, &ht);
+    hashtable_set_p(&ht, key, _new_int(2));
+    _freed_values = 0;
+    hashtable_restore(&ht, &saved);
+    ASSERT_EQ(1, _freed_values);
+    ASSERT_EQ(original, hashtable_get_p(&ht, key));
+    ASSERT_EQ(1, *(int *)hashtable_get_p(&ht, key));
+    //restoring an unchanged value keeps it alive
+    hashtable_restore(&ht, &saved);
+    ASSERT_EQ(1, _freed_values);
+    hashtable_deinit(&saved);
+    hashtable_deinit(&ht);
+    ASSERT_EQ(2, _freed_values);
+}
+
 int test_hashtable(void)
 {
     UNITY_BEGIN();
@@ -217,6 +384,13 @@ int test_hashtable(void)
     RUN_TEST(test_hashtable_clear);
     RUN_TEST(test_hashtable_collision);
     RUN_TEST(test_hashtable_grow_with_collision);
+    RUN_TEST(test_hashtable_grow_and_remove);
+    RUN_TEST(test_hashtable_value_address_stable_on_grow);
+    RUN_TEST(test_hashtable_custom_hash_fun);
+    RUN_TEST(test_hashtable_hash_distribution);
+    RUN_TEST(test_hashtable_remove_pointer_key);
+    RUN_TEST(test_hashtable_copy_and_restore);
+    RUN_TEST(test_hashtable_restore_frees_overwritten_owned_value);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
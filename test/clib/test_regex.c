@@ -116,6 +116,52 @@ TEST(test_regex, int_num)
     regex_free(re);
 }
 
+TEST(test_regex, dfa_longest_match)
+{
+    void *res[3];
+    res[0] = regex_new("[0-9]+|0x[0-9a-fA-F]+");
+    res[1] = regex_new("([0-9]*.)?[0-9]+");
+    res[2] = regex_new("\\.\\.");
+    struct dfa *dfa = dfa_new(res, 3);
+    int matched_re;
+    ASSERT_EQ(3, dfa_match(dfa, "123 !", &matched_re));
+    ASSERT_EQ(0, matched_re);
+    ASSERT_EQ(4, dfa_match(dfa, "0x3F !", &matched_re));
+    ASSERT_EQ(0, matched_re);
+    ASSERT_EQ(4, dfa_match(dfa, "12.5+", &matched_re));
+    ASSERT_EQ(1, matched_re);
+    ASSERT_EQ(1, dfa_match(dfa, "1..10", &matched_re));
+    ASSERT_EQ(0, matched_re);
+    ASSERT_EQ(2, dfa_match(dfa, "..10", &matched_re));
+    ASSERT_EQ(2, matched_re);
+    ASSERT_EQ(0, dfa_match(dfa, "abc", &matched_re));
+    ASSERT_EQ(-1, matched_re);
+    dfa_free(dfa);
+    for(int i = 0; i < 3; i++) regex_free(res[i]);
+}
+
+TEST(test_regex, dfa_priority)
+{
+    void *res[3];
+    res[0] = regex_new("in");
+    res[1] = regex_new("int");
+    res[2] = regex_new("[_a-zA-Z][_a-zA-Z0-9]*");
+    struct dfa *dfa = dfa_new(res, 3);
+    int matched_re;
+    ASSERT_EQ(2, dfa_match(dfa, "in x", &matched_re));
+    ASSERT_EQ(0, matched_re);
+    ASSERT_EQ(3, dfa_match(dfa, "int x", &matched_re));
+    ASSERT_EQ(1, matched_re);
+    ASSERT_EQ(5, dfa_match(dfa, "inner x", &matched_re));
+    ASSERT_EQ(2, matched_re);
+    ASSERT_EQ(1, dfa_match(dfa, "i", &matched_re));
+    ASSERT_EQ(2, matched_re);
+    //minimized states: start, "i", "in", "int", other identifiers and the dead state
+    ASSERT_TRUE(dfa_state_count(dfa) <= 6);
+    dfa_free(dfa);
+    for(int i = 0; i < 3; i++) regex_free(res[i]);
+}
+
 int test_regex(void)
 {
     UNITY_BEGIN();
@@ -129,6 +175,8 @@ int test_regex(void)
     RUN_TEST(test_regex_to_postfix_escaping_char);
     RUN_TEST(test_regex_int_num);
     RUN_TEST(test_regex_float_num);
+    RUN_TEST(test_regex_dfa_longest_match);
+    RUN_TEST(test_regex_dfa_priority);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * unit test for clib thread functions
+ */
+#include "test.h"
+
+#include "clib/thread.h"
+#include "clib/typedef.h"
+
+#define TASKS 1000
+
+struct counter_task {
+    struct mutex *lock;
+    u32 *total;
+    u32 runs;
+};
+
+static void _count(void *arg)
+{
+    struct counter_task *task = arg;
+    task->runs++;
+    mutex_lock(task->lock);
+    (*task->total)++;
+    mutex_unlock(task->lock);
+}
+
+TEST(test_thread, pool_runs_every_task_once)
+{
+    struct mutex lock;
+    mutex_init(&lock);
+    u32 total = 0;
+    struct counter_task counters[TASKS];
+    struct task tasks[TASKS];
+    for (u32 i = 0; i < TASKS; i++) {
+        counters[i].lock = &lock;
+        counters[i].total = &total;
+        counters[i].runs = 0;
+        tasks[i].fun = _count;
+        tasks[i].arg = &counters[i];
+    }
+    thread_pool_run(tasks, TASKS, 8);
+    ASSERT_EQ(TASKS, total);
+    for (u32 i = 0; i < TASKS; i++) {
+        ASSERT_EQ(1, counters[i].runs);
+    }
+    //more workers than tasks
+    total = 0;
+    thread_pool_run(tasks, 3, 16);
+    ASSERT_EQ(3, total);
+    mutex_deinit(&lock);
+}
+
+TEST(test_thread, hardware_concurrency)
+{
+    ASSERT_TRUE(thread_hardware_concurrency() >= 1);
+}
+
+int test_thread(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_thread_pool_runs_every_task_once);
+    RUN_TEST(test_thread_hardware_concurrency);
+    test_stats.total_failures += Unity.TestFailures;
+    test_stats.total_tests += Unity.NumberOfTests;
+    return UNITY_END();
+}
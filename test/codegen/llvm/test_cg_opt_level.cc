@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * Unit tests for the optimization levels of native code
+ */
+#include "codegen/llvm/cg_llvm.h"
+#include "compiler/engine.h"
+#include "sema/analyzer.h"
+#include "test_env.h"
+#include "gtest/gtest.h"
+#include "test_fixture.h"
+#include <string.h>
+
+//the IR of quad before and after the pipeline of the opt level runs over its module
+static void _optimize_quad(enum llvm_opt_level opt_level, char **emitted_ir, char **optimized_ir)
+{
+    const char test_code[] = R"(
+def sq(x:int) -> int: x * x
+def quad(x:int) -> int: sq(sq(x))
+)";
+    struct engine *engine = engine_llvm_new(get_test_env()->sys_path, false);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    cg->target_options.opt_level = opt_level;
+    create_ir_module(cg, "opt_level");
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    analyze(cg->base.sema_context, block);
+    emit_code(cg, block);
+    for (size_t i = 0; i < array_size(&block->block->nodes); i++) {
+        emit_ir_code(cg, (struct ast_node *)array_get_ptr(&block->block->nodes, i));
+    }
+    *emitted_ir = LLVMPrintValueToString(LLVMGetNamedFunction(cg->module, "quad"));
+    EXPECT_TRUE(optimize_ir_module(cg));
+    *optimized_ir = LLVMPrintValueToString(LLVMGetNamedFunction(cg->module, "quad"));
+    node_free(block);
+    engine_free(engine);
+}
+
+TEST_F(TestFixture, testCGOptLevelO0KeepsEmittedIR)
+{
+    char *emitted_ir, *optimized_ir;
+    _optimize_quad(LLVM_OPT_O0, &emitted_ir, &optimized_ir);
+    ASSERT_STREQ(emitted_ir, optimized_ir);
+    ASSERT_NE((char *)0, strstr(optimized_ir, "call"));
+    LLVMDisposeMessage(emitted_ir);
+    LLVMDisposeMessage(optimized_ir);
+}
+
+TEST_F(TestFixture, testCGOptLevelO2InlinesCalls)
+{
+    char *emitted_ir, *optimized_ir;
+    _optimize_quad(LLVM_OPT_O2, &emitted_ir, &optimized_ir);
+    ASSERT_NE((char *)0, strstr(emitted_ir, "call"));
+    ASSERT_EQ((char *)0, strstr(optimized_ir, "call"));
+    //the locals the function was emitted with are promoted to registers
+    ASSERT_EQ((char *)0, strstr(optimized_ir, "alloca"));
+    LLVMDisposeMessage(emitted_ir);
+    LLVMDisposeMessage(optimized_ir);
+}
+
+TEST_F(TestFixture, testCGOptLevelParse)
+{
+    enum llvm_opt_level opt_level = LLVM_OPT_O2;
+    ASSERT_TRUE(parse_opt_level("0", &opt_level));
+    ASSERT_EQ(LLVM_OPT_O0, opt_level);
+    ASSERT_TRUE(parse_opt_level("3", &opt_level));
+    ASSERT_EQ(LLVM_OPT_O3, opt_level);
+    ASSERT_TRUE(parse_opt_level("s", &opt_level));
+    ASSERT_EQ(LLVM_OPT_OS, opt_level);
+    //what -O does not name is rejected, the level is left as it was
+    const char *invalid_levels[] = { "", "4", "22", "-1", "fast", "z", "2 " };
+    for (size_t i = 0; i < sizeof(invalid_levels) / sizeof(invalid_levels[0]); i++) {
+        ASSERT_FALSE(parse_opt_level(invalid_levels[i], &opt_level)) << invalid_levels[i];
+        ASSERT_EQ(LLVM_OPT_OS, opt_level);
+    }
+}
@@ -73,6 +73,35 @@ struct Contains = xy:&Point2D\n\
     engine_free(engine);
 }
 
+TEST(test_type_size_info, struct_contains_unnamed_struct)
+{
+    char test_code[] = "struct Point2D = x:f64, y:f64";
+    struct engine *engine = engine_wasm_new();
+    struct type_context *tc = engine->fe->sema_context->tc;
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    struct ast_node *node = array_front_ptr(&block->block->nodes);
+    analyze(engine->fe->sema_context, node);
+    //unnamed structs like a function's stack frame are not cached, their layouts are owned by the parent
+    struct type_item inner, outer;
+    struct_type_init(&inner);
+    struct_type_add_member(&inner, create_nullary_type(tc, TYPE_F64));
+    struct_type_add_member(&inner, create_nullary_type(tc, TYPE_F64));
+    struct_type_init(&outer);
+    struct_type_add_member(&outer, node->type);
+    struct_type_add_member(&outer, &inner);
+    struct struct_layout *sl = layout_struct(tc, &outer, Product);
+    ASSERT_EQ(256, sl->size_bits);
+    ASSERT_EQ(128, *(u64 *)array_get(&sl->field_offsets, 1));
+    ASSERT_EQ(1, array_size(&sl->owned_layouts));
+    struct struct_layout *inner_sl = array_get_ptr(&sl->field_layouts, 1);
+    ASSERT_EQ(128, inner_sl->size_bits);
+    sl_free(sl);
+    struct_type_deinit(&outer);
+    struct_type_deinit(&inner);
+    node_free(block);
+    engine_free(engine);
+}
+
 TEST(test_type_size_info, struct_char_double)
 {
     char test_code[] = "struct Point2D = x:char, y:f64";
@@ -154,6 +183,7 @@ int test_type_size_info(void)
     RUN_TEST(test_type_size_info_struct_double_double);
     RUN_TEST(test_type_size_info_struct_contains_struct);
     RUN_TEST(test_type_size_info_struct_refs_struct);
+    RUN_TEST(test_type_size_info_struct_contains_unnamed_struct);
     RUN_TEST(test_type_size_info_struct_char_double);
     RUN_TEST(test_type_size_info_struct_char_char);
     RUN_TEST(test_type_size_info_struct_bool_char);
@@ -8,8 +8,12 @@
 #include "clib/typedef.h"
 #include "test.h"
 #include "codegen/wasm/cg_wasm.h"
+#include "codegen/wasm/wasm_api.h"
+#include "codegen/wasm/wasm_pass.h"
 #include "compiler/engine.h"
+#include "clib/thread.h"
 #include <stdio.h>
+#include <string.h>
 
 u8 *_compile_code(const char *text)
 {
@@ -245,6 +249,532 @@ a[0] + a[1]\n\
     free(wasm);
 }
 
+#define PARALLEL_THREADS 8
+#define PARALLEL_ROUNDS 4
+
+static const char *parallel_codes[] = {
+    "def sq(x): x * x\nsq(10.0)\n",
+    "let mut sum = 0\nfor i in 1..3:\n    for j in 1..3:\n        sum = sum + i * j\nsum",
+    "struct Point2D = x:mut f64, y:f64\ndef change(z:Point2D): \n    z.x = z.x * 10.0\n    z\nlet mut old_z = Point2D{10.0, 20.0}\nlet new_z = change(old_z)\n",
+    "variant A = x:int | y:int\nlet a = A { 10 }\na.y\n",
+    "def pm(x):\n    match x with\n    | -1 -> 100\n    | 3 -> 200\n    | y -> y + 300\npm(-1)\n",
+    "print(\"hello world\")\n",
+    "def t(): (100, 200)\nlet x, y = t()\nx + y\n",
+    "let mut a:u8[2] = [10, 20]\na[0] = 30\na[1] = 40\na[0] + a[1]\n",
+    "def f(x:f64): x ** 2.5 + 1.5\nf(3.0)\n",
+};
+
+struct parallel_output {
+    u8 *data;
+    u32 size;
+};
+
+static struct parallel_output parallel_expected[ARRAY_SIZE(parallel_codes)];
+
+static struct parallel_output _compile_output(const char *text)
+{
+    struct parallel_output output;
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    output.data = compile_to_wasm(engine, text);
+    output.size = cg->ba.size;
+    cg->ba.data = 0;
+    engine_free(engine);
+    return output;
+}
+
+static void *_compile_worker(void *arg)
+{
+    size_t worker = (size_t)arg;
+    size_t code_count = ARRAY_SIZE(parallel_codes);
+    size_t mismatches = 0;
+    for (size_t i = 0; i < PARALLEL_ROUNDS * code_count; i++) {
+        size_t code_index = (worker + i) % code_count;
+        struct parallel_output output = _compile_output(parallel_codes[code_index]);
+        struct parallel_output *expected = &parallel_expected[code_index];
+        if (!output.data || output.size != expected->size || memcmp(output.data, expected->data, output.size))
+            mismatches++;
+        free(output.data);
+    }
+    return (void *)mismatches;
+}
+
+TEST(test_wasm_codegen, parallel_compile)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(parallel_codes); i++) {
+        parallel_expected[i] = _compile_output(parallel_codes[i]);
+        ASSERT_TRUE(parallel_expected[i].data);
+    }
+    struct thread threads[PARALLEL_THREADS];
+    for (size_t i = 0; i < PARALLEL_THREADS; i++) {
+        ASSERT_TRUE(thread_start(&threads[i], _compile_worker, (void *)i));
+    }
+    size_t mismatches = 0;
+    for (size_t i = 0; i < PARALLEL_THREADS; i++) {
+        mismatches += (size_t)thread_join(&threads[i]);
+    }
+    ASSERT_EQ(0, mismatches);
+    for (size_t i = 0; i < ARRAY_SIZE(parallel_codes); i++) {
+        free(parallel_expected[i].data);
+    }
+}
+
+TEST(test_wasm_codegen, reuse_engine)
+{
+    size_t code_count = ARRAY_SIZE(parallel_codes);
+    for (size_t i = 0; i < code_count; i++) {
+        parallel_expected[i] = _compile_output(parallel_codes[i]);
+        ASSERT_TRUE(parallel_expected[i].data);
+    }
+    //one engine keeps the analyzed prelude and rolls back to it after each module
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 2 * code_count; i++) {
+        size_t code_index = i < code_count ? i : 2 * code_count - 1 - i;
+        //a module failing to parse must not leave state behind
+        ASSERT_EQ(0, compile_to_wasm(engine, "for i in 0..10\n"));
+        u8 *data = compile_to_wasm(engine, parallel_codes[code_index]);
+        struct parallel_output *expected = &parallel_expected[code_index];
+        if (!data || cg->ba.size != expected->size || memcmp(data, expected->data, expected->size))
+            mismatches++;
+    }
+    ASSERT_EQ(0, mismatches);
+    engine_free(engine);
+    for (size_t i = 0; i < code_count; i++) {
+        free(parallel_expected[i].data);
+    }
+}
+
+TEST(test_wasm_codegen, time_report)
+{
+    struct engine *engine = engine_wasm_new();
+    struct time_report *report = &engine->time_report;
+    ASSERT_TRUE(report->phases[PHASE_FRONTEND].nodes > 0);
+    ASSERT_TRUE(report->phases[PHASE_FRONTEND].tokens > 0);
+    u64 frontend_ns = report->phases[PHASE_FRONTEND].ns;
+    compile_to_wasm(engine, "def sq(x): x * x\nsq(10.0)\n");
+    ASSERT_EQ(frontend_ns, report->phases[PHASE_FRONTEND].ns);
+    ASSERT_EQ(PHASE_COUNT, report->phase);
+    struct phase_stats *parse = &report->phases[PHASE_PARSE];
+    struct phase_stats *analyze = &report->phases[PHASE_ANALYZE];
+    ASSERT_TRUE(parse->tokens > 0 && parse->nodes > 0 && parse->allocs > 0);
+    //tokens are only made while parsing, types while analyzing
+    ASSERT_EQ(0, analyze->tokens);
+    ASSERT_TRUE(analyze->types > 0);
+    ASSERT_EQ(0, report->phases[PHASE_CODEGEN].tokens);
+    ASSERT_EQ(0, report->phases[PHASE_EMIT].ns);
+    u64 tokens = parse->tokens;
+    //the report is of the last module only
+    compile_to_wasm(engine, "def sq(x): x * x\nsq(10.0)\n");
+    ASSERT_EQ(tokens, parse->tokens);
+    engine_free(engine);
+}
+
+static u32 _read_uleb(const u8 **p)
+{
+    u32 value = 0, shift = 0;
+    u8 byte;
+    do {
+        byte = *(*p)++;
+        value |= (u32)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+TEST(test_wasm_codegen, many_functions)
+{
+    //the function count takes more than one LEB128 byte
+    char code[200 * 32 + 16];
+    size_t len = 0;
+    for (int i = 0; i < 200; i++) {
+        len += sprintf(code + len, "def fn%d(x:int): x + %d\n", i, i);
+    }
+    sprintf(code + len, "fn199(1)\n");
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    const u8 *p = compile_to_wasm(engine, code);
+    ASSERT_TRUE(p != 0);
+    const u8 *end = p + cg->ba.size;
+    p += 8; //magic and version
+    u32 num_func = 0;
+    while (p < end) {
+        u8 id = *p++;
+        u32 size = _read_uleb(&p);
+        if (id == 3) { //function section
+            num_func = _read_uleb(&p);
+            break;
+        }
+        p += size;
+    }
+    ASSERT_EQ(201, num_func); //and the start function
+    engine_free(engine);
+}
+
+TEST(test_wasm_codegen, many_locals)
+{
+    //more locals than the former fixed local variable stack, chained so they coalesce into one
+    char code[1500 * 32 + 64];
+    size_t len = sprintf(code, "def chain():\n    let v0 = 0\n");
+    for (int i = 1; i < 1500; i++) {
+        len += sprintf(code + len, "    let v%d = v%d + 1\n", i, i - 1);
+    }
+    sprintf(code + len, "    v1499\nchain()\n");
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg->opt_level = 0;
+    ASSERT_TRUE(compile_to_wasm(engine, code) != 0);
+    u32 size = cg->ba.size;
+    cg->opt_level = 1;
+    ASSERT_TRUE(compile_to_wasm(engine, code) != 0);
+    ASSERT_TRUE(cg->ba.size < size);
+    engine_free(engine);
+}
+
+TEST(test_wasm_codegen, definitions_only)
+{
+    //no top level statement, the start function is empty
+    const char test_code[] = "def inc(x:int): x + 1\n";
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    const u8 *p = compile_to_wasm(engine, test_code);
+    ASSERT_TRUE(p != 0);
+    ASSERT_TRUE(cg->ba.size > 8);
+    engine_free(engine);
+}
+
+TEST(test_wasm_codegen, while_body_local)
+{
+    //a let binding in the while body is collected as a local of the function
+    const char test_code[] = "def run():\n    let mut i = 0\n    let mut n = 0\n    while i < 5:\n        let sq = i * i\n        n = n + sq\n        i = i + 1\n    n\nrun()\n";
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    const u8 *p = compile_to_wasm(engine, test_code);
+    ASSERT_TRUE(p != 0);
+    ASSERT_TRUE(cg->ba.size > 8);
+    engine_free(engine);
+}
+
+TEST(test_wasm_codegen, leb128)
+{
+    struct byte_array ba;
+    ba_init(&ba, 1);
+    ASSERT_EQ(1, wasm_emit_uint(&ba, 0));
+    ASSERT_EQ(1, wasm_emit_uint(&ba, 127));
+    ASSERT_EQ(2, wasm_emit_uint(&ba, 128));
+    ASSERT_EQ(0x7F, ba.data[1]);
+    ASSERT_EQ(0x80, ba.data[2]);
+    ASSERT_EQ(0x01, ba.data[3]);
+    ba_reset(&ba);
+    ASSERT_EQ(3, wasm_emit_uint(&ba, 624485));
+    ASSERT_EQ(0xE5, ba.data[0]);
+    ASSERT_EQ(0x8E, ba.data[1]);
+    ASSERT_EQ(0x26, ba.data[2]);
+    ASSERT_EQ(5, wasm_emit_uint(&ba, 0xFFFFFFFF));
+    ASSERT_EQ(10, wasm_emit_uint(&ba, 0xFFFFFFFFFFFFFFFF));
+    ASSERT_EQ(0x01, ba.data[ba.size - 1]);
+    ba_reset(&ba);
+    ASSERT_EQ(1, wasm_emit_int(&ba, 63));
+    ASSERT_EQ(2, wasm_emit_int(&ba, 64));
+    ASSERT_EQ(1, wasm_emit_int(&ba, -64));
+    ASSERT_EQ(3, wasm_emit_int(&ba, -123456));
+    ASSERT_EQ(0xC0, ba.data[4]);
+    ASSERT_EQ(0xBB, ba.data[5]);
+    ASSERT_EQ(0x78, ba.data[6]);
+    ba_reset(&ba);
+    ASSERT_EQ(10, wasm_emit_int(&ba, INT64_MIN));
+    ASSERT_EQ(0x7F, ba.data[9]);
+    ba_deinit(&ba);
+}
+
+TEST(test_wasm_codegen, back_filled_size)
+{
+    struct byte_array ba;
+    ba_init(&ba, 1);
+    ba_add(&ba, 0xAA);
+    u32 start = wasm_begin_size(&ba);
+    ba_add(&ba, 1);
+    ba_add(&ba, 2);
+    wasm_end_size(&ba, start);
+    ASSERT_EQ(4, ba.size);
+    ASSERT_EQ(2, ba.data[1]);
+    ASSERT_EQ(1, ba.data[2]);
+    ASSERT_EQ(2, ba.data[3]);
+    start = wasm_begin_size(&ba);
+    for (u32 i = 0; i < 200; i++) {
+        ba_add(&ba, (u8)i);
+    }
+    wasm_end_size(&ba, start);
+    ASSERT_EQ(4 + 2 + 200, ba.size);
+    ASSERT_EQ(0xC8, ba.data[4]);
+    ASSERT_EQ(0x01, ba.data[5]);
+    ASSERT_EQ(0, ba.data[6]);
+    ASSERT_EQ(199, ba.data[205]);
+    ba_deinit(&ba);
+}
+
+TEST(test_wasm_codegen, back_filled_padded_size)
+{
+    struct byte_array ba;
+    ba_init(&ba, 1);
+    ba_add(&ba, 0xAA);
+    u32 start = wasm_begin_size(&ba);
+    ba_add(&ba, 1);
+    ba_add(&ba, 2);
+    wasm_end_padded_size(&ba, start);
+    ASSERT_EQ(1 + 5 + 2, ba.size);
+    u8 padded_size[] = {0x82, 0x80, 0x80, 0x80, 0x00};
+    ASSERT_EQ(0, memcmp(padded_size, &ba.data[1], sizeof(padded_size)));
+    u32 read_size;
+    ASSERT_EQ(2, wasm_read_uint(&ba.data[1], &read_size));
+    ASSERT_EQ(5, read_size);
+    ASSERT_EQ(1, ba.data[6]);
+    ASSERT_EQ(2, ba.data[7]);
+    ba_deinit(&ba);
+}
+
+TEST(test_wasm_codegen, ir_roundtrip)
+{
+    //block i32, br_table, call_indirect, memarg, negative i64, f64 bits, memory.copy, if else
+    u8 code[] = {0x02, 0x7F, 0x20, 0, 0x0E, 2, 0, 1, 0, 0x41, 7, 0x0B, 0x1A,
+                 0x20, 0, 0x11, 3, 0, 0x28, 2, 0x90, 0x03, 0x1A,
+                 0x42, 0x7F, 0x1A, 0x44, 0, 0, 0, 0, 0, 0, 0xF0, 0x3F, 0x1A,
+                 0x20, 0, 0x20, 1, 0x41, 8, 0xFC, 10, 0, 0,
+                 0x20, 0, 0x04, 0x40, 0x01, 0x05, 0x00, 0x0B, 0x0B};
+    struct wasm_function_ir fun;
+    wasm_ir_init(&fun);
+    wasm_ir_add_local(&fun, WasmTypeI32);
+    ASSERT_TRUE(wasm_ir_decode(&fun, code, sizeof(code)));
+    ASSERT_TRUE(wasm_ir_link(&fun));
+    ASSERT_EQ(WasmTypeI32, wasm_ir_at(&fun, 0)->value);
+    ASSERT_EQ(4, wasm_ir_at(&fun, 0)->match);
+    ASSERT_EQ(0, wasm_ir_at(&fun, 4)->match);
+    ASSERT_EQ(2, wasm_ir_at(&fun, 2)->value);
+    ASSERT_EQ(1, wasm_ir_label(&fun, wasm_ir_at(&fun, 2), 1));
+    ASSERT_EQ(3, wasm_ir_at(&fun, 7)->value);
+    ASSERT_EQ(400, wasm_ir_at(&fun, 8)->extra);
+    ASSERT_EQ(-1, wasm_ir_at(&fun, 10)->value);
+    ASSERT_EQ(0x3FF0000000000000LL, wasm_ir_at(&fun, 12)->value);
+    ASSERT_EQ(10, wasm_ir_at(&fun, 17)->sub);
+    ASSERT_EQ(21, wasm_ir_at(&fun, 19)->match);
+    ASSERT_EQ(23, wasm_ir_at(&fun, 21)->match);
+    struct byte_array ba;
+    ba_init(&ba, 17);
+    wasm_ir_encode(&fun, &ba);
+    ASSERT_EQ(3 + sizeof(code), ba.size);
+    ASSERT_EQ(1, ba.data[0]);
+    ASSERT_EQ(1, ba.data[1]);
+    ASSERT_EQ(WasmTypeI32, ba.data[2]);
+    for (u32 i = 0; i < sizeof(code); i++) {
+        ASSERT_EQ(code[i], ba.data[i + 3]);
+    }
+    //an unknown opcode fails to decode
+    u8 unknown[] = {0x20, 0, 0xFE, 0x0B};
+    wasm_ir_reset(&fun);
+    ASSERT_FALSE(wasm_ir_decode(&fun, unknown, sizeof(unknown)));
+    ba_deinit(&ba);
+    wasm_ir_deinit(&fun);
+}
+
+TEST(test_wasm_codegen, simd_ir_roundtrip)
+{
+    //v128.load, v128.const, f64x2.add, v128.store, i32x4.splat, i32x4.extract_lane
+    u8 code[] = {0x20, 0, 0x20, 0, 0xFD, 0x00, 3, 0,
+                 0xFD, 0x0C, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+                 0xFD, 0xF0, 0x01, 0xFD, 0x0B, 3, 0,
+                 0x20, 0, 0xFD, 0x11, 0xFD, 0x1B, 2, 0x1A, 0x0B};
+    struct wasm_function_ir fun;
+    wasm_ir_init(&fun);
+    ASSERT_TRUE(wasm_ir_decode(&fun, code, sizeof(code)));
+    ASSERT_TRUE(wasm_ir_link(&fun));
+    ASSERT_EQ(11, wasm_ir_size(&fun));
+    ASSERT_EQ(WasmInstrVecV128Load, wasm_ir_at(&fun, 2)->sub);
+    ASSERT_EQ(3, wasm_ir_at(&fun, 2)->value);
+    ASSERT_EQ(WasmInstrVecV128Const, wasm_ir_at(&fun, 3)->sub);
+    ASSERT_EQ(0x08070605, wasm_ir_label(&fun, wasm_ir_at(&fun, 3), 1));
+    ASSERT_EQ(WasmInstrVecF64x2Add, wasm_ir_at(&fun, 4)->sub);
+    ASSERT_EQ(WasmInstrVecV128Store, wasm_ir_at(&fun, 5)->sub);
+    ASSERT_EQ(2, wasm_ir_at(&fun, 8)->value);
+    struct byte_array ba;
+    ba_init(&ba, 17);
+    wasm_ir_encode(&fun, &ba);
+    ASSERT_EQ(1 + sizeof(code), ba.size);
+    for (u32 i = 0; i < sizeof(code); i++) {
+        ASSERT_EQ(code[i], ba.data[i + 1]);
+    }
+    //the lane loads and stores of memory are not known
+    u8 load_lane[] = {0x20, 0, 0x20, 1, 0xFD, 0x54, 0, 0, 0, 0x1A, 0x0B};
+    wasm_ir_reset(&fun);
+    ASSERT_FALSE(wasm_ir_decode(&fun, load_lane, sizeof(load_lane)));
+    ba_deinit(&ba);
+    wasm_ir_deinit(&fun);
+}
+
+static u32 _compile_size(struct engine *engine, const char *code, u32 target_features)
+{
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    cg->target_features = target_features;
+    ASSERT_TRUE(compile_to_wasm(engine, code) != 0);
+    return cg->ba.size;
+}
+
+TEST(test_wasm_codegen, simd_for_loop)
+{
+    //the vector loop goes ahead of the scalar one
+    const char vector_code[] = "\n\
+let mut x:f64[11], y:f64[11]\n\
+for i in 0..11:\n\
+    y[i] = 0.5 * x[i] + y[i]\n\
+y[10]\n\
+";
+    //the loop variable as value, the element of another iteration and another row written are not vectorized
+    const char *scalar_codes[] = {
+        "let mut x:f64[11]\nfor i in 0..11:\n    x[i] = i * 0.5\nx[10]\n",
+        "let mut x:f64[11], y:f64[11]\nfor i in 0..10:\n    y[i] = x[i + 1]\ny[9]\n",
+        "let mut b:f64[2][9]\nfor i in 0..9:\n    b[1][i] = b[0][i]\n    b[0][i] = 1.0\nb[1][8]\n",
+    };
+    struct engine *engine = engine_wasm_new();
+    ASSERT_TRUE(_compile_size(engine, vector_code, WASM_FEATURE_SIMD) > _compile_size(engine, vector_code, 0));
+    for (u32 i = 0; i < ARRAY_SIZE(scalar_codes); i++) {
+        ASSERT_EQ(_compile_size(engine, scalar_codes[i], 0), _compile_size(engine, scalar_codes[i], WASM_FEATURE_SIMD));
+    }
+    engine_free(engine);
+}
+
+static u32 _count_bytes(struct byte_array *ba, const u8 *bytes, u32 size)
+{
+    u32 count = 0;
+    for (u32 i = 0; i + size <= ba->size; i++) {
+        if (!memcmp(&ba->data[i], bytes, size)) count++;
+    }
+    return count;
+}
+
+TEST(test_wasm_codegen, bulk_memory)
+{
+    const u8 memory_copy[] = {WasmInstrMemOp, WasmInstrMemCopy, 0, 0};
+    const u8 memory_fill[] = {WasmInstrMemOp, WasmInstrMemFill, 0};
+    //256 bytes struct copied from its literal to s and to t, small struct, constant, same bytes and small arrays
+    const char *codes[] = {
+        "struct R = a:f64, b:f64, c:f64, d:f64, e:f64, f:f64, g:f64, h:f64\nstruct B = a:R, b:R, c:R, d:R\n"
+            "let s = B{R{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, R{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, R{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}, R{1.0, 2.0, 3.0, 4.0, 5.0, 6.0, 7.0, 8.0}}\nlet t = s\nt.d.h\n",
+        "let s = cf64{1.0, 2.0}\nlet t = s\nt.im\n",
+        "let a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63, 64]\na[63]\n",
+        "let a = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]\na[31]\n",
+        "let a = [1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 62, 63]\na[62]\n",
+        "let a = [0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0]\na[30]\n",
+    };
+    u32 copies[] = {2, 0, 1, 0, 0, 0};
+    u32 fills[] = {0, 0, 0, 1, 0, 0};
+    struct engine *engine = engine_wasm_new();
+    struct cg_wasm *cg = (struct cg_wasm*)engine->be->cg;
+    for (u32 i = 0; i < ARRAY_SIZE(codes); i++) {
+        ASSERT_TRUE(compile_to_wasm(engine, codes[i]) != 0);
+        ASSERT_EQ(copies[i], _count_bytes(&cg->ba, memory_copy, sizeof(memory_copy)));
+        ASSERT_EQ(fills[i], _count_bytes(&cg->ba, memory_fill, sizeof(memory_fill)));
+    }
+    //the constant array is in the data section
+    ASSERT_TRUE(compile_to_wasm(engine, codes[2]) != 0);
+    ASSERT_EQ(256, cg->data.size);
+    engine_free(engine);
+}
+
+static void _assert_passes(u8 *code, u32 size, u8 *expected, u32 expected_size)
+{
+    struct wasm_function_ir fun;
+    wasm_ir_init(&fun);
+    ASSERT_TRUE(wasm_ir_decode(&fun, code, size));
+    ASSERT_TRUE(wasm_ir_link(&fun));
+    wasm_run_passes(&fun, WASM_OPT_LEVEL_MAX);
+    struct byte_array ba;
+    ba_init(&ba, 17);
+    wasm_ir_encode(&fun, &ba);
+    ASSERT_EQ(expected_size + 1, ba.size);
+    ASSERT_EQ(0, ba.data[0]); //no locals
+    for (u32 i = 0; i < expected_size; i++) {
+        ASSERT_EQ(expected[i], ba.data[i + 1]);
+    }
+    ba_deinit(&ba);
+    wasm_ir_deinit(&fun);
+}
+
+TEST(test_wasm_codegen, peephole)
+{
+    //local.set x, local.get x => local.tee x
+    u8 tee[] = {0x20, 0, 0x21, 1, 0x20, 1, 0x20, 1, 0x6A, 0x21, 2, 0x0B};
+    u8 tee_expected[] = {0x20, 0, 0x22, 1, 0x20, 1, 0x6A, 0x21, 2, 0x0B};
+    _assert_passes(tee, sizeof(tee), tee_expected, sizeof(tee_expected));
+    //(2 + 3) + 0, dropped
+    u8 fold[] = {0x41, 2, 0x41, 3, 0x6A, 0x41, 0, 0x6A, 0x1A, 0x0B};
+    u8 fold_expected[] = {0x0B};
+    _assert_passes(fold, sizeof(fold), fold_expected, sizeof(fold_expected));
+    //not (a < b) => a >= b
+    u8 not_lt[] = {0x02, 0x40, 0x20, 0, 0x20, 1, 0x48, 0x45, 0x0D, 0, 0x0B, 0x0B};
+    u8 not_lt_expected[] = {0x02, 0x40, 0x20, 0, 0x20, 1, 0x4E, 0x0D, 0, 0x0B, 0x0B};
+    _assert_passes(not_lt, sizeof(not_lt), not_lt_expected, sizeof(not_lt_expected));
+    //loop body block without continue is unwrapped, the branch to the loop crosses one block less
+    u8 loop[] = {0x02, 0x40, 0x03, 0x40, 0x20, 0, 0x0D, 1, 0x02, 0x40, 0x20, 1, 0x0D, 1, 0x0B, 0x0C, 0, 0x0B, 0x0B, 0x0B};
+    u8 loop_expected[] = {0x02, 0x40, 0x03, 0x40, 0x20, 0, 0x0D, 1, 0x20, 1, 0x0D, 0, 0x0C, 0, 0x0B, 0x0B, 0x0B};
+    _assert_passes(loop, sizeof(loop), loop_expected, sizeof(loop_expected));
+    //code after br is never run
+    u8 dead[] = {0x02, 0x40, 0x0C, 0, 0x20, 0, 0x21, 1, 0x0B, 0x0B};
+    u8 dead_expected[] = {0x02, 0x40, 0x0C, 0, 0x0B, 0x0B};
+    _assert_passes(dead, sizeof(dead), dead_expected, sizeof(dead_expected));
+}
+
+static void _assert_coalesced(u8 *code, u32 size, u32 locals, u32 expected_locals)
+{
+    struct wasm_function_ir fun;
+    wasm_ir_init(&fun);
+    for (u32 i = 0; i < locals; i++) {
+        wasm_ir_add_local(&fun, WasmTypeI32);
+    }
+    ASSERT_TRUE(wasm_ir_decode(&fun, code, size));
+    ASSERT_TRUE(wasm_ir_link(&fun));
+    ASSERT_EQ(expected_locals < locals, wasm_coalesce_locals(&fun));
+    ASSERT_EQ(expected_locals, array_size(&fun.locals));
+    wasm_ir_deinit(&fun);
+}
+
+TEST(test_wasm_codegen, coalesce_locals)
+{
+    //one local after the other
+    u8 sequence[] = {0x41, 1, 0x21, 0, 0x20, 0, 0x24, 0, 0x41, 2, 0x21, 1, 0x20, 1, 0x24, 0, 0x0B};
+    _assert_coalesced(sequence, sizeof(sequence), 2, 1);
+    //local 0 is live around the loop while local 1 is written in it
+    u8 loop[] = {0x41, 0, 0x21, 0, 0x03, 0x40, 0x41, 5, 0x21, 1, 0x20, 1, 0x20, 0, 0x6A, 0x21, 0, 0x0C, 0, 0x0B, 0x0B};
+    _assert_coalesced(loop, sizeof(loop), 2, 2);
+    //local 0 is read as its zero initial value
+    u8 zero[] = {0x20, 0, 0x24, 0, 0x41, 1, 0x21, 1, 0x20, 1, 0x24, 0, 0x0B};
+    _assert_coalesced(zero, sizeof(zero), 2, 2);
+    //the value of local 0 set before the if is read after it, through the branch writing local 1
+    u8 branch[] = {0x41, 1, 0x21, 0, 0x20, 2, 0x04, 0x40, 0x41, 2, 0x21, 1, 0x20, 1, 0x24, 0, 0x0B, 0x20, 0, 0x24, 0, 0x0B};
+    _assert_coalesced(branch, sizeof(branch), 3, 3);
+    //interfering i32, f64 and i32 locals are declared as one run of two i32 and one of f64
+    u8 mixed[] = {0x41, 1, 0x21, 0, 0x44, 0, 0, 0, 0, 0, 0, 0, 0, 0x21, 1, 0x41, 2, 0x21, 2,
+        0x20, 0, 0x1A, 0x20, 1, 0x1A, 0x20, 2, 0x1A, 0x0B};
+    u8 mixed_locals[] = {2, 2, WasmTypeI32, 1, WasmTypeF64};
+    struct wasm_function_ir fun;
+    wasm_ir_init(&fun);
+    wasm_ir_add_local(&fun, WasmTypeI32);
+    wasm_ir_add_local(&fun, WasmTypeF64);
+    wasm_ir_add_local(&fun, WasmTypeI32);
+    ASSERT_TRUE(wasm_ir_decode(&fun, mixed, sizeof(mixed)));
+    ASSERT_TRUE(wasm_ir_link(&fun));
+    ASSERT_TRUE(wasm_coalesce_locals(&fun));
+    struct byte_array ba;
+    ba_init(&ba, 17);
+    wasm_ir_encode(&fun, &ba);
+    for (u32 i = 0; i < sizeof(mixed_locals); i++) {
+        ASSERT_EQ(mixed_locals[i], ba.data[i]);
+    }
+    //the f64 local is the last one now
+    ASSERT_EQ(WasmTypeF64, wasm_ir_local_type(&fun, 2));
+    ba_deinit(&ba);
+    wasm_ir_deinit(&fun);
+}
+
 int test_wasm_codegen(void)
 {
     UNITY_BEGIN();
@@ -263,6 +793,22 @@ int test_wasm_codegen(void)
     RUN_TEST(test_wasm_codegen_return_tuple);
     RUN_TEST(test_wasm_codegen_tuple_param);
     RUN_TEST(test_wasm_codegen_array_access);
+    RUN_TEST(test_wasm_codegen_parallel_compile);
+    RUN_TEST(test_wasm_codegen_reuse_engine);
+    RUN_TEST(test_wasm_codegen_time_report);
+    RUN_TEST(test_wasm_codegen_many_functions);
+    RUN_TEST(test_wasm_codegen_many_locals);
+    RUN_TEST(test_wasm_codegen_definitions_only);
+    RUN_TEST(test_wasm_codegen_while_body_local);
+    RUN_TEST(test_wasm_codegen_leb128);
+    RUN_TEST(test_wasm_codegen_back_filled_size);
+    RUN_TEST(test_wasm_codegen_back_filled_padded_size);
+    RUN_TEST(test_wasm_codegen_ir_roundtrip);
+    RUN_TEST(test_wasm_codegen_simd_ir_roundtrip);
+    RUN_TEST(test_wasm_codegen_simd_for_loop);
+    RUN_TEST(test_wasm_codegen_bulk_memory);
+    RUN_TEST(test_wasm_codegen_peephole);
+    RUN_TEST(test_wasm_codegen_coalesce_locals);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * unit test for the on-disk compile cache
+ */
+#include "test.h"
+
+#include "compiler/compile_cache.h"
+#include "clib/string.h"
+#include "clib/util.h"
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+#include <dirent.h>
+
+#define MODULES 4
+#define CACHE_DIR "compile_cache_test"
+
+static void _write_file(const char *path, const char *text)
+{
+    FILE *f = fopen(path, "wb");
+    fputs(text, f);
+    fclose(f);
+}
+
+static void _module_path(char *path, size_t size, int i, const char *ext)
+{
+    snprintf(path, size, CACHE_DIR "_m%d%s", i, ext);
+}
+
+//compile every module through the cache, a compile writes the source as the object. returns the modules compiled
+static int _build(struct compile_cache *cache, bool *compiled)
+{
+    int count = 0;
+    char source[64], object[64];
+    for (int i = 0; i < MODULES; i++) {
+        _module_path(source, sizeof(source), i, ".m");
+        _module_path(object, sizeof(object), i, ".o");
+        remove(object);
+        u64 key;
+        compiled[i] = !compile_cache_fetch(cache, source, ".o", object, &key);
+        if (compiled[i]) {
+            const char *text = read_text_file(source);
+            _write_file(object, text);
+            free((void *)text);
+            compile_cache_store(cache, key, ".o", object);
+            count++;
+        }
+        //hit or miss, the object holds what the source compiles to
+        const char *text = read_text_file(source);
+        const char *obj = read_text_file(object);
+        ASSERT_STREQ(text, obj);
+        free((void *)text);
+        free((void *)obj);
+    }
+    return count;
+}
+
+static void _cleanup(void)
+{
+    char path[300];
+    for (int i = 0; i < MODULES; i++) {
+        _module_path(path, sizeof(path), i, ".m");
+        remove(path);
+        _module_path(path, sizeof(path), i, ".o");
+        remove(path);
+    }
+    DIR *dir = opendir(CACHE_DIR);
+    struct dirent *dp;
+    while (dir && (dp = readdir(dir))) {
+        if (dp->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), CACHE_DIR "/%s", dp->d_name);
+        remove(path);
+    }
+    if (dir)
+        closedir(dir);
+    rmdir(CACHE_DIR);
+}
+
+static void _prelude_init(struct sys_prelude *prelude, const char *text)
+{
+    array_init_free(&prelude->codes, sizeof(string), string_free_generic);
+    string code;
+    string_init_chars(&code, text);
+    array_push(&prelude->codes, &code);
+}
+
+TEST(test_compile_cache, recompile_touched_module)
+{
+    struct sys_prelude prelude;
+    _prelude_init(&prelude, "def sys_fun(x): x\n");
+    struct compile_cache cache;
+    compile_cache_init(&cache, CACHE_DIR, &prelude);
+    char path[64], text[64];
+    for (int i = 0; i < MODULES; i++) {
+        _module_path(path, sizeof(path), i, ".m");
+        snprintf(text, sizeof(text), "def f%d(): %d\n", i, i);
+        _write_file(path, text);
+    }
+    bool compiled[MODULES];
+    ASSERT_EQ(MODULES, _build(&cache, compiled));
+    ASSERT_EQ(0, _build(&cache, compiled));
+    ASSERT_EQ(MODULES, cache.hits);
+
+    //touch one module: only that one is compiled again
+    _module_path(path, sizeof(path), 2, ".m");
+    _write_file(path, "def f2(): 200\n");
+    ASSERT_EQ(1, _build(&cache, compiled));
+    ASSERT_TRUE(compiled[2]);
+    ASSERT_EQ(2 * MODULES - 1, cache.hits);
+    ASSERT_EQ(MODULES + 1, cache.misses);
+    ASSERT_EQ(MODULES + 1, cache.stores);
+    compile_cache_deinit(&cache);
+    sys_prelude_deinit(&prelude);
+
+    //a changed prelude invalidates every module
+    _prelude_init(&prelude, "def sys_fun(x): x + 1\n");
+    compile_cache_init(&cache, CACHE_DIR, &prelude);
+    ASSERT_EQ(MODULES, _build(&cache, compiled));
+    ASSERT_EQ(0, _build(&cache, compiled));
+
+    //so do other compile options
+    compile_cache_add_options(&cache, "-O3");
+    ASSERT_EQ(MODULES, _build(&cache, compiled));
+    compile_cache_deinit(&cache);
+    sys_prelude_deinit(&prelude);
+    _cleanup();
+}
+
+TEST(test_compile_cache, lookup_stored_data)
+{
+    struct compile_cache cache;
+    compile_cache_init(&cache, CACHE_DIR, 0);
+    u64 hash = 0x1234;
+    string path;
+    ASSERT_FALSE(compile_cache_lookup(&cache, hash, ".jit.o", &path));
+    string_deinit(&path);
+    const char object[] = "object code";
+    ASSERT_TRUE(compile_cache_store_data(&cache, hash, ".jit.o", object, sizeof(object)));
+    ASSERT_TRUE(compile_cache_lookup(&cache, hash, ".jit.o", &path));
+    const char *text = read_text_file(string_get(&path));
+    ASSERT_STREQ(object, text);
+    free((void *)text);
+    string_deinit(&path);
+    //the same data under another extension is another artifact
+    ASSERT_FALSE(compile_cache_lookup(&cache, hash, ".o", &path));
+    string_deinit(&path);
+    ASSERT_EQ(1, cache.hits);
+    ASSERT_EQ(2, cache.misses);
+    ASSERT_EQ(1, cache.stores);
+    compile_cache_deinit(&cache);
+    _cleanup();
+}
+
+int test_compile_cache(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_compile_cache_recompile_touched_module);
+    RUN_TEST(test_compile_cache_lookup_stored_data);
+    test_stats.total_failures += Unity.TestFailures;
+    test_stats.total_tests += Unity.NumberOfTests;
+    return UNITY_END();
+}
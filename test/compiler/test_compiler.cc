@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * Unit tests for compiling source files with compile jobs
+ */
+#include "compiler/compiler.h"
+#include "test_env.h"
+#include "gtest/gtest.h"
+#include "test_fixture.h"
+#include <dirent.h>
+#include <stdio.h>
+
+#define COMPILE_JOBS_TEST_DIR "compile_jobs_test"
+#define COMPILE_JOBS_MODULES 4
+
+static void _module_path(char *path, size_t size, int i, const char *ext)
+{
+    snprintf(path, size, COMPILE_JOBS_TEST_DIR "_m%d%s", i, ext);
+}
+
+static void _write_module(int i, const char *body)
+{
+    char path[64];
+    _module_path(path, sizeof(path), i, ".m");
+    FILE *f = fopen(path, "wb");
+    fprintf(f, "def f%d(x:int) -> int: %s\n", i, body);
+    fclose(f);
+}
+
+static void _cleanup(void)
+{
+    char path[300];
+    for (int i = 0; i < COMPILE_JOBS_MODULES; i++) {
+        _module_path(path, sizeof(path), i, ".m");
+        remove(path);
+        _module_path(path, sizeof(path), i, ".o");
+        remove(path);
+    }
+    DIR *dir = opendir(COMPILE_JOBS_TEST_DIR);
+    struct dirent *dp;
+    while (dir && (dp = readdir(dir))) {
+        if (dp->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), COMPILE_JOBS_TEST_DIR "/%s", dp->d_name);
+        remove(path);
+    }
+    if (dir)
+        closedir(dir);
+    remove(COMPILE_JOBS_TEST_DIR);
+}
+
+//compile all modules to objects on two workers, returns the number of failed jobs
+static int _compile_modules(struct sys_prelude *prelude, struct compile_cache *cache, struct compile_job *jobs, char (*sources)[64])
+{
+    for (int i = 0; i < COMPILE_JOBS_MODULES; i++) {
+        _module_path(sources[i], 64, i, ".m");
+        jobs[i].source_file = sources[i];
+        jobs[i].output_filepath = 0;
+        jobs[i].file_type = FT_OBJECT;
+        jobs[i].target = 0;
+        jobs[i].cache = cache;
+        jobs[i].result = 0;
+    }
+    return compile_jobs(prelude, jobs, COMPILE_JOBS_MODULES, 2);
+}
+
+TEST_F(TestFixture, testCompileJobsCacheMissesChangedModuleOnly)
+{
+    _cleanup();
+    for (int i = 0; i < COMPILE_JOBS_MODULES; i++) {
+        _write_module(i, "x + 1");
+    }
+    struct sys_prelude prelude;
+    sys_prelude_init(&prelude, get_test_env()->sys_path);
+    struct compile_cache cache;
+    compile_cache_init(&cache, COMPILE_JOBS_TEST_DIR, &prelude);
+    struct compile_job jobs[COMPILE_JOBS_MODULES];
+    char sources[COMPILE_JOBS_MODULES][64];
+    ASSERT_EQ(0, _compile_modules(&prelude, &cache, jobs, sources));
+    ASSERT_EQ(0, cache.hits);
+    ASSERT_EQ(COMPILE_JOBS_MODULES, cache.misses);
+    ASSERT_EQ(COMPILE_JOBS_MODULES, cache.stores);
+    //only the changed module is compiled again, the others are copied from the cache
+    _write_module(2, "x * 10");
+    ASSERT_EQ(0, _compile_modules(&prelude, &cache, jobs, sources));
+    ASSERT_EQ(COMPILE_JOBS_MODULES - 1, cache.hits);
+    ASSERT_EQ(COMPILE_JOBS_MODULES + 1, cache.misses);
+    ASSERT_EQ(COMPILE_JOBS_MODULES + 1, cache.stores);
+    for (int i = 0; i < COMPILE_JOBS_MODULES; i++) {
+        ASSERT_EQ(i != 2, jobs[i].cached);
+        char object[64];
+        _module_path(object, sizeof(object), i, ".o");
+        FILE *f = fopen(object, "rb");
+        ASSERT_TRUE(f);
+        fclose(f);
+    }
+    compile_cache_deinit(&cache);
+    sys_prelude_deinit(&prelude);
+    _cleanup();
+}
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * unit tests for the tier-0 interpreter
+ */
+#include "test.h"
+
+#include "compiler/interp.h"
+#include "parser/parser.h"
+#include "sema/analyzer.h"
+#include "sema/frontend.h"
+#include <stdio.h>
+
+struct interp_test {
+    struct frontend *fe;
+    struct ast_node *block;
+    struct interp in;
+};
+
+//parse and analyze the code as a module, returns its _start lowered, 0 if it can not be interpreted
+static struct interp_fun *_load(struct interp_test *t, const char *code)
+{
+    t->fe = frontend_init();
+    t->block = split_ast_nodes_with_start_func(0, parse_code(t->fe->parser, code));
+    analyze(t->fe->sema_context, t->block);
+    interp_init(&t->in, t->fe->sema_context);
+    return interp_load(&t->in, t->block, to_symbol("_start"));
+}
+
+static void _unload(struct interp_test *t)
+{
+    interp_deinit(&t->in);
+    node_free(t->block);
+    frontend_deinit(t->fe);
+}
+
+static union interp_value _run(const char *code)
+{
+    struct interp_test t;
+    struct interp_fun *start = _load(&t, code);
+    union interp_value result = { 0 };
+    TEST_ASSERT_NOT_NULL(start);
+    TEST_ASSERT_TRUE(interp_call(&t.in, start, 0, &result));
+    _unload(&t);
+    return result;
+}
+
+TEST(test_interp, local_vars)
+{
+    char test_code[] = "\n\
+let x = 10\n\
+let mut y = x * 3 + 1\n\
+y -= 2\n\
+y\n\
+";
+    ASSERT_EQ(29, _run(test_code).i);
+}
+
+TEST(test_interp, int_wraps)
+{
+    char test_code[] = "\n\
+let x = 2147483647\n\
+x + 1\n\
+";
+    ASSERT_EQ(-2147483647 - 1, _run(test_code).i);
+}
+
+TEST(test_interp, math_call)
+{
+    char test_code[] = "\n\
+func sqrt(__x:f64) -> f64\n\
+sqrt(16.0) + 0.5\n\
+";
+    ASSERT_TRUE(4.5 == _run(test_code).d);
+}
+
+TEST(test_interp, recursion)
+{
+    char test_code[] = "\n\
+def fib(n:int) -> int:\n\
+    if n < 2:\n\
+        n\n\
+    else:\n\
+        fib(n-1) + fib(n-2)\n\
+fib(20)\n\
+";
+    ASSERT_EQ(6765, _run(test_code).i);
+}
+
+TEST(test_interp, loops)
+{
+    char test_code[] = "\n\
+let mut sum = 0\n\
+for i in 0..100:\n\
+    if i % 2 == 0:\n\
+        continue\n\
+    if i > 50:\n\
+        break\n\
+    sum += i\n\
+let mut n = 27\n\
+let mut steps = 0\n\
+while n != 1:\n\
+    n = n % 2 == 0 ? n / 2 : 3 * n + 1\n\
+    steps++\n\
+sum * 1000 + steps\n\
+";
+    ASSERT_EQ(625111, _run(test_code).i);
+}
+
+TEST(test_interp, loop_end_changed)
+{
+    char test_code[] = "\n\
+let mut last = 10\n\
+let mut count = 0\n\
+for i in 0..last:\n\
+    last -= 1\n\
+    count += 1\n\
+count\n\
+";
+    ASSERT_EQ(5, _run(test_code).i);
+}
+
+TEST(test_interp, return_from_loop)
+{
+    char test_code[] = "\n\
+def first_square_above(limit:int) -> int:\n\
+    let mut i = 0\n\
+    while i < 1000:\n\
+        if i * i > limit:\n\
+            return i\n\
+        i++\n\
+    0\n\
+first_square_above(50)\n\
+";
+    ASSERT_EQ(8, _run(test_code).i);
+}
+
+TEST(test_interp, not_supported)
+{
+    char test_code[] = "\n\
+func printf(__format:string, ...) -> int\n\
+printf(\"%d\", 10)\n\
+";
+    struct interp_test t;
+    TEST_ASSERT_NULL(_load(&t, test_code));
+    _unload(&t);
+}
+
+static int native_calls;
+
+static void _native_sq(union interp_value *args, union interp_value *ret)
+{
+    native_calls++;
+    ret->i = args[0].i * args[0].i;
+}
+
+static interp_native_fun _promote_sq(void *promote_context, struct interp_fun *fun)
+{
+    (*(int *)promote_context)++;
+    return fun->name == to_symbol("sq") ? _native_sq : 0;
+}
+
+static interp_native_fun _promote_none(void *promote_context, struct interp_fun *fun)
+{
+    (*(int *)promote_context)++;
+    return 0;
+}
+
+static const char *hot_code = "\n\
+def sq(x:int) -> int: x * x\n\
+let mut sum = 0\n\
+for i in 0..100:\n\
+    sum += sq(i)\n\
+sum\n\
+";
+
+TEST(test_interp, promote_hot_function)
+{
+    struct interp_test t;
+    struct interp_fun *start = _load(&t, hot_code);
+    int promotes = 0;
+    union interp_value result;
+    t.in.hot_threshold = 10;
+    t.in.promote = _promote_sq;
+    t.in.promote_context = &promotes;
+    native_calls = 0;
+    ASSERT_TRUE(interp_call(&t.in, start, 0, &result));
+    ASSERT_EQ(328350, result.i);
+    //the call reaching the threshold is the first one run natively
+    ASSERT_EQ(1, promotes);
+    ASSERT_EQ(1, t.in.promotions);
+    ASSERT_EQ(91, native_calls);
+    _unload(&t);
+}
+
+TEST(test_interp, promote_failed)
+{
+    struct interp_test t;
+    struct interp_fun *start = _load(&t, hot_code);
+    int promotes = 0;
+    union interp_value result;
+    t.in.hot_threshold = 10;
+    t.in.promote = _promote_none;
+    t.in.promote_context = &promotes;
+    ASSERT_TRUE(interp_call(&t.in, start, 0, &result));
+    ASSERT_EQ(328350, result.i);
+    ASSERT_EQ(1, promotes);
+    ASSERT_EQ(0, t.in.promotions);
+    _unload(&t);
+}
+
+TEST(test_interp, out_of_stack)
+{
+    char test_code[] = "\n\
+def down(n:int) -> int:\n\
+    if n == 0:\n\
+        0\n\
+    else:\n\
+        down(n - 1) + 1\n\
+down(100000)\n\
+";
+    struct interp_test t;
+    struct interp_fun *start = _load(&t, test_code);
+    union interp_value result;
+    ASSERT_FALSE(interp_call(&t.in, start, 0, &result));
+    _unload(&t);
+}
+
+int test_interp(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_interp_local_vars);
+    RUN_TEST(test_interp_int_wraps);
+    RUN_TEST(test_interp_math_call);
+    RUN_TEST(test_interp_recursion);
+    RUN_TEST(test_interp_loops);
+    RUN_TEST(test_interp_loop_end_changed);
+    RUN_TEST(test_interp_return_from_loop);
+    RUN_TEST(test_interp_not_supported);
+    RUN_TEST(test_interp_promote_hot_function);
+    RUN_TEST(test_interp_promote_failed);
+    RUN_TEST(test_interp_out_of_stack);
+    test_stats.total_failures += Unity.TestFailures;
+    test_stats.total_tests += Unity.NumberOfTests;
+    return UNITY_END();
+}
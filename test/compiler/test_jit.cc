@@ -12,6 +12,9 @@
 #include "test_env.h"
 #include "gtest/gtest.h"
 #include "test_fixture.h"
+#include <dirent.h>
+
+#define JIT_CACHE_TEST_DIR "jit_cache_test"
 
 
 TEST_F(TestFixture, testJITNumber)
@@ -37,6 +40,19 @@ TEST_F(TestFixture, testJITNegNumber)
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITNegF64)
+{
+    char test_code[] = R"(
+def f(x:f64):
+    -x * 2.0
+f(1.25)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(-2.5, eval_module(jit, block).d_value);
+    node_free(block);
+}
+
 TEST_F(TestFixture, testJITRemainderOp)
 {
     char test_code[] = R"(
@@ -48,6 +64,32 @@ TEST_F(TestFixture, testJITRemainderOp)
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITBitwiseOps)
+{
+    char test_code[] = R"(
+def f(x:int, y:int):
+    ((x & y) | (x << 4)) ^ (y >> 1)
+f(12, 10)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(205, eval_module(jit, block).i_value);
+    node_free(block);
+}
+
+TEST_F(TestFixture, testJITPowOp)
+{
+    char test_code[] = R"(
+def f(x:f64):
+    x ** 3.0 + x ** 0.5
+f(4.0)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(66.0, eval_module(jit, block).d_value);
+    node_free(block);
+}
+
 TEST_F(TestFixture, testJITPositiveNumber)
 {
     char test_code[] = R"(
@@ -70,7 +112,6 @@ TEST_F(TestFixture, testJITChar)
     node_free(block);
 }
 
-/*FIXME: type cast tests is not working
 TEST_F(TestFixture, testJITTypeCast)
 {
     char test_code[] = R"(
@@ -81,7 +122,33 @@ TEST_F(TestFixture, testJITTypeCast)
     ASSERT_EQ(20.0, eval_module(jit, block).d_value);
     node_free(block);
 }
-*/
+
+TEST_F(TestFixture, testJITCastNode)
+{
+    char test_code[] = R"(
+def f(x:f64):
+    (int)x * 10 + (int)(x * 4.0)
+f(2.75)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(31, eval_module(jit, block).i_value);
+    node_free(block);
+}
+
+TEST_F(TestFixture, testJITLibcFunc)
+{
+    //c library functions declared in the sys prelude are resolved from the process
+    char test_code[] = R"(
+def f(x:f64):
+    log2(x) + cbrt(x)
+f(8.0)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(5.0, eval_module(jit, block).d_value);
+    node_free(block);
+}
 
 TEST_F(TestFixture, testJITLocalVar)
 {
@@ -235,6 +302,86 @@ sq(10.0)
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITLazyFuncDefinitions)
+{
+    char test_code[] = R"(
+def sq_lazy(x:int) -> int: x * x
+def quad_lazy(x:int) -> int: sq_lazy(sq_lazy(x))
+quad_lazy(3)
+quad_lazy(2)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    //the definitions are added as the repl does, they are compiled by the first call of quad_lazy
+    eval_node(jit, (struct ast_node *)array_get_ptr(&block->block->nodes, 0));
+    eval_node(jit, (struct ast_node *)array_get_ptr(&block->block->nodes, 1));
+    auto call = (struct ast_node *)array_get_ptr(&block->block->nodes, 2);
+    analyze(cg->base.sema_context, call);
+    ASSERT_EQ(81, eval_exp(jit, call).i_value);
+    call = (struct ast_node *)array_get_ptr(&block->block->nodes, 3);
+    analyze(cg->base.sema_context, call);
+    ASSERT_EQ(16, eval_exp(jit, call).i_value);
+    node_free(block);
+}
+
+static void _clear_dir(const char *dir_path)
+{
+    char path[300];
+    DIR *dir = opendir(dir_path);
+    struct dirent *dp;
+    while (dir && (dp = readdir(dir))) {
+        if (dp->d_name[0] == '.')
+            continue;
+        snprintf(path, sizeof(path), "%s/%s", dir_path, dp->d_name);
+        remove(path);
+    }
+    if (dir)
+        closedir(dir);
+}
+
+//a repl session through its own engine and jit, returns quad_cached(3)
+static int _eval_cached_session(struct compile_cache *cache)
+{
+    char test_code[] = R"(
+def sq_cached(x:int) -> int: x * x
+def quad_cached(x:int) -> int: sq_cached(sq_cached(x))
+quad_cached(3)
+)";
+    struct engine *engine = engine_llvm_new(get_test_env()->sys_path, false);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    cg->target_options.opt_level = LLVM_OPT_O0;
+    struct JIT *jit = jit_new(engine);
+    jit->cache = cache;
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    eval_node(jit, (struct ast_node *)array_get_ptr(&block->block->nodes, 0));
+    eval_node(jit, (struct ast_node *)array_get_ptr(&block->block->nodes, 1));
+    auto call = (struct ast_node *)array_get_ptr(&block->block->nodes, 2);
+    analyze(cg->base.sema_context, call);
+    int result = eval_exp(jit, call).i_value;
+    node_free(block);
+    jit_free(jit);
+    engine_free(engine);
+    return result;
+}
+
+TEST_F(TestFixture, testJITObjectCache)
+{
+    struct compile_cache cache;
+    compile_cache_init(&cache, JIT_CACHE_TEST_DIR, 0);
+    _clear_dir(JIT_CACHE_TEST_DIR);
+    ASSERT_EQ(81, _eval_cached_session(&cache));
+    ASSERT_EQ(0, cache.hits);
+    ASSERT_EQ(3, cache.misses);
+    ASSERT_EQ(3, cache.stores);
+    //the same definitions and expression load the objects the first session compiled
+    ASSERT_EQ(81, _eval_cached_session(&cache));
+    ASSERT_EQ(3, cache.hits);
+    ASSERT_EQ(3, cache.misses);
+    ASSERT_EQ(3, cache.stores);
+    _clear_dir(JIT_CACHE_TEST_DIR);
+    compile_cache_deinit(&cache);
+}
+
 /*TODO: The following operator override is not supported
 TEST_F(TestFixture, testJITUnaryFunc)
 {
@@ -70,6 +70,40 @@ getx()
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITAdtStructAssign)
+{
+    char test_code[] = R"(
+struct Point2D = x:f64, y:f64
+def f(a:f64):
+    let mut p = Point2D { 1.0, 2.0 }
+    let q = Point2D { a, a * 2.0 }
+    p = q
+    p.x + p.y
+f(3.0)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(9.0, eval_module(jit, block).d_value);
+    node_free(block);
+}
+
+TEST_F(TestFixture, testJITAdtStructReturnWithArgs)
+{
+    //the struct is returned by the sret pointer, which is passed before the arguments
+    char test_code[] = R"(
+struct Vec3 = x:f64, y:f64, z:f64
+def mk(a:f64, b:f64): Vec3 { a, b, a + b }
+def f(a:f64):
+    let v = mk(a, 2.0)
+    v.x * 100.0 + v.y * 10.0 + v.z
+f(3.0)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(325.0, eval_module(jit, block).d_value);
+    node_free(block);
+}
+
 // TEST_F(TestFixture, testJITAdtStructEmbedStruct)
 // {
 //     char test_code[] = R"(
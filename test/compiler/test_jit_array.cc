@@ -53,3 +53,37 @@ f()
     ASSERT_EQ(20, eval_module(jit, block).i_value);
     node_free(block);
 }
+
+TEST_F(TestFixture, testJITArrayArray_variable_index)
+{
+    char test_code[] = R"(
+def f(n:int):
+    let a:int[2][3] = [1, 2, 3, 4, 5, 6]
+    let mut sum = 0
+    for i in 0..n:
+        for j in 0..3:
+            sum = sum + a[i][j] * (i + 1)
+    sum
+f(2)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(36, eval_module(jit, block).i_value);
+    node_free(block);
+}
+
+TEST_F(TestFixture, testJITArrayArray_local_array_without_init)
+{
+    char test_code[] = R"(
+def f(n:int):
+    let mut a:int[4]
+    for i in 0..4:
+        a[i] = i * n
+    a[3] + a[1]
+f(5)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    ASSERT_EQ(20, eval_module(jit, block).i_value);
+    node_free(block);
+}
@@ -36,6 +36,26 @@ if_f(10)
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITControlIfElseStatement)
+{
+    //both branches end with an assignment, there is no value to merge
+    char test_code[] = R"(
+def if_f(n:int):
+    let mut x = 0
+    if n > 5:
+        x = n * 2
+    else:
+        x = n + 1
+    x
+if_f(10)
+)";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    eval_result result = eval_module(jit, block);
+    ASSERT_EQ(20, result.i_value);
+    node_free(block);
+}
+
 TEST_F(TestFixture, testJITControlForLoopFunc)
 {
     char test_code[] = R"(
@@ -53,6 +73,47 @@ forloop(5)
     node_free(block);
 }
 
+TEST_F(TestFixture, testJITControlForLoopChangingEnd)
+{
+    //the end is evaluated before each iteration, the constant step does not make it evaluated once
+    char test_code[] = R"(
+def forloop(n:int):
+    let mut last = n
+    let mut count = 0
+    for i in 0..last:
+        last -= 1
+        count += 1
+    count
+forloop(10)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    eval_result result = eval_module(jit, block);
+    ASSERT_EQ(5, result.i_value);
+    node_free(block);
+}
+
+TEST_F(TestFixture, testJITControlForLoopEmptyRange)
+{
+    //the end condition is tested before the first iteration, so an empty range runs no iteration
+    char test_code[] = R"(
+def forloop(n:int):
+    let mut last = n
+    let mut count = 0
+    for i in 0..last - 3:
+        count += 100
+    for j in 0..last:
+        count += 1
+    count
+forloop(3)
+  )";
+    struct ast_node *block = parse_code(engine->fe->parser, test_code);
+    block = split_ast_nodes_with_start_func(0, block);
+    eval_result result = eval_module(jit, block);
+    ASSERT_EQ(3, result.i_value);
+    node_free(block);
+}
+
 TEST_F(TestFixture, testJITControlBreakForLoop)
 {
     char test_code[] = R"(
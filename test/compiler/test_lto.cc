@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * Unit tests for linking the bitcode of modules and optimizing them as one module
+ */
+#include "codegen/llvm/cg_llvm.h"
+#include "compiler/engine.h"
+#include "sema/analyzer.h"
+#include "test_env.h"
+#include "gtest/gtest.h"
+#include "test_fixture.h"
+#include <llvm-c/BitWriter.h>
+#include <string.h>
+
+//the module of the code compiled by its own engine with the lto pre-link pipeline
+static LLVMMemoryBufferRef _compile_bitcode(const char *name, const char *code)
+{
+    struct engine *engine = engine_llvm_new(get_test_env()->sys_path, false);
+    struct cg_llvm *cg = (struct cg_llvm *)engine->be->cg;
+    cg->target_options.lto = true;
+    create_ir_module(cg, name);
+    struct ast_node *block = parse_code(engine->fe->parser, code);
+    analyze(cg->base.sema_context, block);
+    emit_code(cg, block);
+    for (size_t i = 0; i < array_size(&block->block->nodes); i++) {
+        emit_ir_code(cg, (struct ast_node *)array_get_ptr(&block->block->nodes, i));
+    }
+    EXPECT_TRUE(optimize_ir_module(cg));
+    LLVMMemoryBufferRef bitcode = LLVMWriteBitcodeToMemoryBuffer(cg->module);
+    node_free(block);
+    engine_free(engine);
+    return bitcode;
+}
+
+TEST_F(TestFixture, testLTOInlinesCallAcrossModules)
+{
+    LLVMMemoryBufferRef bitcodes[2];
+    bitcodes[0] = _compile_bitcode("lib", "def sq(x:int) -> int: x * x");
+    bitcodes[1] = _compile_bitcode("main", R"(
+from lib import func sq(x:int) -> int
+def quad(x:int) -> int: sq(sq(x))
+)");
+    LLVMContextRef context = LLVMContextCreate();
+    LLVMModuleRef module = link_bitcode_modules(context, bitcodes, 2);
+    LLVMDisposeMemoryBuffer(bitcodes[0]);
+    LLVMDisposeMemoryBuffer(bitcodes[1]);
+    ASSERT_TRUE(module);
+    LLVMTargetDataRef target_data;
+    LLVMTargetMachineRef target_machine = create_target_machine(module, 0, &target_data);
+    ASSERT_TRUE(run_ir_pipeline(module, target_machine, LLVM_OPT_O2, LLVM_PIPELINE_LTO));
+    LLVMValueRef quad = LLVMGetNamedFunction(module, "quad");
+    ASSERT_TRUE(quad);
+    char *ir = LLVMPrintValueToString(quad);
+    ASSERT_EQ(0, strstr(ir, "call"));
+    LLVMDisposeMessage(ir);
+    LLVMDisposeTargetData(target_data);
+    LLVMDisposeTargetMachine(target_machine);
+    LLVMDisposeModule(module);
+    LLVMContextDispose(context);
+}
+
+TEST_F(TestFixture, testLTOSymbolDefinedTwice)
+{
+    LLVMMemoryBufferRef bitcodes[2];
+    bitcodes[0] = _compile_bitcode("lib", "def sq(x:int) -> int: x * x");
+    bitcodes[1] = _compile_bitcode("lib2", "def sq(x:int) -> int: x + x");
+    LLVMContextRef context = LLVMContextCreate();
+    ASSERT_EQ(0, link_bitcode_modules(context, bitcodes, 2));
+    LLVMDisposeMemoryBuffer(bitcodes[0]);
+    LLVMDisposeMemoryBuffer(bitcodes[1]);
+    LLVMContextDispose(context);
+}
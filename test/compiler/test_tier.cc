@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * Unit tests for tiered execution, interpreted first and the hot functions jitted
+ */
+#include "codegen/llvm/cg_llvm.h"
+#include "compiler/engine.h"
+#include "compiler/tier.h"
+#include "sema/analyzer.h"
+#include "test_env.h"
+#include "gtest/gtest.h"
+#include "test_fixture.h"
+
+//each tier evaluates one module with its own engine
+static struct tier *_tier_new()
+{
+    return tier_new(engine_llvm_new(get_test_env()->sys_path, false));
+}
+
+static struct eval_result _tier_eval(struct tier *tier, const char *code)
+{
+    struct ast_node *block = split_ast_nodes_with_start_func(0, parse_code(tier->engine->fe->parser, code));
+    struct eval_result result = tier_eval_module(tier, block);
+    node_free(block);
+    return result;
+}
+
+static void _tier_free(struct tier *tier)
+{
+    struct engine *engine = tier->engine;
+    tier_free(tier);
+    engine_free(engine);
+}
+
+TEST_F(TestFixture, testTierInterpretsModule)
+{
+    struct tier *tier = _tier_new();
+    struct eval_result result = _tier_eval(tier, R"(
+let x = 10
+x * 4 + 2
+)");
+    ASSERT_EQ(TYPE_INT, result.type);
+    ASSERT_EQ(42, result.i_value);
+    ASSERT_TRUE(tier->is_interpreted);
+    ASSERT_EQ(0, tier->jit);
+    _tier_free(tier);
+}
+
+TEST_F(TestFixture, testTierPromotesHotFunctions)
+{
+    struct tier *tier = _tier_new();
+    struct eval_result result = _tier_eval(tier, R"(
+def sq(x:int) -> int: x * x
+def scale(x:f64, k:int) -> f64: x * (f64)k
+def is_odd(x:int) -> bool: x % 2 == 1
+let mut sum = 0
+let mut total = 0.0
+let mut odds = 0
+for i in 0..20000:
+    sum += sq(i) % 7
+    total += scale(0.5, i)
+    if is_odd(i):
+        odds++
+sum + (int)total + odds
+)");
+    int expected = 0, odds = 0;
+    double total = 0.0;
+    for (int i = 0; i < 20000; i++) {
+        expected += i * i % 7;
+        total += 0.5 * i;
+        odds += i % 2 == 1;
+    }
+    expected += (int)total + odds;
+    ASSERT_EQ(expected, result.i_value);
+    ASSERT_TRUE(tier->is_interpreted);
+    ASSERT_NE(nullptr, tier->jit);
+    ASSERT_EQ(3, tier->interp.promotions);
+    _tier_free(tier);
+}
+
+TEST_F(TestFixture, testTierFallsBackToJIT)
+{
+    struct tier *tier = _tier_new();
+    struct eval_result result = _tier_eval(tier, R"(
+struct Point2D = x:int, y:int
+let xy:Point2D = Point2D { 10, 20 }
+xy.y
+)");
+    ASSERT_EQ(20, result.i_value);
+    ASSERT_FALSE(tier->is_interpreted);
+    ASSERT_NE(nullptr, tier->jit);
+    _tier_free(tier);
+}
+
+static const char *deep_recursion = R"(
+def down(n:int) -> int:
+    if n == 0:
+        0
+    else:
+        down(n - 1) + 1
+down(10000)
+)";
+
+TEST_F(TestFixture, testTierPromotesRecursion)
+{
+    struct tier *tier = _tier_new();
+    //deeper than the interpreter stack, the recursion goes on natively once it is promoted
+    tier->interp.hot_threshold = 1000;
+    struct eval_result result = _tier_eval(tier, deep_recursion);
+    ASSERT_EQ(10000, result.i_value);
+    ASSERT_TRUE(tier->is_interpreted);
+    ASSERT_EQ(1, tier->interp.promotions);
+    _tier_free(tier);
+}
+
+TEST_F(TestFixture, testTierOutOfStackRunsInJIT)
+{
+    struct tier *tier = _tier_new();
+    tier->interp.hot_threshold = 0;
+    struct eval_result result = _tier_eval(tier, deep_recursion);
+    ASSERT_EQ(10000, result.i_value);
+    ASSERT_FALSE(tier->is_interpreted);
+    _tier_free(tier);
+}
@@ -623,6 +623,65 @@ TEST(test_lexer, mut_let_variable)
     frontend_deinit(fe);
 }
 
+static string _gen_large_code(size_t min_size)
+{
+    string code;
+    string_init_chars(&code, "");
+    char line[256];
+    for(int i = 0; string_size(&code) < min_size; i++){
+        sprintf(line, "let var_%d = %d + 0x%x * %d.5 // comment %d\n", i, i, i, i, i);
+        string_add_chars(&code, line);
+        if(i % 500 == 0){
+            //a string literal and a block comment longer than the stream window
+            string_add_chars(&code, "let s = \"");
+            for(int j = 0; j < LEXER_STREAM_CHUNK; j++) string_push(&code, (char)('a' + j % 26));
+            string_add_chars(&code, "\"\n/*");
+            for(int j = 0; j < LEXER_STREAM_CHUNK; j++) string_push(&code, j % 80 ? '*' : '\n');
+            string_add_chars(&code, "*/\n");
+        }
+    }
+    return code;
+}
+
+TEST(test_lexer, large_code_stream_and_in_memory)
+{
+    struct frontend *fe = frontend_init();
+    string code = _gen_large_code(256 * 1024);
+    const char *text = string_get(&code);
+    struct lexer *mem_lexer = lexer_new_with_string(text);
+    struct lexer *stream_lexer = lexer_new_for_string(text);
+    struct token *tok, *stream_tok;
+    int tokens = 0;
+    do {
+        tok = get_tok(mem_lexer);
+        stream_tok = get_tok(stream_lexer);
+        ASSERT_EQ(tok->token_type, stream_tok->token_type);
+        ASSERT_EQ(tok->loc.start, stream_tok->loc.start);
+        ASSERT_EQ(tok->loc.end, stream_tok->loc.end);
+        ASSERT_EQ(tok->loc.line, stream_tok->loc.line);
+        ASSERT_EQ(tok->loc.col, stream_tok->loc.col);
+        if(tok->token_type == TOKEN_IDENT){
+            ASSERT_EQ(tok->symbol_val, stream_tok->symbol_val);
+            ASSERT_TRUE(!strncmp(&text[tok->loc.start], string_get(tok->symbol_val), tok->loc.end - tok->loc.start));
+        } else if(tok->token_type == TOKEN_LITERAL_INT){
+            ASSERT_EQ(tok->int_val, stream_tok->int_val);
+        } else if(tok->token_type == TOKEN_LITERAL_STRING){
+            ASSERT_STREQ(tok->str_val, stream_tok->str_val);
+            tok_clean(tok);
+            tok_clean(stream_tok);
+        }
+        tokens++;
+    } while(tok->token_type != TOKEN_EOF && tok->token_type != TOKEN_NULL);
+    ASSERT_EQ(TOKEN_EOF, tok->token_type);
+    ASSERT_TRUE(tokens > 10000);
+    //the stream window stays bounded by the longest token, not by the code size
+    ASSERT_TRUE(stream_lexer->stream_cap < 8 * LEXER_STREAM_CHUNK);
+    lexer_free(mem_lexer);
+    lexer_free(stream_lexer);
+    string_deinit(&code);
+    frontend_deinit(fe);
+}
+
 int test_lexer(void)
 {
     UNITY_BEGIN();
@@ -658,6 +717,7 @@ int test_lexer(void)
     RUN_TEST(test_lexer_highlight_block_comment);
     RUN_TEST(test_lexer_highlight_code_multi_lines);
     RUN_TEST(test_lexer_mut_let_variable);
+    RUN_TEST(test_lexer_large_code_stream_and_in_memory);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
@@ -63,12 +63,40 @@ TEST(test_ast_dump, func_type_no_parameter)
     frontend_deinit(fe);
 }
 
+TEST(test_ast, arena_nodes)
+{
+    struct frontend *fe = frontend_init();
+    struct parser *parser = parser_new();
+    struct sema_context *context = sema_context_new(parser->tc, 0, false);
+    struct arena arena;
+    arena_init(&arena);
+    struct arena *prev_arena = ast_set_arena(&arena);
+    struct ast_node *block = parse_code(parser, "x = 10 + 20");
+    ast_set_arena(prev_arena);
+    analyze(context, block);
+    struct ast_node *node = (struct ast_node *)array_front_ptr(&block->block->nodes);
+    ASSERT_TRUE(block->is_arena_alloc);
+    ASSERT_TRUE(node->is_arena_alloc);
+    ASSERT_TRUE(arena.allocated > 0);
+    //nodes created without the arena are allocated from the heap
+    struct source_location loc = {0, 0, 0, 0};
+    struct ast_node *heap_node = ast_node_new(NULL_NODE, loc);
+    ASSERT_FALSE(heap_node->is_arena_alloc);
+    node_free(heap_node);
+    node_free(block);
+    sema_context_free(context);
+    parser_free(parser);
+    arena_deinit(&arena);
+    frontend_deinit(fe);
+}
+
 int test_ast(void)
 {
     UNITY_BEGIN();
     RUN_TEST(test_ast_node_type_names);
     RUN_TEST(test_ast_dump_prototype);
     RUN_TEST(test_ast_dump_func_type_no_parameter);
+    RUN_TEST(test_ast_arena_nodes);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
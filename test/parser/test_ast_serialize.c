@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2023 Ligang Wang <ligangwangs@gmail.com>
+ *
+ * Unit tests for binary ast save/load
+ */
+#include "parser/ast_serialize.h"
+#include "parser/parser.h"
+#include "sema/frontend.h"
+#include "codegen/wasm/cg_wasm.h"
+#include "compiler/engine.h"
+#include "clib/hash.h"
+#include "test.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *test_programs[] = {
+    "let x = 11\nx",
+    "\n\
+let mut a:u8[2][3]\n\
+for x in 0..3:\n\
+    for y in 0..2:\n\
+        a[y][x] = x + y\n\
+let mut i = 10\n\
+while i > 0:\n\
+    i--\n\
+    if i == 3: break\n\
+a[1][2]\n\
+",
+    "\n\
+let scale = 0.01, max_iter = 510\n\
+let mut v = 0.0, r = 0.0\n\
+let n = 100\n\
+if n < max_iter:\n\
+    v = (log(n+1.5-(log2((log(scale))/2.0))))/3.4\n\
+    if v < 1.0:\n\
+        r = v ** 4\n\
+    else:\n\
+        v = v < 2.0 ? 2.0 - v : 0.0\n\
+let c = (u8)v\n\
+r\n\
+",
+    "\n\
+struct Point2D = x:mut f64, y:f64\n\
+def change(z:Point2D): \n\
+    z.x = z.x * 10.0\n\
+    z\n\
+let mut old_z = Point2D{10.0, 20.0}\n\
+let new_z = change(old_z)\n\
+let i = 10\n\
+let j = &i\n\
+new_z.x\n\
+",
+    "variant A = x:int | y:int\nlet a = A { 10 }\na.y\n",
+    "\n\
+def sq(x): x * x //comments \n\
+def pm(x):\n\
+    match x with\n\
+    | -1 -> 100\n\
+    | 3 -> 200\n\
+    | y -> y + 300\n\
+print(\"%d %s\\n\", pm(-1), \"ok\")\n\
+sq(10.0)\n\
+",
+    "\n\
+def a(t:(int, int)): (100+t[0], 200+t[1])\n\
+let x, y = a((100, 200))\n\
+let mut b:u8[2] = [10, 20]\n\
+b[0] = 30\n\
+x + y\n\
+",
+};
+
+//one or more of each node kind the parser produces, these are saved and loaded without compiling them
+static const char *node_kind_programs[] = {
+    "from sys import memory 2, 10\nfrom sys import func print () -> None\nfrom sys import __stack_pointer:int\n",
+    "func printf(__format:string, ...) -> int\n",
+    "type RGB = (u8, u8, u8)\ntype Shape = int | f64 * f64\n",
+    "struct Point2D = x:f64, y:&f64\nlet xy = new Point2D{0.0, 0.0}\ndel xy\n",
+    "\n\
+variant XY = \n\
+    | Rectangle(width:f64, height:f64) \n\
+    | Square(f64) \n\
+    | Empty\n\
+    | Tag = 3\n\
+",
+    "\n\
+def f(x:int) -> int:\n\
+    match x with\n\
+    | 0 -> 1\n\
+    | y when y > 10 -> y\n\
+    | _ -> 3\n\
+",
+    "\n\
+def g(n:int) -> int:\n\
+    let mut sum = 0\n\
+    for i in n..-1..0:\n\
+        if i % 2 == 0: continue\n\
+        elif i > 100: return 0\n\
+        sum += (int)(f64)i << 1\n\
+    let a = [for j in 0..10: j * 2]\n\
+    let b = [0..4]\n\
+    let mut c:int[2][3]\n\
+    c[1][2] = ~sum ^ 3 | a[2] & b[1]\n\
+    not (sum >= 1 or sum != 2) and sum <= 3 ? -sum : |/ sum\n\
+",
+};
+
+static u8 *_compile(struct engine *engine, const u8 *data, size_t size, const char *text, u32 *module_size)
+{
+    struct cg_wasm *cg = (struct cg_wasm *)engine->be->cg;
+    u8 *module = data ? compile_ast_to_wasm(engine, data, size) : compile_to_wasm(engine, text);
+    *module_size = cg->ba.size;
+    cg->ba.data = 0;
+    return module;
+}
+
+TEST(test_ast_serialize, round_trip)
+{
+    struct frontend *fe = frontend_init();
+    struct engine *engine = engine_wasm_new();
+    for (size_t i = 0; i < ARRAY_SIZE(test_programs); i++) {
+        struct ast_node *block = parse_code(fe->parser, test_programs[i]);
+        ASSERT_TRUE(block != 0);
+        struct byte_array saved, resaved;
+        ba_init(&saved, 256);
+        ba_init(&resaved, 256);
+        ASSERT_TRUE(ast_serialize(fe->parser->tc, block, &saved));
+        struct ast_node *loaded = ast_deserialize(fe->parser->tc, saved.data, saved.size);
+        ASSERT_TRUE(loaded != 0);
+        ASSERT_TRUE(ast_serialize(fe->parser->tc, loaded, &resaved));
+        ASSERT_EQ(saved.size, resaved.size);
+        ASSERT_EQ(0, memcmp(saved.data, resaved.data, saved.size));
+        //the loaded tree compiles to the same module as the source text
+        u32 parsed_size, loaded_size;
+        u8 *parsed = _compile(engine, 0, 0, test_programs[i], &parsed_size);
+        u8 *compiled = _compile(engine, saved.data, saved.size, 0, &loaded_size);
+        ASSERT_TRUE(parsed && compiled);
+        ASSERT_EQ(parsed_size, loaded_size);
+        ASSERT_EQ(0, memcmp(parsed, compiled, parsed_size));
+        FREE(parsed);
+        FREE(compiled);
+        node_free(loaded);
+        node_free(block);
+        ba_deinit(&resaved);
+        ba_deinit(&saved);
+    }
+    engine_free(engine);
+    frontend_deinit(fe);
+}
+
+//the records of a saved tree, see the layout in parser/ast_serialize.h
+static struct ast_record *_records(struct byte_array *saved)
+{
+    struct ast_file_header *header = (struct ast_file_header *)saved->data;
+    return (struct ast_record *)(saved->data + sizeof(*header) + (header->name_count + header->list_size) * sizeof(u32));
+}
+
+TEST(test_ast_serialize, node_kinds)
+{
+    struct frontend *fe = frontend_init();
+    bool saved_kinds[TOTAL_NODE] = { false };
+    for (size_t i = 0; i < ARRAY_SIZE(test_programs) + ARRAY_SIZE(node_kind_programs); i++) {
+        const char *code = i < ARRAY_SIZE(test_programs) ? test_programs[i] : node_kind_programs[i - ARRAY_SIZE(test_programs)];
+        struct ast_node *block = parse_code(fe->parser, code);
+        TEST_ASSERT_NOT_NULL_MESSAGE(block, code);
+        struct byte_array saved, resaved;
+        ba_init(&saved, 256);
+        ba_init(&resaved, 256);
+        TEST_ASSERT_TRUE_MESSAGE(ast_serialize(fe->parser->tc, block, &saved), code);
+        struct ast_node *loaded = ast_deserialize(fe->parser->tc, saved.data, saved.size);
+        TEST_ASSERT_NOT_NULL_MESSAGE(loaded, code);
+        ASSERT_TRUE(ast_serialize(fe->parser->tc, loaded, &resaved));
+        ASSERT_EQ(saved.size, resaved.size);
+        TEST_ASSERT_EQUAL_MEMORY_MESSAGE(saved.data, resaved.data, saved.size, code);
+        struct ast_record *records = _records(&saved);
+        for (u32 r = 0; r < ((struct ast_file_header *)saved.data)->node_count; r++) {
+            saved_kinds[records[r].node_type] = true;
+        }
+        node_free(loaded);
+        node_free(block);
+        ba_deinit(&resaved);
+        ba_deinit(&saved);
+    }
+    //a node kind added to the parser needs a program here
+    for (int kind = NULL_NODE + 1; kind < TOTAL_NODE; kind++) {
+        if (kind != TOKEN_NODE)
+            TEST_ASSERT_TRUE_MESSAGE(saved_kinds[kind], node_type_strings[kind]);
+    }
+    frontend_deinit(fe);
+}
+
+TEST(test_ast_serialize, reject_corrupted)
+{
+    struct frontend *fe = frontend_init();
+    struct ast_node *block = parse_code(fe->parser, test_programs[1]);
+    struct byte_array saved;
+    ba_init(&saved, 256);
+    ASSERT_TRUE(ast_serialize(fe->parser->tc, block, &saved));
+    struct ast_file_header *header = (struct ast_file_header *)saved.data;
+    ASSERT_EQ(0, ast_deserialize(fe->parser->tc, saved.data, saved.size - 1));
+    saved.data[saved.size - 2] ^= 0x5a;
+    ASSERT_EQ(0, ast_deserialize(fe->parser->tc, saved.data, saved.size));
+    saved.data[saved.size - 2] ^= 0x5a;
+    header->version++;
+    ASSERT_EQ(0, ast_deserialize(fe->parser->tc, saved.data, saved.size));
+    header->version--;
+    //a reference to a later record is refused even with a matching checksum
+    struct ast_record *records = _records(&saved);
+    records[0].refs[0] = header->node_count;
+    records[0].node_type = UNARY_NODE;
+    header->checksum = hash64(saved.data + sizeof(*header), saved.size - sizeof(*header));
+    ASSERT_EQ(0, ast_deserialize(fe->parser->tc, saved.data, saved.size));
+    ba_deinit(&saved);
+    node_free(block);
+    frontend_deinit(fe);
+}
+
+int test_ast_serialize(void)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_ast_serialize_round_trip);
+    RUN_TEST(test_ast_serialize_node_kinds);
+    RUN_TEST(test_ast_serialize_reject_corrupted);
+    test_stats.total_failures += Unity.TestFailures;
+    test_stats.total_tests += Unity.NumberOfTests;
+    return UNITY_END();
+}
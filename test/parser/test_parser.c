@@ -785,6 +785,19 @@ TEST(test_parser, multiple_statements_on_one_line)
     frontend_deinit(fe);
 }
 
+TEST(test_parser, reuse_parser)
+{
+    char test_code[] = "let a = 10; let b = 20";
+    struct frontend *fe = frontend_init();
+    for (int i = 0; i < 2 * MAX_STATES; i++) {
+        struct ast_node *block = parse_code(fe->parser, test_code);
+        ASSERT_EQ(2, array_size(&block->block->nodes));
+        node_free(block);
+    }
+    ASSERT_EQ(0, fe->parser->stack_top);
+    frontend_deinit(fe);
+}
+
 int test_parser(void)
 {
     UNITY_BEGIN();
@@ -829,6 +842,7 @@ int test_parser(void)
     RUN_TEST(test_parser_onebytwo_array_variable);
     RUN_TEST(test_parser_twobytwo_array_variable);
     RUN_TEST(test_parser_multiple_statements_on_one_line);
+    RUN_TEST(test_parser_reuse_parser);
     test_stats.total_failures += Unity.TestFailures;
     test_stats.total_tests += Unity.NumberOfTests;
     return UNITY_END();
@@ -121,6 +121,17 @@ let a = []\n\
     frontend_deinit(fe);
 }
 
+TEST(test_analyzer, empty_block)
+{
+    //e.g. start function of a module having definitions only
+    struct frontend *fe = frontend_init();
+    struct ast_node *block = block_node_new_empty();
+    analyze(fe->sema_context, block);
+    ASSERT_EQ(TYPE_UNIT, get_type(fe->sema_context->tc, block->type));
+    node_free(block);
+    frontend_deinit(fe);
+}
+
 TEST(test_analyzer, int_variable)
 {
     char test_code[] = "let x = 11";
@@ -409,6 +420,50 @@ def loopprint(n): \n\
     frontend_deinit(fe);
 }
 
+TEST(test_analyzer, const_range_loop)
+{
+    char test_code[] = "\n\
+def loops(n): \n\
+  let mut sum = 0\n\
+  for i in 0..n:\n\
+    sum += i\n\
+  for j in 10..-3..0:\n\
+    sum += j\n\
+  for k in 0..2..9:\n\
+    if k == 6:\n\
+      break\n\
+    sum += k\n\
+  for m in 0..sum:\n\
+    sum -= 1\n\
+  sum\n\
+";
+    struct frontend *fe = frontend_init();
+    struct ast_node *block = parse_code(fe->parser, test_code);
+    analyze(fe->sema_context, block);
+    struct ast_node *node = array_front_ptr(&block->block->nodes);
+    struct ast_node *forn = array_get_ptr(&node->func->body->block->nodes, 1);
+    ASSERT_EQ(FOR_NODE, forn->node_type);
+    ASSERT_EQ(1, forn->forloop->step_sign);
+    ASSERT_EQ(-1, forn->forloop->trip_count);
+    ASSERT_TRUE(forn->forloop->is_end_invariant);
+    forn = array_get_ptr(&node->func->body->block->nodes, 2);
+    ASSERT_EQ(FOR_NODE, forn->node_type);
+    ASSERT_EQ(-1, forn->forloop->step_sign);
+    ASSERT_EQ(4, forn->forloop->trip_count);
+    forn = array_get_ptr(&node->func->body->block->nodes, 3);
+    ASSERT_EQ(FOR_NODE, forn->node_type);
+    ASSERT_EQ(1, forn->forloop->step_sign);
+    ASSERT_EQ(-1, forn->forloop->trip_count);
+    ASSERT_TRUE(forn->forloop->is_end_invariant);
+    //the end is a mutable variable
+    forn = array_get_ptr(&node->func->body->block->nodes, 4);
+    ASSERT_EQ(FOR_NODE, forn->node_type);
+    ASSERT_EQ(1, forn->forloop->step_sign);
+    ASSERT_FALSE(forn->forloop->is_end_invariant);
+    node_free(block);
+    frontend_deinit(fe);
+}
+
 TEST(test_analyzer, float_var_loop)
 {
     char test_code[] = "\n\
@@ -720,6 +775,7 @@ int test_analyzer(void)
     RUN_TEST(test_analyzer_array_type_decl);
     RUN_TEST(test_analyzer_array_type_decl_use_const_value);
     RUN_TEST(test_analyzer_empty_array);
+    RUN_TEST(test_analyzer_empty_block);
     RUN_TEST(test_analyzer_int_variable);
     RUN_TEST(test_analyzer_double_variable);
     RUN_TEST(test_analyzer_bool_fun);
@@ -731,6 +787,7 @@ int test_analyzer(void)
     RUN_TEST(test_analyzer_empty_array);
     RUN_TEST(test_analyzer_float_var_loop);
     RUN_TEST(test_analyzer_for_loop_fun);
+    RUN_TEST(test_analyzer_const_range_loop);
     RUN_TEST(test_analyzer_fun_type_annotation);
     RUN_TEST(test_analyzer_fun_type_with_ret_type);
     RUN_TEST(test_analyzer_greater_than);
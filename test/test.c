@@ -13,6 +13,7 @@
 struct test_stats test_stats = { 0, 0 };
 
 int test_array(void);
+int test_arena(void);
 int test_byte_array(void);
 int test_hashset(void);
 int test_hashtable(void);
@@ -24,6 +25,7 @@ int test_symbol(void);
 int test_symboltable(void);
 int test_util(void);
 int test_regex(void);
+int test_thread(void);
 
 int test_token(void);
 int test_lexer(void);
@@ -36,6 +38,7 @@ int test_parser_type(void);
 int test_parser_struct(void);
 int test_parser_variant(void);
 int test_parser_error(void);
+int test_ast_serialize(void);
 int test_grammar(void);
 int test_analyzer(void);
 int test_analyzer_mut(void);
@@ -46,6 +49,10 @@ int test_analyzer_variant(void);
 int test_analyzer_pm(void);
 int test_type_size_info(void);
 int test_wasm_codegen(void);
+#ifndef WASM
+int test_compile_cache(void);
+int test_interp(void);
+#endif
 
 void setUp(void){}
 void tearDown(void){}
@@ -56,6 +63,7 @@ EXPORT int ENTRY(void)
   int failures = 0;
   app_init();
   failures += test_array();
+  failures += test_arena();
   failures += test_byte_array();
   failures += test_hashset();
   failures += test_hashtable();
@@ -67,6 +75,7 @@ EXPORT int ENTRY(void)
   failures += test_symboltable();
   failures += test_util();
   failures += test_regex();
+  failures += test_thread();
 
   failures += test_token();
   failures += test_lexer();
@@ -80,6 +89,7 @@ EXPORT int ENTRY(void)
   failures += test_parser_variant();
   failures += test_parser_error();
   failures += test_grammar();
+  failures += test_ast_serialize();
   failures += test_analyzer();
   failures += test_analyzer_struct();
   failures += test_analyzer_type();
@@ -89,6 +99,10 @@ EXPORT int ENTRY(void)
   failures += test_analyzer_errors();
   failures += test_type_size_info();
   failures += test_wasm_codegen();
+#ifndef WASM
+  failures += test_compile_cache();
+  failures += test_interp();
+#endif
   if (!failures)
     printf("%d/%d Unit tests passed !\n", test_stats.total_tests - test_stats.total_failures, test_stats.total_tests);
   else
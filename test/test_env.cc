@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <cstdio>
+#include <cstdlib>
 
 #include "gtest/gtest.h"
 #include "test_env.h"
@@ -72,8 +73,22 @@ GTEST_API_ int main(int argc, char **argv) {
   return RUN_ALL_TESTS();
 }
 
+TestEnvironment::TestEnvironment(const char *sys_path) : sys_path(sys_path) {
+    //a warm cache skips codegen, so the tests only use one when MTEST_JIT_CACHE names its dir
+    jit_cache_dir = getenv("MTEST_JIT_CACHE");
+    if (jit_cache_dir)
+        compile_cache_init(&jit_cache, jit_cache_dir, 0);
+}
+
 TestEnvironment::~TestEnvironment() {
-    // Implementation of virtual destructor
+    if (!jit_cache_dir)
+        return;
+    printf("jit cache %s: %zu hits, %zu misses, %zu stored\n", jit_cache_dir, jit_cache.hits, jit_cache.misses, jit_cache.stores);
+    compile_cache_deinit(&jit_cache);
+}
+
+struct compile_cache *TestEnvironment::get_jit_cache() {
+    return jit_cache_dir ? &jit_cache : 0;
 }
 
 void TestEnvironment::setUp() {
@@ -1,5 +1,6 @@
 #include "compiler/repl.h"
 #include "compiler/engine.h"
+#include "compiler/compile_cache.h"
 #include "codegen/llvm/cg_llvm.h"
 #include "gtest/gtest.h"
 #include "app/app.h"
@@ -7,8 +8,11 @@
 class TestEnvironment : public testing::Environment {
  public:
     const char *sys_path = 0;
-    TestEnvironment(const char *sys_path) : sys_path(sys_path) {}
+    const char *jit_cache_dir = 0; //MTEST_JIT_CACHE, 0 if the jit tests compile every module
+    struct compile_cache jit_cache; //objects the jit tests compiled, loaded again by the next run
+    TestEnvironment(const char *sys_path);
     virtual ~TestEnvironment(); // Declare destructor as virtual
+    struct compile_cache *get_jit_cache(); // 0 unless MTEST_JIT_CACHE is set
     virtual void setUp();       // A virtual method to set up the test environment
     virtual void tearDown();    // A virtual method to tear down the test environment    
 };
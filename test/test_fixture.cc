@@ -9,6 +9,7 @@ void TestFixture::SetUp()
   app_init();
   engine = CreateEngine();
   jit = jit_new(engine);
+  jit->cache = get_test_env()->get_jit_cache();
 }
 
 void TestFixture::TearDown() 
@@ -22,7 +23,10 @@ void TestFixture::TearDown()
 
 struct engine* TestFixture::CreateEngine() 
 {
-  return engine_llvm_new(get_test_env()->sys_path, false);
+  struct engine *engine = engine_llvm_new(get_test_env()->sys_path, false);
+  //each test module runs once, the jit compiles it without optimizing
+  ((struct cg_llvm *)engine->be->cg)->target_options.opt_level = LLVM_OPT_O0;
+  return engine;
 }
 
 struct engine* TestFixture2::CreateEngine() 
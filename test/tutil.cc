@@ -28,7 +28,7 @@ void make_module_llvmir(const char *module_name, const char *ir_string, char *mo
     LLVMContextRef context = LLVMContextCreate();
     LLVMModuleRef module = LLVMModuleCreateWithNameInContext(module_name, context);
     LLVMTargetDataRef data_layout;;
-    LLVMTargetMachineRef target_machine = create_target_machine(module, &data_layout);
+    LLVMTargetMachineRef target_machine = create_target_machine(module, 0, &data_layout);
     const char *target_triple = LLVMGetDefaultTargetTriple();
     sprintf(module_ir, R"(; ModuleID = '%s'
 source_filename = "%s"